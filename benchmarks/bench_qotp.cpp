@@ -0,0 +1,701 @@
+#include <benchmark/benchmark.h>
+
+#include <QBuffer>
+#include <QTemporaryDir>
+
+#include <libqotp/asyncverifier.h>
+#include <libqotp/batch.h>
+#include <libqotp/clock.h>
+#include <libqotp/counterlog.h>
+#include <libqotp/core/otp.h>
+#include <libqotp/hmacbackend.h>
+#include <libqotp/keystore.h>
+#include <libqotp/otp.h>
+#include <libqotp/otpauth.h>
+#include <libqotp/qotp.h>
+#include <libqotp/replaystore.h>
+#include <libqotp/secrets.h>
+#include <libqotp/throttle.h>
+#include <libqotp/totpcache.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Benchmarks for every public entry point.
+//
+// Besides the time per operation, every benchmark reports:
+//   allocs/op  heap allocations per call, counted by the replaced global operator new below
+//   codes/s    generated or verified codes per second and thread
+//
+// Machine readable results for regression tracking:
+//   bench_qotp --benchmark_out=bench.json --benchmark_out_format=json
+
+namespace
+{
+   // Allocations made by the current thread. Thread-local, so multi-threaded runs do not share a counter.
+   thread_local std::size_t allocations = 0;
+
+   const QByteArray sha1Secret("12345678901234567890");
+   const QByteArray sha256Secret("12345678901234567890123456789012");
+   const QByteArray sha512Secret("1234567890123456789012345678901234567890123456789012345678901234");
+   const quint64 now = 1111111109;
+
+   QCryptographicHash::Algorithm algorithm_from(std::int64_t value)
+   {
+      return static_cast<QCryptographicHash::Algorithm>(value);
+   }
+
+   QByteArray secret_for(QCryptographicHash::Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case QCryptographicHash::Sha256:
+         return sha256Secret;
+      case QCryptographicHash::Sha512:
+         return sha512Secret;
+      default:
+         return sha1Secret;
+      }
+   }
+
+   // A Base32 string that decodes to 'length' bytes
+   QString base32_of_length(std::int64_t length)
+   {
+      static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+      const std::int64_t characters = (length * 8 + 4) / 5;
+
+      QString result;
+      for (std::int64_t i = 0; i < characters; ++i)
+      {
+         result.append(QLatin1Char(alphabet[(i * 7) % 32]));
+      }
+      return result;
+   }
+
+   // Runs 'function' once per iteration and reports allocations and codes per second.
+   template <typename Function>
+   void measure(benchmark::State &state, std::int64_t codesPerCall, Function function)
+   {
+      const std::size_t before = allocations;
+      for (auto _ : state)
+      {
+         benchmark::DoNotOptimize(function());
+      }
+
+      const double iterations = static_cast<double>(state.iterations());
+      state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(allocations - before) / iterations, benchmark::Counter::kAvgThreads);
+      state.counters["codes/s"] = benchmark::Counter(iterations * codesPerCall, benchmark::Counter::kIsRate);
+   }
+
+   void algorithms(benchmark::internal::Benchmark *benchmark)
+   {
+      benchmark->ArgName("algorithm");
+      for (QCryptographicHash::Algorithm algorithm : {QCryptographicHash::Sha1, QCryptographicHash::Sha256, QCryptographicHash::Sha512})
+      {
+         benchmark->Arg(algorithm);
+      }
+   }
+
+   // Single-key entry points also run on several threads to show contention in shared state
+   void algorithms_threaded(benchmark::internal::Benchmark *benchmark)
+   {
+      algorithms(benchmark);
+      benchmark->ThreadRange(1, 8)->UseRealTime();
+   }
+}
+
+// Counting allocator. Replaces the global operators for the whole benchmark binary.
+// GCC cannot tell that the replaced new and delete belong together and warns about malloc/free.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size)
+{
+   ++allocations;
+   if (void *pointer = std::malloc(size ? size : 1))
+   {
+      return pointer;
+   }
+   throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+   std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+   std::free(pointer);
+}
+
+// HOTP
+
+static void bench_hotp(benchmark::State &state)
+{
+   const auto algorithm = algorithm_from(state.range(0));
+   const QByteArray secret = secret_for(algorithm);
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp(secret, counter++, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, algorithm); });
+}
+BENCHMARK(bench_hotp)->Apply(algorithms_threaded);
+
+static void bench_hotp_otpkey(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp(key, counter++); });
+}
+BENCHMARK(bench_hotp_otpkey)->Apply(algorithms_threaded);
+
+static void bench_hotp_value(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp_value(key, counter++); });
+}
+BENCHMARK(bench_hotp_value)->Apply(algorithms_threaded);
+
+static void bench_hotp_value_secret(benchmark::State &state)
+{
+   const auto algorithm = algorithm_from(state.range(0));
+   const QByteArray secret = secret_for(algorithm);
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp_value(secret, counter++, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, algorithm); });
+}
+BENCHMARK(bench_hotp_value_secret)->Apply(algorithms);
+
+static void bench_hotp_buffer(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   char buffer[8];
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp(key, counter++, std::span<char>(buffer)); });
+}
+BENCHMARK(bench_hotp_buffer)->Apply(algorithms);
+
+// A run of 1024 consecutive codes per call, each written into the same buffer; compare with bench_hotp_buffer
+static void bench_hotp_range(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   char buffer[8];
+   quint64 counter = 0;
+   measure(state, 1024, [&]() {
+      std::size_t written = 0;
+      const libqotp::core::HotpRange codes = libqotp::hotp_range(key, counter, 1024);
+      for (auto it = codes.begin(); it != codes.end(); ++it)
+      {
+         written += it.write(buffer);
+      }
+      counter += 1024;
+      return written;
+   });
+}
+BENCHMARK(bench_hotp_range)->Apply(algorithms);
+
+// The Qt-free core, without the QString and OtpKey layer
+static void bench_core_hotp(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   const libqotp::core::Key &coreKey = key.coreKey();
+   char buffer[8];
+   std::uint64_t counter = 0;
+   measure(state, 1, [&]() { return libqotp::core::hotp(coreKey, counter++, std::span<char>(buffer)); });
+}
+BENCHMARK(bench_core_hotp)->Apply(algorithms);
+
+// Every available HMAC backend, with the backend and the algorithm as arguments
+static void bench_hotp_backend(benchmark::State &state)
+{
+   const libqotp::HmacBackend previous = libqotp::hmac_backend();
+   if (!libqotp::set_hmac_backend(static_cast<libqotp::HmacBackend>(state.range(0))))
+   {
+      state.SkipWithError("backend not available");
+      return;
+   }
+
+   const auto algorithm = algorithm_from(state.range(1));
+   const libqotp::OtpKey key(secret_for(algorithm), algorithm);
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp_value(key, counter++); });
+
+   libqotp::set_hmac_backend(previous);
+}
+BENCHMARK(bench_hotp_backend)
+    ->ArgNames({"backend", "algorithm"})
+    ->ArgsProduct({{int(libqotp::HmacBackend::Generic), int(libqotp::HmacBackend::ShaNi), int(libqotp::HmacBackend::OpenSsl)},
+                   {QCryptographicHash::Sha1, QCryptographicHash::Sha256, QCryptographicHash::Sha512}});
+
+// The compile-time specialized instance, SHA-1 with 6 digits, without the runtime dispatch
+static void bench_hotp_fixed(benchmark::State &state)
+{
+   using Code = libqotp::Hotp<QCryptographicHash::Sha1, 6>;
+   const libqotp::OtpKey key(sha1Secret);
+   char buffer[Code::digits];
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return Code::write(key, counter++, buffer); });
+}
+BENCHMARK(bench_hotp_fixed)->ThreadRange(1, 8)->UseRealTime();
+
+static void bench_hotp_base32(benchmark::State &state)
+{
+   const QString secret = QStringLiteral("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ");
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp_base32(secret, counter++); });
+}
+BENCHMARK(bench_hotp_base32);
+
+static void bench_hotp_base64(benchmark::State &state)
+{
+   const QByteArray secret = sha1Secret.toBase64();
+   quint64 counter = 0;
+   measure(state, 1, [&]() { return libqotp::hotp_base64(secret, counter++); });
+}
+BENCHMARK(bench_hotp_base64);
+
+// TOTP
+
+static void bench_totp(benchmark::State &state)
+{
+   const auto algorithm = algorithm_from(state.range(0));
+   const QByteArray secret = secret_for(algorithm);
+   measure(state, 1, [&]() { return libqotp::totp(secret, now, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, algorithm); });
+}
+BENCHMARK(bench_totp)->Apply(algorithms_threaded);
+
+static void bench_totp_otpkey(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   measure(state, 1, [&]() { return libqotp::totp(key, now); });
+}
+BENCHMARK(bench_totp_otpkey)->Apply(algorithms);
+
+static void bench_totp_value(benchmark::State &state)
+{
+   const libqotp::OtpKey key(secret_for(algorithm_from(state.range(0))), algorithm_from(state.range(0)));
+   measure(state, 1, [&]() { return libqotp::totp_value(key, now); });
+}
+BENCHMARK(bench_totp_value)->Apply(algorithms_threaded);
+
+static void bench_totp_base32(benchmark::State &state)
+{
+   const QString secret = QStringLiteral("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ");
+   measure(state, 1, [&]() { return libqotp::totp_base32(secret, now); });
+}
+BENCHMARK(bench_totp_base32);
+
+static void bench_totp_base64(benchmark::State &state)
+{
+   const QByteArray secret = sha1Secret.toBase64();
+   measure(state, 1, [&]() { return libqotp::totp_base64(secret, now); });
+}
+BENCHMARK(bench_totp_base64);
+
+// Reading the current time, which every defaulted currentUnixTime argument does
+
+static void bench_clock_qdatetime(benchmark::State &state)
+{
+   measure(state, 1, []() { return QDateTime::currentDateTimeUtc().toSecsSinceEpoch(); });
+}
+BENCHMARK(bench_clock_qdatetime);
+
+static void bench_clock_system(benchmark::State &state)
+{
+   const libqotp::SystemClock clock;
+   measure(state, 1, [&]() { return clock.now(); });
+}
+BENCHMARK(bench_clock_system);
+
+static void bench_clock_default(benchmark::State &state)
+{
+   measure(state, 1, []() { return libqotp::current_unix_time(); });
+}
+BENCHMARK(bench_clock_default)->ThreadRange(1, 8)->UseRealTime();
+
+// TOTP at the current time from the default clock, compare with bench_totp_value
+static void bench_totp_value_now(benchmark::State &state)
+{
+   const libqotp::OtpKey key(sha1Secret);
+   measure(state, 1, [&]() { return libqotp::totp_value(key); });
+}
+BENCHMARK(bench_totp_value_now);
+
+// Verification, window size as argument. Every candidate in the window is computed.
+static void bench_totp_verify(benchmark::State &state)
+{
+   const libqotp::OtpKey key(sha1Secret);
+   const auto window = static_cast<unsigned int>(state.range(0));
+   measure(state, 1, [&]() { return libqotp::totp_verify(key, 12345678u, now, window); });
+}
+BENCHMARK(bench_totp_verify)->ArgName("window")->Arg(0)->Arg(1)->Arg(2)->Arg(10)->Arg(50)->ThreadRange(1, 8)->UseRealTime();
+
+static void bench_core_totp_verify(benchmark::State &state)
+{
+   const libqotp::OtpKey key(sha1Secret);
+   const auto window = static_cast<unsigned int>(state.range(0));
+   const std::chrono::sys_seconds time{std::chrono::seconds(now)};
+   measure(state, 1, [&]() { return libqotp::core::totp_verify(key.coreKey(), 12345678u, time, window); });
+}
+BENCHMARK(bench_core_totp_verify)->ArgName("window")->Arg(0)->Arg(1)->Arg(10);
+
+// HOTP resynchronization, look-ahead window as argument. Every candidate in the window is computed.
+static void bench_hotp_resync(benchmark::State &state)
+{
+   const libqotp::OtpKey key(sha1Secret);
+   const auto lookAhead = static_cast<unsigned int>(state.range(0));
+   measure(state, 1, [&]() { return libqotp::hotp_resync(key, 0, 123456u, lookAhead); });
+}
+BENCHMARK(bench_hotp_resync)->ArgName("lookAhead")->Arg(10)->Arg(100)->Arg(1000);
+
+// Key preparation
+
+static void bench_otpkey(benchmark::State &state)
+{
+   const auto algorithm = algorithm_from(state.range(0));
+   const QByteArray secret = secret_for(algorithm);
+   measure(state, 1, [&]() { return libqotp::OtpKey(secret, algorithm).isValid(); });
+}
+BENCHMARK(bench_otpkey)->Apply(algorithms);
+
+// Base32 decoding across secret lengths in bytes
+
+static void bench_base32_decode(benchmark::State &state)
+{
+   const QString encoded = base32_of_length(state.range(0));
+   measure(state, 1, [&]() { return libqotp::base32_decode(encoded); });
+   state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bench_base32_decode)->ArgName("bytes")->Arg(10)->Arg(20)->Arg(32)->Arg(64)->Arg(256)->Arg(4096);
+
+// Base32 encoding across secret lengths in bytes
+
+static void bench_base32_encode(benchmark::State &state)
+{
+   const QByteArray data(static_cast<qsizetype>(state.range(0)), 'x');
+   measure(state, 1, [&]() { return libqotp::base32_encode(data); });
+   state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bench_base32_encode)->ArgName("bytes")->Arg(10)->Arg(20)->Arg(32)->Arg(64)->Arg(256)->Arg(4096);
+
+static void bench_base32_encode_buffer(benchmark::State &state)
+{
+   const QByteArray data(static_cast<qsizetype>(state.range(0)), 'x');
+   std::vector<char> buffer(static_cast<std::size_t>(libqotp::base32_encoded_size(data.size())));
+   measure(state, 1, [&]() { return libqotp::base32_encode(data, std::span<char>(buffer)); });
+   state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bench_base32_encode_buffer)->ArgName("bytes")->Arg(10)->Arg(20)->Arg(32)->Arg(64)->Arg(256)->Arg(4096);
+
+// Secret generation, one code per generated secret
+
+static void bench_generate_secrets(benchmark::State &state)
+{
+   measure(state, state.range(0), [&]() { return libqotp::generate_secrets(state.range(0)).count(); });
+}
+BENCHMARK(bench_generate_secrets)->ArgName("secrets")->Arg(1)->Arg(1000)->Arg(100000);
+
+// otpauth:// URIs, one code per URI
+
+static void bench_otpauth_parse(benchmark::State &state)
+{
+   const QByteArray uri("otpauth://totp/ACME%20Co:john.doe@email.com?secret=HXDMVJECJJWSRB3HWIZR4IFUGFTMXBOZ&issuer=ACME%20Co&algorithm=SHA256&digits=8&period=60");
+   QByteArray buffer = uri;
+   libqotp::OtpAuthUri result;
+   measure(state, 1, [&]() {
+      // Parsing works in place, so every iteration starts from a fresh copy
+      std::memcpy(buffer.data(), uri.constData(), static_cast<std::size_t>(uri.size()));
+      return libqotp::parse_otpauth_uri(std::span<char>(buffer.data(), buffer.size()), result);
+   });
+}
+BENCHMARK(bench_otpauth_parse);
+
+static void bench_otpauth_write(benchmark::State &state)
+{
+   libqotp::OtpAuthUri uri;
+   uri.issuer = "ACME Co";
+   uri.account = "john.doe@email.com";
+   uri.secret = "12345678901234567890";
+
+   QByteArray buffer;
+   measure(state, 1, [&]() {
+      buffer.resize(0);
+      return libqotp::write_otpauth_uri(uri, buffer);
+   });
+}
+BENCHMARK(bench_otpauth_write);
+
+static void bench_otpauth_reader(benchmark::State &state)
+{
+   const QByteArray line("otpauth://totp/ACME%20Co:john.doe@email.com?secret=HXDMVJECJJWSRB3HWIZR4IFUGFTMXBOZ&issuer=ACME%20Co\n");
+   QByteArray data;
+   for (std::int64_t i = 0; i < state.range(0); ++i)
+   {
+      data.append(line);
+   }
+
+   measure(state, state.range(0), [&]() {
+      QBuffer device(&data);
+      device.open(QIODevice::ReadOnly);
+
+      libqotp::OtpAuthReader reader(&device);
+      qint64 valid = 0;
+      while (reader.readNext())
+      {
+         valid += reader.error() == libqotp::OtpAuthError::None;
+      }
+      return valid;
+   });
+   state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bench_otpauth_reader)->ArgName("lines")->Arg(1000)->Arg(100000);
+
+// Replay protection, one accepted code per call. Every thread records increasing steps for its own users.
+
+static void bench_replaystore_accept(benchmark::State &state)
+{
+   static libqotp::ReplayStore store(1 << 20, 0);
+   const quint64 firstUser = static_cast<quint64>(state.thread_index()) << 32;
+   quint64 counter = 0;
+   quint64 user = 0;
+   measure(state, 1, [&]() {
+      if (user == 4096)
+      {
+         user = 0;
+         ++counter;
+      }
+      return store.accept(firstUser + user++, counter, 0);
+   });
+}
+BENCHMARK(bench_replaystore_accept)->ThreadRange(1, 8)->UseRealTime();
+
+// Failure throttling, one lookup per call for users that each failed a few times
+
+static void bench_throttle_check(benchmark::State &state)
+{
+   static libqotp::Throttle throttle;
+   static const bool filled = []() {
+      for (quint64 user = 0; user < 4096; ++user)
+      {
+         throttle.recordFailure(user, 0);
+      }
+      return true;
+   }();
+   Q_UNUSED(filled);
+
+   quint64 user = 0;
+   measure(state, 1, [&]() {
+      return throttle.check(user++ & 4095, 0);
+   });
+}
+BENCHMARK(bench_throttle_check)->ThreadRange(1, 8)->UseRealTime();
+
+// Asynchronous verification, maxBatchSize as argument. Every call submits 1024 requests with a window
+// of 1 and waits for all of them; a batch size of 1 shows the cost of handing single requests to the pool.
+
+static void bench_async_verify(benchmark::State &state)
+{
+   libqotp::AsyncVerifierOptions options;
+   options.maxBatchSize = state.range(0);
+   libqotp::AsyncVerifier verifier(options);
+   const libqotp::OtpKey key(sha1Secret);
+
+   std::vector<QFuture<bool>> results(1024);
+   measure(state, 1024, [&]() {
+      for (QFuture<bool> &result : results)
+      {
+         result = verifier.verify(key, 12345678u, now);
+      }
+      verifier.flush();
+
+      qsizetype accepted = 0;
+      for (QFuture<bool> &result : results)
+      {
+         accepted += result.result();
+      }
+      return accepted;
+   });
+
+   const libqotp::AsyncVerifierStats stats = verifier.stats();
+   state.counters["batch"] = stats.averageBatchSize();
+   state.counters["peakQueue"] = static_cast<double>(stats.peakQueueDepth);
+}
+BENCHMARK(bench_async_verify)->ArgName("maxBatchSize")->Arg(1)->Arg(16)->Arg(64)->Arg(256)->UseRealTime();
+
+// Key store, with the number of records as argument
+
+// Writes a key store of 'records' SHA-1 keys, distinct so that the midstates differ
+static QString write_keystore(const QTemporaryDir &dir, std::int64_t records)
+{
+   const QString fileName = dir.filePath("bench.qotpkeys");
+   libqotp::KeyStoreWriter writer(fileName);
+   QByteArray secret = sha1Secret;
+   for (std::int64_t i = 0; i < records; ++i)
+   {
+      std::memcpy(secret.data(), &i, sizeof(i));
+      writer.add(libqotp::OtpKey(secret), 8);
+   }
+   writer.commit();
+   return fileName;
+}
+
+static void bench_keystore_write(benchmark::State &state)
+{
+   const QTemporaryDir dir;
+   measure(state, state.range(0), [&]() { return write_keystore(dir, state.range(0)).size(); });
+}
+BENCHMARK(bench_keystore_write)->ArgName("records")->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Opening maps the file and checks the header, independent of the number of records
+static void bench_keystore_open(benchmark::State &state)
+{
+   const QTemporaryDir dir;
+   const QString fileName = write_keystore(dir, state.range(0));
+   libqotp::KeyStore store;
+   measure(state, 1, [&]() { return store.open(fileName); });
+}
+BENCHMARK(bench_keystore_open)->ArgName("records")->Arg(1000)->Arg(1000000);
+
+// Verification against records spread over the file, each checked against its checksum first
+static void bench_keystore_totp_verify(benchmark::State &state)
+{
+   const QTemporaryDir dir;
+   libqotp::KeyStore store;
+   store.open(write_keystore(dir, state.range(0)));
+   qsizetype index = 0;
+   measure(state, 1, [&]() {
+      index = (index + 7919) % store.size();
+      return store.totp_verify(index, 12345678u, now);
+   });
+}
+BENCHMARK(bench_keystore_totp_verify)->ArgName("records")->Arg(1000)->Arg(1000000);
+
+// Durable counters. Every call waits for its updates to be synced, so the numbers depend on the disk
+// holding the temporary directory.
+
+// One batch of updates per call and sync, with the batch size as argument
+static void bench_counterlog_advance_batch(benchmark::State &state)
+{
+   const QTemporaryDir dir;
+   libqotp::CounterLog log;
+   log.open(dir.filePath("bench.counters"));
+
+   std::vector<libqotp::CounterUpdate> updates(static_cast<std::size_t>(state.range(0)));
+   std::vector<libqotp::CounterLogResult> results(updates.size());
+   quint64 value = 0;
+   measure(state, state.range(0), [&]() {
+      ++value;
+      for (std::size_t i = 0; i < updates.size(); ++i)
+      {
+         updates[i] = {i, value};
+      }
+      return log.advance(updates, results);
+   });
+   state.counters["syncs"] = static_cast<double>(log.stats().syncs);
+}
+BENCHMARK(bench_counterlog_advance_batch)->ArgName("batch")->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+// Single updates from every thread, made durable together by group commit
+static void bench_counterlog_advance(benchmark::State &state)
+{
+   static const QTemporaryDir dir;
+   static libqotp::CounterLog log;
+   static const bool opened = log.open(dir.filePath("bench.counters"));
+   Q_UNUSED(opened);
+
+   const quint64 user = static_cast<quint64>(state.thread_index());
+   quint64 value = log.value(user).value_or(0);
+   measure(state, 1, [&]() { return log.advance(user, ++value); });
+}
+BENCHMARK(bench_counterlog_advance)->ThreadRange(1, 8)->UseRealTime();
+
+// Precomputed tables, with the number of keys as argument
+
+static std::vector<libqotp::OtpKey> distinct_keys(std::int64_t count)
+{
+   std::vector<libqotp::OtpKey> keys;
+   keys.reserve(static_cast<std::size_t>(count));
+   for (std::int64_t i = 0; i < count; ++i)
+   {
+      keys.emplace_back(sha1Secret + QByteArray::number(static_cast<qlonglong>(i)));
+   }
+   return keys;
+}
+
+// Lookups only, compare with bench_totp_verify at window 1
+static void bench_totpcache_verify(benchmark::State &state)
+{
+   const std::vector<libqotp::OtpKey> keys = distinct_keys(state.range(0));
+   libqotp::TotpCacheOptions options;
+   options.background = false;
+   libqotp::TotpCache cache(keys, options);
+   cache.refresh(now);
+
+   qsizetype index = 0;
+   measure(state, 1, [&]() {
+      index = (index + 7919) % cache.size();
+      return cache.verify(index, 12345678u, now);
+   });
+   state.counters["misses"] = static_cast<double>(cache.stats().misses);
+}
+BENCHMARK(bench_totpcache_verify)->ArgName("keys")->Arg(1000)->Arg(100000)->ThreadRange(1, 8)->UseRealTime();
+
+// The work moved off the request path, four codes per key at window 1
+static void bench_totpcache_refresh(benchmark::State &state)
+{
+   const std::vector<libqotp::OtpKey> keys = distinct_keys(state.range(0));
+   libqotp::TotpCacheOptions options;
+   options.background = false;
+   libqotp::TotpCache cache(keys, options);
+
+   quint64 time = now;
+   measure(state, state.range(0) * 4, [&]() {
+      cache.refresh(time += 30);
+      return cache.size();
+   });
+}
+BENCHMARK(bench_totpcache_refresh)->ArgName("keys")->Arg(1000)->Arg(100000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Batches, with the batch size and the thread cap as arguments
+
+static void bench_totp_batch(benchmark::State &state)
+{
+   const auto count = static_cast<std::size_t>(state.range(0));
+   std::vector<libqotp::OtpKey> keys;
+   keys.reserve(count);
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      keys.emplace_back(sha1Secret + QByteArray::number(static_cast<qulonglong>(i)));
+   }
+   std::vector<quint32> values(count);
+
+   libqotp::BatchOptions options;
+   options.maxThreads = static_cast<int>(state.range(1));
+
+   measure(state, state.range(0), [&]() { return libqotp::totp_batch(keys, now, values, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, options); });
+}
+BENCHMARK(bench_totp_batch)->ArgNames({"keys", "threads"})->ArgsProduct({{1000, 100000}, {1, 2, 4, 8}})->UseRealTime();
+
+static void bench_totp_batch_secrets(benchmark::State &state)
+{
+   const auto count = static_cast<std::size_t>(state.range(0));
+   std::vector<QByteArray> secrets;
+   secrets.reserve(count);
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      secrets.push_back(sha1Secret + QByteArray::number(static_cast<qulonglong>(i)));
+   }
+   const std::vector<QByteArrayView> views(secrets.begin(), secrets.end());
+   std::vector<quint32> values(count);
+
+   libqotp::BatchOptions options;
+   options.maxThreads = static_cast<int>(state.range(1));
+
+   measure(state, state.range(0), [&]() { return libqotp::totp_batch(views, now, values, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha1, options); });
+}
+BENCHMARK(bench_totp_batch_secrets)->ArgNames({"keys", "threads"})->ArgsProduct({{1000, 100000}, {1, 2, 4, 8}})->UseRealTime();
+
+BENCHMARK_MAIN();
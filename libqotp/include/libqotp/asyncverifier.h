@@ -0,0 +1,238 @@
+#ifndef LIBQOTP_ASYNCVERIFIER_H_20261018
+#define LIBQOTP_ASYNCVERIFIER_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <QFuture>
+
+class QThreadPool;
+
+namespace libqotp
+{
+   /**
+    * Controls how an AsyncVerifier groups requests and which TOTP parameters it verifies with.
+    *
+    * maxBatchSize and maxDelay set the trade-off between throughput and latency: larger batches fill the
+    * vector lanes of the HMAC engine and spread the cost of handing work to a thread, a shorter delay
+    * bounds how long a request waits for others to join its batch.
+    */
+   struct AsyncVerifierOptions
+   {
+      // A batch is started as soon as this many requests of one algorithm are waiting.
+      qsizetype maxBatchSize = 256;
+
+      // A batch is started at the latest this long after its first request arrived. 0 starts every
+      // request on its own.
+      std::chrono::microseconds maxDelay = std::chrono::microseconds(50);
+
+      // The pool batches run on. nullptr uses QThreadPool::globalInstance().
+      QThreadPool *pool = nullptr;
+
+      // The number of time steps accepted before and after the current one. Clamped to INT_MAX, the
+      // largest window totp_verify() accepts.
+      unsigned int window = 1;
+
+      // The time step in seconds.
+      unsigned int timeStep = 30;
+
+      // The Unix epoch for the TOTP calculation.
+      quint64 epoch = 0;
+
+      // The length of the OTPs.
+      unsigned int digits = 8;
+   };
+
+   /**
+    * Counters of an AsyncVerifier, for export to monitoring.
+    */
+   struct AsyncVerifierStats
+   {
+      // Requests accepted by verify() and generate().
+      quint64 requests = 0;
+
+      // Requests handed to a batch.
+      quint64 batched = 0;
+
+      // Requests whose result was delivered.
+      quint64 completed = 0;
+
+      // Batches started. fullBatches of them had reached maxBatchSize, the others were started by
+      // maxDelay or flush(). Mostly full batches mean maxBatchSize can grow, mostly others that maxDelay
+      // only adds latency.
+      quint64 batches = 0;
+      quint64 fullBatches = 0;
+
+      // Requests waiting to be batched right now, and the most that ever waited at once.
+      qsizetype queueDepth = 0;
+      qsizetype peakQueueDepth = 0;
+
+      // The largest batch started.
+      qsizetype largestBatch = 0;
+
+      /**
+       * Returns the mean number of requests per batch, or 0 before the first batch.
+       */
+      double averageBatchSize() const { return batches ? static_cast<double>(batched) / static_cast<double>(batches) : 0.0; }
+   };
+
+   /**
+    * Verifies TOTPs asynchronously in micro-batches.
+    *
+    * A server that verifies every login on the thread that received it computes one HMAC at a time and
+    * leaves the multi-buffer engine (see totp_batch()) with empty lanes. AsyncVerifier collects requests
+    * from any number of threads, groups them by hash algorithm and verifies each group in one batch on a
+    * thread pool, with all candidates of the window of every request sharing the vector lanes.
+    *
+    * A group becomes a batch when it reaches maxBatchSize, started by the thread that submitted the last
+    * request, or when its first request has waited maxDelay, started by a timer thread owned by the
+    * verifier. Results are delivered through a QFuture or a callback invoked on a pool thread, never on the
+    * thread that submitted the request, even when its input is invalid.
+    * generate() computes the TOTP of a key in the same batches, and awaitable.h offers both to coroutines.
+    *
+    * The key is copied into the request, so the caller's OtpKey may go away right after verify() returns.
+    * Every code in the window is compared in constant time, as in totp_verify().
+    *
+    * Usage example:
+    *     libqotp::AsyncVerifier verifier;
+    *     verifier.verify(key, code).then([](bool valid) { ... });
+    *
+    * Destroying the verifier starts the remaining batches and waits for all of them.
+    */
+   class AsyncVerifier
+   {
+   public:
+      /**
+       * Starts the timer thread. The options apply to every request.
+       */
+      explicit AsyncVerifier(const AsyncVerifierOptions &options = AsyncVerifierOptions());
+      ~AsyncVerifier();
+
+      AsyncVerifier(const AsyncVerifier &) = delete;
+      AsyncVerifier &operator=(const AsyncVerifier &) = delete;
+
+      /**
+       * Queues a TOTP verification. Safe to call from any thread.
+       *
+       * @param key The precomputed shared secret key.
+       * @param code The code entered by the user.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+       * @return A future that yields true if a code in the window matched, false if none matched or the
+       *         input is invalid.
+       */
+      QFuture<bool> verify(const OtpKey &key, quint32 code, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Queues a TOTP verification and calls 'callback' with the result on a pool thread, also when the
+       * input is invalid, so it never runs on the calling thread. Avoids the shared state of a QFuture.
+       *
+       * If stop is requested on 'stopToken' before the batch of the request runs, no HMAC is computed for
+       * it and 'callback' receives false.
+       */
+      void verify(
+          const OtpKey &key,
+          quint32 code,
+          std::function<void(bool)> callback,
+          quint64 currentUnixTime = current_unix_time(),
+          std::stop_token stopToken = {});
+
+      /**
+       * Queues the generation of the TOTP of 'key' and calls 'callback' with it on a pool thread, also
+       * when the input is invalid.
+       *
+       * The code shares the batches of verify() and uses the digits, time step and epoch of the options.
+       * If stop is requested on 'stopToken' before the batch of the request runs, no HMAC is computed for
+       * it and 'callback' receives std::nullopt.
+       *
+       * @param key The precomputed shared secret key.
+       * @param callback Receives the code as a number, as totp_value() returns it, or std::nullopt if the
+       *                 input is invalid.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+       * @param stopToken Cancels the request.
+       */
+      void generate(
+          const OtpKey &key,
+          std::function<void(std::optional<quint32>)> callback,
+          quint64 currentUnixTime = current_unix_time(),
+          std::stop_token stopToken = {});
+
+      /**
+       * Starts batches for all waiting requests without waiting for maxBatchSize or maxDelay.
+       */
+      void flush();
+
+      /**
+       * Blocks until every request queued so far has its result.
+       */
+      void waitForDone();
+
+      /**
+       * Returns a snapshot of the counters. The fields are read one by one and may be slightly out of step
+       * with each other while requests are processed.
+       */
+      AsyncVerifierStats stats() const;
+
+      /**
+       * Returns the options the verifier was created with, with the window clamped.
+       */
+      const AsyncVerifierOptions &options() const { return m_options; }
+
+   private:
+      struct Request;
+      struct Batch;
+
+      // One queue per hash algorithm
+      static constexpr int queue_count = 3;
+
+      struct Queue
+      {
+         std::vector<Request> requests;
+         std::chrono::steady_clock::time_point deadline;
+      };
+
+      void enqueue(Request &&request);
+
+      // Runs 'answer' on the pool for a request that is not queued, counted by waitForDone()
+      void reject(std::function<void()> answer);
+
+      void start(std::vector<Request> &&requests, bool full);
+      void run(Batch &batch);
+      void timer();
+
+      // Takes the requests of every queue whose deadline is not after 'until'. Called with m_mutex held.
+      std::vector<std::vector<Request>> take(std::chrono::steady_clock::time_point until);
+
+      AsyncVerifierOptions m_options;
+      QThreadPool *m_pool = nullptr;
+
+      std::mutex m_mutex;
+      std::condition_variable m_wake;
+      std::condition_variable m_idle;
+      Queue m_queues[queue_count];
+      qsizetype m_inFlight = 0;
+      bool m_stopping = false;
+
+      std::atomic<quint64> m_requests{0};
+      std::atomic<quint64> m_batched{0};
+      std::atomic<quint64> m_completed{0};
+      std::atomic<quint64> m_batches{0};
+      std::atomic<quint64> m_fullBatches{0};
+      std::atomic<qsizetype> m_queueDepth{0};
+      std::atomic<qsizetype> m_peakQueueDepth{0};
+      std::atomic<qsizetype> m_largestBatch{0};
+
+      std::thread m_timer;
+   };
+}
+
+#endif
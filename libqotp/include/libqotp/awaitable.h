@@ -0,0 +1,149 @@
+#ifndef LIBQOTP_AWAITABLE_H_20261018
+#define LIBQOTP_AWAITABLE_H_20261018
+
+#include <libqotp/asyncverifier.h>
+
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <stop_token>
+
+namespace libqotp
+{
+   class VerifyAwaitable;
+   class GenerateAwaitable;
+
+   /**
+    * Verifies a TOTP from a coroutine without blocking its thread.
+    *
+    * The request is queued on 'verifier' right away and batched with all other requests of the verifier,
+    * so awaits issued by many coroutines at the same time, or several awaitables created by one coroutine
+    * before it awaits the first, share one batch of HMAC work on the thread pool. The window, digits, time
+    * step and epoch are taken from the options of the verifier.
+    *
+    * co_await resumes the coroutine on the thread that awaited, through its Qt event loop. On a thread
+    * without an event loop, such as one not started by QThread, it resumes on the thread that delivered
+    * the result.
+    *
+    * The library does not define a coroutine type, any task type of the application can await the result.
+    *
+    * Usage example:
+    *     Task Gateway::login(QByteArray user, quint32 code)
+    *     {
+    *        const bool valid = co_await libqotp::totp_verify_async(m_verifier, key(user), code, m_stop.get_token());
+    *        ...
+    *     }
+    *
+    * @param verifier The verifier that batches the request. Must outlive the await.
+    * @param key The precomputed shared secret key. It is copied into the request.
+    * @param code The code entered by the user.
+    * @param stopToken Cancels the request. A cancelled await resumes right away with false.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+    * @return An awaitable yielding true if a code in the window matched, false if none matched, the input
+    *         is invalid or the request was cancelled.
+    */
+   VerifyAwaitable totp_verify_async(
+       AsyncVerifier &verifier,
+       const OtpKey &key,
+       quint32 code,
+       std::stop_token stopToken = {},
+       quint64 currentUnixTime = current_unix_time());
+
+   /**
+    * Generates a TOTP from a coroutine without blocking its thread. Batches and resumes like
+    * totp_verify_async().
+    *
+    * @param verifier The verifier that batches the request. Must outlive the await.
+    * @param key The precomputed shared secret key. It is copied into the request.
+    * @param stopToken Cancels the request. A cancelled await resumes right away with std::nullopt.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+    * @return An awaitable yielding the code as a number, as totp_value() returns it, or std::nullopt if
+    *         the input is invalid or the request was cancelled.
+    */
+   GenerateAwaitable totp_async(
+       AsyncVerifier &verifier,
+       const OtpKey &key,
+       std::stop_token stopToken = {},
+       quint64 currentUnixTime = current_unix_time());
+
+   /**
+    * The part of VerifyAwaitable and GenerateAwaitable that waits for the result.
+    *
+    * An awaitable is awaited at most once. Its request is completed even if it is never awaited. A
+    * coroutine suspended on it must not be destroyed; request stop on its token instead.
+    */
+   class OtpAwaitable
+   {
+   public:
+      OtpAwaitable(const OtpAwaitable &) = delete;
+      OtpAwaitable &operator=(const OtpAwaitable &) = delete;
+
+      /**
+       * Returns true if the result is already there, so the coroutine does not suspend.
+       */
+      bool await_ready() const noexcept;
+
+      /**
+       * Remembers the thread of the coroutine and suspends it until the result is there.
+       *
+       * @return false if the result arrived in the meantime, which continues the coroutine right away.
+       */
+      bool await_suspend(std::coroutine_handle<> handle);
+
+   protected:
+      struct State;
+
+      // Completes the await with std::nullopt when stop is requested
+      struct Canceller
+      {
+         std::shared_ptr<State> state;
+
+         void operator()() const;
+      };
+
+      explicit OtpAwaitable(const std::stop_token &stopToken);
+      ~OtpAwaitable();
+
+      // Returns the result once the coroutine resumed. Called by await_resume().
+      std::optional<quint32> take();
+
+      std::shared_ptr<State> m_state;
+      std::optional<std::stop_callback<Canceller>> m_stopCallback;
+   };
+
+   /**
+    * The result of totp_verify_async().
+    */
+   class VerifyAwaitable : public OtpAwaitable
+   {
+   public:
+      /**
+       * Returns true if a code in the window matched.
+       */
+      bool await_resume();
+
+   private:
+      friend VerifyAwaitable totp_verify_async(AsyncVerifier &, const OtpKey &, quint32, std::stop_token, quint64);
+
+      VerifyAwaitable(AsyncVerifier &verifier, const OtpKey &key, quint32 code, std::stop_token stopToken, quint64 currentUnixTime);
+   };
+
+   /**
+    * The result of totp_async().
+    */
+   class GenerateAwaitable : public OtpAwaitable
+   {
+   public:
+      /**
+       * Returns the code, or std::nullopt if the input is invalid or the request was cancelled.
+       */
+      std::optional<quint32> await_resume();
+
+   private:
+      friend GenerateAwaitable totp_async(AsyncVerifier &, const OtpKey &, std::stop_token, quint64);
+
+      GenerateAwaitable(AsyncVerifier &verifier, const OtpKey &key, std::stop_token stopToken, quint64 currentUnixTime);
+   };
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef LIBQOTP_BATCH_H_20261018
+#define LIBQOTP_BATCH_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <span>
+
+class QThreadPool;
+
+namespace libqotp
+{
+   /**
+    * Value written for an entry that could not be computed, for example because its secret is empty.
+    * Real codes are below 2^31 and never take this value.
+    */
+   inline constexpr quint32 invalid_batch_value = 0xffffffffu;
+
+   /**
+    * Controls how a batch is split across threads.
+    *
+    * The calling thread always computes the first part of the batch itself. The remaining parts are offered
+    * to the thread pool; a part the pool cannot take immediately is computed by the calling thread as well,
+    * so a batch never waits for a busy pool and can safely be started from a pool thread.
+    */
+   struct BatchOptions
+   {
+      /**
+       * The maximum number of threads working on one batch, including the calling thread.
+       * 0 uses QThreadPool::maxThreadCount() of the pool, 1 computes the batch on the calling thread only.
+       */
+      int maxThreads = 0;
+
+      /**
+       * The pool used for the additional threads. nullptr uses QThreadPool::globalInstance().
+       */
+      QThreadPool *pool = nullptr;
+
+      /**
+       * The smallest number of entries worth handing to another thread. Small batches stay on the calling thread.
+       */
+      qsizetype minimumPerThread = 4096;
+   };
+
+   /**
+    * Computes the TOTP values of many precomputed keys for one point in time.
+    *
+    * values[i] receives the code of keys[i], independent of how the work was split across threads.
+    * Keys that are invalid yield invalid_batch_value. The keys may use different hash algorithms.
+    *
+    * No memory is allocated per entry: every thread works on fixed-size scratch buffers on its stack and
+    * writes directly into 'values'.
+    *
+    * @param keys The precomputed shared secret keys.
+    * @param currentUnixTime The Unix epoch timestamp in seconds shared by all entries.
+    * @param values Receives one value per key. Must hold at least keys.size() elements.
+    * @param timeStep The time step in seconds. The RFC recommends 30 seconds.
+    * @param epoch The Unix epoch for the TOTP calculation. Usually 0 (Unix epoch).
+    * @param digits The desired length of the OTPs. Defaults to 8.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @param options Threading options.
+    * @return false if a parameter is invalid or 'values' is too small, in which case nothing is written.
+    */
+   bool totp_batch(
+       std::span<const OtpKey> keys,
+       quint64 currentUnixTime,
+       std::span<quint32> values,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       const BatchOptions &options = BatchOptions());
+
+   /**
+    * Computes the TOTP values of many raw secrets for one point in time.
+    *
+    * Behaves like the OtpKey overload. The HMAC state of every secret is derived on the fly; when the same
+    * secrets are used again, precompute OtpKey objects instead.
+    *
+    * @return false if a parameter is invalid or 'values' is too small, in which case nothing is written.
+    */
+   bool totp_batch(
+       std::span<const QByteArrayView> secrets,
+       quint64 currentUnixTime,
+       std::span<quint32> values,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1,
+       const BatchOptions &options = BatchOptions());
+
+   /**
+    * Computes the HOTP values of many precomputed keys, each with its own counter.
+    *
+    * values[i] receives the code of keys[i] at counters[i]. Keys that are invalid yield invalid_batch_value.
+    *
+    * @return false if a parameter is invalid, the spans differ in size or 'values' is too small,
+    *         in which case nothing is written.
+    */
+   bool hotp_batch(
+       std::span<const OtpKey> keys,
+       std::span<const quint64> counters,
+       std::span<quint32> values,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       const BatchOptions &options = BatchOptions());
+
+   /**
+    * Computes the HOTP values of many raw secrets, each with its own counter.
+    *
+    * @return false if a parameter is invalid, the spans differ in size or 'values' is too small,
+    *         in which case nothing is written.
+    */
+   bool hotp_batch(
+       std::span<const QByteArrayView> secrets,
+       std::span<const quint64> counters,
+       std::span<quint32> values,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1,
+       const BatchOptions &options = BatchOptions());
+}
+
+#endif
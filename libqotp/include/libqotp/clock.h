@@ -0,0 +1,128 @@
+#ifndef LIBQOTP_CLOCK_H_20261018
+#define LIBQOTP_CLOCK_H_20261018
+
+#include <atomic>
+
+#include <QtGlobal>
+
+namespace libqotp
+{
+   /**
+    * A source of the current Unix time in seconds, for the TOTP functions.
+    *
+    * TOTP only needs second resolution. The clocks below read the time without building a QDateTime, and
+    * tests and hosts with a known drift can substitute their own. Implementations must be safe to call
+    * from any thread.
+    */
+   class Clock
+   {
+   public:
+      virtual ~Clock() = default;
+
+      /**
+       * Returns the current Unix time in seconds.
+       */
+      virtual quint64 now() const = 0;
+   };
+
+   /**
+    * The system real time clock, read with full resolution.
+    */
+   class SystemClock final : public Clock
+   {
+   public:
+      quint64 now() const override;
+   };
+
+   /**
+    * The system real time clock, read through CLOCK_REALTIME_COARSE on Linux.
+    *
+    * The coarse clock is the time of the last timer tick, which the kernel exposes without a system call
+    * or a hardware counter read. It lags the precise clock by at most one tick (a few milliseconds), which
+    * does not matter at second resolution. On other platforms it behaves like SystemClock.
+    *
+    * This is the default clock.
+    */
+   class CoarseClock final : public Clock
+   {
+   public:
+      quint64 now() const override;
+   };
+
+   /**
+    * A clock that only moves when told to, for deterministic tests.
+    */
+   class FakeClock final : public Clock
+   {
+   public:
+      explicit FakeClock(quint64 time = 0)
+         : m_time(time)
+      {
+      }
+
+      quint64 now() const override { return m_time.load(std::memory_order_relaxed); }
+
+      /**
+       * Sets the time returned by now().
+       */
+      void set(quint64 time) { m_time.store(time, std::memory_order_relaxed); }
+
+      /**
+       * Moves the time by 'seconds', which may be negative. The time does not go below 0.
+       */
+      void advance(qint64 seconds);
+
+   private:
+      std::atomic<quint64> m_time;
+   };
+
+   /**
+    * Another clock corrected by a fixed offset, for hosts whose clock is known to drift.
+    *
+    * With an offset of 3, now() returns three seconds more than the base clock. The result does not go
+    * below 0. The base clock must outlive this one.
+    */
+   class SkewedClock final : public Clock
+   {
+   public:
+      explicit SkewedClock(const Clock &base, qint64 offset = 0)
+         : m_base(base)
+         , m_offset(offset)
+      {
+      }
+
+      quint64 now() const override;
+
+      /**
+       * Returns or changes the offset in seconds. May be changed while other threads read the clock.
+       */
+      qint64 offset() const { return m_offset.load(std::memory_order_relaxed); }
+      void setOffset(qint64 offset) { m_offset.store(offset, std::memory_order_relaxed); }
+
+   private:
+      const Clock &m_base;
+      std::atomic<qint64> m_offset;
+   };
+
+   /**
+    * Returns the clock behind current_unix_time(), a CoarseClock unless replaced by set_default_clock().
+    */
+   const Clock &default_clock();
+
+   /**
+    * Replaces the clock behind current_unix_time() for the whole process, for example with a SkewedClock.
+    *
+    * @param clock The new default clock, or nullptr to restore the CoarseClock. It must stay alive until
+    *        it is replaced and no call may still be using it.
+    */
+   void set_default_clock(const Clock *clock);
+
+   /**
+    * Returns the current Unix time in seconds from the default clock.
+    *
+    * This is the default of every 'currentUnixTime' argument of the library.
+    */
+   quint64 current_unix_time();
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef LIBQOTP_CORE_HMACBACKEND_H_20261018
+#define LIBQOTP_CORE_HMACBACKEND_H_20261018
+
+#include <string_view>
+
+namespace libqotp::core
+{
+   /**
+    * The implementations of the SHA block function single HMACs are computed with.
+    *
+    * The backend covers every HMAC computed one at a time: preparing keys, OtpKey::hmac(), hotp(), totp(),
+    * hotp_value(), totp_value() and the other single-code functions, and the jobs the batch engine leaves
+    * over because they do not fill a vector. Functions that compute many codes of the same hash function
+    * at once, that is totp_verify() with a window, hotp_resync(), HotpRange, hotp_batch(), totp_batch(),
+    * KeyStore, TotpCache and AsyncVerifier, run the full vectors of their batch on the multi-buffer
+    * kernels reported by hmac_batch_level() instead.
+    *
+    * All backends produce identical results, they only differ in speed. Keys prepared with one backend
+    * remain valid after switching to another.
+    */
+   enum class HmacBackend
+   {
+      // The portable C++ implementation. Always available.
+      Generic,
+
+      // The x86 SHA extensions (SHA-NI) for SHA-1 and SHA-256. SHA-512 uses the portable implementation.
+      ShaNi,
+
+      // The block functions of OpenSSL's libcrypto. Only available if the library was built with WITH_OPENSSL.
+      OpenSsl
+   };
+
+   /**
+    * Returns the backend currently in use.
+    *
+    * On first use the library selects the fastest available backend: SHA-NI, then OpenSSL, then the portable
+    * implementation. The QOTP_HMAC environment variable ("generic", "sha-ni" or "openssl") overrides the
+    * choice if the named backend is available.
+    */
+   HmacBackend hmac_backend();
+
+   /**
+    * Returns the name of a backend as accepted by the QOTP_HMAC environment variable.
+    */
+   std::string_view hmac_backend_name(HmacBackend backend);
+
+   /**
+    * Returns true if 'backend' was compiled in, is supported by the CPU and passed its self-test.
+    *
+    * Each backend is checked against the RFC 4226 and RFC 6238 test vectors for SHA-1, SHA-256 and SHA-512
+    * before it is first used. A backend that fails is never selected.
+    */
+   bool hmac_backend_available(HmacBackend backend);
+
+   /**
+    * Switches all following HMAC computations to 'backend'. Safe to call while other threads compute codes.
+    *
+    * @return True on success, false if the backend is not available.
+    */
+   bool set_hmac_backend(HmacBackend backend);
+
+   /**
+    * The vector instruction sets of the multi-buffer kernels the batch engine computes several HMACs at once with.
+    */
+   enum class HmacBatchLevel
+   {
+      // No vector kernels, every HMAC of a batch runs on the active HmacBackend
+      None,
+
+      // 4 SHA-1/SHA-256 or 2 SHA-512 lanes
+      Sse2,
+
+      // 8 SHA-1/SHA-256 or 4 SHA-512 lanes
+      Avx2,
+
+      // 16 SHA-1/SHA-256 or 8 SHA-512 lanes
+      Avx512
+   };
+
+   /**
+    * Returns the level of the kernels that compute full vectors of batch jobs, see HmacBackend for the
+    * functions that use them.
+    *
+    * The library selects the widest level the CPU and operating system support when first used. The
+    * QOTP_SIMD environment variable ("none", "sse2", "ssse3", "avx2" or "avx512") caps it; "ssse3" gives
+    * Sse2 kernels and, like "sse2" and "none", also disables the SHA-NI backend. Unlike the backend, the
+    * level cannot be changed at runtime.
+    */
+   HmacBatchLevel hmac_batch_level();
+
+   /**
+    * Returns the name of a level as accepted by the QOTP_SIMD environment variable.
+    */
+   std::string_view hmac_batch_level_name(HmacBatchLevel level);
+}
+
+#endif
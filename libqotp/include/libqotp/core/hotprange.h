@@ -0,0 +1,176 @@
+#ifndef LIBQOTP_CORE_HOTPRANGE_H_20261018
+#define LIBQOTP_CORE_HOTPRANGE_H_20261018
+
+#include <libqotp/core/otp.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <span>
+
+namespace libqotp::core
+{
+   /**
+    * The HOTP values of consecutive counters of one key, computed lazily.
+    *
+    * Hardware token emulators, test harnesses and printed backup codes need long runs of codes. Calling
+    * hotp_value() for each counter hashes one counter at a time. HotpRange instead computes the values in
+    * blocks of consecutive counters through the multi-buffer HMAC engine, which fills its vector lanes
+    * with them, and only when an iterator is dereferenced: skipping ahead computes nothing.
+    *
+    * HotpRange is a std::ranges::view and a forward range, so it combines with the standard adaptors:
+    *     libqotp::core::HotpRange codes(key, counter, 1000);
+    *     for (std::uint32_t code : codes | std::views::drop(10) | std::views::take(5))
+    *     {
+    *        ...
+    *     }
+    *
+    * The range and its iterators refer to 'key', which must outlive them. They never allocate. An iterator
+    * caches its current block, so copies are independent, but one iterator must not be dereferenced from
+    * several threads at once.
+    */
+   class HotpRange : public std::ranges::view_interface<HotpRange>
+   {
+   public:
+      // The number of consecutive counters computed together
+      static constexpr std::size_t block_size = 16;
+
+      class iterator
+      {
+      public:
+         using iterator_concept = std::forward_iterator_tag;
+         using iterator_category = std::input_iterator_tag;
+         using value_type = std::uint32_t;
+         using difference_type = std::ptrdiff_t;
+
+         iterator() = default;
+
+         /**
+          * Returns the value of the current counter, computing the block starting at it if needed.
+          */
+         std::uint32_t operator*() const
+         {
+            if (m_index - m_blockStart >= m_blockCount)
+            {
+               fill();
+            }
+            return m_block[m_index - m_blockStart];
+         }
+
+         iterator &operator++()
+         {
+            ++m_index;
+            return *this;
+         }
+
+         iterator operator++(int)
+         {
+            iterator previous = *this;
+            ++m_index;
+            return previous;
+         }
+
+         bool operator==(const iterator &other) const { return m_index == other.m_index; }
+
+         /**
+          * Returns the counter the iterator points to.
+          */
+         std::uint64_t counter() const { return m_first + m_index; }
+
+         /**
+          * Writes the current code as exactly digits() zero-padded ASCII digits into 'output', which can be
+          * reused for every code. No terminator is written.
+          *
+          * @return The number of characters written, or 0 if 'output' is too small.
+          */
+         std::size_t write(std::span<char> output) const;
+
+      private:
+         friend class HotpRange;
+
+         iterator(const Key *key, std::uint64_t first, std::uint64_t index, std::uint64_t count, unsigned int digits)
+            : m_key(key)
+            , m_first(first)
+            , m_index(index)
+            , m_count(count)
+            , m_digits(digits)
+         {
+         }
+
+         // Computes the block of up to block_size values starting at the current counter
+         void fill() const;
+
+         const Key *m_key = nullptr;
+         std::uint64_t m_first = 0;
+         std::uint64_t m_index = 0;
+         std::uint64_t m_count = 0;
+         unsigned int m_digits = 0;
+         mutable std::uint64_t m_blockStart = 0;
+         mutable std::uint64_t m_blockCount = 0;
+         mutable std::uint32_t m_block[block_size] = {};
+      };
+
+      /**
+       * Constructs an empty range.
+       */
+      HotpRange() = default;
+
+      /**
+       * Constructs the range of the values of 'key' for counter, counter + 1, ..., counter + count - 1.
+       *
+       * The range is empty if the key is invalid or 'digits' is out of range. It ends before the counter
+       * would wrap around.
+       *
+       * @param key The precomputed shared secret key.
+       * @param counter The first counter.
+       * @param count The number of counters.
+       * @param digits The length of the OTPs. Defaults to 6.
+       * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+       * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+       */
+      HotpRange(
+          const Key &key,
+          std::uint64_t counter,
+          std::uint64_t count,
+          unsigned int digits = 6,
+          unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+          unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+      /**
+       * The range refers to the key, so it cannot be constructed from a temporary one.
+       */
+      HotpRange(
+          const Key &&key,
+          std::uint64_t counter,
+          std::uint64_t count,
+          unsigned int digits = 6,
+          unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+          unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT) = delete;
+
+      iterator begin() const { return iterator(m_key, m_first, 0, m_count, m_digits); }
+      iterator end() const { return iterator(m_key, m_first, m_count, m_count, m_digits); }
+
+      /**
+       * Returns the number of counters.
+       */
+      std::uint64_t size() const { return m_count; }
+
+      /**
+       * Returns the length of the OTPs.
+       */
+      unsigned int digits() const { return m_digits; }
+
+   private:
+      const Key *m_key = nullptr;
+      std::uint64_t m_first = 0;
+      std::uint64_t m_count = 0;
+      unsigned int m_digits = 6;
+   };
+}
+
+// Iterators hold the key and the counters, not the range, so they stay valid after the range is gone.
+template <>
+inline constexpr bool std::ranges::enable_borrowed_range<libqotp::core::HotpRange> = true;
+
+#endif
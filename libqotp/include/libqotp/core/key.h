@@ -0,0 +1,114 @@
+#ifndef LIBQOTP_CORE_KEY_H_20261018
+#define LIBQOTP_CORE_KEY_H_20261018
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace libqotp
+{
+   namespace detail
+   {
+      struct KeyAccess;
+   }
+
+   namespace core
+   {
+      /**
+       * The hash algorithms HOTP and TOTP are defined for.
+       */
+      enum class Algorithm
+      {
+         // HMAC-SHA-1, the algorithm of RFC 4226 and the default of RFC 6238.
+         Sha1,
+
+         // HMAC-SHA-256, allowed by RFC 6238.
+         Sha256,
+
+         // HMAC-SHA-512, allowed by RFC 6238.
+         Sha512
+      };
+
+      /**
+       * A shared secret prepared for repeated HMAC computation, without any Qt dependency.
+       *
+       * HMAC (RFC 2104) hashes the key padded with ipad and opad in front of every message. For a given
+       * secret these two blocks never change, so Key compresses them once on construction and stores the
+       * resulting SHA chaining states (the HMAC "midstates"). Every following HMAC only has to process the
+       * message itself, which for an 8 byte HOTP counter is a single block for the inner and a single block
+       * for the outer hash.
+       *
+       * The secret itself is not retained. The cached midstates are as sensitive as the secret and are
+       * wiped when the object is destroyed. libqotp::OtpKey wraps a Key for the Qt API.
+       */
+      class Key
+      {
+      public:
+         /**
+          * Constructs an invalid key.
+          */
+         Key() = default;
+
+         /**
+          * Prepares the HMAC state for the given secret and algorithm.
+          *
+          * @param secret The shared secret key.
+          * @param algorithm The hash algorithm to be used. Defaults to Algorithm::Sha1.
+          *
+          * The key is invalid if the secret is empty or the algorithm is not supported.
+          */
+         explicit Key(std::span<const std::byte> secret, Algorithm algorithm = Algorithm::Sha1);
+
+         Key(const Key &other) = default;
+         Key &operator=(const Key &other) = default;
+         ~Key();
+
+         /**
+          * Returns true if the key was constructed from a non-empty secret and a supported algorithm.
+          */
+         bool isValid() const { return m_valid; }
+
+         /**
+          * Returns the hash algorithm the key was prepared for.
+          */
+         Algorithm algorithm() const { return m_algorithm; }
+
+         /**
+          * Returns the length in bytes of the HMAC produced by this key, or 0 if the key is invalid.
+          */
+         std::size_t hashLength() const;
+
+         /**
+          * Computes HMAC(secret, message) using the cached midstates.
+          *
+          * @param message The message to authenticate.
+          * @param digest The buffer receiving the HMAC. Must hold at least hashLength() bytes.
+          * @return The number of bytes written to 'digest', or 0 if the key is invalid or 'digest' is too small.
+          */
+         std::size_t hmac(std::span<const std::byte> message, std::span<std::byte> digest) const;
+
+         /**
+          * Wipes the cached midstates and makes the key invalid.
+          */
+         void clear();
+
+      private:
+         friend struct detail::KeyAccess;
+
+         // Chaining state of the underlying hash. SHA-1 and SHA-256 use the 32-bit words,
+         // SHA-512 uses the 64-bit words.
+         union State
+         {
+            std::uint64_t words64[8];
+            std::uint32_t words32[16];
+         };
+
+         State m_inner = {};
+         State m_outer = {};
+         Algorithm m_algorithm = Algorithm::Sha1;
+         bool m_valid = false;
+      };
+   }
+}
+
+#endif
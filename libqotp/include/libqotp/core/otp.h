@@ -0,0 +1,411 @@
+#ifndef LIBQOTP_CORE_OTP_H_20261018
+#define LIBQOTP_CORE_OTP_H_20261018
+
+#include <libqotp/core/key.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+/**
+ * @def QOTP_MINIMUM_DIGIT
+ *
+ * Defines the minimum number of digits for the generated HOTP value.
+ *
+ * This macro sets the lower limit on the length of the one-time password (OTP) generated by the HOTP algorithm.
+ * The RFC 4226 recommends that OTPs should have a minimum length of 6 digits to ensure a reasonable level of security.
+ * Users of the library can define this macro to increase the minimum length requirement if desired.
+ *
+ * The default value is set to 6 if it is not defined prior to including this library.
+ *
+ * Usage example:
+ *     #define QOTP_MINIMUM_DIGIT 6
+ *     #include <libqotp/qotp.h>
+ */
+#ifndef QOTP_MINIMUM_DIGIT
+#define QOTP_MINIMUM_DIGIT 6
+#endif
+
+/**
+ * @def QOTP_MAXIMUM_DIGIT
+ *
+ * Defines the maximum number of digits for the generated HOTP value.
+ *
+ * This macro sets the upper limit on the length of the one-time password (OTP) generated by the HOTP algorithm.
+ * While the HOTP algorithm can technically generate OTPs of any length, values longer than 8 digits are typically not
+ * user-friendly and are often not supported by OTP systems. Users of the library can define this macro to decrease the
+ * maximum length requirement if desired, keeping in mind usability considerations.
+ *
+ * The default value is set to 8 if it is not defined prior to including this library.
+ *
+ * Usage example:
+ *     #define QOTP_MAXIMUM_DIGIT 8
+ *     #include <libqotp/qotp.h>
+ */
+#ifndef QOTP_MAXIMUM_DIGIT
+#define QOTP_MAXIMUM_DIGIT 8
+#endif
+
+// The Qt-free core of the library.
+//
+// These functions depend on the C++ standard library only: secrets are byte spans, codes are integers or
+// characters written into caller-provided buffers, and time is a std::chrono time point. Nothing allocates.
+// Applications that only verify codes can link libqotp_core alone. The functions in libqotp/qotp.h are
+// thin Qt wrappers around these.
+namespace libqotp::core
+{
+   /**
+    * Returns the current system time in whole seconds, the default time of the TOTP functions.
+    */
+   inline std::chrono::sys_seconds current_time()
+   {
+      return std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+   }
+
+   /**
+    * Computes an HMAC-based One-Time Password (HOTP, RFC 4226) as integer.
+    *
+    * Leading zeros are implicit: the code 1234 with 6 digits is displayed as "001234".
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The moving factor (counter value) for HOTP generation.
+    * @param digits The desired length of the OTP. Defaults to 6 if not specified.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The OTP value, or std::nullopt if the key is invalid or 'digits' is out of range.
+    */
+   std::optional<std::uint32_t> hotp_value(
+       const Key &key,
+       std::uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes an HOTP value from a raw secret. The HMAC key state is derived on the stack.
+    *
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<std::uint32_t> hotp_value(
+       std::span<const std::byte> secret,
+       std::uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       Algorithm algorithm = Algorithm::Sha1);
+
+   /**
+    * Writes an HOTP as exactly 'digits' zero-padded ASCII digits into a caller-provided buffer.
+    *
+    * No terminator is written. A buffer of 10 characters is large enough for every supported digit count.
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The moving factor (counter value) for HOTP generation.
+    * @param output The buffer receiving the digits.
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   std::size_t hotp(
+       const Key &key,
+       std::uint64_t counter,
+       std::span<char> output,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Writes an HOTP from a raw secret into a caller-provided buffer.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   std::size_t hotp(
+       std::span<const std::byte> secret,
+       std::uint64_t counter,
+       std::span<char> output,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       Algorithm algorithm = Algorithm::Sha1);
+
+   /**
+    * Resynchronizes an HOTP counter with a token that moved ahead, as described in RFC 4226 section 7.4.
+    *
+    * Searches counter, counter + 1, ..., counter + lookAhead for the code. Every candidate is computed
+    * and compared, so the duration does not depend on whether or where the code matched.
+    *
+    * @return The new counter to store, which is the counter following the matched one, or std::nullopt if
+    *         no counter in the window matched or the input is invalid. If several counters match, the
+    *         lowest one wins.
+    */
+   std::optional<std::uint64_t> hotp_resync(
+       const Key &key,
+       std::uint64_t counter,
+       std::uint32_t code,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Resynchronizes an HOTP counter using one or two consecutive codes. With two codes a counter only
+    * matches if codes[0] is its code and codes[1] the code of the following counter.
+    *
+    * @return The new counter to store, which follows the counter of the last code, or std::nullopt.
+    */
+   std::optional<std::uint64_t> hotp_resync(
+       const Key &key,
+       std::uint64_t counter,
+       std::span<const std::uint32_t> codes,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Returns the TOTP time step counter (RFC 6238 section 4.2) for a point in time.
+    *
+    * @param time The point in time.
+    * @param timeStep The time step. The RFC recommends 30 seconds.
+    * @param epoch The time counting starts at. Usually the Unix epoch.
+    * @return The counter, or std::nullopt if 'timeStep' is not positive or 'time' lies before 'epoch'.
+    */
+   std::optional<std::uint64_t> totp_counter(
+       std::chrono::sys_seconds time,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds());
+
+   /**
+    * Computes a Time-Based One-Time Password (TOTP, RFC 6238) as integer.
+    *
+    * @param key The precomputed shared secret key.
+    * @param time The point in time. Defaults to the current time.
+    * @param timeStep The time step. The RFC recommends 30 seconds.
+    * @param epoch The time counting starts at. Usually the Unix epoch.
+    * @param digits The length of the OTP. Defaults to 8.
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<std::uint32_t> totp_value(
+       const Key &key,
+       std::chrono::sys_seconds time = current_time(),
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes a TOTP value from a raw secret. The HMAC key state is derived on the stack.
+    *
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<std::uint32_t> totp_value(
+       std::span<const std::byte> secret,
+       std::chrono::sys_seconds time = current_time(),
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       Algorithm algorithm = Algorithm::Sha1);
+
+   /**
+    * Writes a TOTP as exactly 'digits' zero-padded ASCII digits into a caller-provided buffer.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   std::size_t totp(
+       const Key &key,
+       std::chrono::sys_seconds time,
+       std::span<char> output,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Writes a TOTP from a raw secret into a caller-provided buffer.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   std::size_t totp(
+       std::span<const std::byte> secret,
+       std::chrono::sys_seconds time,
+       std::span<char> output,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       Algorithm algorithm = Algorithm::Sha1);
+
+   /**
+    * Verifies a TOTP against the current time step and 'window' steps before and after it (RFC 6238 section 5.2).
+    *
+    * Every candidate is computed and compared in constant time, so the duration does not depend on
+    * whether or where the code matched. A successful verification does not prevent replay of the same code.
+    *
+    * @param key The precomputed shared secret key.
+    * @param code The code entered by the user.
+    * @param time The point in time. Defaults to the current time.
+    * @param window The number of time steps accepted before and after the current one. Defaults to 1.
+    * @return The offset in time steps of the matching code (0 for the current step, -1 for the previous one,
+    *         and so on), or std::nullopt if no code in the window matched or the input is invalid.
+    *         If several steps match, the one closest to the current step is returned.
+    */
+   std::optional<int> totp_verify(
+       const Key &key,
+       std::uint32_t code,
+       std::chrono::sys_seconds time = current_time(),
+       unsigned int window = 1,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Verifies a TOTP given as characters. The code must consist of exactly 'digits' decimal digits.
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       const Key &key,
+       std::string_view code,
+       std::chrono::sys_seconds time = current_time(),
+       unsigned int window = 1,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Verifies a TOTP against a raw secret. The HMAC state is derived once and shared by all candidates.
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       std::span<const std::byte> secret,
+       std::uint32_t code,
+       std::chrono::sys_seconds time = current_time(),
+       unsigned int window = 1,
+       std::chrono::seconds timeStep = std::chrono::seconds(30),
+       std::chrono::sys_seconds epoch = std::chrono::sys_seconds(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       Algorithm algorithm = Algorithm::Sha1);
+
+   /**
+    * HOTP (RFC 4226) for an algorithm and code length fixed at compile time.
+    *
+    * The hash length, the truncation bounds and the power of ten the code is reduced by are constants, so
+    * the truncation and formatting stage has no branches on the configuration and no loops of unknown length.
+    * The runtime functions dispatch to these instances. The library instantiates every algorithm with 1 to
+    * 10 digits. Unlike the runtime functions, the digit count is not checked against QOTP_MINIMUM_DIGIT and
+    * QOTP_MAXIMUM_DIGIT.
+    */
+   template <Algorithm HashAlgorithm, unsigned int Digits>
+   class Hotp
+   {
+      static_assert(Digits >= 1 && Digits <= 10, "A 31-bit truncated hash produces 1 to 10 digits");
+
+      static constexpr std::uint64_t power_of_ten(unsigned int exponent)
+      {
+         return exponent == 0 ? 1 : 10 * power_of_ten(exponent - 1);
+      }
+
+   public:
+      // The hash algorithm the key must have been prepared for.
+      static constexpr Algorithm algorithm = HashAlgorithm;
+
+      // The length of the code.
+      static constexpr unsigned int digits = Digits;
+
+      // The length of the HMAC in bytes.
+      static constexpr int hashLength = HashAlgorithm == Algorithm::Sha1 ? 20 : (HashAlgorithm == Algorithm::Sha256 ? 32 : 64);
+
+      // The highest offset dynamic truncation can take from the last byte of the HMAC. The four bytes
+      // after it are always inside the HMAC, so no offset needs a bounds check.
+      static constexpr int maximumOffset = 15;
+      static_assert(maximumOffset + 4 <= hashLength);
+
+      // The truncated hash is reduced modulo this value. For 10 digits it exceeds every 31-bit value.
+      static constexpr std::uint64_t modulus = power_of_ten(Digits);
+
+      /**
+       * Computes the code as integer.
+       *
+       * @return The OTP value, or std::nullopt if the key is invalid or prepared for another algorithm.
+       */
+      static std::optional<std::uint32_t> value(const Key &key, std::uint64_t counter);
+
+      /**
+       * Writes the code as exactly 'digits' zero-padded ASCII digits. No terminator is written.
+       *
+       * @return True on success, false if the key is invalid or prepared for another algorithm.
+       */
+      static bool write(const Key &key, std::uint64_t counter, std::span<char, Digits> output);
+   };
+
+   /**
+    * TOTP (RFC 6238) for an algorithm, code length and time step fixed at compile time.
+    *
+    * The time step is a constant as well, so the division of the elapsed time compiles to a multiplication.
+    */
+   template <Algorithm HashAlgorithm, unsigned int Digits, unsigned int TimeStep = 30>
+   class Totp
+   {
+      static_assert(TimeStep > 0, "The time step must not be zero");
+
+   public:
+      // The HOTP configuration used for the time step counter.
+      using HotpType = Hotp<HashAlgorithm, Digits>;
+
+      // The time step in seconds.
+      static constexpr unsigned int timeStep = TimeStep;
+
+      /**
+       * Returns the time step counter, or std::nullopt if 'time' lies before 'epoch'.
+       */
+      static constexpr std::optional<std::uint64_t> counter(std::chrono::sys_seconds time, std::chrono::sys_seconds epoch = std::chrono::sys_seconds())
+      {
+         if (time < epoch)
+         {
+            return std::nullopt;
+         }
+         return static_cast<std::uint64_t>((time - epoch).count()) / TimeStep;
+      }
+
+      /**
+       * Computes the code as integer.
+       *
+       * @return The OTP value, or std::nullopt if the key is invalid, prepared for another algorithm or 'time' lies before 'epoch'.
+       */
+      static std::optional<std::uint32_t> value(const Key &key, std::chrono::sys_seconds time = current_time(), std::chrono::sys_seconds epoch = std::chrono::sys_seconds())
+      {
+         const auto step = counter(time, epoch);
+         if (!step)
+         {
+            return std::nullopt;
+         }
+         return HotpType::value(key, *step);
+      }
+
+      /**
+       * Writes the code as exactly 'Digits' zero-padded ASCII digits. No terminator is written.
+       *
+       * @return True on success, false in case of an error.
+       */
+      static bool write(const Key &key, std::span<char, Digits> output, std::chrono::sys_seconds time = current_time(), std::chrono::sys_seconds epoch = std::chrono::sys_seconds())
+      {
+         const auto step = counter(time, epoch);
+         return step && HotpType::write(key, *step, output);
+      }
+   };
+}
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef LIBQOTP_COUNTERLOG_H_20261018
+#define LIBQOTP_COUNTERLOG_H_20261018
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+namespace libqotp
+{
+   /**
+    * The reasons a CounterLog operation can fail.
+    */
+   enum class CounterLogError
+   {
+      // The last operation succeeded.
+      None,
+
+      // The log or snapshot could not be opened or created.
+      OpenFailed,
+
+      // The snapshot or log does not start with a header of a supported version.
+      NotACounterLog,
+
+      // The snapshot is truncated or its checksum does not match, or a damaged group of log records is
+      // followed by intact ones. The counters cannot be recovered and the files are left as they are.
+      ChecksumMismatch,
+
+      // Writing or syncing the log or snapshot failed. After a failed write of the log, it refuses further
+      // updates until it is reopened.
+      WriteFailed,
+
+      // The log is not open.
+      NotOpen
+   };
+
+   /**
+    * The outcome of an update of a CounterLog.
+    */
+   enum class CounterLogResult
+   {
+      // The value was higher than the stored one and is durable.
+      Advanced,
+
+      // The stored value is as high or higher. Nothing was written; the code must be rejected.
+      Stale,
+
+      // The value could not be made durable. The code must be rejected.
+      Failed
+   };
+
+   /**
+    * One update for the batch overload of CounterLog::advance().
+    */
+   struct CounterUpdate
+   {
+      // The user, for example a key store index.
+      quint64 user = 0;
+
+      // The new value.
+      quint64 value = 0;
+   };
+
+   /**
+    * Options of a CounterLog.
+    */
+   struct CounterLogOptions
+   {
+      // The size in bytes the log may grow to before it is compacted into the snapshot. 0 disables
+      // automatic compaction; compact() still works.
+      qint64 compactBytes = 64 * 1024 * 1024;
+   };
+
+   /**
+    * Counters of a CounterLog.
+    */
+   struct CounterLogStats
+   {
+      // Records appended to the log since open().
+      quint64 records = 0;
+
+      // Syncs of the log since open(). Each one made a group of records durable.
+      quint64 syncs = 0;
+
+      // Compactions since open().
+      quint64 compactions = 0;
+
+      // Records replayed from the log by open().
+      quint64 recovered = 0;
+
+      // Bytes at the end of the log that open() discarded because they did not form a complete group with
+      // valid checksums, left by a crash during a write.
+      quint64 discarded = 0;
+   };
+
+   /**
+    * A durable table of one increasing value per user, for HOTP counters and accepted TOTP time steps.
+    *
+    * An HOTP verifier must store the counter of every user after each accepted code (RFC 4226 section 7.2),
+    * and a TOTP verifier that rejects replays across restarts must store the last accepted time step.
+    * CounterLog keeps these values in memory and makes every update durable in an append-only log before
+    * reporting it, without a round trip to a database.
+    *
+    * Updates are group committed: callers on all threads append their records to a shared buffer, and one
+    * of them writes the buffer and syncs it with a single fdatasync() for all of them while the next group
+    * collects. The number of syncs follows the rate of the disk, not the rate of updates, so throughput grows
+    * with the number of concurrent callers and with the size of batches passed to advance().
+    *
+    * Files: the snapshot at 'fileName' holds all values as of the last compaction and is replaced
+    * atomically through QSaveFile. The log at 'fileName' + ".log" holds the updates since, one group of
+    * records per sync, each group framed by its record count and a CRC-32C. open() loads the snapshot,
+    * replays the log and cuts the log after the last intact group, which undoes a write torn by a crash,
+    * even one that reached the disk with a hole in its middle; such a write was never reported as durable.
+    * A damaged group followed by intact ones is corruption of durable updates instead, and open() fails
+    * rather than lose them. When the log exceeds CounterLogOptions::compactBytes it is compacted: the
+    * table is written to a new snapshot and the log is emptied. A crash between the two replays the old
+    * log over the new snapshot, which changes nothing because values only increase.
+    *
+    * Values only increase, so an update that is not higher than the stored value is refused. This is the
+    * replay check: of two concurrent updates to the same value, one is Advanced and the other Stale.
+    *
+    * Usage example:
+    *     libqotp::CounterLog counters;
+    *     if (!counters.open("counters.qotp"))
+    *     {
+    *        qWarning() << "counter log unusable" << int(counters.error());
+    *     }
+    *     const auto next = libqotp::hotp_resync(key, counters.value(user).value_or(0), code, 10);
+    *     const bool valid = next && counters.advance(user, *next) == libqotp::CounterLogResult::Advanced;
+    *
+    * All members are safe to call from any number of threads.
+    */
+   class CounterLog
+   {
+   public:
+      /**
+       * Constructs a closed log.
+       */
+      explicit CounterLog(const CounterLogOptions &options = CounterLogOptions());
+      ~CounterLog();
+
+      CounterLog(const CounterLog &) = delete;
+      CounterLog &operator=(const CounterLog &) = delete;
+
+      /**
+       * Opens or creates the snapshot and log and recovers the values, closing the files opened before.
+       *
+       * @param fileName The snapshot file. The log is 'fileName' + ".log".
+       * @return true on success. On failure the log is closed and error() tells why.
+       */
+      bool open(const QString &fileName);
+
+      /**
+       * Waits for pending updates and closes the files. The values stay readable until the next open().
+       */
+      void close();
+
+      /**
+       * Returns true if the log is open.
+       */
+      bool isOpen() const;
+
+      /**
+       * Returns CounterLogError::None if the last call to open() or compact() succeeded and no write has
+       * failed since, otherwise the reason.
+       */
+      CounterLogError error() const;
+
+      /**
+       * Returns the durable value stored for 'user', or std::nullopt if it has none. Updates still being
+       * written are not reported until advance() returns Advanced for them.
+       */
+      std::optional<quint64> value(quint64 user) const;
+
+      /**
+       * Returns the number of users with a value.
+       */
+      qsizetype size() const;
+
+      /**
+       * Stores 'value' for 'user' if it is higher than the stored value, and returns once it is durable.
+       *
+       * @param user The user, for example a key store index.
+       * @param value The new value, for HOTP the next counter expected as returned by hotp_resync().
+       * @return CounterLogResult::Advanced if the value is stored and durable.
+       */
+      CounterLogResult advance(quint64 user, quint64 value);
+
+      /**
+       * Stores many values with one sync, results[i] receiving what advance(updates[i]) would return.
+       * Updates are applied in order, so of two updates of the same user the second only advances if it is higher.
+       *
+       * @param updates The users and their new values.
+       * @param results Receives one result per update. Must hold at least updates.size() elements.
+       * @return false if 'results' is too small, in which case nothing is written.
+       */
+      bool advance(std::span<const CounterUpdate> updates, std::span<CounterLogResult> results);
+
+      /**
+       * Writes all values to a new snapshot and empties the log.
+       *
+       * @return true on success. Sets error() otherwise.
+       */
+      bool compact();
+
+      /**
+       * Returns the counters since open().
+       */
+      CounterLogStats stats() const;
+
+   private:
+      // Makes the records up to group 'ticket' durable, writing as the leader of a group if no other
+      // thread does. Called and returns with 'lock' held.
+      bool commit(std::unique_lock<std::mutex> &lock, quint64 ticket);
+
+      // Waits until no thread writes, then makes this one the writer. Called and returns with 'lock' held.
+      void becomeWriter(std::unique_lock<std::mutex> &lock);
+
+      // compact() with 'lock' held
+      bool compact(std::unique_lock<std::mutex> &lock);
+
+      // Moves the values of the durable 'entries' into the table. Called with the lock held.
+      void publish(const QByteArray &entries);
+
+      bool recover(const QString &fileName);
+      bool writeSnapshot(const std::unordered_map<quint64, quint64> &values);
+
+      CounterLogOptions m_options;
+      QString m_fileName;
+      QFile m_log;
+
+      mutable std::mutex m_mutex;
+      std::condition_variable m_written;
+      // Durable values, and the highest value of each user that is still being written
+      std::unordered_map<quint64, quint64> m_values;
+      std::unordered_map<quint64, quint64> m_unsynced;
+      QByteArray m_pending;
+      quint64 m_groups = 0;
+      quint64 m_durable = 0;
+      qint64 m_logSize = 0;
+      bool m_writing = false;
+      bool m_open = false;
+      bool m_broken = false;
+      CounterLogError m_error = CounterLogError::NotOpen;
+      CounterLogStats m_stats;
+   };
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef LIBQOTP_HMACBACKEND_H_20261018
+#define LIBQOTP_HMACBACKEND_H_20261018
+
+#include <libqotp/core/hmacbackend.h>
+
+#include <QString>
+
+namespace libqotp
+{
+   // The backend selection lives in the Qt-free core, see libqotp/core/hmacbackend.h.
+   using core::HmacBackend;
+   using core::hmac_backend;
+   using core::hmac_backend_available;
+   using core::set_hmac_backend;
+   using core::HmacBatchLevel;
+   using core::hmac_batch_level;
+
+   /**
+    * Returns the name of a backend as accepted by the QOTP_HMAC environment variable.
+    */
+   QString hmac_backend_name(HmacBackend backend);
+
+   /**
+    * Returns the name of a batch level as accepted by the QOTP_SIMD environment variable.
+    */
+   QString hmac_batch_level_name(HmacBatchLevel level);
+}
+
+#endif
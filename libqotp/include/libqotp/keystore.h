@@ -0,0 +1,303 @@
+#ifndef LIBQOTP_KEYSTORE_H_20261018
+#define LIBQOTP_KEYSTORE_H_20261018
+
+#include <libqotp/otpauth.h>
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+class QSaveFile;
+
+namespace libqotp
+{
+   /**
+    * The reasons a KeyStore or KeyStoreWriter operation can fail.
+    */
+   enum class KeyStoreError
+   {
+      // The last operation succeeded.
+      None,
+
+      // The file could not be opened, mapped or created.
+      OpenFailed,
+
+      // The file does not start with a key store header of a supported version.
+      NotAKeyStore,
+
+      // The file is shorter or longer than its header says.
+      Truncated,
+
+      // A checksum does not match, the file is corrupt.
+      ChecksumMismatch,
+
+      // Writing or committing the file failed.
+      WriteFailed,
+
+      // The key is invalid, or its digits or period are out of range.
+      InvalidKey
+   };
+
+   /**
+    * The verification parameters of one key store record.
+    */
+   struct KeyStoreRecord
+   {
+      // The HMAC hash algorithm.
+      QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1;
+
+      // The number of digits of a code.
+      unsigned int digits = 6;
+
+      // The TOTP time step in seconds, or 0 for an HOTP key.
+      unsigned int period = 30;
+
+      // The Unix epoch for the TOTP calculation.
+      quint64 epoch = 0;
+   };
+
+   /**
+    * One code to verify against a record, for the batch overload of KeyStore::totp_verify().
+    */
+   struct KeyStoreCheck
+   {
+      // The record of the user.
+      qsizetype index = 0;
+
+      // The code entered by the user.
+      quint32 code = 0;
+   };
+
+   /**
+    * A read-only file of precomputed keys, verified against in place.
+    *
+    * Loading millions of users from Base32 secrets means decoding every secret and deriving its HMAC
+    * midstates (see OtpKey) before the first code can be checked. A key store holds the derived midstates
+    * together with the digits, period and epoch of each key in fixed-size records, so opening it maps the
+    * file into memory and costs the same for ten users as for ten million. Records are addressed by index;
+    * mapping user IDs to indexes is left to the application.
+    *
+    * The file is laid out as structure of arrays: a 64-byte header, then one column each for the
+    * midstates, epochs, periods, checksums, algorithms and digits. All integers are little endian. The
+    * header carries a checksum of itself, each record a CRC-32C of its fields and its index. open() only
+    * checks the header, so it stays constant time; every lookup checks the checksum of its record and
+    * fails closed on a mismatch. verifyChecksums() checks all records at once.
+    *
+    * The mapping is shared, so worker processes opening the same file share its pages in the page cache.
+    * The midstates are as sensitive as the secrets; KeyStoreWriter creates the file readable by its owner
+    * only. Files are written by KeyStoreWriter and never modified in place.
+    *
+    * Usage example:
+    *     libqotp::KeyStore store;
+    *     if (!store.open("users.qotpkeys"))
+    *     {
+    *        qWarning() << "key store unusable" << int(store.error());
+    *     }
+    *     const bool valid = store.totp_verify(userIndex, code).has_value();
+    *
+    * Lookups are const and safe to call from any number of threads.
+    */
+   class KeyStore
+   {
+   public:
+      /**
+       * Constructs a closed store.
+       */
+      KeyStore();
+      ~KeyStore();
+
+      KeyStore(const KeyStore &) = delete;
+      KeyStore &operator=(const KeyStore &) = delete;
+
+      /**
+       * Maps a key store file, closing the file opened before.
+       *
+       * @param fileName The file written by KeyStoreWriter.
+       * @return true on success. On failure the store is closed and error() tells why.
+       */
+      bool open(const QString &fileName);
+
+      /**
+       * Unmaps the file. Keys returned by key() stay valid, they are copies.
+       */
+      void close();
+
+      /**
+       * Returns true if a file is mapped.
+       */
+      bool isOpen() const { return m_data != nullptr; }
+
+      /**
+       * Returns KeyStoreError::None if the last call to open() or verifyChecksums() succeeded,
+       * otherwise the reason it failed.
+       */
+      KeyStoreError error() const { return m_error; }
+
+      /**
+       * Returns the number of records, 0 if the store is closed.
+       */
+      qsizetype size() const { return m_count; }
+
+      /**
+       * Returns the verification parameters of record 'index', or std::nullopt if the index is out of
+       * range or the record is corrupt.
+       */
+      std::optional<KeyStoreRecord> record(qsizetype index) const;
+
+      /**
+       * Returns the precomputed key of record 'index', for use with the functions of libqotp/core/otp.h.
+       * The key is invalid if the index is out of range or the record is corrupt.
+       */
+      core::Key key(qsizetype index) const;
+
+      /**
+       * Verifies a TOTP with the key, digits, period and epoch of record 'index'. Behaves like totp_verify().
+       *
+       * @param index The record of the user.
+       * @param code The code entered by the user.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+       * @param window The number of time steps accepted before and after the current one. Defaults to 1.
+       * @return The offset in time steps of the matching code, or std::nullopt if no code matched, the
+       *         record is an HOTP key or corrupt, or the index is out of range.
+       */
+      std::optional<int> totp_verify(
+          qsizetype index,
+          quint32 code,
+          quint64 currentUnixTime = current_unix_time(),
+          unsigned int window = 1) const;
+
+      /**
+       * Verifies many TOTPs at once, results[i] receiving what totp_verify(checks[i].index, checks[i].code)
+       * would return.
+       *
+       * The candidates of all checks go through the multi-buffer HMAC engine together, so records of the
+       * same hash algorithm share vector lanes even though each contributes only a few candidates. Every
+       * candidate is computed and compared in constant time, as for a single check.
+       *
+       * @param checks The records and the codes to verify against them.
+       * @param results Receives one result per check. Must hold at least checks.size() elements.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds shared by all checks.
+       * @param window The number of time steps accepted before and after the current one. Defaults to 1.
+       * @return false if 'results' is too small, in which case nothing is written.
+       */
+      bool totp_verify(
+          std::span<const KeyStoreCheck> checks,
+          std::span<std::optional<int>> results,
+          quint64 currentUnixTime = current_unix_time(),
+          unsigned int window = 1) const;
+
+      /**
+       * Calculates the TOTP of record 'index' as a number, or std::nullopt if the record is an HOTP key,
+       * corrupt, or the index is out of range.
+       */
+      std::optional<quint32> totp_value(qsizetype index, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Calculates the HOTP of record 'index' for 'counter' as a number, or std::nullopt if the record is
+       * corrupt or the index is out of range. TOTP records are accepted as well.
+       */
+      std::optional<quint32> hotp_value(qsizetype index, quint64 counter) const;
+
+      /**
+       * Checks the checksums of all records, for example after copying the file or in a periodic scrub.
+       *
+       * @return true if all records are intact. Sets error() to KeyStoreError::ChecksumMismatch otherwise.
+       */
+      bool verifyChecksums();
+
+   private:
+      // Checks the checksum of record 'index' and loads its key and parameters, either of which may be null.
+      bool load(qsizetype index, core::Key *key, KeyStoreRecord *record) const;
+
+      QFile m_file;
+      const uchar *m_data = nullptr;
+      qsizetype m_count = 0;
+      KeyStoreError m_error = KeyStoreError::None;
+   };
+
+   /**
+    * Writes a key store file record by record.
+    *
+    * The midstates, which make up most of the file, are written out as keys are added; only the small
+    * columns are kept in memory until commit(). The file is written through QSaveFile, so an existing
+    * store is replaced atomically on commit() and left untouched if the writer is destroyed before.
+    *
+    * Usage example:
+    *     libqotp::KeyStoreWriter writer("users.qotpkeys");
+    *     libqotp::OtpAuthReader reader(&exportFile);
+    *     while (reader.readNext())
+    *     {
+    *        if (reader.error() == libqotp::OtpAuthError::None)
+    *        {
+    *           writer.add(reader.uri());
+    *        }
+    *     }
+    *     writer.commit();
+    */
+   class KeyStoreWriter
+   {
+   public:
+      /**
+       * Starts writing a key store to 'fileName'. Check error() to see whether the file could be created.
+       */
+      explicit KeyStoreWriter(const QString &fileName);
+
+      /**
+       * Discards the file unless commit() was called.
+       */
+      ~KeyStoreWriter();
+
+      KeyStoreWriter(const KeyStoreWriter &) = delete;
+      KeyStoreWriter &operator=(const KeyStoreWriter &) = delete;
+
+      /**
+       * Appends a record. Its index is the number of records added before.
+       *
+       * @param key The precomputed key. Must be valid.
+       * @param digits The length of the OTP, within QOTP_MINIMUM_DIGIT and QOTP_MAXIMUM_DIGIT. Defaults to 6.
+       * @param period The TOTP time step in seconds, or 0 for an HOTP key. Defaults to 30.
+       * @param epoch The Unix epoch for the TOTP calculation. Defaults to 0 (Unix epoch).
+       * @return true on success. Records that fail are not added, a failed write fails commit() as well.
+       */
+      bool add(const OtpKey &key, unsigned int digits = 6, unsigned int period = 30, quint64 epoch = 0);
+
+      /**
+       * Appends the key of an otpauth:// URI, with its digits and period, or a period of 0 for HOTP.
+       * The HOTP counter is not part of the store.
+       */
+      bool add(const OtpAuthUri &uri);
+
+      /**
+       * Returns the number of records added.
+       */
+      qsizetype count() const { return static_cast<qsizetype>(m_checksums.size()); }
+
+      /**
+       * Returns KeyStoreError::None if the last operation succeeded, otherwise the reason it failed.
+       */
+      KeyStoreError error() const { return m_error; }
+
+      /**
+       * Writes the remaining columns and the header and replaces 'fileName' with the new store.
+       *
+       * @return true on success. No records can be added afterwards.
+       */
+      bool commit();
+
+   private:
+      std::unique_ptr<QSaveFile> m_file;
+      std::vector<quint64> m_epochs;
+      std::vector<quint32> m_periods;
+      std::vector<quint32> m_checksums;
+      std::vector<quint8> m_algorithms;
+      std::vector<quint8> m_digits;
+      bool m_failed = false;
+      KeyStoreError m_error = KeyStoreError::None;
+   };
+}
+
+#endif
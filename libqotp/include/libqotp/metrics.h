@@ -0,0 +1,87 @@
+#ifndef LIBQOTP_METRICS_H_20261018
+#define LIBQOTP_METRICS_H_20261018
+
+#include <libqotp/core/key.h>
+#include <libqotp/result.h>
+
+#include <array>
+#include <chrono>
+
+#include <QtGlobal>
+
+namespace libqotp
+{
+   /**
+    * Whether the library records metrics. Set by building with -DWITH_METRICS=ON, which defines
+    * QOTP_WITH_METRICS. Without it the recording compiles to nothing and metrics() returns zeros.
+    */
+#ifdef QOTP_WITH_METRICS
+   inline constexpr bool metrics_enabled = true;
+#else
+   inline constexpr bool metrics_enabled = false;
+#endif
+
+   // One in this many OTP operations of a thread has its duration measured.
+   inline constexpr unsigned int metrics_sample_interval = 64;
+
+   /**
+    * Counters of the OTP hot path, summed over all threads.
+    *
+    * An operation is one call of hotp(), totp(), hotp_value(), totp_value() or totp_verify() and their
+    * try_ variants, on the key or the secret overloads; Base32 decoding failures are counted as well.
+    * The batch, AsyncVerifier and TotpCache paths are not recorded.
+    */
+   struct Metrics
+   {
+      // The number of latency buckets. Bucket i counts samples of [2^(i-1), 2^i) nanoseconds, the last
+      // bucket also everything longer.
+      static constexpr int latency_buckets = 32;
+
+      // Operations per hash algorithm, indexed by core::Algorithm. Operations with an unsupported
+      // algorithm are only counted as failures.
+      std::array<quint64, 3> calls{};
+
+      // Failed operations and decodings per reason, indexed by OtpError. failures[OtpError::None] is unused.
+      std::array<quint64, otp_error_count> failures{};
+
+      // Sampled operation durations.
+      std::array<quint64, latency_buckets> latency{};
+
+      /**
+       * Returns the number of operations with 'algorithm'.
+       */
+      quint64 callCount(core::Algorithm algorithm) const { return calls[static_cast<int>(algorithm)]; }
+
+      /**
+       * Returns the number of failures for 'error'.
+       */
+      quint64 failureCount(OtpError error) const { return failures[static_cast<int>(error)]; }
+
+      /**
+       * Returns the number of sampled durations.
+       */
+      quint64 samples() const;
+
+      /**
+       * Returns an upper bound of the duration below which 'fraction' of the samples lie, for example
+       * 0.99 for the 99th percentile, at the resolution of the buckets. Returns 0 without samples.
+       */
+      std::chrono::nanoseconds latencyPercentile(double fraction) const;
+   };
+
+   /**
+    * Returns the metrics recorded since the start of the process or the last reset_metrics().
+    *
+    * Every thread counts into its own block, so recording takes no lock and shares no cache line. This
+    * function sums the blocks of all threads, including the ones that already exited. Operations running
+    * concurrently may or may not be included.
+    */
+   Metrics metrics();
+
+   /**
+    * Makes metrics() count from now on.
+    */
+   void reset_metrics();
+}
+
+#endif
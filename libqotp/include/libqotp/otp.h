@@ -0,0 +1,158 @@
+#ifndef LIBQOTP_OTP_H_20261018
+#define LIBQOTP_OTP_H_20261018
+
+#include <libqotp/core/otp.h>
+#include <libqotp/qotp.h>
+
+#include <optional>
+#include <span>
+
+#include <QString>
+
+namespace libqotp
+{
+   /**
+    * HOTP (RFC 4226) for an algorithm and code length fixed at compile time.
+    *
+    * Most deployments use a single configuration, for example SHA-1 with 6 digits. Hotp fixes the hash
+    * length, the truncation bounds and the power of ten the code is reduced by as constants, so the
+    * truncation and formatting stage has no branches on the configuration and no loops of unknown length.
+    * The runtime functions hotp(), hotp_value() and their overloads dispatch to these instances.
+    *
+    * Hotp wraps the Qt-free core::Hotp instance, which the library instantiates for every supported
+    * combination: QCryptographicHash::Sha1, Sha256 and Sha512 with 1 to 10 digits. Unlike the runtime
+    * functions, the digit count is not checked against QOTP_MINIMUM_DIGIT and QOTP_MAXIMUM_DIGIT.
+    *
+    * Example:
+    * @code
+    *     using Code = libqotp::Hotp<QCryptographicHash::Sha1, 6>;
+    *     const libqotp::OtpKey key(secret);
+    *     std::optional<quint32> value = Code::value(key, counter);
+    * @endcode
+    */
+   template <QCryptographicHash::Algorithm Algorithm, unsigned int Digits>
+   class Hotp
+   {
+      static_assert(Algorithm == QCryptographicHash::Sha1 || Algorithm == QCryptographicHash::Sha256 || Algorithm == QCryptographicHash::Sha512,
+                    "Hotp supports QCryptographicHash::Sha1, Sha256 and Sha512");
+
+   public:
+      // The Qt-free instance that computes the codes.
+      using CoreType = core::Hotp<*detail::core_algorithm(Algorithm), Digits>;
+
+      // The hash algorithm the key must have been prepared for.
+      static constexpr QCryptographicHash::Algorithm algorithm = Algorithm;
+
+      // The length of the code.
+      static constexpr unsigned int digits = Digits;
+
+      // The length of the HMAC in bytes.
+      static constexpr int hashLength = CoreType::hashLength;
+
+      // The highest offset dynamic truncation can take from the last byte of the HMAC.
+      static constexpr int maximumOffset = CoreType::maximumOffset;
+
+      // The truncated hash is reduced modulo this value. For 10 digits it exceeds every 31-bit value.
+      static constexpr quint64 modulus = CoreType::modulus;
+
+      /**
+       * Computes the code as integer.
+       *
+       * @param key The precomputed shared secret key. Must have been prepared for 'algorithm'.
+       * @param counter The moving factor (counter value) for HOTP generation.
+       * @return The OTP value, or std::nullopt if the key is invalid or prepared for another algorithm.
+       */
+      static std::optional<quint32> value(const OtpKey &key, quint64 counter)
+      {
+         return CoreType::value(key.coreKey(), counter);
+      }
+
+      /**
+       * Writes the code as exactly 'digits' zero-padded ASCII digits. No terminator is written.
+       *
+       * @return True on success, false if the key is invalid or prepared for another algorithm.
+       */
+      static bool write(const OtpKey &key, quint64 counter, std::span<char, Digits> output)
+      {
+         return CoreType::write(key.coreKey(), counter, output);
+      }
+
+      /**
+       * Generates the code as zero-padded string.
+       *
+       * @return A QString containing the OTP. Returns an empty string if the key is invalid or prepared for another algorithm.
+       */
+      static QString generate(const OtpKey &key, quint64 counter)
+      {
+         char buffer[Digits];
+         if (!write(key, counter, buffer))
+         {
+            return QString();
+         }
+
+         return QString::fromLatin1(buffer, Digits);
+      }
+   };
+
+   /**
+    * TOTP (RFC 6238) for an algorithm, code length and time step fixed at compile time.
+    *
+    * The time step is a constant as well, so the division of the Unix time compiles to a multiplication.
+    * The code itself is computed by the matching Hotp instance.
+    */
+   template <QCryptographicHash::Algorithm Algorithm, unsigned int Digits, unsigned int TimeStep = 30>
+   class Totp
+   {
+      static_assert(TimeStep > 0, "The time step must not be zero");
+
+   public:
+      // The HOTP configuration used for the time step counter.
+      using HotpType = Hotp<Algorithm, Digits>;
+
+      // The time step in seconds.
+      static constexpr unsigned int timeStep = TimeStep;
+
+      /**
+       * Returns the time step counter for a Unix time.
+       */
+      static constexpr quint64 counter(quint64 currentUnixTime, quint64 epoch = 0)
+      {
+         return (currentUnixTime - epoch) / TimeStep;
+      }
+
+      /**
+       * Computes the code as integer.
+       *
+       * @param key The precomputed shared secret key. Must have been prepared for 'Algorithm'.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+       * @param epoch The Unix epoch for the TOTP calculation. Usually 0 (Unix epoch).
+       * @return The OTP value, or std::nullopt if the key is invalid or prepared for another algorithm.
+       */
+      static std::optional<quint32> value(const OtpKey &key, quint64 currentUnixTime = current_unix_time(), quint64 epoch = 0)
+      {
+         return HotpType::value(key, counter(currentUnixTime, epoch));
+      }
+
+      /**
+       * Writes the code as exactly 'Digits' zero-padded ASCII digits. No terminator is written.
+       *
+       * @return True on success, false if the key is invalid or prepared for another algorithm.
+       */
+      static bool write(const OtpKey &key, std::span<char, Digits> output, quint64 currentUnixTime = current_unix_time(), quint64 epoch = 0)
+      {
+         return HotpType::write(key, counter(currentUnixTime, epoch), output);
+      }
+
+      /**
+       * Generates the code as zero-padded string.
+       *
+       * @return A QString containing the OTP. Returns an empty string if the key is invalid or prepared for another algorithm.
+       */
+      static QString generate(const OtpKey &key, quint64 currentUnixTime = current_unix_time(), quint64 epoch = 0)
+      {
+         return HotpType::generate(key, counter(currentUnixTime, epoch));
+      }
+   };
+}
+
+#endif
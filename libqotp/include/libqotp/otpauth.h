@@ -0,0 +1,231 @@
+#ifndef LIBQOTP_OTPAUTH_H_20261018
+#define LIBQOTP_OTPAUTH_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <span>
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+class QIODevice;
+
+namespace libqotp
+{
+   /**
+    * The OTP flavour of an otpauth:// URI.
+    */
+   enum class OtpType
+   {
+      // Time-based, RFC 6238.
+      Totp,
+
+      // Counter-based, RFC 4226.
+      Hotp
+   };
+
+   /**
+    * The reasons parse_otpauth_uri() can reject a URI.
+    */
+   enum class OtpAuthError
+   {
+      // The URI was parsed successfully.
+      None,
+
+      // The URI does not start with otpauth://.
+      InvalidScheme,
+
+      // The type is neither totp nor hotp.
+      InvalidType,
+
+      // A '%' is not followed by two hexadecimal digits.
+      InvalidEncoding,
+
+      // There is no secret parameter, or it is empty.
+      MissingSecret,
+
+      // The secret is not valid Base32.
+      InvalidSecret,
+
+      // The algorithm is not SHA1, SHA256 or SHA512.
+      InvalidAlgorithm,
+
+      // The digits are not a number within the accepted range.
+      InvalidDigits,
+
+      // The period is not a positive number.
+      InvalidPeriod,
+
+      // An hotp URI has no counter, or it is not a number.
+      InvalidCounter,
+
+      // The line is longer than the buffer of the OtpAuthReader.
+      LineTooLong
+   };
+
+   /**
+    * The parameters of an otpauth:// key URI.
+    *
+    * Returned by parse_otpauth_uri() with all views pointing into the parsed buffer, and accepted by
+    * write_otpauth_uri() with views pointing anywhere.
+    */
+   struct OtpAuthUri
+   {
+      // TOTP or HOTP.
+      OtpType type = OtpType::Totp;
+
+      // The issuer as UTF-8. Taken from the issuer parameter, or from the label prefix if the parameter is missing.
+      QByteArrayView issuer;
+
+      // The account name from the label as UTF-8.
+      QByteArrayView account;
+
+      // The raw shared secret, not Base32 encoded.
+      QByteArrayView secret;
+
+      // The HMAC hash algorithm.
+      QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1;
+
+      // The number of digits of a code.
+      unsigned int digits = 6;
+
+      // The time step in seconds. Only used for TOTP.
+      unsigned int period = 30;
+
+      // The initial counter. Only used for HOTP.
+      quint64 counter = 0;
+   };
+
+   /**
+    * Parses an otpauth:// key URI in place.
+    *
+    * The URI has the form otpauth://TYPE/LABEL?PARAMETERS as used by authenticator apps, for example
+    * otpauth://totp/Example:alice@example.com?secret=JBSWY3DPEHPK3PXP&issuer=Example&digits=6&period=30.
+    *
+    * Nothing is copied or allocated: percent-encoded text and the Base32 secret are decoded in place, and
+    * the views in 'result' point into 'uri'. They stay valid as long as the buffer does. The scheme, the
+    * type, the parameter names and the algorithm are matched case-insensitively. Unknown parameters are
+    * ignored; if a parameter is repeated, the last occurrence wins.
+    *
+    * @param uri The URI. Its content is overwritten while parsing, also if parsing fails.
+    * @param result Receives the parameters. Parameters missing from the URI keep their default values.
+    * @param digitMinimum The minimum accepted number of digits. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum accepted number of digits. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return OtpAuthError::None on success, otherwise the reason the URI was rejected.
+    */
+   OtpAuthError parse_otpauth_uri(
+       std::span<char> uri,
+       OtpAuthUri &result,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Appends the otpauth:// URI for 'uri' to 'buffer'.
+    *
+    * The label is written as "issuer:account", the secret as upper case Base32 without padding. The
+    * algorithm, digits and period are only written if they differ from the defaults, the counter is
+    * always written for HOTP. The issuer and account are percent-encoded.
+    *
+    * The buffer grows at most once per call. When writing many URIs, reuse one buffer and reset it with
+    * buffer.resize(0), which keeps its capacity.
+    *
+    * @param uri The parameters to write.
+    * @param buffer The buffer the URI is appended to.
+    * @return The number of bytes appended, or -1 if the secret is empty or the algorithm is not supported.
+    */
+   qsizetype write_otpauth_uri(const OtpAuthUri &uri, QByteArray &buffer);
+
+   /**
+    * Reads otpauth:// URIs from a device, one per line.
+    *
+    * The device is read in chunks into a fixed buffer, so files of any size are imported with constant
+    * memory. Each line is parsed in place in that buffer; the views of uri() are valid until the next call
+    * to readNext(). Empty lines and lines starting with '#' are skipped, surrounding whitespace and a
+    * trailing '\r' are ignored.
+    *
+    * Usage example:
+    *     QFile file("export.txt");
+    *     file.open(QIODevice::ReadOnly);
+    *     libqotp::OtpAuthReader reader(&file);
+    *     while (reader.readNext())
+    *     {
+    *        if (reader.error() == libqotp::OtpAuthError::None)
+    *        {
+    *           store(reader.uri().account, reader.key());
+    *        }
+    *     }
+    *
+    * The buffer is wiped when the reader is destroyed.
+    */
+   class OtpAuthReader
+   {
+   public:
+      /**
+       * Creates a reader for an open device.
+       *
+       * @param device The device to read from. Must stay valid for the lifetime of the reader.
+       * @param bufferSize The size of the read buffer, which is also the maximum length of a line.
+       * @param digitMinimum The minimum accepted number of digits. Defaults to QOTP_MINIMUM_DIGIT.
+       * @param digitMaximum The maximum accepted number of digits. Defaults to QOTP_MAXIMUM_DIGIT.
+       */
+      explicit OtpAuthReader(
+          QIODevice *device,
+          qsizetype bufferSize = 64 * 1024,
+          unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+          unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+      ~OtpAuthReader();
+
+      OtpAuthReader(const OtpAuthReader &) = delete;
+      OtpAuthReader &operator=(const OtpAuthReader &) = delete;
+
+      /**
+       * Advances to the next non-empty line and parses it.
+       *
+       * @return true if a line was read, whether or not it is a valid URI (see error()). false at the end
+       *         of the input or if the device failed (see atEnd()).
+       */
+      bool readNext();
+
+      /**
+       * Returns OtpAuthError::None if the current line is a valid URI, otherwise the reason it was rejected.
+       */
+      OtpAuthError error() const { return m_error; }
+
+      /**
+       * Returns the parameters of the current line. Only meaningful if error() is OtpAuthError::None.
+       */
+      const OtpAuthUri &uri() const { return m_uri; }
+
+      /**
+       * Returns the precomputed key of the current line, or an invalid key if the line was rejected.
+       */
+      OtpKey key() const;
+
+      /**
+       * Returns the 1-based number of the current line.
+       */
+      qint64 lineNumber() const { return m_lineNumber; }
+
+      /**
+       * Returns true once readNext() returned false because all input was consumed. Stays false if the
+       * device failed before its end.
+       */
+      bool atEnd() const { return m_atEnd; }
+
+   private:
+      QIODevice *m_device = nullptr;
+      QByteArray m_buffer;
+      qsizetype m_begin = 0;
+      qsizetype m_end = 0;
+      bool m_skipping = false;
+      bool m_eof = false;
+      bool m_atEnd = false;
+      unsigned int m_digitMinimum = QOTP_MINIMUM_DIGIT;
+      unsigned int m_digitMaximum = QOTP_MAXIMUM_DIGIT;
+      qint64 m_lineNumber = 0;
+      OtpAuthError m_error = OtpAuthError::None;
+      OtpAuthUri m_uri;
+   };
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef LIBQOTP_OTPKEY_H_20261018
+#define LIBQOTP_OTPKEY_H_20261018
+
+#include <libqotp/core/key.h>
+
+#include <optional>
+
+#include <QByteArrayView>
+#include <QCryptographicHash>
+
+namespace libqotp
+{
+   namespace detail
+   {
+      /**
+       * Maps a Qt hash algorithm to the algorithm of the Qt-free core, or std::nullopt if HOTP does not support it.
+       */
+      constexpr std::optional<core::Algorithm> core_algorithm(QCryptographicHash::Algorithm algorithm)
+      {
+         switch (algorithm)
+         {
+         case QCryptographicHash::Sha1:
+            return core::Algorithm::Sha1;
+         case QCryptographicHash::Sha256:
+            return core::Algorithm::Sha256;
+         case QCryptographicHash::Sha512:
+            return core::Algorithm::Sha512;
+         default:
+            return std::nullopt;
+         }
+      }
+   }
+
+   /**
+    * A shared secret prepared for repeated HMAC computation.
+    *
+    * HMAC (RFC 2104) hashes the key padded with ipad and opad in front of every message. For a given
+    * secret these two blocks never change, so OtpKey compresses them once on construction and stores
+    * the resulting SHA chaining states (the HMAC "midstates"). Every following HMAC only has to process
+    * the message itself, which for an 8 byte HOTP counter is a single block for the inner and a single
+    * block for the outer hash.
+    *
+    * Build one OtpKey per secret and reuse it for all codes generated or verified with that secret.
+    * The secret itself is not retained. The cached midstates are as sensitive as the secret and are
+    * wiped when the object is destroyed.
+    *
+    * Supported algorithms are QCryptographicHash::Sha1, QCryptographicHash::Sha256 and
+    * QCryptographicHash::Sha512, matching the algorithms accepted by libqotp::hotp().
+    *
+    * OtpKey is the Qt face of core::Key, which holds the state and does the work.
+    */
+   class OtpKey
+   {
+   public:
+      /**
+       * Constructs an invalid key.
+       */
+      OtpKey() = default;
+
+      /**
+       * Prepares the HMAC state for the given secret and algorithm.
+       *
+       * @param secret The shared secret key as a QByteArrayView.
+       * @param algorithm The cryptographic hash algorithm to be used. Defaults to QCryptographicHash::Sha1.
+       *
+       * The key is invalid if the secret is empty or the algorithm is not supported.
+       */
+      explicit OtpKey(QByteArrayView secret, QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+      /**
+       * Returns true if the key was constructed from a non-empty secret and a supported algorithm.
+       */
+      bool isValid() const { return m_key.isValid(); }
+
+      /**
+       * Returns the hash algorithm the key was prepared for.
+       */
+      QCryptographicHash::Algorithm algorithm() const { return m_algorithm; }
+
+      /**
+       * Returns the length in bytes of the HMAC produced by this key, or 0 if the key is invalid.
+       */
+      int hashLength() const;
+
+      /**
+       * Computes HMAC(secret, message) using the cached midstates.
+       *
+       * @param message The message to authenticate.
+       * @param digest Output buffer that must hold at least hashLength() bytes.
+       * @return The number of bytes written to 'digest', or 0 if the key is invalid.
+       */
+      int hmac(QByteArrayView message, char *digest) const;
+
+      /**
+       * Wipes the cached midstates and makes the key invalid.
+       */
+      void clear();
+
+      /**
+       * Returns the underlying key, for use with the Qt-free functions in libqotp/core/otp.h.
+       */
+      const core::Key &coreKey() const { return m_key; }
+
+   private:
+      core::Key m_key;
+      QCryptographicHash::Algorithm m_algorithm = QCryptographicHash::Sha1;
+   };
+}
+
+#endif
@@ -2,49 +2,19 @@
 #define LIBQOTP_H_20231127
 
 #include <cstdint>
+#include <optional>
+#include <span>
 
 #include <QString>
+#include <QStringView>
 #include <QDateTime>
 #include <QCryptographicHash>
 
-/**
- * @def QOTP_MINIMUM_DIGIT
- *
- * Defines the minimum number of digits for the generated HOTP value.
- *
- * This macro sets the lower limit on the length of the one-time password (OTP) generated by the HOTP algorithm.
- * The RFC 4226 recommends that OTPs should have a minimum length of 6 digits to ensure a reasonable level of security.
- * Users of the library can define this macro to increase the minimum length requirement if desired.
- *
- * The default value is set to 6 if it is not defined prior to including this library.
- *
- * Usage example:
- *     #define QOTP_MINIMUM_DIGIT 6
- *     #include <libqotp/qotp.h>
- */
-#ifndef QOTP_MINIMUM_DIGIT
-#define QOTP_MINIMUM_DIGIT 6
-#endif
-
-/**
- * @def QOTP_MAXIMUM_DIGIT
- *
- * Defines the maximum number of digits for the generated HOTP value.
- *
- * This macro sets the upper limit on the length of the one-time password (OTP) generated by the HOTP algorithm.
- * While the HOTP algorithm can technically generate OTPs of any length, values longer than 8 digits are typically not
- * user-friendly and are often not supported by OTP systems. Users of the library can define this macro to decrease the
- * maximum length requirement if desired, keeping in mind usability considerations.
- *
- * The default value is set to 8 if it is not defined prior to including this library.
- *
- * Usage example:
- *     #define QOTP_MAXIMUM_DIGIT 8
- *     #include <libqotp/qotp.h>
- */
-#ifndef QOTP_MAXIMUM_DIGIT
-#define QOTP_MAXIMUM_DIGIT 8
-#endif
+#include <libqotp/clock.h>
+#include <libqotp/core/hotprange.h>
+#include <libqotp/core/otp.h>
+#include <libqotp/otpkey.h>
+#include <libqotp/result.h>
 
 namespace libqotp
 {
@@ -81,6 +51,213 @@ namespace libqotp
        unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
        QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
 
+   /**
+    * Generates an HMAC-based One-Time Password (HOTP) from a precomputed key.
+    *
+    * Behaves like the QByteArrayView overload, but reuses the HMAC state cached in 'key' instead of
+    * re-deriving it from the secret. Use this overload when generating or verifying many codes for
+    * the same secret. The hash algorithm is the one the key was prepared for.
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The moving factor (counter value) for HOTP generation.
+    * @param digits The desired length of the OTP. Defaults to 6 if not specified.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return A QString containing the OTP. Returns an empty string if the key is invalid or on error.
+    */
+   QString hotp(
+       const OtpKey &key,
+       uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes an HMAC-based One-Time Password (HOTP) as integer.
+    *
+    * Same algorithm and validation as hotp(), but returns the numeric code instead of a string and does
+    * not allocate. Leading zeros are implicit: the code 1234 with 6 digits is displayed as "001234".
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The moving factor (counter value) for HOTP generation.
+    * @param digits The desired length of the OTP. Defaults to 6 if not specified.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<quint32> hotp_value(
+       const OtpKey &key,
+       uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Returns the HOTP values of 'count' consecutive counters starting at 'counter', computed lazily.
+    *
+    * The values are computed in blocks of consecutive counters when the iterators are dereferenced, see
+    * core::HotpRange. Iterators also write the current code into a reusable buffer, so long runs of codes
+    * need neither a QString nor an HMAC key schedule per code.
+    *
+    * @param key The precomputed shared secret key. Must outlive the range and its iterators.
+    * @param counter The first counter.
+    * @param count The number of counters.
+    * @param digits The desired length of the OTPs. Defaults to 6 if not specified.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The range, which is empty if the key is invalid or 'digits' is out of range.
+    */
+   core::HotpRange hotp_range(
+       const OtpKey &key,
+       uint64_t counter,
+       uint64_t count,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * The range refers to the key, so it cannot be created from a temporary one.
+    */
+   core::HotpRange hotp_range(
+       const OtpKey &&key,
+       uint64_t counter,
+       uint64_t count,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT) = delete;
+
+   /**
+    * Computes an HMAC-based One-Time Password (HOTP) as integer from a raw secret.
+    *
+    * The HMAC key state is derived on the stack, so this overload does not allocate either.
+    * Prefer the OtpKey overload when the same secret is used more than once.
+    *
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<quint32> hotp_value(
+       QByteArrayView secret,
+       uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Writes an HMAC-based One-Time Password (HOTP) as ASCII digits into a caller-provided buffer.
+    *
+    * Exactly 'digits' zero-padded characters are written, without a terminating null character.
+    * A buffer of 10 characters is large enough for every supported digit count.
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The moving factor (counter value) for HOTP generation.
+    * @param output The buffer receiving the digits.
+    * @param digits The desired length of the OTP. Defaults to 6 if not specified.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   qsizetype hotp(
+       const OtpKey &key,
+       uint64_t counter,
+       std::span<char> output,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Writes an HMAC-based One-Time Password (HOTP) from a raw secret into a caller-provided buffer.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   qsizetype hotp(
+       QByteArrayView secret,
+       uint64_t counter,
+       std::span<char> output,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Resynchronizes an HOTP counter with a token that moved ahead, as described in RFC 4226 section 7.4.
+    *
+    * Tokens advance their counter every time the button is pressed, also when the code is never used. The
+    * server then searches the look-ahead window counter, counter + 1, ..., counter + lookAhead for the code.
+    *
+    * All candidates are derived from the same key state and computed in batches by the multi-buffer HMAC
+    * engine. Every candidate in the window is computed and compared, so the duration does not depend on
+    * whether or where the code matched.
+    *
+    * @param key The precomputed shared secret key.
+    * @param counter The stored counter, the next counter the server expects.
+    * @param code The code entered by the user.
+    * @param lookAhead The number of counters searched after 'counter'. Defaults to 100.
+    * @param digits The length of the OTP. Defaults to 6.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The new counter to store, which is the counter following the matched one, or std::nullopt if
+    *         no counter in the window matched or the input is invalid. If several counters match, the
+    *         lowest one wins.
+    */
+   std::optional<quint64> hotp_resync(
+       const OtpKey &key,
+       quint64 counter,
+       quint32 code,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Resynchronizes an HOTP counter using one or two consecutive codes.
+    *
+    * With a large look-ahead window a single code also matches by chance, lookAhead / 10^digits of the time.
+    * RFC 4226 therefore recommends asking the user for the next code as well: a counter only matches if
+    * codes[0] is its code and codes[1] the code of the following counter.
+    *
+    * @param codes One code, or two codes the token displayed one after the other.
+    * @return The new counter to store, which follows the counter of the last code, or std::nullopt if
+    *         nothing matched, 'codes' does not hold one or two codes or the input is invalid.
+    */
+   std::optional<quint64> hotp_resync(
+       const OtpKey &key,
+       quint64 counter,
+       std::span<const quint32> codes,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Resynchronizes an HOTP counter against a raw secret. The HMAC state is derived once and shared by all candidates.
+    *
+    * @return The new counter to store, or std::nullopt.
+    */
+   std::optional<quint64> hotp_resync(
+       QByteArrayView secret,
+       quint64 counter,
+       quint32 code,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Resynchronizes an HOTP counter using one or two consecutive codes against a raw secret.
+    *
+    * @return The new counter to store, or std::nullopt.
+    */
+   std::optional<quint64> hotp_resync(
+       QByteArrayView secret,
+       quint64 counter,
+       std::span<const quint32> codes,
+       unsigned int lookAhead = 100,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
    /**
     * Generates a Time-Based One-Time Password (TOTP).
     *
@@ -98,7 +275,183 @@ namespace libqotp
     */
    QString totp(
        QByteArrayView secret,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Generates a Time-Based One-Time Password (TOTP) from a precomputed key.
+    *
+    * Behaves like the QByteArrayView overload, but reuses the HMAC state cached in 'key'.
+    * The hash algorithm is the one the key was prepared for.
+    *
+    * @param key The precomputed shared secret key.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds for the TOTP calculation. Defaults to the current time.
+    * @param timeStep The time step in seconds. The RFC recommends 30 seconds.
+    * @param epoch The Unix epoch for the TOTP calculation. Usually 0 (Unix epoch).
+    * @param digits The desired length of the OTP. Defaults to 8.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return A QString containing the TOTP or an empty string in case of an error.
+    */
+   QString totp(
+       const OtpKey &key,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes a Time-Based One-Time Password (TOTP) as integer.
+    *
+    * Same algorithm and validation as totp(), but returns the numeric code and does not allocate.
+    *
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<quint32> totp_value(
+       const OtpKey &key,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes a Time-Based One-Time Password (TOTP) as integer from a raw secret.
+    *
+    * @return The OTP value, or std::nullopt in case of an error.
+    */
+   std::optional<quint32> totp_value(
+       QByteArrayView secret,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Writes a Time-Based One-Time Password (TOTP) as ASCII digits into a caller-provided buffer.
+    *
+    * Exactly 'digits' zero-padded characters are written, without a terminating null character.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   qsizetype totp(
+       const OtpKey &key,
+       quint64 currentUnixTime,
+       std::span<char> output,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Writes a Time-Based One-Time Password (TOTP) from a raw secret into a caller-provided buffer.
+    *
+    * @return The number of characters written, or 0 in case of an error or if 'output' is too small.
+    */
+   qsizetype totp(
+       QByteArrayView secret,
+       quint64 currentUnixTime,
+       std::span<char> output,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Verifies a Time-Based One-Time Password (TOTP) against a window of time steps.
+    *
+    * Clocks of client and server drift apart, and users need time to type a code, so RFC 6238 section 5.2
+    * recommends accepting codes from a small number of neighbouring time steps. This function checks the
+    * current step and 'window' steps before and after it.
+    *
+    * All candidates are derived from the same key state, the counter message is updated in place and the
+    * codes are compared as integers. Every candidate is computed and compared in constant time, so the
+    * duration does not depend on whether or where the code matched.
+    *
+    * Note that a successful verification does not prevent replay of the same code. RFC 6238 requires the
+    * verifier to remember accepted time steps and to reject them afterwards.
+    *
+    * @param key The precomputed shared secret key.
+    * @param code The code entered by the user.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+    * @param window The number of time steps accepted before and after the current one. Defaults to 1.
+    * @param timeStep The time step in seconds. The RFC recommends 30 seconds.
+    * @param epoch The Unix epoch for the TOTP calculation. Usually 0 (Unix epoch).
+    * @param digits The length of the OTP. Defaults to 8.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The offset in time steps of the matching code (0 for the current step, -1 for the previous one,
+    *         and so on), or std::nullopt if no code in the window matched or the input is invalid.
+    *         If several steps match, the one closest to the current step is returned.
+    */
+   std::optional<int> totp_verify(
+       const OtpKey &key,
+       quint32 code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int window = 1,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Verifies a TOTP given as string. The code must consist of exactly 'digits' decimal digits.
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       const OtpKey &key,
+       QStringView code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int window = 1,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Verifies a TOTP against a raw secret. The HMAC state is derived once and shared by all candidates.
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       QByteArrayView secret,
+       quint32 code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int window = 1,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Verifies a TOTP given as string against a raw secret.
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       QByteArrayView secret,
+       QStringView code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int window = 1,
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -115,14 +468,78 @@ namespace libqotp
     * @return A quint64 representing the expiration Unix timestamp of the current TOTP window.
     */
    quint64 totp_expire_time(
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
+       quint64 epoch = 0,
+       unsigned int timeStep = 30);
+
+   /**
+    * Generates a Time-Based One-Time Password (TOTP) for the time of 'clock'.
+    *
+    * Behaves like the overload taking the time, with currentUnixTime = clock.now().
+    */
+   QString totp(
+       const OtpKey &key,
+       const Clock &clock,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Generates a Time-Based One-Time Password (TOTP) for the time of 'clock' and reports why it failed.
+    */
+   Result<QString> try_totp(
+       const OtpKey &key,
+       const Clock &clock,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Computes a Time-Based One-Time Password (TOTP) as integer for the time of 'clock'.
+    */
+   std::optional<quint32> totp_value(
+       const OtpKey &key,
+       const Clock &clock,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Verifies a TOTP against the time of 'clock'.
+    *
+    * Behaves like the overload taking the time, with currentUnixTime = clock.now().
+    *
+    * @return The offset of the matching time step, or std::nullopt.
+    */
+   std::optional<int> totp_verify(
+       const OtpKey &key,
+       quint32 code,
+       const Clock &clock,
+       unsigned int window = 1,
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Calculates the expiration timestamp of the TOTP window the time of 'clock' falls into.
+    */
+   quint64 totp_expire_time(
+       const Clock &clock,
        quint64 epoch = 0,
        unsigned int timeStep = 30);
 
    // Convenience
    QString totp_sha256(
        QByteArrayView secret,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -132,7 +549,7 @@ namespace libqotp
    // Convenience
    QString totp_sha512(
        QByteArrayView secret,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -151,7 +568,7 @@ namespace libqotp
    // Convenience
    QString totp_base32(
        const QString &base32,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -162,7 +579,7 @@ namespace libqotp
    // Convenience
    QString totp_base32_sha256(
        const QString &base32,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -172,7 +589,7 @@ namespace libqotp
    // Convenience
    QString totp_base32_sha512(
        const QString &base32,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -192,7 +609,7 @@ namespace libqotp
    // Convenience
    QString totp_base64(
        const QByteArray &base64,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -204,7 +621,7 @@ namespace libqotp
    // Convenience
    QString totp_base64_sha256(
        const QByteArray &base64,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -215,7 +632,7 @@ namespace libqotp
    // Convenience
    QString totp_base64_sha512(
        const QByteArray &base64,
-       quint64 currentUnixTime = QDateTime::currentDateTimeUtc().toSecsSinceEpoch(),
+       quint64 currentUnixTime = current_unix_time(),
        unsigned int timeStep = 30,
        quint64 epoch = 0,
        unsigned int digits = 8,
@@ -230,14 +647,220 @@ namespace libqotp
     * It supports the standard Base32 alphabet (A-Z2-7) and is case-insensitive.
     *
     * Error handling:
-    * - Ignores non-Base32 characters (based on the standard Base32 alphabet).
-    * - Handles padding characters ('=') properly.
+    * - Rejects characters outside the standard Base32 alphabet.
+    * - Handles padding characters ('=') properly. Any character after a padding character is rejected.
     * - Returns an empty QByteArray if there are illegal characters or other inconsistencies.
     *
     * @param base32String The Base32 encoded string to decode.
     * @return A QByteArray containing the decoded data, or an empty QByteArray in case of an error.
     */
    QByteArray base32_decode(const QString &base32String);
+
+   /**
+    * The reasons base32_decode() can fail.
+    */
+   enum class Base32Error
+   {
+      // The input was decoded successfully.
+      None,
+
+      // A character is neither in the Base32 alphabet nor a padding character.
+      InvalidCharacter,
+
+      // An alphabet character follows a padding character.
+      CharacterAfterPadding,
+
+      // The output buffer cannot hold the decoded data.
+      OutputTooSmall
+   };
+
+   /**
+    * The outcome of decoding Base32 into a caller-provided buffer.
+    */
+   struct Base32DecodeResult
+   {
+      // The number of bytes written to the output buffer. Only meaningful if 'error' is Base32Error::None.
+      qsizetype size = 0;
+
+      // Base32Error::None on success, otherwise the reason for the failure.
+      Base32Error error = Base32Error::None;
+
+      // The index of the offending input character, or -1 if the error is not tied to a character.
+      qsizetype position = -1;
+
+      /**
+       * Returns true if the input was decoded successfully.
+       */
+      bool isValid() const { return error == Base32Error::None; }
+   };
+
+   /**
+    * Returns the number of bytes needed to decode 'length' Base32 characters.
+    *
+    * This is an upper bound: padding characters do not produce output.
+    */
+   constexpr qsizetype base32_decoded_size(qsizetype length)
+   {
+      return length > 0 ? length * 5 / 8 : 0;
+   }
+
+   /**
+    * Decodes a Base32 encoded string into a caller-provided buffer.
+    *
+    * Accepts the same input as the QString overload, but does not allocate and reports why decoding failed.
+    * Long inputs are decoded with SSSE3 or AVX2 when the CPU supports it.
+    *
+    * @param base32 The Base32 encoded string to decode.
+    * @param output The buffer receiving the decoded bytes. base32_decoded_size(base32.size()) bytes are always enough.
+    * @return The number of bytes written, or the error and the position of the offending character.
+    *         The content of 'output' is unspecified after an error.
+    */
+   Base32DecodeResult base32_decode(QStringView base32, std::span<char> output);
+
+   /**
+    * Decodes Latin-1 encoded Base32 text into a caller-provided buffer.
+    *
+    * Behaves like the QStringView overload. The decoded data never overtakes the text being decoded, so
+    * 'output' may start at the same address as 'base32' to decode in place.
+    *
+    * @param base32 The Base32 encoded text to decode.
+    * @param output The buffer receiving the decoded bytes. base32_decoded_size(base32.size()) bytes are always enough.
+    * @return The number of bytes written, or the error and the position of the offending character.
+    *         The content of 'output' is unspecified after an error.
+    */
+   Base32DecodeResult base32_decode(QByteArrayView base32, std::span<char> output);
+
+   /**
+    * Decodes a Base32 encoded string to a QByteArray and reports why decoding failed.
+    *
+    * @param base32 The Base32 encoded string to decode.
+    * @param error Receives Base32Error::None on success, otherwise the reason for the failure.
+    * @return A QByteArray containing the decoded data, or an empty QByteArray in case of an error.
+    */
+   QByteArray base32_decode(QStringView base32, Base32Error &error);
+
+   /**
+    * Options for base32_encode().
+    */
+   enum class Base32Option
+   {
+      // Upper case alphabet, output padded with '=' to a multiple of 8 characters (RFC 4648).
+      Default = 0x0,
+
+      // Do not append '=' padding. Common in otpauth:// URIs.
+      OmitPadding = 0x1,
+
+      // Use the lower case alphabet (a-z2-7).
+      Lowercase = 0x2
+   };
+   Q_DECLARE_FLAGS(Base32Options, Base32Option)
+
+   /**
+    * Returns the number of characters base32_encode() produces for 'length' bytes.
+    */
+   constexpr qsizetype base32_encoded_size(qsizetype length, Base32Options options = Base32Option::Default)
+   {
+      if (length <= 0)
+      {
+         return 0;
+      }
+
+      return options.testFlag(Base32Option::OmitPadding) ? (length * 8 + 4) / 5 : (length + 4) / 5 * 8;
+   }
+
+   /**
+    * Encodes data as Base32 according to RFC 4648.
+    *
+    * @param data The bytes to encode.
+    * @param options Padding and alphabet options.
+    * @return The Base32 encoded string.
+    */
+   QString base32_encode(QByteArrayView data, Base32Options options = Base32Option::Default);
+
+   /**
+    * Encodes data as Base32 into a caller-provided buffer.
+    *
+    * Does not allocate. No terminating null character is written. Long inputs are encoded with SSSE3 or
+    * AVX2 when the CPU supports it.
+    *
+    * @param data The bytes to encode.
+    * @param output Receives the encoded characters. Must hold at least base32_encoded_size(data.size(), options) characters.
+    * @param options Padding and alphabet options.
+    * @return The number of characters written, or -1 if 'output' is too small.
+    */
+   qsizetype base32_encode(QByteArrayView data, std::span<char> output, Base32Options options = Base32Option::Default);
+
+   /**
+    * Generates an HMAC-based One-Time Password (HOTP) and reports why it failed.
+    *
+    * Same algorithm, parameters and output as hotp(), but on failure the result holds the reason instead
+    * of an empty string: OtpError::EmptySecret, OtpError::UnsupportedAlgorithm or OtpError::InvalidDigits.
+    *
+    * @return The OTP, or the reason for the failure.
+    */
+   Result<QString> try_hotp(
+       QByteArrayView secret,
+       uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Generates an HMAC-based One-Time Password (HOTP) from a precomputed key and reports why it failed.
+    *
+    * @return The OTP, or OtpError::InvalidKey, OtpError::UnsupportedAlgorithm or OtpError::InvalidDigits.
+    */
+   Result<QString> try_hotp(
+       const OtpKey &key,
+       uint64_t counter,
+       unsigned int digits = 6,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Generates a Time-Based One-Time Password (TOTP) and reports why it failed.
+    *
+    * Same algorithm, parameters and output as totp(), but on failure the result holds the reason instead
+    * of an empty string. In addition to the reasons of try_hotp(), a zero time step is reported as
+    * OtpError::InvalidTimeStep.
+    *
+    * @return The OTP, or the reason for the failure.
+    */
+   Result<QString> try_totp(
+       QByteArrayView secret,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT,
+       QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+
+   /**
+    * Generates a Time-Based One-Time Password (TOTP) from a precomputed key and reports why it failed.
+    *
+    * @return The OTP, or the reason for the failure.
+    */
+   Result<QString> try_totp(
+       const OtpKey &key,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int timeStep = 30,
+       quint64 epoch = 0,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+
+   /**
+    * Decodes a Base32 encoded string and reports why decoding failed.
+    *
+    * Accepts the same input as base32_decode().
+    *
+    * @return The decoded data, or OtpError::InvalidBase32Character or OtpError::Base32CharacterAfterPadding.
+    */
+   Result<QByteArray> try_base32_decode(QStringView base32);
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(libqotp::Base32Options)
+
 #endif
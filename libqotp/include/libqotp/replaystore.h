@@ -0,0 +1,154 @@
+#ifndef LIBQOTP_REPLAYSTORE_H_20261018
+#define LIBQOTP_REPLAYSTORE_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <atomic>
+#include <memory>
+
+#include <QByteArrayView>
+
+namespace libqotp
+{
+   /**
+    * The outcome of recording an accepted counter in a ReplayStore.
+    */
+   enum class ReplayResult
+   {
+      // The counter is higher than every counter accepted before for this user and was recorded.
+      Accepted,
+
+      // The counter, or a higher one, was accepted before, or it is older than the verification window.
+      // The code must be rejected.
+      Replayed,
+
+      // The counter could not be recorded, because the slots for this user are all in use or the counter
+      // is not below 2^32. The code must be rejected.
+      Unavailable
+   };
+
+   /**
+    * Remembers the highest accepted counter per user, so that a code cannot be used twice.
+    *
+    * RFC 6238 section 5.2 requires a verifier to reject a code it already accepted. ReplayStore keeps the
+    * last accepted counter (the time step for TOTP) of every user and only accepts higher ones.
+    *
+    * The store is lock-free. Every entry is a single 64-bit word holding a tag of the user ID and the
+    * counter, updated with compare-and-swap. The table is made of cache line sized buckets of 8 entries
+    * and a user ID hashes to one bucket, so a lookup usually touches one cache line and threads working
+    * for different users rarely write to the same one. User IDs are hashed with a random seed, so they
+    * cannot be chosen to crowd a bucket.
+    *
+    * Memory is fixed at construction. In TOTP mode an entry expires one time step after its time step has
+    * left the verification window, that is at totp_expire_time() of time step counter + window + 1, and is
+    * then reused. Counters older than the window are always rejected, so expiry never lets a code through
+    * twice. In HOTP mode (a time step of 0) entries never expire.
+    *
+    * If no slot is free the store fails closed and reports ReplayResult::Unavailable. Size it well above
+    * the number of users verifying within one window; a capacity of twice that number keeps the buckets
+    * short.
+    *
+    * Two users whose IDs hash to the same bucket and tag share an entry. This can make one of them wait
+    * for the next time step, but never accepts a code twice.
+    */
+   class ReplayStore
+   {
+   public:
+      /**
+       * Creates an empty store.
+       *
+       * @param capacity The number of entries. Rounded up to a whole number of buckets, a power of two.
+       * @param timeStep The TOTP time step in seconds, or 0 for HOTP counters that never expire.
+       * @param epoch The Unix epoch for the TOTP calculation. Usually 0 (Unix epoch).
+       * @param window The number of time steps accepted before and after the current one, as passed to totp_verify().
+       */
+      explicit ReplayStore(qsizetype capacity, unsigned int timeStep = 30, quint64 epoch = 0, unsigned int window = 1);
+      ~ReplayStore();
+
+      ReplayStore(const ReplayStore &) = delete;
+      ReplayStore &operator=(const ReplayStore &) = delete;
+
+      /**
+       * Records 'counter' as accepted for 'userId' if it is higher than every counter accepted before.
+       *
+       * Safe to call from any number of threads. If several threads record the same counter for the same
+       * user concurrently, at most one of them gets ReplayResult::Accepted.
+       *
+       * @param userId The user, compared byte for byte.
+       * @param counter The HOTP counter or TOTP time step that was verified.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Ignored in HOTP mode.
+       * @return ReplayResult::Accepted if the code may be accepted, anything else if it must be rejected.
+       */
+      ReplayResult accept(QByteArrayView userId, quint64 counter, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Records 'counter' as accepted for a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      ReplayResult accept(quint64 userId, quint64 counter, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Returns the number of entries.
+       */
+      qsizetype capacity() const { return m_bucketCount * bucket_size; }
+
+      /**
+       * Returns the TOTP time step in seconds, or 0 in HOTP mode.
+       */
+      unsigned int timeStep() const { return m_timeStep; }
+
+      /**
+       * Returns the Unix epoch for the TOTP calculation.
+       */
+      quint64 epoch() const { return m_epoch; }
+
+      /**
+       * Returns the number of time steps accepted before and after the current one.
+       */
+      unsigned int window() const { return m_window; }
+
+   private:
+      static constexpr qsizetype bucket_size = 8;
+
+      struct alignas(64) Bucket
+      {
+         std::atomic<quint64> entries[bucket_size] = {};
+      };
+
+      ReplayResult record(quint64 hash, quint64 counter, quint64 currentUnixTime);
+
+      std::unique_ptr<Bucket[]> m_buckets;
+      qsizetype m_bucketCount = 0;
+      size_t m_seed = 0;
+      unsigned int m_timeStep = 30;
+      quint64 m_epoch = 0;
+      unsigned int m_window = 1;
+   };
+
+   /**
+    * Verifies a TOTP and records it in a ReplayStore, so it is accepted only once.
+    *
+    * The time step, epoch and window are taken from the store.
+    *
+    * @param store The store remembering accepted time steps. Must not be in HOTP mode.
+    * @param userId The user the key belongs to.
+    * @param key The precomputed shared secret key.
+    * @param code The code entered by the user.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+    * @param digits The length of the OTP. Defaults to 8.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The offset in time steps of the matching code, or std::nullopt if the code does not match,
+    *         was used before or could not be recorded.
+    */
+   std::optional<int> totp_verify(
+       ReplayStore &store,
+       QByteArrayView userId,
+       const OtpKey &key,
+       quint32 code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+}
+
+#endif
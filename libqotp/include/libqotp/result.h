@@ -0,0 +1,130 @@
+#ifndef LIBQOTP_RESULT_H_20261018
+#define LIBQOTP_RESULT_H_20261018
+
+#include <utility>
+
+namespace libqotp
+{
+   /**
+    * The reasons an OTP or decoding function can fail.
+    *
+    * The functions returning an empty QString, QByteArray or std::nullopt on failure have try_ variants
+    * returning a Result, which carries one of these instead.
+    */
+   enum class OtpError
+   {
+      // No error.
+      None,
+
+      // The secret is empty.
+      EmptySecret,
+
+      // The hash algorithm is not SHA-1, SHA-256 or SHA-512.
+      UnsupportedAlgorithm,
+
+      // The OtpKey is invalid, so no HMAC can be computed: default constructed, cleared or built from an
+      // empty secret. The try_ functions taking the secret report EmptySecret instead.
+      InvalidKey,
+
+      // The number of digits is outside [digitMinimum, digitMaximum] or the limits of the library.
+      InvalidDigits,
+
+      // The time step is zero.
+      InvalidTimeStep,
+
+      // The verification window is larger than the offsets an int can report.
+      InvalidWindow,
+
+      // The code to verify is not exactly 'digits' decimal digits.
+      MalformedCode,
+
+      // A character is neither in the Base32 alphabet nor a padding character.
+      InvalidBase32Character,
+
+      // A Base32 alphabet character follows a padding character.
+      Base32CharacterAfterPadding,
+
+      // The output buffer cannot hold the result.
+      OutputTooSmall
+   };
+
+   // The number of OtpError values, for tables indexed by OtpError.
+   inline constexpr int otp_error_count = static_cast<int>(OtpError::OutputTooSmall) + 1;
+
+   /**
+    * Returns the name of 'error', for example "InvalidDigits", for logs.
+    */
+   const char *otp_error_name(OtpError error);
+
+   /**
+    * A value of type T or the reason it could not be produced.
+    *
+    * Modeled on C++23 std::expected<T, OtpError>, with the same member names, so that code can move to
+    * std::expected once the library requires it. Unlike std::expected, value() does not throw: on error it
+    * returns a default constructed T, the same value the function without the try_ prefix returns.
+    */
+   template <typename T>
+   class Result
+   {
+   public:
+      Result(const T &value)
+         : m_value(value)
+      {
+      }
+
+      Result(T &&value)
+         : m_value(std::move(value))
+      {
+      }
+
+      /**
+       * Constructs a failed result. 'error' must not be OtpError::None.
+       */
+      Result(OtpError error)
+         : m_error(error)
+      {
+      }
+
+      /**
+       * Returns true if the result holds a value.
+       */
+      bool has_value() const { return m_error == OtpError::None; }
+      explicit operator bool() const { return has_value(); }
+
+      /**
+       * Returns the value, or a default constructed T on error.
+       */
+      const T &value() const & { return m_value; }
+      T &&value() && { return std::move(m_value); }
+
+      const T &operator*() const & { return m_value; }
+      T &&operator*() && { return std::move(m_value); }
+      const T *operator->() const { return &m_value; }
+
+      /**
+       * Returns the value, or 'fallback' on error.
+       */
+      template <typename U>
+      T value_or(U &&fallback) const &
+      {
+         return has_value() ? m_value : static_cast<T>(std::forward<U>(fallback));
+      }
+
+      template <typename U>
+      T value_or(U &&fallback) &&
+      {
+         return has_value() ? std::move(m_value) : static_cast<T>(std::forward<U>(fallback));
+      }
+
+      /**
+       * Returns the reason for the failure, or OtpError::None if the result holds a value.
+       */
+      OtpError error() const { return m_error; }
+
+   private:
+      T m_value{};
+      OtpError m_error = OtpError::None;
+   };
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef LIBQOTP_SECRETS_H_20261018
+#define LIBQOTP_SECRETS_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace libqotp
+{
+   class SecretBatch;
+
+   /**
+    * Generates 'count' random secrets for enrollment and encodes them as Base32.
+    *
+    * The random bytes come from QRandomGenerator::system(), the operating system's cryptographically
+    * secure generator, and fill the arena in large chunks. Encoding runs in one pass over the arena.
+    *
+    * @param count The number of secrets to generate.
+    * @param secretLength The length of each secret in bytes. Defaults to 20 bytes (160 bits) as recommended by RFC 4226.
+    * @param options The Base32 options used for the encodings.
+    * @return The generated batch (see SecretBatch), or an empty batch if 'count' or 'secretLength' is not positive.
+    */
+   SecretBatch generate_secrets(qsizetype count, qsizetype secretLength = 20, Base32Options options = Base32Option::Default);
+
+   /**
+    * A batch of random secrets together with their Base32 encodings.
+    *
+    * All secrets live in one contiguous arena and all encodings in a second one, so a batch costs two
+    * allocations regardless of its size. Secret i occupies bytes [i * secretLength(), (i + 1) * secretLength())
+    * of secrets(), its encoding characters [i * encodedLength(), (i + 1) * encodedLength()) of encodedSecrets().
+    *
+    * Both arenas are wiped when the batch is cleared or destroyed. Views returned by the accessors are
+    * invalidated at that point.
+    */
+   class SecretBatch
+   {
+   public:
+      SecretBatch() = default;
+      SecretBatch(SecretBatch &&other) noexcept;
+      SecretBatch &operator=(SecretBatch &&other) noexcept;
+      ~SecretBatch();
+
+      SecretBatch(const SecretBatch &) = delete;
+      SecretBatch &operator=(const SecretBatch &) = delete;
+
+      /**
+       * Returns the number of secrets in the batch.
+       */
+      qsizetype count() const { return m_count; }
+
+      /**
+       * Returns the length in bytes of every secret.
+       */
+      qsizetype secretLength() const { return m_secretLength; }
+
+      /**
+       * Returns the length in characters of every encoded secret.
+       */
+      qsizetype encodedLength() const { return m_encodedLength; }
+
+      /**
+       * Returns secret 'index', which must be in [0, count()).
+       */
+      QByteArrayView secret(qsizetype index) const;
+
+      /**
+       * Returns the Base32 encoding of secret 'index', which must be in [0, count()).
+       */
+      QLatin1StringView encodedSecret(qsizetype index) const;
+
+      /**
+       * Returns the arena holding all secrets back to back.
+       */
+      QByteArrayView secrets() const { return m_secrets; }
+
+      /**
+       * Returns the arena holding all encoded secrets back to back, without separators.
+       */
+      QByteArrayView encodedSecrets() const { return m_encoded; }
+
+      /**
+       * Wipes and releases both arenas.
+       */
+      void clear();
+
+   private:
+      friend SecretBatch generate_secrets(qsizetype count, qsizetype secretLength, Base32Options options);
+
+      QByteArray m_secrets;
+      QByteArray m_encoded;
+      qsizetype m_count = 0;
+      qsizetype m_secretLength = 0;
+      qsizetype m_encodedLength = 0;
+   };
+
+}
+
+#endif
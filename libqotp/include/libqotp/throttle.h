@@ -0,0 +1,238 @@
+#ifndef LIBQOTP_THROTTLE_H_20261018
+#define LIBQOTP_THROTTLE_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include <atomic>
+#include <memory>
+
+#include <QByteArrayView>
+
+namespace libqotp
+{
+   /**
+    * Options of a Throttle.
+    */
+   struct ThrottleOptions
+   {
+      // The number of entries. Rounded up to a whole number of buckets, a power of two.
+      qsizetype capacity = 65536;
+
+      // Failed attempts a user may make before verifications are delayed, and the most attempts a user
+      // may have in flight at once. 0 counts as 1.
+      unsigned int freeAttempts = 3;
+
+      // The delay in seconds after the failure that used up freeAttempts. Every further failure doubles it.
+      unsigned int baseDelay = 1;
+
+      // The longest delay in seconds.
+      unsigned int maxDelay = 900;
+
+      // The TOTP time step in seconds and the Unix epoch, used to expire entries. Must not be 0.
+      unsigned int timeStep = 30;
+      quint64 epoch = 0;
+
+      // Whole time steps an entry is kept after the time step of its deadline ended. A user without a
+      // failure for that long starts over.
+      unsigned int retention = 10;
+   };
+
+   /**
+    * Counts failed verifications per user and delays further attempts with an exponential backoff.
+    *
+    * A six-digit code falls to brute force unless the attempts per user are limited. Throttle keeps the
+    * number of failures and the time until which verifications are refused for every user. A verifier
+    * reserves every attempt with reserve() before it computes any HMAC. The reservation counts against
+    * the free attempts until recordFailure() or recordSuccess() completes it, so concurrent guesses for one
+    * user cannot all pass before the first failure is recorded: at most freeAttempts are in flight at once,
+    * and once they are used up only one at a time, after each deadline.
+    *
+    * The table is lock-free and its memory is fixed at construction. Every entry is a single 64-bit word
+    * holding a tag of the user ID, the reservations, the failure count and the deadline, updated with
+    * compare-and-swap. The
+    * table is sharded into cache line sized buckets of 8 entries and a user ID hashes to one bucket, so a
+    * lookup usually touches one cache line and threads working for different users rarely write to the
+    * same one. User IDs are hashed with a random seed, so they cannot be chosen to crowd a bucket.
+    *
+    * An entry expires at totp_expire_time() of its deadline plus 'retention' time steps and is then
+    * reused. If a failure finds no free entry, as during a credential stuffing flood over many users, it
+    * replaces the entry with the fewest failures, so the users with the most failures stay throttled.
+    *
+    * Two users whose IDs hash to the same bucket and tag share an entry, so a failure of one of them
+    * also delays the other. With 20-bit tags this is rare and cannot be provoked.
+    */
+   class Throttle
+   {
+   public:
+      /**
+       * Creates an empty table.
+       *
+       * @param options The size, backoff and expiry of the table.
+       */
+      explicit Throttle(const ThrottleOptions &options = ThrottleOptions());
+      ~Throttle();
+
+      Throttle(const Throttle &) = delete;
+      Throttle &operator=(const Throttle &) = delete;
+
+      /**
+       * Returns whether 'userId' may attempt a verification now.
+       *
+       * Safe to call from any number of threads. Does not write to the table, so it only informs, for
+       * example to answer a throttled user early; verifiers use reserve().
+       *
+       * @param userId The user, compared byte for byte.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds.
+       * @return 0 if the user may attempt a verification, otherwise the Unix time from which it may.
+       */
+      quint64 check(QByteArrayView userId, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Checks a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      quint64 check(quint64 userId, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Reserves an attempt of 'userId' to verify a code, unless the user is throttled.
+       *
+       * Safe to call from any number of threads. The check and the reservation are one atomic update of
+       * the user's entry. Every successful reservation must be followed by recordFailure() or
+       * recordSuccess(); a reservation that is never completed expires with the entry.
+       *
+       * @param userId The user, compared byte for byte.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds.
+       * @return 0 if the attempt is reserved, otherwise the Unix time from which the user may attempt
+       *         again: its deadline, or the next second while other attempts of the user are in flight.
+       */
+      quint64 reserve(QByteArrayView userId, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Reserves an attempt of a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      quint64 reserve(quint64 userId, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Records a failed verification of 'userId', extends its deadline and completes one reserved attempt.
+       *
+       * Safe to call from any number of threads; concurrent failures of the same user are all counted.
+       * The count saturates at 255.
+       *
+       * @param userId The user, compared byte for byte.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds.
+       * @return 0 if the user may attempt the next verification right away, otherwise the Unix time from which it may.
+       */
+      quint64 recordFailure(QByteArrayView userId, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Records a failure of a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      quint64 recordFailure(quint64 userId, quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Forgets the failures and reserved attempts of 'userId' after a successful verification.
+       *
+       * @param userId The user, compared byte for byte.
+       */
+      void recordSuccess(QByteArrayView userId);
+
+      /**
+       * Forgets the failures of a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      void recordSuccess(quint64 userId);
+
+      /**
+       * Returns the failures counted for 'userId' that have not expired.
+       *
+       * @param userId The user, compared byte for byte.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds.
+       */
+      unsigned int failures(QByteArrayView userId, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Returns the failures of a numeric user ID. Behaves like the QByteArrayView overload.
+       */
+      unsigned int failures(quint64 userId, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Returns the number of entries.
+       */
+      qsizetype capacity() const { return m_bucketCount * bucket_size; }
+
+      /**
+       * Returns the options the table was created with.
+       */
+      const ThrottleOptions &options() const { return m_options; }
+
+   private:
+      static constexpr qsizetype bucket_size = 8;
+
+      struct alignas(64) Bucket
+      {
+         std::atomic<quint64> entries[bucket_size] = {};
+      };
+
+      struct Found
+      {
+         unsigned int failures = 0;
+         quint64 deadline = 0;
+      };
+
+      // The entry to update for a user and the value it was read with
+      struct Slot
+      {
+         std::atomic<quint64> *entry = nullptr;
+         quint64 value = 0;
+
+         // The entry is the user's and has not expired
+         bool live = false;
+      };
+
+      Found find(quint64 hash, quint64 currentUnixTime) const;
+      Slot locate(quint64 hash, quint64 currentUnixTime) const;
+      quint64 acquire(quint64 hash, quint64 currentUnixTime);
+      quint64 fail(quint64 hash, quint64 currentUnixTime);
+      void reset(quint64 hash);
+      bool expired(quint64 value, quint64 currentUnixTime) const;
+      quint64 delay(unsigned int failures) const;
+
+      template <typename Function>
+      void visit(quint64 hash, Function function) const;
+
+      ThrottleOptions m_options;
+      std::unique_ptr<Bucket[]> m_buckets;
+      qsizetype m_bucketCount = 0;
+      size_t m_seed = 0;
+   };
+
+   /**
+    * Verifies a TOTP unless the user is throttled, and records the outcome in the Throttle.
+    *
+    * The attempt is reserved with Throttle::reserve() first, so a throttled user, or one with as many
+    * attempts in flight as allowed, is rejected before any HMAC is computed. A mismatch counts as a
+    * failure, a match forgets the user's failures. The time step and epoch are taken from the throttle.
+    *
+    * @param throttle The table of failures.
+    * @param userId The user the key belongs to.
+    * @param key The precomputed shared secret key.
+    * @param code The code entered by the user.
+    * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+    * @param window The number of time steps accepted before and after the current one. Defaults to 1.
+    * @param digits The length of the OTP. Defaults to 8.
+    * @param digitMinimum The minimum number of digits the OTP should have. Defaults to QOTP_MINIMUM_DIGIT.
+    * @param digitMaximum The maximum number of digits the OTP should have. Defaults to QOTP_MAXIMUM_DIGIT.
+    * @return The offset in time steps of the matching code, or std::nullopt if the user is throttled or
+    *         the code does not match.
+    */
+   std::optional<int> totp_verify(
+       Throttle &throttle,
+       QByteArrayView userId,
+       const OtpKey &key,
+       quint32 code,
+       quint64 currentUnixTime = current_unix_time(),
+       unsigned int window = 1,
+       unsigned int digits = 8,
+       unsigned int digitMinimum = QOTP_MINIMUM_DIGIT,
+       unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT);
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef LIBQOTP_TOTPCACHE_H_20261018
+#define LIBQOTP_TOTPCACHE_H_20261018
+
+#include <libqotp/batch.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace libqotp
+{
+   /**
+    * The TOTP parameters of a TotpCache and when it computes its tables.
+    */
+   struct TotpCacheOptions
+   {
+      // The time step in seconds.
+      unsigned int timeStep = 30;
+
+      // The Unix epoch for the TOTP calculation.
+      quint64 epoch = 0;
+
+      // The length of the OTPs.
+      unsigned int digits = 8;
+
+      // The number of time steps accepted before and after the current one.
+      unsigned int window = 1;
+
+      // How long before a time step starts the table covering it is computed. Must exceed the time a
+      // refresh takes for all keys, otherwise requests right after the boundary fall back to hashing.
+      // Clamped to 0 to timeStep - 1 seconds.
+      std::chrono::seconds lead = std::chrono::seconds(5);
+
+      // Whether a background thread refreshes the table before every time step. Without it, call
+      // refresh() yourself.
+      bool background = true;
+
+      // Threading options for computing a table.
+      BatchOptions batch;
+   };
+
+   /**
+    * Counters of a TotpCache.
+    */
+   struct TotpCacheStats
+   {
+      // Tables computed and published.
+      quint64 refreshes = 0;
+
+      // Verifications whose window was not in the table and that were computed directly. Hits are not
+      // counted, so that lookups do not write to shared memory.
+      quint64 misses = 0;
+
+      // The time the last refresh took.
+      std::chrono::microseconds lastRefresh = std::chrono::microseconds(0);
+   };
+
+   /**
+    * Verifies TOTPs of a fixed set of keys by table lookup.
+    *
+    * The codes of a key only change at time step boundaries, which totp_expire_time() predicts exactly. A
+    * TotpCache computes the codes of all registered keys for the steps around the current one ahead of
+    * time, in one batch (see totp_batch()), and verify() then compares against the table instead of
+    * computing HMACs. The hashing moves off the request path, and the burst of work at the start of every
+    * time step disappears.
+    *
+    * A table covers the window around two consecutive time steps: the one it is computed for and the one
+    * before. The background thread computes the table of the next step 'lead' seconds before it starts
+    * and publishes it with a single atomic pointer store, RCU-style: lookups load the pointer without any
+    * lock or reference count and never wait for a refresh. Replaced tables are freed once they are at
+    * least one time step old, so a lookup must not be suspended for that long.
+    *
+    * Verifications outside the table, such as during a slow refresh or for a time far from the current
+    * one, are computed directly with the key and counted as misses.
+    *
+    * Keys are addressed by their index in the set passed to setKeys(). The codes in the table are as
+    * sensitive as the keys for the duration of their time steps and are wiped when a table is freed.
+    */
+   class TotpCache
+   {
+   public:
+      /**
+       * Creates a cache for 'keys' and computes the table of the current time step before returning.
+       * Starts the background thread unless options.background is false.
+       */
+      explicit TotpCache(std::span<const OtpKey> keys, const TotpCacheOptions &options = TotpCacheOptions());
+      ~TotpCache();
+
+      TotpCache(const TotpCache &) = delete;
+      TotpCache &operator=(const TotpCache &) = delete;
+
+      /**
+       * Replaces the registered keys and publishes a table for them before returning. Lookups running
+       * concurrently use either the old or the new keys.
+       */
+      void setKeys(std::span<const OtpKey> keys);
+
+      /**
+       * Returns the number of registered keys.
+       */
+      qsizetype size() const;
+
+      /**
+       * Computes and publishes the table for the time step of 'currentUnixTime', which also covers the
+       * step before it. Called by the background thread; call it yourself if options.background is false.
+       */
+      void refresh(quint64 currentUnixTime = current_unix_time());
+
+      /**
+       * Verifies the code of key 'index'. Behaves like totp_verify() with the parameters of the cache.
+       *
+       * Safe to call from any number of threads, also while a refresh is running.
+       *
+       * @param index The index of the key in the registered set.
+       * @param code The code entered by the user.
+       * @param currentUnixTime The current Unix epoch timestamp in seconds. Defaults to the current time.
+       * @return The offset in time steps of the matching code, or std::nullopt if no code matched or the
+       *         index is out of range.
+       */
+      std::optional<int> verify(qsizetype index, quint32 code, quint64 currentUnixTime = current_unix_time()) const;
+
+      /**
+       * Returns a snapshot of the counters.
+       */
+      TotpCacheStats stats() const;
+
+      /**
+       * Returns the options the cache was created with, with 'lead' clamped.
+       */
+      const TotpCacheOptions &options() const { return m_options; }
+
+   private:
+      struct Table;
+
+      // Computes and publishes the table of time step 'counter'. Called with m_mutex held, which also
+      // keeps refreshes from overtaking each other.
+      void publish(quint64 counter);
+      quint64 counterAt(quint64 currentUnixTime) const;
+      void run();
+
+      TotpCacheOptions m_options;
+
+      // The published table, m_current. Written under m_mutex, read without it.
+      std::atomic<const Table *> m_table{nullptr};
+
+      std::mutex m_mutex;
+      std::condition_variable m_wake;
+      std::shared_ptr<const std::vector<OtpKey>> m_keys;
+      std::unique_ptr<Table> m_current;
+      std::vector<std::unique_ptr<Table>> m_retired;
+      bool m_stopping = false;
+
+      std::atomic<quint64> m_refreshes{0};
+      mutable std::atomic<quint64> m_misses{0};
+      std::atomic<qint64> m_lastRefresh{0};
+
+      std::thread m_thread;
+   };
+}
+
+#endif
@@ -0,0 +1,415 @@
+#include <libqotp/asyncverifier.h>
+
+#include "hotp_batch.h"
+#include "sha.h"
+#include "truncate.h"
+
+#include <QPromise>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+struct libqotp::AsyncVerifier::Request
+{
+   core::Key key;
+   quint32 code = 0;
+   quint64 counter = 0;
+   std::stop_token stopToken;
+
+   // Exactly one of them delivers the result. A request with 'generated' computes a code instead of
+   // verifying one.
+   std::optional<QPromise<bool>> promise;
+   std::function<void(bool)> callback;
+   std::function<void(std::optional<quint32>)> generated;
+
+   // Set to 1 by any matching candidate of the window
+   quint32 matched = 0;
+
+   // The generated code
+   quint32 value = detail::invalid_code;
+};
+
+struct libqotp::AsyncVerifier::Batch
+{
+   std::vector<Request> requests;
+};
+
+libqotp::AsyncVerifier::AsyncVerifier(const AsyncVerifierOptions &options)
+   : m_options(options)
+   , m_pool(options.pool ? options.pool : QThreadPool::globalInstance())
+{
+   m_options.maxBatchSize = std::max<qsizetype>(m_options.maxBatchSize, 1);
+   m_options.maxDelay = std::max(m_options.maxDelay, std::chrono::microseconds(0));
+
+   // The largest window totp_verify() accepts. Each request hashes 2 * window + 1 candidates.
+   m_options.window = std::min(m_options.window, static_cast<unsigned int>(std::numeric_limits<int>::max()));
+   m_timer = std::thread([this]() { timer(); });
+}
+
+libqotp::AsyncVerifier::~AsyncVerifier()
+{
+   {
+      std::lock_guard lock(m_mutex);
+      m_stopping = true;
+   }
+   m_wake.notify_all();
+   m_timer.join();
+
+   // Requests still waiting are started and completed before the queues go away
+   waitForDone();
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+QFuture<bool> libqotp::AsyncVerifier::verify(const OtpKey &key, quint32 code, quint64 currentUnixTime)
+{
+   QPromise<bool> promise;
+   QFuture<bool> future = promise.future();
+   promise.start();
+
+   // Input validation. Invalid requests are answered right away and never queued.
+   if (!key.isValid() || m_options.timeStep == 0 || currentUnixTime < m_options.epoch ||
+       !detail::valid_digits(m_options.digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT))
+   {
+      promise.addResult(false);
+      promise.finish();
+      return future;
+   }
+
+   Request request;
+   request.key = key.coreKey();
+   request.code = code;
+   request.counter = (currentUnixTime - m_options.epoch) / m_options.timeStep;
+   request.promise.emplace(std::move(promise));
+   enqueue(std::move(request));
+   return future;
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+void libqotp::AsyncVerifier::verify(
+    const OtpKey &key,
+    quint32 code,
+    std::function<void(bool)> callback,
+    quint64 currentUnixTime,
+    std::stop_token stopToken)
+{
+   // Input validation. Invalid requests are never queued, but answered on the pool like any other.
+   if (!key.isValid() || m_options.timeStep == 0 || currentUnixTime < m_options.epoch ||
+       !detail::valid_digits(m_options.digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT))
+   {
+      reject([callback = std::move(callback)]() { callback(false); });
+      return;
+   }
+
+   Request request;
+   request.key = key.coreKey();
+   request.code = code;
+   request.counter = (currentUnixTime - m_options.epoch) / m_options.timeStep;
+   request.stopToken = std::move(stopToken);
+   request.callback = std::move(callback);
+   enqueue(std::move(request));
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+void libqotp::AsyncVerifier::generate(
+    const OtpKey &key,
+    std::function<void(std::optional<quint32>)> callback,
+    quint64 currentUnixTime,
+    std::stop_token stopToken)
+{
+   // Input validation. Invalid requests are never queued, but answered on the pool like any other.
+   if (!key.isValid() || m_options.timeStep == 0 || currentUnixTime < m_options.epoch ||
+       !detail::valid_digits(m_options.digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT))
+   {
+      reject([callback = std::move(callback)]() { callback(std::nullopt); });
+      return;
+   }
+
+   Request request;
+   request.key = key.coreKey();
+   request.counter = (currentUnixTime - m_options.epoch) / m_options.timeStep;
+   request.stopToken = std::move(stopToken);
+   request.generated = std::move(callback);
+   enqueue(std::move(request));
+}
+
+void libqotp::AsyncVerifier::reject(std::function<void()> answer)
+{
+   {
+      std::lock_guard lock(m_mutex);
+      ++m_inFlight;
+   }
+
+   m_pool->start([this, answer = std::move(answer)]()
+   {
+      answer();
+
+      std::lock_guard lock(m_mutex);
+      --m_inFlight;
+      m_idle.notify_all();
+   });
+}
+
+void libqotp::AsyncVerifier::enqueue(Request &&request)
+{
+   ++m_requests;
+
+   std::vector<Request> full;
+   bool first = false;
+   {
+      std::lock_guard lock(m_mutex);
+
+      Queue &queue = m_queues[static_cast<int>(request.key.algorithm())];
+      if (queue.requests.empty())
+      {
+         first = true;
+         queue.deadline = std::chrono::steady_clock::now() + m_options.maxDelay;
+         queue.requests.reserve(static_cast<std::size_t>(std::min<qsizetype>(m_options.maxBatchSize, 1024)));
+      }
+      queue.requests.push_back(std::move(request));
+
+      // The peak is only written under the lock, the depth also by start()
+      const qsizetype depth = ++m_queueDepth;
+      m_peakQueueDepth.store(std::max(m_peakQueueDepth.load(std::memory_order_relaxed), depth), std::memory_order_relaxed);
+
+      // A full batch is started by the submitting thread, which saves waking the timer
+      if (static_cast<qsizetype>(queue.requests.size()) >= m_options.maxBatchSize || m_options.maxDelay.count() == 0)
+      {
+         full.swap(queue.requests);
+         ++m_inFlight;
+      }
+   }
+
+   if (!full.empty())
+   {
+      start(std::move(full), true);
+   }
+   else if (first)
+   {
+      // The timer has to learn about the new deadline
+      m_wake.notify_one();
+   }
+}
+
+std::vector<std::vector<libqotp::AsyncVerifier::Request>> libqotp::AsyncVerifier::take(std::chrono::steady_clock::time_point until)
+{
+   std::vector<std::vector<Request>> due;
+   for (Queue &queue : m_queues)
+   {
+      if (!queue.requests.empty() && queue.deadline <= until)
+      {
+         due.emplace_back().swap(queue.requests);
+         ++m_inFlight;
+      }
+   }
+   return due;
+}
+
+void libqotp::AsyncVerifier::start(std::vector<Request> &&requests, bool full)
+{
+   const auto size = static_cast<qsizetype>(requests.size());
+   m_queueDepth -= size;
+   m_batched += static_cast<quint64>(size);
+   ++m_batches;
+   if (full)
+   {
+      ++m_fullBatches;
+   }
+
+   qsizetype largest = m_largestBatch.load(std::memory_order_relaxed);
+   while (size > largest && !m_largestBatch.compare_exchange_weak(largest, size, std::memory_order_relaxed))
+   {
+   }
+
+   // The pool takes copyable functions only, the requests hold move-only promises
+   auto batch = std::make_shared<Batch>();
+   batch->requests = std::move(requests);
+   m_pool->start([this, batch]() { run(*batch); });
+}
+
+void libqotp::AsyncVerifier::run(Batch &batch)
+{
+   const quint64 window = m_options.window;
+   const unsigned int digits = m_options.digits;
+
+   // The candidates of all requests are streamed through the batch engine in chunks, so requests with
+   // few candidates still fill its lanes
+   constexpr std::size_t chunkSize = 64;
+   detail::HotpJob jobs[chunkSize];
+   Request *owners[chunkSize];
+   quint32 values[chunkSize];
+   std::size_t pending = 0;
+
+   const auto evaluate = [&]()
+   {
+      detail::hotp_values(jobs, pending, digits, values);
+      for (std::size_t i = 0; i < pending; ++i)
+      {
+         if (owners[i]->generated)
+         {
+            owners[i]->value = values[i];
+            continue;
+         }
+
+         // A value that could not be computed is invalid_code, which never equals a code of 'digits' digits
+         const quint32 valid = detail::equal_mask(values[i], detail::invalid_code) ^ 1u;
+         owners[i]->matched |= detail::equal_mask(values[i], owners[i]->code) & valid;
+      }
+      pending = 0;
+   };
+
+   for (Request &request : batch.requests)
+   {
+      // Cancelled requests are answered without computing anything, as rejected or without a code
+      if (request.stopToken.stop_requested())
+      {
+         continue;
+      }
+      if (request.generated)
+      {
+         jobs[pending] = {&request.key, request.counter};
+         owners[pending] = &request;
+         if (++pending == chunkSize)
+         {
+            evaluate();
+         }
+         continue;
+      }
+
+      // Counters below zero do not exist, the window is clamped instead
+      const quint64 first = request.counter >= window ? request.counter - window : 0;
+      const quint64 last = request.counter <= std::numeric_limits<quint64>::max() - window ? request.counter + window : std::numeric_limits<quint64>::max();
+
+      for (quint64 candidate = first;; ++candidate)
+      {
+         jobs[pending] = {&request.key, candidate};
+         owners[pending] = &request;
+         if (++pending == chunkSize)
+         {
+            evaluate();
+         }
+         if (candidate == last)
+         {
+            break;
+         }
+      }
+   }
+   if (pending > 0)
+   {
+      evaluate();
+   }
+   detail::secure_zero(values, sizeof(values));
+
+   for (Request &request : batch.requests)
+   {
+      const bool matched = request.matched != 0;
+      if (request.generated)
+      {
+         request.generated(request.value != detail::invalid_code ? std::optional<quint32>(request.value) : std::nullopt);
+         request.value = detail::invalid_code;
+      }
+      else if (request.promise)
+      {
+         request.promise->addResult(matched);
+         request.promise->finish();
+      }
+      else
+      {
+         request.callback(matched);
+      }
+   }
+   m_completed += batch.requests.size();
+
+   // Notified under the lock, so a destructor waiting in waitForDone() cannot return before this
+   // thread let go of the verifier
+   std::lock_guard lock(m_mutex);
+   --m_inFlight;
+   m_idle.notify_all();
+}
+
+void libqotp::AsyncVerifier::timer()
+{
+#if defined(__linux__)
+   // The default timer slack of 50 microseconds would stretch short delays considerably
+   prctl(PR_SET_TIMERSLACK, 1000UL);
+#endif
+
+   std::unique_lock lock(m_mutex);
+   while (!m_stopping)
+   {
+      auto next = std::chrono::steady_clock::time_point::max();
+      for (const Queue &queue : m_queues)
+      {
+         if (!queue.requests.empty())
+         {
+            next = std::min(next, queue.deadline);
+         }
+      }
+
+      if (next == std::chrono::steady_clock::time_point::max())
+      {
+         m_wake.wait(lock);
+      }
+      else
+      {
+         m_wake.wait_until(lock, next);
+      }
+
+      auto due = take(std::chrono::steady_clock::now());
+      if (due.empty())
+      {
+         continue;
+      }
+
+      lock.unlock();
+      for (auto &requests : due)
+      {
+         start(std::move(requests), false);
+      }
+      lock.lock();
+   }
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+void libqotp::AsyncVerifier::flush()
+{
+   std::vector<std::vector<Request>> due;
+   {
+      std::lock_guard lock(m_mutex);
+      due = take(std::chrono::steady_clock::time_point::max());
+   }
+
+   for (auto &requests : due)
+   {
+      start(std::move(requests), false);
+   }
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+void libqotp::AsyncVerifier::waitForDone()
+{
+   flush();
+
+   std::unique_lock lock(m_mutex);
+   m_idle.wait(lock, [this]() { return m_inFlight == 0; });
+}
+
+// Refer to the detailed documentation in asyncverifier.h for complete information about this function.
+libqotp::AsyncVerifierStats libqotp::AsyncVerifier::stats() const
+{
+   AsyncVerifierStats result;
+   result.requests = m_requests.load(std::memory_order_relaxed);
+   result.batched = m_batched.load(std::memory_order_relaxed);
+   result.completed = m_completed.load(std::memory_order_relaxed);
+   result.batches = m_batches.load(std::memory_order_relaxed);
+   result.fullBatches = m_fullBatches.load(std::memory_order_relaxed);
+   result.queueDepth = m_queueDepth.load(std::memory_order_relaxed);
+   result.peakQueueDepth = m_peakQueueDepth.load(std::memory_order_relaxed);
+   result.largestBatch = m_largestBatch.load(std::memory_order_relaxed);
+   return result;
+}
@@ -0,0 +1,156 @@
+#include <libqotp/awaitable.h>
+
+#include <QMetaObject>
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+
+struct libqotp::OtpAwaitable::State
+{
+   // Completes the await with 'result' unless it completed before. Called on any thread.
+   void complete(std::optional<quint32> result);
+
+   std::coroutine_handle<> handle;
+
+   // Lives on the awaiting thread and receives its resumption. nullptr if that thread has no event loop.
+   QObject *context = nullptr;
+
+   std::optional<quint32> value;
+
+   // Set by the first of the result and the cancellation
+   std::atomic<bool> finished = false;
+
+   // Set by the first of complete() and await_suspend(), the second one resumes the coroutine
+   std::atomic<bool> armed = false;
+};
+
+void libqotp::OtpAwaitable::State::complete(std::optional<quint32> result)
+{
+   if (finished.exchange(true, std::memory_order_acq_rel))
+   {
+      return;
+   }
+
+   value = result;
+   if (!armed.exchange(true, std::memory_order_acq_rel))
+   {
+      // Not suspended yet, await_ready() or await_suspend() picks the value up
+      return;
+   }
+
+   if (context)
+   {
+      QMetaObject::invokeMethod(context, [coroutine = handle]() { coroutine.resume(); }, Qt::QueuedConnection);
+   }
+   else
+   {
+      handle.resume();
+   }
+}
+
+void libqotp::OtpAwaitable::Canceller::operator()() const
+{
+   state->complete(std::nullopt);
+}
+
+libqotp::OtpAwaitable::OtpAwaitable(const std::stop_token &stopToken)
+   : m_state(std::make_shared<State>())
+{
+   // Invoked right here if stop was already requested
+   if (stopToken.stop_possible())
+   {
+      m_stopCallback.emplace(stopToken, Canceller{m_state});
+   }
+}
+
+libqotp::OtpAwaitable::~OtpAwaitable() = default;
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+bool libqotp::OtpAwaitable::await_ready() const noexcept
+{
+   return m_state->armed.load(std::memory_order_acquire);
+}
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+bool libqotp::OtpAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+   State *state = m_state.get();
+   state->handle = handle;
+   if (QThread::currentThread()->eventDispatcher())
+   {
+      state->context = new QObject;
+   }
+
+   // Once armed, the coroutine may run and destroy this awaitable on another thread at any time
+   return !state->armed.exchange(true, std::memory_order_acq_rel);
+}
+
+std::optional<quint32> libqotp::OtpAwaitable::take()
+{
+   // Deleted by the event loop, the resumption may still be delivered to it
+   if (m_state->context)
+   {
+      m_state->context->deleteLater();
+      m_state->context = nullptr;
+   }
+
+   m_stopCallback.reset();
+   return m_state->value;
+}
+
+libqotp::VerifyAwaitable::VerifyAwaitable(
+    AsyncVerifier &verifier,
+    const OtpKey &key,
+    quint32 code,
+    std::stop_token stopToken,
+    quint64 currentUnixTime)
+   : OtpAwaitable(stopToken)
+{
+   verifier.verify(
+       key, code, [state = m_state](bool valid) { state->complete(valid ? 1u : 0u); }, currentUnixTime, std::move(stopToken));
+}
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+bool libqotp::VerifyAwaitable::await_resume()
+{
+   return take().value_or(0) != 0;
+}
+
+libqotp::GenerateAwaitable::GenerateAwaitable(
+    AsyncVerifier &verifier,
+    const OtpKey &key,
+    std::stop_token stopToken,
+    quint64 currentUnixTime)
+   : OtpAwaitable(stopToken)
+{
+   verifier.generate(
+       key, [state = m_state](std::optional<quint32> value) { state->complete(value); }, currentUnixTime, std::move(stopToken));
+}
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+std::optional<quint32> libqotp::GenerateAwaitable::await_resume()
+{
+   return take();
+}
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+libqotp::VerifyAwaitable libqotp::totp_verify_async(
+    AsyncVerifier &verifier,
+    const OtpKey &key,
+    quint32 code,
+    std::stop_token stopToken,
+    quint64 currentUnixTime)
+{
+   return VerifyAwaitable(verifier, key, code, std::move(stopToken), currentUnixTime);
+}
+
+// Refer to the detailed documentation in awaitable.h for complete information about this function.
+libqotp::GenerateAwaitable libqotp::totp_async(
+    AsyncVerifier &verifier,
+    const OtpKey &key,
+    std::stop_token stopToken,
+    quint64 currentUnixTime)
+{
+   return GenerateAwaitable(verifier, key, std::move(stopToken), currentUnixTime);
+}
@@ -1,53 +1,310 @@
 #include <libqotp/qotp.h>
 
-#include <QMap>
+#include "base32_simd.h"
+#include "cpu.h"
+#include "metrics_record.h"
 
-// Refer to the detailed documentation in qotp.h for complete information about this function.
-QByteArray libqotp::base32_decode(const QString &base32String)
+#include <array>
+
+namespace
 {
-   static const QMap<char, quint8> base32Alphabet = {
-      {'A', 0}   , {'B', 1}  , {'C', 2}  , {'D', 3}   , {'E', 4}  , {'F', 5}  , {'G', 6}  , {'H', 7},
-      {'I', 8}   , {'J', 9}  , {'K', 10} , {'L', 11}  , {'M', 12} , {'N', 13} , {'O', 14} ,
-      {'P', 15}  , {'Q', 16} , {'R', 17} , {'S', 18}  , {'T', 19} , {'U', 20} , {'V', 21} ,
-      {'W', 22}  , {'X', 23} , {'Y', 24} , {'Z', 25}  , {'2', 26} , {'3', 27} , {'4', 28} ,
-      {'5', 29}  , {'6', 30} , {'7', 31}
-   };
+   // Maps a decoding error to the error of the try_ functions and the metrics
+   libqotp::OtpError otp_error(libqotp::Base32Error error)
+   {
+      switch (error)
+      {
+      case libqotp::Base32Error::None:
+         return libqotp::OtpError::None;
+      case libqotp::Base32Error::InvalidCharacter:
+         return libqotp::OtpError::InvalidBase32Character;
+      case libqotp::Base32Error::CharacterAfterPadding:
+         return libqotp::OtpError::Base32CharacterAfterPadding;
+      case libqotp::Base32Error::OutputTooSmall:
+         return libqotp::OtpError::OutputTooSmall;
+      }
 
-   QByteArray decoded;
-   int bitBuffer = 0;
-   int currentBits = 0;
-   int paddingCount = 0;
+      return libqotp::OtpError::None;
+   }
+
+   // Table entries that are not a 5-bit value
+   constexpr quint8 invalid = 0xff;
+   constexpr quint8 padding = 0xfe;
+
+   // Maps every Latin-1 character to its 5-bit value, 'padding' or 'invalid'. Lower case letters decode
+   // like upper case ones.
+   constexpr std::array<quint8, 256> make_decode_table()
+   {
+      std::array<quint8, 256> table = {};
+      for (quint8 &entry : table)
+      {
+         entry = invalid;
+      }
+
+      for (int i = 0; i < 26; ++i)
+      {
+         table['A' + i] = static_cast<quint8>(i);
+         table['a' + i] = static_cast<quint8>(i);
+      }
+
+      for (int i = 0; i < 6; ++i)
+      {
+         table['2' + i] = static_cast<quint8>(26 + i);
+      }
+
+      table['='] = padding;
+      return table;
+   }
+
+   constexpr std::array<quint8, 256> decode_table = make_decode_table();
+
+   constexpr char upper_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+   constexpr char lower_alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+   quint8 decode_value(char16_t c)
+   {
+      return c < decode_table.size() ? decode_table[c] : invalid;
+   }
+
+   quint8 decode_value(char c)
+   {
+      return decode_table[static_cast<quint8>(c)];
+   }
 
-   for (QChar c : base32String.toUpper())
+   // Decodes as many leading blocks as the vector kernels accept. Returns the number of characters consumed,
+   // the number of bytes written is consumed * 5 / 8.
+   template <typename Char>
+   qsizetype decode_blocks(const Char *input, qsizetype length, char *output, qsizetype outputSize)
    {
-      if (c == '=')
+      qsizetype consumed = 0;
+
+#if defined(QOTP_ARCH_X86)
+      const libqotp::detail::CpuFeatures &features = libqotp::detail::cpu_features();
+      if (features.avx2 && length >= 32)
       {
-         // Padding character
-         paddingCount++;
-         continue;
+         consumed = libqotp::detail::base32_decode_avx2(input, length, output, outputSize);
       }
 
-      if (!base32Alphabet.contains(c.toLatin1()))
+      if (features.ssse3 && length - consumed >= 16)
+      {
+         const qsizetype written = consumed * 5 / 8;
+         consumed += libqotp::detail::base32_decode_ssse3(input + consumed, length - consumed, output + written, outputSize - written);
+      }
+#else
+      Q_UNUSED(input);
+      Q_UNUSED(length);
+      Q_UNUSED(output);
+      Q_UNUSED(outputSize);
+#endif
+
+      return consumed;
+   }
+
+   // Encodes as many leading blocks as the vector kernels handle. Returns the number of bytes consumed,
+   // the number of characters written is consumed / 5 * 8.
+   qsizetype encode_blocks(const char *input, qsizetype length, char *output, bool lowercase)
+   {
+      qsizetype consumed = 0;
+
+#if defined(QOTP_ARCH_X86)
+      const libqotp::detail::CpuFeatures &features = libqotp::detail::cpu_features();
+      if (features.avx2 && length >= 20)
       {
-         // Invalid character encountered
-         return QByteArray();
+         consumed = libqotp::detail::base32_encode_avx2(input, length, output, lowercase);
       }
 
-      if (paddingCount > 0)
+      if (features.ssse3 && length - consumed >= 10)
       {
-         // Any character after a padding character is invalid
-         return QByteArray();
+         consumed += libqotp::detail::base32_encode_ssse3(input + consumed, length - consumed, output + consumed / 5 * 8, lowercase);
       }
+#else
+      Q_UNUSED(input);
+      Q_UNUSED(length);
+      Q_UNUSED(output);
+      Q_UNUSED(lowercase);
+#endif
+
+      return consumed;
+   }
+
+   // Decodes UTF-16 or Latin-1 input. Every character is read before the byte it completes is written and
+   // the output never runs ahead of the input, so Latin-1 input can be decoded in place.
+   template <typename Char>
+   libqotp::Base32DecodeResult decode(const Char *input, qsizetype length, char *output, qsizetype outputSize)
+   {
+      libqotp::Base32DecodeResult result;
+
+      // Long runs of alphabet characters are decoded in vector blocks first
+      qsizetype position = decode_blocks(input, length, output, outputSize);
+      qsizetype written = position * 5 / 8;
 
-      bitBuffer = (bitBuffer << 5) | base32Alphabet[c.toLatin1()];
-      currentBits += 5;
+      quint32 bitBuffer = 0;
+      int currentBits = 0;
+      bool paddingSeen = false;
 
-      if (currentBits >= 8)
+      for (; position < length; ++position)
       {
-         decoded.append(static_cast<char>((bitBuffer >> (currentBits - 8)) & 0xFF));
-         currentBits -= 8;
+         const quint8 value = decode_value(input[position]);
+
+         if (value == invalid)
+         {
+            // Invalid character encountered
+            result.error = libqotp::Base32Error::InvalidCharacter;
+            result.position = position;
+            return result;
+         }
+
+         if (value == padding)
+         {
+            // Padding character
+            paddingSeen = true;
+            continue;
+         }
+
+         if (paddingSeen)
+         {
+            // Any character after a padding character is invalid
+            result.error = libqotp::Base32Error::CharacterAfterPadding;
+            result.position = position;
+            return result;
+         }
+
+         bitBuffer = (bitBuffer << 5) | value;
+         currentBits += 5;
+
+         if (currentBits >= 8)
+         {
+            if (written == outputSize)
+            {
+               result.error = libqotp::Base32Error::OutputTooSmall;
+               return result;
+            }
+
+            currentBits -= 8;
+            output[written++] = static_cast<char>((bitBuffer >> currentBits) & 0xff);
+         }
       }
+
+      result.size = written;
+      return result;
+   }
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Base32DecodeResult libqotp::base32_decode(QStringView base32, std::span<char> output)
+{
+   const Base32DecodeResult result = decode(base32.utf16(), base32.size(), output.data(), static_cast<qsizetype>(output.size()));
+   if (!result.isValid())
+   {
+      detail::record_failure(otp_error(result.error));
+   }
+   return result;
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Base32DecodeResult libqotp::base32_decode(QByteArrayView base32, std::span<char> output)
+{
+   const Base32DecodeResult result = decode(base32.data(), base32.size(), output.data(), static_cast<qsizetype>(output.size()));
+   if (!result.isValid())
+   {
+      detail::record_failure(otp_error(result.error));
+   }
+   return result;
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QByteArray libqotp::base32_decode(QStringView base32, Base32Error &error)
+{
+   QByteArray decoded(base32_decoded_size(base32.size()), Qt::Uninitialized);
+
+   const Base32DecodeResult result = libqotp::base32_decode(base32, std::span<char>(decoded.data(), decoded.size()));
+   error = result.error;
+   if (!result.isValid())
+   {
+      return QByteArray();
+   }
+
+   decoded.truncate(result.size);
+   return decoded;
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QByteArray libqotp::base32_decode(const QString &base32String)
+{
+   return libqotp::try_base32_decode(QStringView(base32String)).value();
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QByteArray> libqotp::try_base32_decode(QStringView base32)
+{
+   Base32Error error = Base32Error::None;
+   QByteArray decoded = libqotp::base32_decode(base32, error);
+   if (error != Base32Error::None)
+   {
+      return otp_error(error);
    }
 
    return decoded;
 }
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+qsizetype libqotp::base32_encode(QByteArrayView data, std::span<char> output, Base32Options options)
+{
+   const qsizetype size = base32_encoded_size(data.size(), options);
+   if (static_cast<qsizetype>(output.size()) < size)
+   {
+      return -1;
+   }
+
+   const bool lowercase = options.testFlag(Base32Option::Lowercase);
+   const char *alphabet = lowercase ? lower_alphabet : upper_alphabet;
+
+   // Whole blocks of 10 or 20 bytes are encoded by the vector kernels first
+   qsizetype position = encode_blocks(data.data(), data.size(), output.data(), lowercase);
+   qsizetype written = position / 5 * 8;
+
+   quint32 bitBuffer = 0;
+   int currentBits = 0;
+
+   for (; position < data.size(); ++position)
+   {
+      bitBuffer = (bitBuffer << 8) | static_cast<quint8>(data[position]);
+      currentBits += 8;
+
+      while (currentBits >= 5)
+      {
+         currentBits -= 5;
+         output[written++] = alphabet[(bitBuffer >> currentBits) & 0x1f];
+      }
+   }
+
+   if (currentBits > 0)
+   {
+      // The last character is filled up with zero bits
+      output[written++] = alphabet[(bitBuffer << (5 - currentBits)) & 0x1f];
+   }
+
+   while (written < size)
+   {
+      output[written++] = '=';
+   }
+
+   return written;
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QString libqotp::base32_encode(QByteArrayView data, Base32Options options)
+{
+   // Secrets are short, so the characters usually go through a stack buffer before the QString is built
+   const qsizetype size = base32_encoded_size(data.size(), options);
+
+   char buffer[256];
+   if (size <= static_cast<qsizetype>(sizeof(buffer)))
+   {
+      const qsizetype written = libqotp::base32_encode(data, std::span<char>(buffer), options);
+      return QString::fromLatin1(buffer, written);
+   }
+
+   QByteArray encoded(size, Qt::Uninitialized);
+   const qsizetype written = libqotp::base32_encode(data, std::span<char>(encoded.data(), encoded.size()), options);
+   return QString::fromLatin1(encoded.constData(), written);
+}
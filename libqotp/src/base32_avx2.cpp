@@ -0,0 +1,119 @@
+#include "base32_simd.h"
+#include "cpu.h"
+
+#if defined(QOTP_ARCH_X86)
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace
+{
+   // Loads 32 characters as bytes. The pack works per 128-bit lane, the permute restores the order.
+   __m256i load_characters(const char16_t *input)
+   {
+      const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+      const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + 16));
+      return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+   }
+
+   __m256i load_characters(const char *input)
+   {
+      return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+   }
+
+   // Like the SSSE3 kernel, safe for decoding in place
+   template <typename Char>
+   qsizetype decode(const Char *input, qsizetype length, char *output, qsizetype outputSize)
+   {
+      qsizetype consumed = 0;
+      qsizetype written = 0;
+
+      while (length - consumed >= 32 && outputSize - written >= 20)
+      {
+         const __m256i characters = load_characters(input + consumed);
+
+         // Same mapping as the SSSE3 kernel, see base32_ssse3.cpp
+         const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(characters, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+         const __m256i digit = _mm256_sub_epi8(characters, _mm256_set1_epi8('2'));
+         const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+         const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(5)), digit);
+
+         if (_mm256_movemask_epi8(_mm256_or_si256(isLetter, isDigit)) != -1)
+         {
+            break;
+         }
+
+         const __m256i values = _mm256_or_si256(_mm256_and_si256(isLetter, letter), _mm256_and_si256(isDigit, _mm256_add_epi8(digit, _mm256_set1_epi8(26))));
+
+         const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0120));
+         const __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010400));
+
+         const __m256i merged = _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(quads, _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1)), 20), _mm256_srli_epi64(quads, 32));
+         const __m256i bytes = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+            4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1,
+            4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1));
+
+         // Each 128-bit lane holds 10 bytes
+         alignas(32) char block[32];
+         _mm256_store_si256(reinterpret_cast<__m256i *>(block), bytes);
+         std::memcpy(output + written, block, 10);
+         std::memcpy(output + written + 10, block + 16, 10);
+
+         consumed += 32;
+         written += 20;
+      }
+
+      return consumed;
+   }
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_decode_avx2(const char16_t *input, qsizetype length, char *output, qsizetype outputSize)
+{
+   return decode(input, length, output, outputSize);
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_decode_avx2(const char *input, qsizetype length, char *output, qsizetype outputSize)
+{
+   return decode(input, length, output, outputSize);
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_encode_avx2(const char *input, qsizetype length, char *output, bool lowercase)
+{
+   const __m256i letterBase = _mm256_set1_epi8(lowercase ? 'a' : 'A');
+   const __m256i digitOffset = _mm256_set1_epi8(static_cast<char>(lowercase ? '2' - 26 - 'a' : '2' - 26 - 'A'));
+
+   qsizetype consumed = 0;
+   qsizetype written = 0;
+
+   while (length - consumed >= 20)
+   {
+      // Ten input bytes per 128-bit lane, then the same steps as the SSSE3 kernel, see base32_ssse3.cpp
+      alignas(32) char block[32] = {};
+      std::memcpy(block, input + consumed, 10);
+      std::memcpy(block + 16, input + consumed + 10, 10);
+      const __m256i bytes = _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+
+      const __m256i groups = _mm256_shuffle_epi8(bytes, _mm256_setr_epi8(
+         4, 3, 2, 1, 0, -1, -1, -1, 9, 8, 7, 6, 5, -1, -1, -1,
+         4, 3, 2, 1, 0, -1, -1, -1, 9, 8, 7, 6, 5, -1, -1, -1));
+
+      const __m256i halves = _mm256_or_si256(_mm256_srli_epi64(groups, 20), _mm256_slli_epi64(_mm256_and_si256(groups, _mm256_set1_epi64x(0xfffff)), 32));
+      const __m256i quarters = _mm256_or_si256(_mm256_srli_epi32(halves, 10), _mm256_slli_epi32(_mm256_and_si256(halves, _mm256_set1_epi32(0x3ff)), 16));
+      const __m256i values = _mm256_or_si256(_mm256_srli_epi16(quarters, 5), _mm256_slli_epi16(_mm256_and_si256(quarters, _mm256_set1_epi16(0x1f)), 8));
+
+      const __m256i isDigit = _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25));
+      const __m256i characters = _mm256_add_epi8(_mm256_add_epi8(values, letterBase), _mm256_and_si256(isDigit, digitOffset));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + written), characters);
+
+      consumed += 20;
+      written += 32;
+   }
+
+   return consumed;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef LIBQOTP_BASE32_SECRET_H_20261018
+#define LIBQOTP_BASE32_SECRET_H_20261018
+
+#include <libqotp/qotp.h>
+
+#include "sha.h"
+
+namespace libqotp::detail
+{
+   /**
+    * Decodes a Base32 secret and calls 'function' with the decoded bytes.
+    *
+    * Secrets of common length are decoded into a stack buffer, so the Base32 convenience wrappers do not
+    * allocate for the secret. An invalid encoding is passed on as an empty secret, which every entry point
+    * rejects. The decoded secret is wiped afterwards.
+    */
+   template <typename Function>
+   auto with_base32_secret(const QString &base32, Function function)
+   {
+      char buffer[128];
+      if (base32_decoded_size(base32.size()) <= static_cast<qsizetype>(sizeof(buffer)))
+      {
+         const Base32DecodeResult decoded = base32_decode(QStringView(base32), std::span<char>(buffer));
+         auto result = function(QByteArrayView(buffer, decoded.isValid() ? decoded.size : 0));
+         secure_zero(buffer, sizeof(buffer));
+         return result;
+      }
+
+      QByteArray secret = base32_decode(base32);
+      auto result = function(QByteArrayView(secret));
+      secure_zero(secret.data(), static_cast<std::size_t>(secret.size()));
+      return result;
+   }
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef LIBQOTP_BASE32_SIMD_H_20261018
+#define LIBQOTP_BASE32_SIMD_H_20261018
+
+#include <QtGlobal>
+
+// Vectorized Base32 decoding and encoding.
+//
+// The decoding kernels decode whole blocks of 16 (SSSE3) or 32 (AVX2) characters, which are exactly 10 or 20 bytes
+// of output, so the scalar decoder can continue with an empty bit buffer where a kernel stops. A kernel stops
+// at the first block that contains anything but alphabet characters and leaves padding, errors and the tail
+// to the scalar decoder, which also produces the error position.
+namespace libqotp::detail
+{
+   /**
+    * Decodes leading blocks of 'input' as long as they consist of alphabet characters only and 'output'
+    * has room for them.
+    *
+    * The Latin-1 overloads accept 'output' == 'input' and then decode in place.
+    *
+    * @return The number of input characters consumed, a multiple of the block size. Exactly
+    *         consumed * 5 / 8 bytes were written to 'output'.
+    */
+   qsizetype base32_decode_ssse3(const char16_t *input, qsizetype length, char *output, qsizetype outputSize);
+   qsizetype base32_decode_ssse3(const char *input, qsizetype length, char *output, qsizetype outputSize);
+   qsizetype base32_decode_avx2(const char16_t *input, qsizetype length, char *output, qsizetype outputSize);
+   qsizetype base32_decode_avx2(const char *input, qsizetype length, char *output, qsizetype outputSize);
+
+   /**
+    * Encodes leading blocks of 10 (SSSE3) or 20 (AVX2) bytes into 16 or 32 characters. The caller guarantees
+    * room for length / 10 * 16 characters and encodes the remaining bytes itself.
+    *
+    * @return The number of input bytes consumed, a multiple of the block size.
+    */
+   qsizetype base32_encode_ssse3(const char *input, qsizetype length, char *output, bool lowercase);
+   qsizetype base32_encode_avx2(const char *input, qsizetype length, char *output, bool lowercase);
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "base32_simd.h"
+#include "cpu.h"
+
+#if defined(QOTP_ARCH_X86)
+
+#include <tmmintrin.h>
+
+#include <cstring>
+
+namespace
+{
+   // Loads 16 characters as bytes. UTF-16 code units above 0xff saturate to 0xff or 0x00,
+   // neither of which is in the alphabet.
+   __m128i load_characters(const char16_t *input)
+   {
+      const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+      const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 8));
+      return _mm_packus_epi16(low, high);
+   }
+
+   __m128i load_characters(const char *input)
+   {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+   }
+
+   // A block is completely loaded before its 10 bytes are stored, and the output never runs ahead of
+   // the input, so 'output' may point to 'input' for decoding in place.
+   template <typename Char>
+   qsizetype decode(const Char *input, qsizetype length, char *output, qsizetype outputSize)
+   {
+      qsizetype consumed = 0;
+      qsizetype written = 0;
+
+      while (length - consumed >= 16 && outputSize - written >= 10)
+      {
+         const __m128i characters = load_characters(input + consumed);
+
+         // 'A'-'Z' and 'a'-'z' map to 0-25, '2'-'7' to 26-31. An unsigned comparison against the range
+         // end is done as min(x, end) == x.
+         const __m128i letter = _mm_sub_epi8(_mm_or_si128(characters, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+         const __m128i digit = _mm_sub_epi8(characters, _mm_set1_epi8('2'));
+         const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+         const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(5)), digit);
+
+         if (_mm_movemask_epi8(_mm_or_si128(isLetter, isDigit)) != 0xffff)
+         {
+            // Padding, an invalid character or non-Base32 text: the scalar decoder takes over
+            break;
+         }
+
+         const __m128i values = _mm_or_si128(_mm_and_si128(isLetter, letter), _mm_and_si128(isDigit, _mm_add_epi8(digit, _mm_set1_epi8(26))));
+
+         // Merge 5-bit values into 10-bit pairs, then 20-bit quads
+         const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0120));
+         const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010400));
+
+         // Merge two quads into the 40 bits of each 64-bit lane, then emit them big-endian
+         const __m128i merged = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(quads, _mm_set_epi32(0, -1, 0, -1)), 20), _mm_srli_epi64(quads, 32));
+         const __m128i bytes = _mm_shuffle_epi8(merged, _mm_setr_epi8(4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1));
+
+         alignas(16) char block[16];
+         _mm_store_si128(reinterpret_cast<__m128i *>(block), bytes);
+         std::memcpy(output + written, block, 10);
+
+         consumed += 16;
+         written += 10;
+      }
+
+      return consumed;
+   }
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_decode_ssse3(const char16_t *input, qsizetype length, char *output, qsizetype outputSize)
+{
+   return decode(input, length, output, outputSize);
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_decode_ssse3(const char *input, qsizetype length, char *output, qsizetype outputSize)
+{
+   return decode(input, length, output, outputSize);
+}
+
+// Refer to the detailed documentation in base32_simd.h for complete information about this function.
+qsizetype libqotp::detail::base32_encode_ssse3(const char *input, qsizetype length, char *output, bool lowercase)
+{
+   // 'A' + value for letters, '2' + value - 26 for digits
+   const __m128i letterBase = _mm_set1_epi8(lowercase ? 'a' : 'A');
+   const __m128i digitOffset = _mm_set1_epi8(static_cast<char>(lowercase ? '2' - 26 - 'a' : '2' - 26 - 'A'));
+
+   qsizetype consumed = 0;
+   qsizetype written = 0;
+
+   while (length - consumed >= 10)
+   {
+      alignas(16) char block[16] = {};
+      std::memcpy(block, input + consumed, 10);
+      const __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+
+      // Each 64-bit lane receives five input bytes as a 40-bit big-endian number
+      const __m128i groups = _mm_shuffle_epi8(bytes, _mm_setr_epi8(4, 3, 2, 1, 0, -1, -1, -1, 9, 8, 7, 6, 5, -1, -1, -1));
+
+      // Split 40 bits into two 20-bit, four 10-bit and finally eight 5-bit values, in output order
+      const __m128i halves = _mm_or_si128(_mm_srli_epi64(groups, 20), _mm_slli_epi64(_mm_and_si128(groups, _mm_set1_epi64x(0xfffff)), 32));
+      const __m128i quarters = _mm_or_si128(_mm_srli_epi32(halves, 10), _mm_slli_epi32(_mm_and_si128(halves, _mm_set1_epi32(0x3ff)), 16));
+      const __m128i values = _mm_or_si128(_mm_srli_epi16(quarters, 5), _mm_slli_epi16(_mm_and_si128(quarters, _mm_set1_epi16(0x1f)), 8));
+
+      const __m128i isDigit = _mm_cmpgt_epi8(values, _mm_set1_epi8(25));
+      const __m128i characters = _mm_add_epi8(_mm_add_epi8(values, letterBase), _mm_and_si128(isDigit, digitOffset));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(output + written), characters);
+
+      consumed += 10;
+      written += 16;
+   }
+
+   return consumed;
+}
+
+#endif
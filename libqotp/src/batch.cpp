@@ -0,0 +1,182 @@
+#include <libqotp/batch.h>
+
+#include "hotp_batch.h"
+#include "parallel.h"
+#include "truncate.h"
+
+#include <algorithm>
+
+static_assert(libqotp::invalid_batch_value == libqotp::detail::invalid_code);
+
+namespace
+{
+   // The number of entries a thread prepares on its stack before handing them to the HMAC engine
+   constexpr std::size_t scratchSize = 64;
+
+   // Computes values[begin, end) for precomputed keys. 'counterAt(i)' returns the counter of entry i.
+   template <typename CounterAt>
+   void key_values(
+       std::span<const libqotp::OtpKey> keys,
+       CounterAt counterAt,
+       unsigned int digits,
+       quint32 *values,
+       std::size_t begin,
+       std::size_t end)
+   {
+      libqotp::detail::HotpJob jobs[scratchSize];
+
+      for (std::size_t first = begin; first < end; first += scratchSize)
+      {
+         const std::size_t count = std::min(scratchSize, end - first);
+         for (std::size_t i = 0; i < count; ++i)
+         {
+            jobs[i] = {&keys[first + i].coreKey(), counterAt(first + i)};
+         }
+
+         libqotp::detail::hotp_values(jobs, count, digits, values + first);
+      }
+   }
+
+   // Computes values[begin, end) for raw secrets. The keys are derived into a stack buffer that is wiped
+   // when the thread is done with it.
+   template <typename CounterAt>
+   void secret_values(
+       std::span<const QByteArrayView> secrets,
+       QCryptographicHash::Algorithm algorithm,
+       CounterAt counterAt,
+       unsigned int digits,
+       quint32 *values,
+       std::size_t begin,
+       std::size_t end)
+   {
+      libqotp::OtpKey keys[scratchSize];
+      libqotp::detail::HotpJob jobs[scratchSize];
+
+      for (std::size_t first = begin; first < end; first += scratchSize)
+      {
+         const std::size_t count = std::min(scratchSize, end - first);
+         for (std::size_t i = 0; i < count; ++i)
+         {
+            keys[i] = libqotp::OtpKey(secrets[first + i], algorithm);
+            jobs[i] = {&keys[i].coreKey(), counterAt(first + i)};
+         }
+
+         libqotp::detail::hotp_values(jobs, count, digits, values + first);
+      }
+   }
+
+   template <typename Function>
+   void run(std::size_t count, const libqotp::BatchOptions &options, Function function)
+   {
+      libqotp::detail::parallel_for(count, options.pool, options.maxThreads, static_cast<std::size_t>(std::max<qsizetype>(options.minimumPerThread, 1)), function);
+   }
+}
+
+// Refer to the detailed documentation in batch.h for complete information about this function.
+bool libqotp::totp_batch(
+    std::span<const OtpKey> keys,
+    quint64 currentUnixTime,
+    std::span<quint32> values,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    const BatchOptions &options)
+{
+   // Input validation
+   if (timeStep == 0 || !detail::valid_digits(digits, digitMinimum, digitMaximum) || values.size() < keys.size())
+   {
+      return false;
+   }
+
+   // All entries share the counter of the current time step
+   const quint64 counter = (currentUnixTime - epoch) / timeStep;
+   const auto counterAt = [counter](std::size_t) { return counter; };
+
+   run(keys.size(), options, [&](std::size_t begin, std::size_t end)
+   {
+      key_values(keys, counterAt, digits, values.data(), begin, end);
+   });
+   return true;
+}
+
+// Refer to the detailed documentation in batch.h for complete information about this function.
+bool libqotp::totp_batch(
+    std::span<const QByteArrayView> secrets,
+    quint64 currentUnixTime,
+    std::span<quint32> values,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm,
+    const BatchOptions &options)
+{
+   // Input validation
+   if (timeStep == 0 || !detail::valid_digits(digits, digitMinimum, digitMaximum) || values.size() < secrets.size())
+   {
+      return false;
+   }
+
+   const quint64 counter = (currentUnixTime - epoch) / timeStep;
+   const auto counterAt = [counter](std::size_t) { return counter; };
+
+   run(secrets.size(), options, [&](std::size_t begin, std::size_t end)
+   {
+      secret_values(secrets, algorithm, counterAt, digits, values.data(), begin, end);
+   });
+   return true;
+}
+
+// Refer to the detailed documentation in batch.h for complete information about this function.
+bool libqotp::hotp_batch(
+    std::span<const OtpKey> keys,
+    std::span<const quint64> counters,
+    std::span<quint32> values,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    const BatchOptions &options)
+{
+   // Input validation
+   if (!detail::valid_digits(digits, digitMinimum, digitMaximum) || counters.size() != keys.size() || values.size() < keys.size())
+   {
+      return false;
+   }
+
+   const auto counterAt = [counters](std::size_t index) { return counters[index]; };
+
+   run(keys.size(), options, [&](std::size_t begin, std::size_t end)
+   {
+      key_values(keys, counterAt, digits, values.data(), begin, end);
+   });
+   return true;
+}
+
+// Refer to the detailed documentation in batch.h for complete information about this function.
+bool libqotp::hotp_batch(
+    std::span<const QByteArrayView> secrets,
+    std::span<const quint64> counters,
+    std::span<quint32> values,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm,
+    const BatchOptions &options)
+{
+   // Input validation
+   if (!detail::valid_digits(digits, digitMinimum, digitMaximum) || counters.size() != secrets.size() || values.size() < secrets.size())
+   {
+      return false;
+   }
+
+   const auto counterAt = [counters](std::size_t index) { return counters[index]; };
+
+   run(secrets.size(), options, [&](std::size_t begin, std::size_t end)
+   {
+      secret_values(secrets, algorithm, counterAt, digits, values.data(), begin, end);
+   });
+   return true;
+}
@@ -0,0 +1,93 @@
+#include <libqotp/clock.h>
+
+#include <chrono>
+#include <limits>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace
+{
+   // nullptr stands for the built-in coarse clock, which current_unix_time() then reads without a virtual call
+   std::atomic<const libqotp::Clock *> g_defaultClock{nullptr};
+
+   quint64 system_seconds()
+   {
+      const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      return seconds > 0 ? static_cast<quint64>(seconds) : 0;
+   }
+
+   quint64 coarse_seconds()
+   {
+#if defined(__linux__) && defined(CLOCK_REALTIME_COARSE)
+      timespec time;
+      if (clock_gettime(CLOCK_REALTIME_COARSE, &time) == 0)
+      {
+         return time.tv_sec > 0 ? static_cast<quint64>(time.tv_sec) : 0;
+      }
+#endif
+      return system_seconds();
+   }
+
+   // Adds a signed offset, clamped to the range of quint64
+   quint64 add_offset(quint64 time, qint64 offset)
+   {
+      if (offset < 0)
+      {
+         const quint64 magnitude = static_cast<quint64>(-(offset + 1)) + 1;
+         return time > magnitude ? time - magnitude : 0;
+      }
+
+      const quint64 magnitude = static_cast<quint64>(offset);
+      return time <= std::numeric_limits<quint64>::max() - magnitude ? time + magnitude : std::numeric_limits<quint64>::max();
+   }
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+quint64 libqotp::SystemClock::now() const
+{
+   return system_seconds();
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+quint64 libqotp::CoarseClock::now() const
+{
+   return coarse_seconds();
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+void libqotp::FakeClock::advance(qint64 seconds)
+{
+   quint64 time = m_time.load(std::memory_order_relaxed);
+   while (!m_time.compare_exchange_weak(time, add_offset(time, seconds), std::memory_order_relaxed))
+   {
+   }
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+quint64 libqotp::SkewedClock::now() const
+{
+   return add_offset(m_base.now(), offset());
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+const libqotp::Clock &libqotp::default_clock()
+{
+   static const CoarseClock coarse;
+   const Clock *clock = g_defaultClock.load(std::memory_order_acquire);
+   return clock ? *clock : coarse;
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+void libqotp::set_default_clock(const Clock *clock)
+{
+   g_defaultClock.store(clock, std::memory_order_release);
+}
+
+// Refer to the detailed documentation in clock.h for complete information about this function.
+quint64 libqotp::current_unix_time()
+{
+   const Clock *clock = g_defaultClock.load(std::memory_order_acquire);
+   return clock ? clock->now() : coarse_seconds();
+}
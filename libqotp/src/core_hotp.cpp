@@ -0,0 +1,468 @@
+#include <libqotp/core/hotprange.h>
+#include <libqotp/core/otp.h>
+
+#include "hotp_batch.h"
+#include "key_access.h"
+#include "multibuffer.h"
+#include "sha.h"
+#include "truncate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace
+{
+   using libqotp::core::Algorithm;
+
+   libqotp::detail::HashKind hash_kind(Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case Algorithm::Sha256:
+         return libqotp::detail::HashKind::Sha256;
+      case Algorithm::Sha512:
+         return libqotp::detail::HashKind::Sha512;
+      default:
+         return libqotp::detail::HashKind::Sha1;
+      }
+   }
+
+   int hash_length(libqotp::detail::HashKind kind)
+   {
+      switch (kind)
+      {
+      case libqotp::detail::HashKind::Sha1:
+         return 20;
+      case libqotp::detail::HashKind::Sha256:
+         return 32;
+      case libqotp::detail::HashKind::Sha512:
+         return 64;
+      }
+      return 0;
+   }
+
+   // HMAC over the 8 byte big-endian counter, continuing from the midstates cached in the key.
+   template <Algorithm HashAlgorithm>
+   void hmac_counter(const libqotp::core::Key &key, std::uint64_t counter, std::uint8_t *digest)
+   {
+      using libqotp::detail::KeyAccess;
+
+      std::uint8_t message[8];
+      libqotp::detail::write_counter(counter, message);
+
+      if constexpr (HashAlgorithm == Algorithm::Sha512)
+      {
+         std::uint64_t state[8];
+         std::uint8_t innerHash[64];
+
+         std::memcpy(state, KeyAccess::innerState(key), sizeof(state));
+         libqotp::detail::sha512_finish(state, message, sizeof(message), 128, innerHash);
+
+         std::memcpy(state, KeyAccess::outerState(key), sizeof(state));
+         libqotp::detail::sha512_finish(state, innerHash, sizeof(innerHash), 128, digest);
+      }
+      else if constexpr (HashAlgorithm == Algorithm::Sha256)
+      {
+         std::uint32_t state[8];
+         std::uint8_t innerHash[32];
+
+         std::memcpy(state, KeyAccess::innerState(key), sizeof(state));
+         libqotp::detail::sha256_finish(state, message, sizeof(message), 64, innerHash);
+
+         std::memcpy(state, KeyAccess::outerState(key), sizeof(state));
+         libqotp::detail::sha256_finish(state, innerHash, sizeof(innerHash), 64, digest);
+      }
+      else
+      {
+         std::uint32_t state[5];
+         std::uint8_t innerHash[20];
+
+         std::memcpy(state, KeyAccess::innerState(key), sizeof(state));
+         libqotp::detail::sha1_finish(state, message, sizeof(message), 64, innerHash);
+
+         std::memcpy(state, KeyAccess::outerState(key), sizeof(state));
+         libqotp::detail::sha1_finish(state, innerHash, sizeof(innerHash), 64, digest);
+      }
+   }
+
+   // The entry points of one Hotp instance, selected at runtime by algorithm and digit count.
+   struct HotpKernel
+   {
+      std::optional<std::uint32_t> (*value)(const libqotp::core::Key &key, std::uint64_t counter);
+      bool (*write)(const libqotp::core::Key &key, std::uint64_t counter, char *output);
+   };
+
+   template <Algorithm HashAlgorithm, unsigned int Digits>
+   bool write_kernel(const libqotp::core::Key &key, std::uint64_t counter, char *output)
+   {
+      return libqotp::core::Hotp<HashAlgorithm, Digits>::write(key, counter, std::span<char, Digits>(output, Digits));
+   }
+
+   template <Algorithm HashAlgorithm, std::size_t... Index>
+   constexpr std::array<HotpKernel, sizeof...(Index)> kernels_for(std::index_sequence<Index...>)
+   {
+      return {{{&libqotp::core::Hotp<HashAlgorithm, Index + 1>::value, &write_kernel<HashAlgorithm, Index + 1>}...}};
+   }
+
+   // Indexed by digits - 1
+   constexpr auto sha1_kernels = kernels_for<Algorithm::Sha1>(std::make_index_sequence<libqotp::detail::max_code_digits>());
+   constexpr auto sha256_kernels = kernels_for<Algorithm::Sha256>(std::make_index_sequence<libqotp::detail::max_code_digits>());
+   constexpr auto sha512_kernels = kernels_for<Algorithm::Sha512>(std::make_index_sequence<libqotp::detail::max_code_digits>());
+
+   // Returns the kernel for a valid key and a digit count in [1, max_code_digits].
+   const HotpKernel &kernel_for(const libqotp::core::Key &key, unsigned int digits)
+   {
+      switch (key.algorithm())
+      {
+      case Algorithm::Sha256:
+         return sha256_kernels[digits - 1];
+      case Algorithm::Sha512:
+         return sha512_kernels[digits - 1];
+      default:
+         return sha1_kernels[digits - 1];
+      }
+   }
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+template <libqotp::core::Algorithm HashAlgorithm, unsigned int Digits>
+std::optional<std::uint32_t> libqotp::core::Hotp<HashAlgorithm, Digits>::value(const Key &key, std::uint64_t counter)
+{
+   if (!key.isValid() || key.algorithm() != HashAlgorithm)
+   {
+      return std::nullopt;
+   }
+
+   std::uint8_t hash[hashLength];
+   hmac_counter<HashAlgorithm>(key, counter, hash);
+
+   const std::uint32_t truncatedHash = detail::dynamic_truncate<hashLength>(hash);
+   if constexpr (modulus > std::numeric_limits<std::uint32_t>::max())
+   {
+      // Every 31-bit value has at most 10 digits
+      return truncatedHash;
+   }
+   else
+   {
+      return truncatedHash % static_cast<std::uint32_t>(modulus);
+   }
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+template <libqotp::core::Algorithm HashAlgorithm, unsigned int Digits>
+bool libqotp::core::Hotp<HashAlgorithm, Digits>::write(const Key &key, std::uint64_t counter, std::span<char, Digits> output)
+{
+   const auto code = value(key, counter);
+   if (!code)
+   {
+      return false;
+   }
+
+   detail::write_digits<Digits>(*code, output.data());
+   return true;
+}
+
+// Every configuration the runtime functions dispatch to
+#define LIBQOTP_INSTANTIATE_HOTP(algorithm)                                   \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 1>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 2>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 3>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 4>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 5>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 6>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 7>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 8>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 9>; \
+   template class libqotp::core::Hotp<libqotp::core::Algorithm::algorithm, 10>;
+
+LIBQOTP_INSTANTIATE_HOTP(Sha1)
+LIBQOTP_INSTANTIATE_HOTP(Sha256)
+LIBQOTP_INSTANTIATE_HOTP(Sha512)
+
+#undef LIBQOTP_INSTANTIATE_HOTP
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint32_t> libqotp::core::hotp_value(
+    const Key &key,
+    std::uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Input validation
+   if (!key.isValid())
+   {
+      // An invalid key was built from an empty secret or an unsupported algorithm.
+      return std::nullopt;
+   }
+
+   if (!detail::valid_digits(digits, digitMinimum, digitMaximum))
+   {
+      return std::nullopt;
+   }
+
+   // The specialized instance for the key's algorithm and the digit count
+   return kernel_for(key, digits).value(key, counter);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint32_t> libqotp::core::hotp_value(
+    std::span<const std::byte> secret,
+    std::uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    Algorithm algorithm)
+{
+   // The key lives on the stack, so the one-shot path does not allocate either
+   return core::hotp_value(Key(secret, algorithm), counter, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::size_t libqotp::core::hotp(
+    const Key &key,
+    std::uint64_t counter,
+    std::span<char> output,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Input validation
+   if (!key.isValid() || !detail::valid_digits(digits, digitMinimum, digitMaximum) || output.size() < digits)
+   {
+      return 0;
+   }
+
+   if (!kernel_for(key, digits).write(key, counter, output.data()))
+   {
+      return 0;
+   }
+
+   return digits;
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::size_t libqotp::core::hotp(
+    std::span<const std::byte> secret,
+    std::uint64_t counter,
+    std::span<char> output,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    Algorithm algorithm)
+{
+   return core::hotp(Key(secret, algorithm), counter, output, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in hotp_batch.h for complete information about this function.
+void libqotp::detail::hotp_values(
+    const HotpJob *jobs,
+    std::size_t count,
+    unsigned int digits,
+    std::uint32_t *values)
+{
+   // Jobs are processed in chunks that fit on the stack. Within a chunk, the jobs of each algorithm
+   // are handed to the engine together so that they share vector lanes.
+   constexpr std::size_t chunkSize = 64;
+   HmacCounterJob hmacJobs[chunkSize];
+   std::size_t positions[chunkSize];
+   alignas(64) std::uint8_t digests[chunkSize][64];
+
+   for (std::size_t begin = 0; begin < count; begin += chunkSize)
+   {
+      const std::size_t end = std::min(count, begin + chunkSize);
+
+      for (const HashKind kind : {HashKind::Sha1, HashKind::Sha256, HashKind::Sha512})
+      {
+         std::size_t pending = 0;
+         for (std::size_t i = begin; i < end; ++i)
+         {
+            const core::Key *key = jobs[i].key;
+            if (kind == HashKind::Sha1)
+            {
+               // The first pass also marks every job that no pass will pick up
+               values[i] = invalid_code;
+            }
+
+            if (!key || !key->isValid() || hash_kind(key->algorithm()) != kind)
+            {
+               continue;
+            }
+
+            hmacJobs[pending] = {KeyAccess::innerState(*key), KeyAccess::outerState(*key), jobs[i].counter, digests[pending]};
+            positions[pending] = i;
+            ++pending;
+         }
+
+         if (pending == 0)
+         {
+            continue;
+         }
+
+         hmac_counters(kind, hmacJobs, pending);
+
+         const int hashLength = hash_length(kind);
+         for (std::size_t j = 0; j < pending; ++j)
+         {
+            std::uint32_t truncatedHash = 0;
+            if (dynamic_truncate(digests[j], hashLength, truncatedHash))
+            {
+               values[positions[j]] = reduce_to_digits(truncatedHash, digits);
+            }
+         }
+      }
+   }
+
+   secure_zero(digests, sizeof(digests));
+}
+
+// Refer to the detailed documentation in core/hotprange.h for complete information about this function.
+libqotp::core::HotpRange::HotpRange(
+    const Key &key,
+    std::uint64_t counter,
+    std::uint64_t count,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+   : m_key(&key)
+   , m_first(counter)
+   , m_digits(digits)
+{
+   if (!key.isValid() || !detail::valid_digits(digits, digitMinimum, digitMaximum))
+   {
+      return;
+   }
+
+   // The last counter is 2^64 - 1, which leaves 2^64 - counter of them
+   m_count = counter == 0 ? count : std::min<std::uint64_t>(count, 0 - counter);
+}
+
+void libqotp::core::HotpRange::iterator::fill() const
+{
+   // Consecutive counters of one key, which the engine hashes side by side
+   detail::HotpJob jobs[block_size];
+   m_blockStart = m_index;
+   m_blockCount = std::min<std::uint64_t>(block_size, m_count - m_index);
+   for (std::size_t i = 0; i < m_blockCount; ++i)
+   {
+      jobs[i] = {m_key, m_first + m_index + i};
+   }
+
+   detail::hotp_values(jobs, static_cast<std::size_t>(m_blockCount), m_digits, m_block);
+}
+
+// Refer to the detailed documentation in core/hotprange.h for complete information about this function.
+std::size_t libqotp::core::HotpRange::iterator::write(std::span<char> output) const
+{
+   if (output.size() < m_digits)
+   {
+      return 0;
+   }
+
+   detail::write_digits(**this, m_digits, output.data());
+   return m_digits;
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint64_t> libqotp::core::hotp_resync(
+    const Key &key,
+    std::uint64_t counter,
+    std::uint32_t code,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return core::hotp_resync(key, counter, std::span<const std::uint32_t>(&code, 1), lookAhead, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint64_t> libqotp::core::hotp_resync(
+    const Key &key,
+    std::uint64_t counter,
+    std::span<const std::uint32_t> codes,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Input validation
+   if (!key.isValid() || codes.empty() || codes.size() > 2 || !detail::valid_digits(digits, digitMinimum, digitMaximum))
+   {
+      return std::nullopt;
+   }
+
+   // The first code may sit at any counter of the window, each further code at the counter after it.
+   // The new counter follows the last code, so the window ends early enough for that to exist.
+   constexpr std::uint64_t maximum = std::numeric_limits<std::uint64_t>::max();
+   const std::uint64_t codeCount = codes.size();
+   if (counter > maximum - codeCount)
+   {
+      return std::nullopt;
+   }
+
+   const std::uint64_t windowEnd = counter <= maximum - codeCount - lookAhead ? counter + lookAhead : maximum - codeCount;
+   const std::uint64_t last = windowEnd + codeCount - 1;
+
+   // Candidates are computed in chunks through the batch engine, which fills its vector lanes with
+   // consecutive counters of the same key
+   constexpr std::size_t chunkSize = 64;
+   detail::HotpJob jobs[chunkSize];
+   std::uint32_t values[chunkSize];
+
+   std::uint32_t found = 0;
+   std::uint32_t previous = 0;
+   std::uint64_t next = 0;
+
+   // Every candidate is computed and compared, whether or not an earlier one matched, so the
+   // time taken does not reveal where the codes matched. Among several matches the lowest counter wins.
+   std::uint64_t candidate = counter;
+   for (bool done = false; !done;)
+   {
+      std::size_t pending = 0;
+      while (pending < chunkSize)
+      {
+         jobs[pending++] = {&key, candidate};
+         if (candidate == last)
+         {
+            done = true;
+            break;
+         }
+         ++candidate;
+      }
+
+      detail::hotp_values(jobs, pending, digits, values);
+
+      for (std::size_t i = 0; i < pending; ++i)
+      {
+         // A value that could not be computed is invalid_code, which never equals a parsed code of 'digits' digits.
+         const std::uint32_t valid = detail::equal_mask(values[i], detail::invalid_code) ^ 1u;
+         const std::uint32_t first = detail::equal_mask(values[i], codes[0]) & valid;
+
+         // With two codes a counter completes a match when the one before it matched the first code.
+         // The first code only counts inside the window.
+         std::uint32_t match = first;
+         if (codeCount == 2)
+         {
+            match = previous & detail::equal_mask(values[i], codes[1]) & valid;
+         }
+         previous = first & (static_cast<std::uint32_t>((windowEnd - jobs[i].counter) >> 63) ^ 1u);
+
+         const std::uint64_t select = 0 - static_cast<std::uint64_t>(match & (found ^ 1u));
+         next = (next & ~select) | ((jobs[i].counter + 1) & select);
+         found |= match;
+      }
+   }
+
+   detail::secure_zero(values, sizeof(values));
+
+   if (!found)
+   {
+      return std::nullopt;
+   }
+
+   return next;
+}
@@ -0,0 +1,200 @@
+#include <libqotp/core/key.h>
+
+#include "sha.h"
+
+#include <cstring>
+
+namespace
+{
+   using libqotp::core::Algorithm;
+
+   // Block size of the hash function in bytes, which is also the HMAC key block size.
+   std::size_t block_size(Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case Algorithm::Sha1:
+      case Algorithm::Sha256:
+         return 64;
+      case Algorithm::Sha512:
+         return 128;
+      }
+      return 0;
+   }
+}
+
+// Refer to the detailed documentation in core/key.h for complete information about this function.
+libqotp::core::Key::Key(std::span<const std::byte> secret, Algorithm algorithm)
+    : m_algorithm(algorithm)
+{
+   const std::size_t blockSize = block_size(algorithm);
+   if (secret.empty() || blockSize == 0)
+   {
+      // Same rules as libqotp::hotp(): an empty secret or an unsupported algorithm is an error.
+      return;
+   }
+
+   // RFC 2104: keys longer than the block size are hashed first, shorter keys are padded with zeros.
+   std::uint8_t key[128] = {};
+   const auto *secretData = reinterpret_cast<const std::uint8_t *>(secret.data());
+   const std::size_t secretLength = secret.size();
+
+   if (secretLength > blockSize)
+   {
+      switch (algorithm)
+      {
+      case Algorithm::Sha1:
+      {
+         std::uint32_t state[5];
+         std::memcpy(state, detail::sha1_initial, sizeof(state));
+         detail::sha1_finish(state, secretData, secretLength, 0, key);
+         break;
+      }
+      case Algorithm::Sha256:
+      {
+         std::uint32_t state[8];
+         std::memcpy(state, detail::sha256_initial, sizeof(state));
+         detail::sha256_finish(state, secretData, secretLength, 0, key);
+         break;
+      }
+      case Algorithm::Sha512:
+      {
+         std::uint64_t state[8];
+         std::memcpy(state, detail::sha512_initial, sizeof(state));
+         detail::sha512_finish(state, secretData, secretLength, 0, key);
+         break;
+      }
+      }
+   }
+   else
+   {
+      std::memcpy(key, secretData, secretLength);
+   }
+
+   std::uint8_t innerPad[128];
+   std::uint8_t outerPad[128];
+   for (std::size_t i = 0; i < blockSize; ++i)
+   {
+      innerPad[i] = key[i] ^ 0x36;
+      outerPad[i] = key[i] ^ 0x5c;
+   }
+
+   switch (algorithm)
+   {
+   case Algorithm::Sha1:
+      std::memcpy(m_inner.words32, detail::sha1_initial, sizeof(detail::sha1_initial));
+      std::memcpy(m_outer.words32, detail::sha1_initial, sizeof(detail::sha1_initial));
+      detail::sha1_compress(m_inner.words32, innerPad, 1);
+      detail::sha1_compress(m_outer.words32, outerPad, 1);
+      break;
+   case Algorithm::Sha256:
+      std::memcpy(m_inner.words32, detail::sha256_initial, sizeof(detail::sha256_initial));
+      std::memcpy(m_outer.words32, detail::sha256_initial, sizeof(detail::sha256_initial));
+      detail::sha256_compress(m_inner.words32, innerPad, 1);
+      detail::sha256_compress(m_outer.words32, outerPad, 1);
+      break;
+   case Algorithm::Sha512:
+      std::memcpy(m_inner.words64, detail::sha512_initial, sizeof(detail::sha512_initial));
+      std::memcpy(m_outer.words64, detail::sha512_initial, sizeof(detail::sha512_initial));
+      detail::sha512_compress(m_inner.words64, innerPad, 1);
+      detail::sha512_compress(m_outer.words64, outerPad, 1);
+      break;
+   }
+
+   // Do not leave key material behind on the stack
+   detail::secure_zero(key, sizeof(key));
+   detail::secure_zero(innerPad, sizeof(innerPad));
+   detail::secure_zero(outerPad, sizeof(outerPad));
+
+   m_valid = true;
+}
+
+libqotp::core::Key::~Key()
+{
+   clear();
+}
+
+// Refer to the detailed documentation in core/key.h for complete information about this function.
+std::size_t libqotp::core::Key::hashLength() const
+{
+   if (!m_valid)
+   {
+      return 0;
+   }
+
+   switch (m_algorithm)
+   {
+   case Algorithm::Sha1:
+      return 20;
+   case Algorithm::Sha256:
+      return 32;
+   case Algorithm::Sha512:
+      return 64;
+   }
+   return 0;
+}
+
+// Refer to the detailed documentation in core/key.h for complete information about this function.
+std::size_t libqotp::core::Key::hmac(std::span<const std::byte> message, std::span<std::byte> digest) const
+{
+   const std::size_t length = hashLength();
+   if (length == 0 || digest.size() < length)
+   {
+      return 0;
+   }
+
+   const auto *messageData = reinterpret_cast<const std::uint8_t *>(message.data());
+   const std::size_t messageLength = message.size();
+   auto *output = reinterpret_cast<std::uint8_t *>(digest.data());
+
+   // Both hashes continue after the first block, which holds the padded key.
+   switch (m_algorithm)
+   {
+   case Algorithm::Sha1:
+   {
+      std::uint32_t state[5];
+      std::uint8_t innerHash[20];
+
+      std::memcpy(state, m_inner.words32, sizeof(state));
+      detail::sha1_finish(state, messageData, messageLength, 64, innerHash);
+
+      std::memcpy(state, m_outer.words32, sizeof(state));
+      detail::sha1_finish(state, innerHash, sizeof(innerHash), 64, output);
+      break;
+   }
+   case Algorithm::Sha256:
+   {
+      std::uint32_t state[8];
+      std::uint8_t innerHash[32];
+
+      std::memcpy(state, m_inner.words32, sizeof(state));
+      detail::sha256_finish(state, messageData, messageLength, 64, innerHash);
+
+      std::memcpy(state, m_outer.words32, sizeof(state));
+      detail::sha256_finish(state, innerHash, sizeof(innerHash), 64, output);
+      break;
+   }
+   case Algorithm::Sha512:
+   {
+      std::uint64_t state[8];
+      std::uint8_t innerHash[64];
+
+      std::memcpy(state, m_inner.words64, sizeof(state));
+      detail::sha512_finish(state, messageData, messageLength, 128, innerHash);
+
+      std::memcpy(state, m_outer.words64, sizeof(state));
+      detail::sha512_finish(state, innerHash, sizeof(innerHash), 128, output);
+      break;
+   }
+   }
+
+   return length;
+}
+
+// Refer to the detailed documentation in core/key.h for complete information about this function.
+void libqotp::core::Key::clear()
+{
+   detail::secure_zero(&m_inner, sizeof(m_inner));
+   detail::secure_zero(&m_outer, sizeof(m_outer));
+   m_valid = false;
+}
@@ -0,0 +1,229 @@
+#include <libqotp/core/otp.h>
+
+#include "hotp_batch.h"
+#include "sha.h"
+#include "truncate.h"
+
+#include <limits>
+
+namespace
+{
+   // Parses a code that consists of exactly 'digits' decimal digits. The length of a code is not secret,
+   // so malformed input is rejected early.
+   std::optional<std::uint32_t> parse_code(std::string_view code, unsigned int digits)
+   {
+      if (code.size() != digits || digits > libqotp::detail::max_code_digits)
+      {
+         return std::nullopt;
+      }
+
+      std::uint64_t value = 0;
+      for (const char character : code)
+      {
+         if (character < '0' || character > '9')
+         {
+            return std::nullopt;
+         }
+         value = value * 10 + static_cast<std::uint64_t>(character - '0');
+      }
+
+      if (value > std::numeric_limits<std::uint32_t>::max())
+      {
+         return std::nullopt;
+      }
+
+      return static_cast<std::uint32_t>(value);
+   }
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint64_t> libqotp::core::totp_counter(
+    std::chrono::sys_seconds time,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch)
+{
+   // Ensure timeStep is positive to avoid division by zero, and that the counter is not negative
+   if (timeStep.count() <= 0 || time < epoch)
+   {
+      return std::nullopt;
+   }
+
+   return static_cast<std::uint64_t>((time - epoch).count()) / static_cast<std::uint64_t>(timeStep.count());
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint32_t> libqotp::core::totp_value(
+    const Key &key,
+    std::chrono::sys_seconds time,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   const auto counter = core::totp_counter(time, timeStep, epoch);
+   if (!counter)
+   {
+      return std::nullopt;
+   }
+
+   return core::hotp_value(key, *counter, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<std::uint32_t> libqotp::core::totp_value(
+    std::span<const std::byte> secret,
+    std::chrono::sys_seconds time,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    Algorithm algorithm)
+{
+   return core::totp_value(Key(secret, algorithm), time, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::size_t libqotp::core::totp(
+    const Key &key,
+    std::chrono::sys_seconds time,
+    std::span<char> output,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   const auto counter = core::totp_counter(time, timeStep, epoch);
+   if (!counter)
+   {
+      return 0;
+   }
+
+   return core::hotp(key, *counter, output, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::size_t libqotp::core::totp(
+    std::span<const std::byte> secret,
+    std::chrono::sys_seconds time,
+    std::span<char> output,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    Algorithm algorithm)
+{
+   return core::totp(Key(secret, algorithm), time, output, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<int> libqotp::core::totp_verify(
+    const Key &key,
+    std::uint32_t code,
+    std::chrono::sys_seconds time,
+    unsigned int window,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Input validation. The matched offset must be representable.
+   const auto counter = core::totp_counter(time, timeStep, epoch);
+   if (!key.isValid() || !counter || !detail::valid_digits(digits, digitMinimum, digitMaximum) ||
+       window > static_cast<unsigned int>(std::numeric_limits<int>::max()))
+   {
+      return std::nullopt;
+   }
+
+   return detail::verify_window(key, code, *counter, window, digits);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<int> libqotp::core::totp_verify(
+    const Key &key,
+    std::string_view code,
+    std::chrono::sys_seconds time,
+    unsigned int window,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   const auto value = parse_code(code, digits);
+   if (!value)
+   {
+      return std::nullopt;
+   }
+
+   return core::totp_verify(key, *value, time, window, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in core/otp.h for complete information about this function.
+std::optional<int> libqotp::core::totp_verify(
+    std::span<const std::byte> secret,
+    std::uint32_t code,
+    std::chrono::sys_seconds time,
+    unsigned int window,
+    std::chrono::seconds timeStep,
+    std::chrono::sys_seconds epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    Algorithm algorithm)
+{
+   // One key schedule is shared by all candidates of the window
+   return core::totp_verify(Key(secret, algorithm), code, time, window, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in hotp_batch.h for complete information about this function.
+std::optional<int> libqotp::detail::verify_window(
+    const core::Key &key,
+    std::uint32_t code,
+    std::uint64_t counter,
+    unsigned int window,
+    unsigned int digits)
+{
+   // Counters below zero do not exist, the window is clamped instead.
+   const std::uint64_t first = counter >= window ? counter - window : 0;
+   const std::uint64_t last = counter <= std::numeric_limits<std::uint64_t>::max() - window ? counter + window : std::numeric_limits<std::uint64_t>::max();
+
+   // Candidates are computed in chunks through the batch engine, which fills its vector lanes with
+   // consecutive counters of the same key
+   constexpr std::size_t chunkSize = 64;
+   HotpJob jobs[chunkSize];
+   std::uint32_t values[chunkSize];
+
+   // Every candidate is computed and compared, whether or not an earlier one matched
+   WindowMatch match;
+   std::uint64_t candidate = first;
+   for (bool done = false; !done;)
+   {
+      std::size_t pending = 0;
+      while (pending < chunkSize)
+      {
+         jobs[pending++] = {&key, candidate};
+         if (candidate == last)
+         {
+            done = true;
+            break;
+         }
+         ++candidate;
+      }
+
+      hotp_values(jobs, pending, digits, values);
+
+      // A value that could not be computed is invalid_code, which never equals a parsed code of 'digits' digits
+      for (std::size_t i = 0; i < pending; ++i)
+      {
+         match.add(static_cast<std::int64_t>(jobs[i].counter - counter), values[i], code);
+      }
+   }
+
+   secure_zero(values, sizeof(values));
+   return match.result();
+}
@@ -0,0 +1,597 @@
+#include <libqotp/counterlog.h>
+
+#include "crc32.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+   // Snapshot layout: a 32-byte header, then 16 bytes of user and value per entry. The header checksum
+   // covers the first 24 header bytes followed by all entries.
+   constexpr char snapshot_magic[8] = {'Q', 'O', 'T', 'P', 'C', 'S', 'N', 'P'};
+   constexpr qint64 snapshot_header_size = 32;
+   constexpr qint64 snapshot_count_offset = 16;
+   constexpr qint64 snapshot_checksum_offset = 24;
+   constexpr qint64 entry_size = 16;
+
+   // Log layout: a 16-byte header with a checksum of its first 12 bytes, then one group per write. A group
+   // is a 16-byte group header, holding the number of entries, a reserved zero word, the checksum of the
+   // entries and the checksum of the first 12 group header bytes, followed by the entries.
+   constexpr char log_magic[8] = {'Q', 'O', 'T', 'P', 'C', 'L', 'O', 'G'};
+   constexpr qint64 log_header_size = 16;
+   constexpr qint64 log_checksum_offset = 12;
+   constexpr qint64 group_header_size = 16;
+   constexpr qint64 group_checksum_offset = 8;
+   constexpr qint64 group_header_checksum_offset = 12;
+
+   constexpr quint32 format_version = 1;
+   constexpr qint64 version_offset = 8;
+
+   // Entries written to the snapshot at once
+   constexpr qint64 snapshot_chunk = 4096;
+
+   // Makes the data written to 'file' durable. The size of the file counts as data, so a resize is
+   // covered as well.
+   bool sync_file(QFileDevice &file)
+   {
+      if (!file.flush())
+      {
+         return false;
+      }
+#if defined(_WIN32)
+      return ::_commit(file.handle()) == 0;
+#elif defined(__linux__)
+      return ::fdatasync(file.handle()) == 0;
+#else
+      return ::fsync(file.handle()) == 0;
+#endif
+   }
+
+   // Makes the directory entry of 'fileName' durable, so a rename into it or its creation survives a
+   // power loss. Windows offers no handle on a directory to sync; NTFS journals the entry.
+   bool sync_directory(const QString &fileName)
+   {
+#if defined(_WIN32)
+      Q_UNUSED(fileName);
+      return true;
+#else
+      const QByteArray path = QFile::encodeName(QFileInfo(fileName).absolutePath());
+      const int directory = ::open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (directory < 0)
+      {
+         return false;
+      }
+      const bool synced = ::fsync(directory) == 0;
+      ::close(directory);
+      return synced;
+#endif
+   }
+
+   void write_entry(char *output, quint64 user, quint64 value)
+   {
+      qToLittleEndian<quint64>(user, output);
+      qToLittleEndian<quint64>(value, output + 8);
+   }
+
+   // Prefixes 'entries' with their group header
+   QByteArray log_group(const QByteArray &entries)
+   {
+      QByteArray group(group_header_size, '\0');
+      qToLittleEndian<quint32>(static_cast<quint32>(entries.size() / entry_size), group.data());
+      qToLittleEndian<quint32>(libqotp::detail::crc32c(0, entries.constData(), static_cast<std::size_t>(entries.size())), group.data() + group_checksum_offset);
+      qToLittleEndian<quint32>(libqotp::detail::crc32c(0, group.constData(), group_header_checksum_offset), group.data() + group_header_checksum_offset);
+      group.append(entries);
+      return group;
+   }
+
+   // Returns the number of entries of the complete and intact group at 'offset' of 'data', or 0 if there is none
+   quint32 intact_group(const QByteArray &data, qint64 offset)
+   {
+      if (offset + group_header_size > data.size())
+      {
+         return 0;
+      }
+
+      const char *header = data.constData() + offset;
+      const quint32 count = qFromLittleEndian<quint32>(header);
+      if (count == 0 || qFromLittleEndian<quint32>(header + 4) != 0 ||
+          libqotp::detail::crc32c(0, header, group_header_checksum_offset) != qFromLittleEndian<quint32>(header + group_header_checksum_offset) ||
+          offset + group_header_size + count * entry_size > data.size())
+      {
+         return 0;
+      }
+
+      const std::size_t size = static_cast<std::size_t>(count * entry_size);
+      return libqotp::detail::crc32c(0, header + group_header_size, size) == qFromLittleEndian<quint32>(header + group_checksum_offset) ? count : 0;
+   }
+
+   QByteArray log_header()
+   {
+      QByteArray header(log_header_size, '\0');
+      std::memcpy(header.data(), log_magic, sizeof(log_magic));
+      qToLittleEndian<quint32>(format_version, header.data() + version_offset);
+      qToLittleEndian<quint32>(libqotp::detail::crc32c(0, header.constData(), log_checksum_offset), header.data() + log_checksum_offset);
+      return header;
+   }
+}
+
+libqotp::CounterLog::CounterLog(const CounterLogOptions &options)
+   : m_options(options)
+{
+}
+
+libqotp::CounterLog::~CounterLog()
+{
+   close();
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+bool libqotp::CounterLog::open(const QString &fileName)
+{
+   close();
+
+   std::unique_lock lock(m_mutex);
+   m_values.clear();
+   m_unsynced.clear();
+   m_pending.clear();
+   m_groups = 0;
+   m_durable = 0;
+   m_broken = false;
+   m_stats = CounterLogStats();
+   m_fileName = fileName;
+
+   if (!recover(fileName))
+   {
+      m_log.close();
+      return false;
+   }
+
+   m_open = true;
+   m_error = CounterLogError::None;
+   return true;
+}
+
+// Loads the snapshot, replays the log and cuts off a torn tail. Sets m_error on failure.
+bool libqotp::CounterLog::recover(const QString &fileName)
+{
+   QFile snapshot(fileName);
+   if (snapshot.exists())
+   {
+      if (!snapshot.open(QIODevice::ReadOnly))
+      {
+         m_error = CounterLogError::OpenFailed;
+         return false;
+      }
+
+      const QByteArray data = snapshot.readAll();
+      if (data.size() < snapshot_header_size || std::memcmp(data.constData(), snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+          qFromLittleEndian<quint32>(data.constData() + version_offset) != format_version)
+      {
+         m_error = CounterLogError::NotACounterLog;
+         return false;
+      }
+
+      // The snapshot was committed atomically, so unlike the log any damage is corruption
+      const quint64 count = qFromLittleEndian<quint64>(data.constData() + snapshot_count_offset);
+      const quint64 available = static_cast<quint64>(data.size() - snapshot_header_size) / entry_size;
+      if (count != available || (data.size() - snapshot_header_size) % entry_size != 0)
+      {
+         m_error = CounterLogError::ChecksumMismatch;
+         return false;
+      }
+
+      const char *entries = data.constData() + snapshot_header_size;
+      quint32 crc = detail::crc32c(0, data.constData(), snapshot_checksum_offset);
+      crc = detail::crc32c(crc, entries, static_cast<std::size_t>(count * entry_size));
+      if (crc != qFromLittleEndian<quint32>(data.constData() + snapshot_checksum_offset))
+      {
+         m_error = CounterLogError::ChecksumMismatch;
+         return false;
+      }
+
+      m_values.reserve(static_cast<std::size_t>(count));
+      for (quint64 i = 0; i < count; ++i)
+      {
+         const char *entry = entries + i * entry_size;
+         m_values[qFromLittleEndian<quint64>(entry)] = qFromLittleEndian<quint64>(entry + 8);
+      }
+   }
+
+   m_log.setFileName(fileName + QStringLiteral(".log"));
+   if (!m_log.open(QIODevice::ReadWrite | QIODevice::Unbuffered) ||
+       !m_log.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner))
+   {
+      m_error = CounterLogError::OpenFailed;
+      return false;
+   }
+
+   const QByteArray data = m_log.readAll();
+   const QByteArray header = log_header();
+   if (data.size() < log_header_size)
+   {
+      // A new log, or a crash while the header of one was written
+      if (std::memcmp(data.constData(), header.constData(), static_cast<std::size_t>(data.size())) != 0)
+      {
+         m_error = CounterLogError::NotACounterLog;
+         return false;
+      }
+
+      if (!m_log.resize(0) || !m_log.seek(0) || m_log.write(header) != log_header_size || !sync_file(m_log) ||
+          !sync_directory(m_log.fileName()))
+      {
+         m_error = CounterLogError::WriteFailed;
+         return false;
+      }
+
+      m_logSize = log_header_size;
+      return true;
+   }
+
+   if (std::memcmp(data.constData(), header.constData(), log_header_size) != 0)
+   {
+      m_error = CounterLogError::NotACounterLog;
+      return false;
+   }
+
+   // Groups are replayed up to the first incomplete or damaged one. Only the last group can be torn: it
+   // was being synced when the process stopped, and its pages may have reached the disk in any order, but
+   // no caller was told it is durable. A group is only written after the one before it was synced, so an
+   // intact group behind a damaged one means that a durable group was damaged; cutting it off would roll
+   // counters back and allow replays. Groups start at multiples of 16 bytes, which bounds the search.
+   qint64 offset = log_header_size;
+   while (const quint32 count = intact_group(data, offset))
+   {
+      const char *entries = data.constData() + offset + group_header_size;
+      for (quint32 i = 0; i < count; ++i)
+      {
+         const char *entry = entries + i * entry_size;
+         quint64 &value = m_values[qFromLittleEndian<quint64>(entry)];
+         value = std::max(value, qFromLittleEndian<quint64>(entry + 8));
+      }
+      m_stats.recovered += count;
+      offset += group_header_size + count * entry_size;
+   }
+
+   for (qint64 later = offset + entry_size; later + group_header_size <= data.size(); later += entry_size)
+   {
+      if (intact_group(data, later))
+      {
+         m_error = CounterLogError::ChecksumMismatch;
+         return false;
+      }
+   }
+
+   if (offset != data.size())
+   {
+      m_stats.discarded = static_cast<quint64>(data.size() - offset);
+      if (!m_log.resize(offset) || !sync_file(m_log))
+      {
+         m_error = CounterLogError::WriteFailed;
+         return false;
+      }
+   }
+
+   if (!m_log.seek(offset))
+   {
+      m_error = CounterLogError::OpenFailed;
+      return false;
+   }
+
+   m_logSize = offset;
+   return true;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+void libqotp::CounterLog::close()
+{
+   std::unique_lock lock(m_mutex);
+   if (!m_open)
+   {
+      return;
+   }
+
+   // Groups still waiting for a writer are written here; their callers find them durable
+   becomeWriter(lock);
+   if (!m_pending.isEmpty() && !m_broken)
+   {
+      const QByteArray group = log_group(m_pending);
+      if (m_log.write(group) == group.size() && sync_file(m_log))
+      {
+         publish(m_pending);
+         m_stats.records += static_cast<quint64>(m_pending.size() / entry_size);
+         ++m_stats.syncs;
+         m_durable = m_groups;
+      }
+      else
+      {
+         m_broken = true;
+         m_error = CounterLogError::WriteFailed;
+      }
+   }
+
+   m_pending.clear();
+   m_unsynced.clear();
+   m_log.close();
+   m_open = false;
+   m_writing = false;
+   m_written.notify_all();
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+bool libqotp::CounterLog::isOpen() const
+{
+   std::lock_guard lock(m_mutex);
+   return m_open;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+libqotp::CounterLogError libqotp::CounterLog::error() const
+{
+   std::lock_guard lock(m_mutex);
+   return m_error;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+std::optional<quint64> libqotp::CounterLog::value(quint64 user) const
+{
+   std::lock_guard lock(m_mutex);
+   const auto it = m_values.find(user);
+   if (it == m_values.end())
+   {
+      return std::nullopt;
+   }
+   return it->second;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+qsizetype libqotp::CounterLog::size() const
+{
+   std::lock_guard lock(m_mutex);
+   return static_cast<qsizetype>(m_values.size());
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+libqotp::CounterLogResult libqotp::CounterLog::advance(quint64 user, quint64 value)
+{
+   const CounterUpdate update = {user, value};
+   CounterLogResult result = CounterLogResult::Failed;
+   advance(std::span<const CounterUpdate>(&update, 1), std::span<CounterLogResult>(&result, 1));
+   return result;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+bool libqotp::CounterLog::advance(std::span<const CounterUpdate> updates, std::span<CounterLogResult> results)
+{
+   if (results.size() < updates.size())
+   {
+      return false;
+   }
+
+   std::unique_lock lock(m_mutex);
+   if (!m_open || m_broken)
+   {
+      std::fill_n(results.begin(), updates.size(), CounterLogResult::Failed);
+      return true;
+   }
+
+   // Values being written are kept apart until they are durable, but a concurrent update of the same
+   // user already compares against them
+   bool appended = false;
+   for (std::size_t i = 0; i < updates.size(); ++i)
+   {
+      const auto unsynced = m_unsynced.find(updates[i].user);
+      const auto durable = m_values.find(updates[i].user);
+      const bool stale = unsynced != m_unsynced.end() ? unsynced->second >= updates[i].value
+                                                      : durable != m_values.end() && durable->second >= updates[i].value;
+      if (stale)
+      {
+         results[i] = CounterLogResult::Stale;
+         continue;
+      }
+      m_unsynced[updates[i].user] = updates[i].value;
+
+      char entry[entry_size];
+      write_entry(entry, updates[i].user, updates[i].value);
+      m_pending.append(entry, entry_size);
+
+      results[i] = CounterLogResult::Advanced;
+      appended = true;
+   }
+
+   if (!appended)
+   {
+      return true;
+   }
+
+   if (!commit(lock, ++m_groups))
+   {
+      std::replace(results.begin(), results.begin() + static_cast<std::ptrdiff_t>(updates.size()), CounterLogResult::Advanced, CounterLogResult::Failed);
+      return true;
+   }
+
+   if (m_options.compactBytes > 0 && m_logSize >= m_options.compactBytes && !m_writing)
+   {
+      // The updates are durable already, so a failed compaction does not fail them
+      compact(lock);
+   }
+   return true;
+}
+
+bool libqotp::CounterLog::commit(std::unique_lock<std::mutex> &lock, quint64 ticket)
+{
+   while (m_durable < ticket)
+   {
+      if (!m_open || m_broken)
+      {
+         return false;
+      }
+
+      if (m_writing)
+      {
+         m_written.wait(lock);
+         continue;
+      }
+
+      // Lead a group: write everything appended so far while the next group collects
+      m_writing = true;
+      QByteArray entries;
+      entries.swap(m_pending);
+      const quint64 last = m_groups;
+      lock.unlock();
+
+      const QByteArray group = log_group(entries);
+      const bool written = m_log.write(group) == group.size() && sync_file(m_log);
+
+      lock.lock();
+      m_writing = false;
+      if (written)
+      {
+         publish(entries);
+         m_durable = last;
+         m_logSize += group.size();
+         m_stats.records += static_cast<quint64>(entries.size() / entry_size);
+         ++m_stats.syncs;
+      }
+      else
+      {
+         // The end of the log is unknown now; reopening cuts it back to the last complete group. The
+         // values of the group never reach the table.
+         m_broken = true;
+         m_error = CounterLogError::WriteFailed;
+      }
+      m_written.notify_all();
+   }
+   return true;
+}
+
+void libqotp::CounterLog::publish(const QByteArray &entries)
+{
+   for (qsizetype offset = 0; offset < entries.size(); offset += entry_size)
+   {
+      const quint64 user = qFromLittleEndian<quint64>(entries.constData() + offset);
+      const quint64 value = qFromLittleEndian<quint64>(entries.constData() + offset + 8);
+
+      quint64 &durable = m_values[user];
+      durable = std::max(durable, value);
+
+      // A later group may hold a higher value of the user that is still being written
+      const auto unsynced = m_unsynced.find(user);
+      if (unsynced != m_unsynced.end() && unsynced->second <= value)
+      {
+         m_unsynced.erase(unsynced);
+      }
+   }
+}
+
+void libqotp::CounterLog::becomeWriter(std::unique_lock<std::mutex> &lock)
+{
+   m_written.wait(lock, [this]() { return !m_writing; });
+   m_writing = true;
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+bool libqotp::CounterLog::compact()
+{
+   std::unique_lock lock(m_mutex);
+   return compact(lock);
+}
+
+bool libqotp::CounterLog::compact(std::unique_lock<std::mutex> &lock)
+{
+   if (!m_open || m_broken)
+   {
+      m_error = m_open ? CounterLogError::WriteFailed : CounterLogError::NotOpen;
+      return false;
+   }
+
+   // The copy holds the durable values only. Pending entries stay pending and are written to the emptied log.
+   becomeWriter(lock);
+   const std::unordered_map<quint64, quint64> values = m_values;
+   lock.unlock();
+
+   const bool saved = writeSnapshot(values);
+   const bool emptied = saved && m_log.resize(log_header_size) && m_log.seek(log_header_size) && sync_file(m_log);
+
+   lock.lock();
+   m_writing = false;
+   if (emptied)
+   {
+      m_logSize = log_header_size;
+      ++m_stats.compactions;
+      m_error = CounterLogError::None;
+   }
+   else
+   {
+      // A failed snapshot leaves the log intact, a failed resize leaves its end unknown
+      m_broken = saved;
+      m_error = CounterLogError::WriteFailed;
+   }
+   m_written.notify_all();
+   return emptied;
+}
+
+bool libqotp::CounterLog::writeSnapshot(const std::unordered_map<quint64, quint64> &values)
+{
+   QSaveFile file(m_fileName);
+   if (!file.open(QIODevice::WriteOnly) || !file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner))
+   {
+      return false;
+   }
+
+   char header[snapshot_header_size] = {};
+   std::memcpy(header, snapshot_magic, sizeof(snapshot_magic));
+   qToLittleEndian<quint32>(format_version, header + version_offset);
+   qToLittleEndian<quint64>(static_cast<quint64>(values.size()), header + snapshot_count_offset);
+
+   // The header is written again at the end, with the checksum of the entries
+   quint32 crc = detail::crc32c(0, header, snapshot_checksum_offset);
+   bool written = file.write(header, snapshot_header_size) == snapshot_header_size;
+
+   QByteArray chunk;
+   chunk.reserve(snapshot_chunk * entry_size);
+   auto it = values.begin();
+   while (written && it != values.end())
+   {
+      chunk.clear();
+      for (qint64 i = 0; i < snapshot_chunk && it != values.end(); ++i, ++it)
+      {
+         char entry[entry_size];
+         write_entry(entry, it->first, it->second);
+         chunk.append(entry, entry_size);
+      }
+
+      crc = detail::crc32c(crc, chunk.constData(), static_cast<std::size_t>(chunk.size()));
+      written = file.write(chunk) == chunk.size();
+   }
+
+   qToLittleEndian<quint32>(crc, header + snapshot_checksum_offset);
+   written = written && file.seek(0) && file.write(header, snapshot_header_size) == snapshot_header_size;
+   if (!written)
+   {
+      file.cancelWriting();
+      return false;
+   }
+
+   // QSaveFile syncs the new file before renaming it over the old one. The rename itself must be durable
+   // before the log is emptied, or a power loss could keep the empty log and lose the new snapshot.
+   return file.commit() && sync_directory(m_fileName);
+}
+
+// Refer to the detailed documentation in counterlog.h for complete information about this function.
+libqotp::CounterLogStats libqotp::CounterLog::stats() const
+{
+   std::lock_guard lock(m_mutex);
+   return m_stats;
+}
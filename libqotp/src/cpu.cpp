@@ -0,0 +1,121 @@
+#include "cpu.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(QOTP_ARCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if defined(QOTP_ARCH_X86)
+   void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+   {
+#if defined(_MSC_VER)
+      int values[4];
+      __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+      for (int i = 0; i < 4; ++i)
+      {
+         registers[i] = static_cast<unsigned int>(values[i]);
+      }
+#else
+      __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+   }
+
+   // Reads XCR0, which tells which register states the operating system saves on context switches.
+   unsigned long long xgetbv0()
+   {
+#if defined(_MSC_VER)
+      return _xgetbv(0);
+#else
+      unsigned int eax = 0;
+      unsigned int edx = 0;
+      __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+   }
+#endif
+
+   libqotp::detail::CpuFeatures detect()
+   {
+      libqotp::detail::CpuFeatures features;
+
+#if defined(QOTP_ARCH_X86)
+      unsigned int registers[4] = {};
+      cpuid(0, 0, registers);
+      const unsigned int maxLeaf = registers[0];
+
+      if (maxLeaf < 1)
+      {
+         return features;
+      }
+
+      cpuid(1, 0, registers);
+      const unsigned int leaf1Ecx = registers[2];
+      const unsigned int leaf1Edx = registers[3];
+
+      features.sse2 = (leaf1Edx & (1u << 26)) != 0;
+      features.ssse3 = (leaf1Ecx & (1u << 9)) != 0;
+      features.sse41 = (leaf1Ecx & (1u << 19)) != 0;
+
+      // AVX state must be enabled by the OS (OSXSAVE and the XMM/YMM bits in XCR0)
+      const bool osxsave = (leaf1Ecx & (1u << 27)) != 0;
+      const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+      const bool osAvx = (xcr0 & 0x6) == 0x6;
+      const bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+      if (maxLeaf >= 7)
+      {
+         cpuid(7, 0, registers);
+         const unsigned int leaf7Ebx = registers[1];
+
+         features.avx2 = osAvx && (leaf7Ebx & (1u << 5)) != 0;
+         features.avx512f = osAvx512 && (leaf7Ebx & (1u << 16)) != 0;
+         features.sha = (leaf7Ebx & (1u << 29)) != 0;
+      }
+#endif
+
+      // Optional cap for testing and benchmarking
+      if (const char *level = std::getenv("QOTP_SIMD"))
+      {
+         if (std::strcmp(level, "none") == 0)
+         {
+            features = libqotp::detail::CpuFeatures();
+         }
+         else if (std::strcmp(level, "sse2") == 0)
+         {
+            features.ssse3 = false;
+            features.sse41 = false;
+            features.avx2 = false;
+            features.avx512f = false;
+            features.sha = false;
+         }
+         else if (std::strcmp(level, "ssse3") == 0)
+         {
+            features.sse41 = false;
+            features.avx2 = false;
+            features.avx512f = false;
+            features.sha = false;
+         }
+         else if (std::strcmp(level, "avx2") == 0)
+         {
+            features.avx512f = false;
+         }
+      }
+
+      return features;
+   }
+}
+
+// Refer to the detailed documentation in cpu.h for complete information about this function.
+const libqotp::detail::CpuFeatures &libqotp::detail::cpu_features()
+{
+   static const CpuFeatures features = detect();
+   return features;
+}
@@ -0,0 +1,32 @@
+#ifndef LIBQOTP_CPU_H_20261018
+#define LIBQOTP_CPU_H_20261018
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define QOTP_ARCH_X86 1
+#endif
+
+namespace libqotp::detail
+{
+   // Instruction set extensions detected at runtime.
+   //
+   // The set can be reduced for testing and benchmarking with the QOTP_SIMD environment variable:
+   // "none" disables all vector paths, "sse2", "ssse3", "avx2" and "avx512" cap the widest level used.
+   // The SHA extensions count as part of the SSE4.1 level, so "sse2" and "ssse3" disable them as well.
+   struct CpuFeatures
+   {
+      bool sse2 = false;
+      bool ssse3 = false;
+      bool sse41 = false;
+      bool avx2 = false;
+      bool avx512f = false;
+      bool sha = false;
+   };
+
+   /**
+    * Returns the features of the current CPU that are also enabled by the operating system.
+    * Detection runs once, the result is cached.
+    */
+   const CpuFeatures &cpu_features();
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "crc32.h"
+
+#include <array>
+
+namespace
+{
+   // Reflected polynomial of CRC-32C
+   constexpr std::uint32_t polynomial = 0x82f63b78;
+
+   // Slicing-by-8 tables: table[0] is the classic byte table, table[k] advances a byte that is
+   // followed by k more bytes, so eight bytes are folded per step.
+   constexpr std::array<std::array<std::uint32_t, 256>, 8> make_tables()
+   {
+      std::array<std::array<std::uint32_t, 256>, 8> tables = {};
+      for (std::uint32_t i = 0; i < 256; ++i)
+      {
+         std::uint32_t crc = i;
+         for (int bit = 0; bit < 8; ++bit)
+         {
+            crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1u)));
+         }
+         tables[0][i] = crc;
+      }
+      for (std::size_t k = 1; k < tables.size(); ++k)
+      {
+         for (std::uint32_t i = 0; i < 256; ++i)
+         {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xff];
+         }
+      }
+      return tables;
+   }
+
+   constexpr auto tables = make_tables();
+}
+
+// Refer to the detailed documentation in crc32.h for complete information about this function.
+std::uint32_t libqotp::detail::crc32c(std::uint32_t crc, const void *data, std::size_t length)
+{
+   const auto *bytes = static_cast<const std::uint8_t *>(data);
+   crc = ~crc;
+
+   while (length >= 8)
+   {
+      const std::uint32_t low = crc ^ (static_cast<std::uint32_t>(bytes[0]) |
+                                       static_cast<std::uint32_t>(bytes[1]) << 8 |
+                                       static_cast<std::uint32_t>(bytes[2]) << 16 |
+                                       static_cast<std::uint32_t>(bytes[3]) << 24);
+      crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^
+            tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24] ^
+            tables[3][bytes[4]] ^ tables[2][bytes[5]] ^
+            tables[1][bytes[6]] ^ tables[0][bytes[7]];
+      bytes += 8;
+      length -= 8;
+   }
+
+   while (length-- > 0)
+   {
+      crc = (crc >> 8) ^ tables[0][(crc ^ *bytes++) & 0xff];
+   }
+
+   return ~crc;
+}
@@ -0,0 +1,22 @@
+#ifndef LIBQOTP_CRC32_H_20261018
+#define LIBQOTP_CRC32_H_20261018
+
+#include <cstddef>
+#include <cstdint>
+
+// Internal CRC-32C (Castagnoli) checksum, used to detect corruption of files written by the library.
+//
+// CRC-32C is the checksum of iSCSI, ext4 and many log formats. It detects all burst errors up to 32 bits
+// and is not a defence against deliberate tampering.
+namespace libqotp::detail
+{
+   /**
+    * Extends the CRC-32C 'crc' by 'length' bytes at 'data'.
+    *
+    * Start with a crc of 0. Checksumming a buffer in pieces gives the same result as checksumming it at
+    * once: crc32c(crc32c(0, a, n), b, m) equals the checksum of a followed by b.
+    */
+   std::uint32_t crc32c(std::uint32_t crc, const void *data, std::size_t length);
+}
+
+#endif
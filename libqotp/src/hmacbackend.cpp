@@ -0,0 +1,15 @@
+#include <libqotp/hmacbackend.h>
+
+// Refer to the detailed documentation in hmacbackend.h for complete information about this function.
+QString libqotp::hmac_backend_name(HmacBackend backend)
+{
+   const std::string_view name = core::hmac_backend_name(backend);
+   return QString::fromLatin1(name.data(), static_cast<qsizetype>(name.size()));
+}
+
+// Refer to the detailed documentation in hmacbackend.h for complete information about this function.
+QString libqotp::hmac_batch_level_name(HmacBatchLevel level)
+{
+   const std::string_view name = core::hmac_batch_level_name(level);
+   return QString::fromLatin1(name.data(), static_cast<qsizetype>(name.size()));
+}
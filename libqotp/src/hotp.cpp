@@ -1,7 +1,9 @@
 #include <libqotp/qotp.h>
 
-#include <cmath>
-#include <QMessageAuthenticationCode>
+#include "base32_secret.h"
+#include "metrics_record.h"
+#include "otp_error.h"
+#include "truncate.h"
 
 // Refer to the detailed documentation in qotp.h for complete information about this function.
 QString libqotp::hotp(
@@ -11,104 +13,197 @@ QString libqotp::hotp(
     unsigned int digitMinimum,
     unsigned int digitMaximum,
     QCryptographicHash::Algorithm algorithm)
+{
+   return libqotp::try_hotp(secret, counter, digits, digitMinimum, digitMaximum, algorithm).value();
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QString libqotp::hotp(
+    const OtpKey &key,
+    uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::try_hotp(key, counter, digits, digitMinimum, digitMaximum).value();
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QString> libqotp::try_hotp(
+    QByteArrayView secret,
+    uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
 {
    // Input validation
    if (secret.isEmpty())
    {
       // An empty secret key is invalid as it compromises the security of the OTP.
       // The shared secret must be kept confidential between the token creator and the token verifier.
-      return QString();
+      detail::record_failure(OtpError::EmptySecret);
+      return OtpError::EmptySecret;
    }
 
-   if (digits < digitMinimum || digits > digitMaximum)
-   {
-      // The RFC 4226 recommends the output OTP to be at least 6 digits long.
-      // Digits more than 8 are often not supported by OTP systems and may be harder for users.
-      return QString();
-   }
+   // The key lives on the stack. Unsupported algorithms produce an invalid key.
+   return libqotp::try_hotp(OtpKey(secret, algorithm), counter, digits, digitMinimum, digitMaximum);
+}
 
-   // Counter value to byte array conversion
-   QByteArray counterBytes;
-   for (int i = 7; i >= 0; --i)
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QString> libqotp::try_hotp(
+    const OtpKey &key,
+    uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   detail::MetricsScope metrics(key);
+
+   const OtpError error = detail::check_otp(key, digits, digitMinimum, digitMaximum);
+   if (error != OtpError::None)
    {
-      counterBytes.append((counter >> (i * 8)) & 0xFF);
+      metrics.fail(error);
+      return error;
    }
 
-   QByteArray hash;
+   char buffer[libqotp::detail::max_code_digits];
+   const std::size_t length = core::hotp(key.coreKey(), counter, std::span<char>(buffer), digits, digitMinimum, digitMaximum);
 
-   switch (algorithm)
-   {
-   case QCryptographicHash::Sha1:
-   {
-      // Calculate HMAC-SHA1 hash
-      hash = QMessageAuthenticationCode::hash(counterBytes, secret.toByteArray(), QCryptographicHash::Sha1);
-
-      // Check for valid hash
-      if (hash.isEmpty() || hash.length() < 20)
-      {
-         // An invalid hash indicates an error in the HMAC computation.
-         // The length of SHA-1 hash should always be 20 bytes.
-         return QString();
-      }
-      break;
-   }
-   case QCryptographicHash::Sha256:
-   {
-      // Calculate HMAC-SHA256 hash
-      hash = QMessageAuthenticationCode::hash(counterBytes, secret.toByteArray(), QCryptographicHash::Sha256);
-
-      // Check for valid hash
-      if (hash.isEmpty() || hash.length() < 32)
-      {
-         // An invalid hash indicates an error in the HMAC computation.
-         // The length of SHA-256 hash should always be 32 bytes.
-         return QString();
-      }
-      break;
-   }
-   case QCryptographicHash::Sha512:
-   {
-      // Calculate HMAC-SHA512 hash
-      hash = QMessageAuthenticationCode::hash(counterBytes, secret.toByteArray(), QCryptographicHash::Sha512);
-
-      // Check for valid hash
-      if (hash.isEmpty() || hash.length() < 64)
-      {
-         // An invalid hash indicates an error in the HMAC computation.
-         // The length of SHA-512 hash should always be 64 bytes.
-         return QString();
-      }
-      break;
-   }
-   default:
-      break;
-   }
+   // Return HOTP as zero-padded string
+   return QString::fromLatin1(buffer, static_cast<qsizetype>(length));
+}
 
-   // Check for valid hash
-   if (hash.isEmpty())
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint32> libqotp::hotp_value(
+    const OtpKey &key,
+    uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   detail::MetricsScope metrics(key);
+
+   const auto value = core::hotp_value(key.coreKey(), counter, digits, digitMinimum, digitMaximum);
+   if (!value)
    {
-      return QString();
+      metrics.fail(detail::check_otp(key, digits, digitMinimum, digitMaximum));
    }
+   return value;
+}
 
-   // Dynamic Truncation
-   int offset = hash.at(hash.length() - 1) & 0xf;
-   if (offset > hash.length() - 4)
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint32> libqotp::hotp_value(
+    QByteArrayView secret,
+    uint64_t counter,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   // The key lives on the stack, so the one-shot path does not allocate either
+   return libqotp::hotp_value(OtpKey(secret, algorithm), counter, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::core::HotpRange libqotp::hotp_range(
+    const OtpKey &key,
+    uint64_t counter,
+    uint64_t count,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return core::HotpRange(key.coreKey(), counter, count, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+qsizetype libqotp::hotp(
+    const OtpKey &key,
+    uint64_t counter,
+    std::span<char> output,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   detail::MetricsScope metrics(key);
+
+   const std::size_t length = core::hotp(key.coreKey(), counter, output, digits, digitMinimum, digitMaximum);
+   if (length == 0)
    {
-      // Ensuring offset is within the bounds of the hash array to prevent out-of-bounds access.
-      // The offset calculation is based on the last byte of the hash and must allow for subsequent bytes.
-      return QString();
+      // With a valid key and digits only the buffer can be the problem
+      const OtpError error = detail::check_otp(key, digits, digitMinimum, digitMaximum);
+      metrics.fail(error != OtpError::None ? error : OtpError::OutputTooSmall);
    }
+   return static_cast<qsizetype>(length);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+qsizetype libqotp::hotp(
+    QByteArrayView secret,
+    uint64_t counter,
+    std::span<char> output,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   return libqotp::hotp(OtpKey(secret, algorithm), counter, output, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint64> libqotp::hotp_resync(
+    const OtpKey &key,
+    quint64 counter,
+    quint32 code,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return core::hotp_resync(key.coreKey(), counter, code, lookAhead, digits, digitMinimum, digitMaximum);
+}
 
-   quint32 truncatedHash = (static_cast<quint32>(hash.at(offset) & 0x7f) << 24) |
-                           (static_cast<quint32>(hash.at(offset + 1) & 0xff) << 16) |
-                           (static_cast<quint32>(hash.at(offset + 2) & 0xff) << 8) |
-                           (static_cast<quint32>(hash.at(offset + 3) & 0xff));
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint64> libqotp::hotp_resync(
+    const OtpKey &key,
+    quint64 counter,
+    std::span<const quint32> codes,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return core::hotp_resync(key.coreKey(), counter, codes, lookAhead, digits, digitMinimum, digitMaximum);
+}
 
-   // Generate HOTP value
-   quint32 hotp = truncatedHash % static_cast<quint32>(std::pow(10, digits));
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint64> libqotp::hotp_resync(
+    QByteArrayView secret,
+    quint64 counter,
+    quint32 code,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   // One key schedule is shared by all candidates of the window
+   return libqotp::hotp_resync(OtpKey(secret, algorithm), counter, code, lookAhead, digits, digitMinimum, digitMaximum);
+}
 
-   // Return HOTP as zero-padded string
-   return QString::number(hotp).rightJustified(digits, '0');
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint64> libqotp::hotp_resync(
+    QByteArrayView secret,
+    quint64 counter,
+    std::span<const quint32> codes,
+    unsigned int lookAhead,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   return libqotp::hotp_resync(OtpKey(secret, algorithm), counter, codes, lookAhead, digits, digitMinimum, digitMaximum);
 }
 
 // Refer to the detailed documentation in qotp.h for complete information about this function.
@@ -120,11 +215,11 @@ QString libqotp::hotp_base32(
     unsigned int digitMaximum,
     QCryptographicHash::Algorithm algorithm)
 {
-   // Decode the Base32 secret
-   QByteArray secret = libqotp::base32_decode(base32);
-
-   // Call the original hotp function with the decoded secret
-   return libqotp::hotp(QByteArrayView(secret), counter, digits, digitMinimum, digitMaximum, algorithm);
+   // Decode the Base32 secret and call the original hotp function with it
+   return libqotp::detail::with_base32_secret(base32, [&](QByteArrayView secret)
+   {
+      return libqotp::hotp(secret, counter, digits, digitMinimum, digitMaximum, algorithm);
+   });
 }
 
 // Refer to the detailed documentation in qotp.h for complete information about this function.
@@ -0,0 +1,87 @@
+#ifndef LIBQOTP_HOTP_BATCH_H_20261018
+#define LIBQOTP_HOTP_BATCH_H_20261018
+
+#include <libqotp/core/key.h>
+
+#include "truncate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Internal batch interface on top of the multi-buffer HMAC engine.
+//
+// Computing many HOTP values at once lets the engine fill its vector lanes. Verification windows,
+// resynchronisation and bulk generation all funnel through here.
+namespace libqotp::detail
+{
+   struct HotpJob
+   {
+      const core::Key *key;
+      std::uint64_t counter;
+   };
+
+   /**
+    * Computes the HOTP value with 'digits' digits for each of the 'count' jobs.
+    *
+    * Jobs may mix keys and algorithms. 'digits' must already be validated. The value of a job whose key
+    * is invalid, or whose hash cannot be truncated, is set to invalid_code.
+    */
+   void hotp_values(const HotpJob *jobs, std::size_t count, unsigned int digits, std::uint32_t *values);
+
+   /**
+    * Compares 'code' in constant time with the codes of counter - window to counter + window, clamped
+    * to the range of counters. Shared by the TOTP verification of the core and the Qt API.
+    *
+    * 'key' must be valid, 'digits' validated and 'window' at most INT_MAX. Returns the offset of the
+    * matching counter closest to 'counter', or std::nullopt.
+    */
+   std::optional<int> verify_window(const core::Key &key, std::uint32_t code, std::uint64_t counter, unsigned int window, unsigned int digits);
+
+   /**
+    * Picks the matching candidate of a verification window that is closest to the current counter.
+    *
+    * Every candidate is passed to add(), whether or not an earlier one matched, and the selection does not
+    * branch on the values, so the time taken does not reveal which offset matched. Offsets must be below
+    * 2^32 in magnitude.
+    */
+   class WindowMatch
+   {
+   public:
+      /**
+       * Considers the candidate at 'offset' whose computed value is 'value'. A value of invalid_code never matches.
+       */
+      void add(std::int64_t offset, std::uint32_t value, std::uint32_t code)
+      {
+         const std::uint64_t distance = offset < 0 ? static_cast<std::uint64_t>(-offset) : static_cast<std::uint64_t>(offset);
+
+         // Distances are below 2^32, so the subtraction borrows exactly when distance < bestDistance.
+         const std::uint64_t closer = (distance - m_bestDistance) >> 63;
+         const std::uint32_t match = equal_mask(value, code) & (equal_mask(value, invalid_code) ^ 1u);
+         const std::uint64_t select = 0 - (static_cast<std::uint64_t>(match) & closer);
+
+         m_bestDistance = (m_bestDistance & ~select) | (distance & select);
+         m_bestOffset = static_cast<std::int64_t>((static_cast<std::uint64_t>(m_bestOffset) & ~select) | (static_cast<std::uint64_t>(offset) & select));
+         m_found |= match;
+      }
+
+      /**
+       * Returns the offset of the closest match, or std::nullopt if no candidate matched.
+       */
+      std::optional<int> result() const
+      {
+         if (!m_found)
+         {
+            return std::nullopt;
+         }
+         return static_cast<int>(m_bestOffset);
+      }
+
+   private:
+      std::uint32_t m_found = 0;
+      std::uint64_t m_bestDistance = std::uint64_t(1) << 32;
+      std::int64_t m_bestOffset = 0;
+   };
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef LIBQOTP_KEY_ACCESS_H_20261018
+#define LIBQOTP_KEY_ACCESS_H_20261018
+
+#include <libqotp/core/key.h>
+
+namespace libqotp::detail
+{
+   // Gives the batch engines read access to the cached midstates of a key, and the key store the
+   // means to load midstates it saved before.
+   struct KeyAccess
+   {
+      static const void *innerState(const core::Key &key)
+      {
+         return &key.m_inner;
+      }
+
+      static const void *outerState(const core::Key &key)
+      {
+         return &key.m_outer;
+      }
+
+      static void *innerState(core::Key &key)
+      {
+         return &key.m_inner;
+      }
+
+      static void *outerState(core::Key &key)
+      {
+         return &key.m_outer;
+      }
+
+      // Marks a key whose midstates were written through innerState() and outerState() as valid.
+      static void setValid(core::Key &key, core::Algorithm algorithm)
+      {
+         key.m_algorithm = algorithm;
+         key.m_valid = true;
+      }
+   };
+}
+
+#endif
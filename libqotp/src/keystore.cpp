@@ -0,0 +1,541 @@
+#include <libqotp/keystore.h>
+
+#include "crc32.h"
+#include "hotp_batch.h"
+#include "key_access.h"
+#include "sha.h"
+#include "truncate.h"
+
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+   using libqotp::core::Algorithm;
+
+   // File layout, see KeyStore. A record is spread over the columns and takes record_size bytes.
+   constexpr char magic[8] = {'Q', 'O', 'T', 'P', 'K', 'E', 'Y', 'S'};
+   constexpr quint32 format_version = 1;
+   constexpr qint64 header_size = 64;
+   constexpr qint64 state_size = 128;
+   constexpr qint64 record_size = state_size + 8 + 4 + 4 + 1 + 1;
+
+   // Header fields
+   constexpr qint64 version_offset = 8;
+   constexpr qint64 flags_offset = 12;
+   constexpr qint64 count_offset = 16;
+   constexpr qint64 file_size_offset = 24;
+   constexpr qint64 header_checksum_offset = 60;
+
+   // Largest count whose file size fits into a qint64
+   constexpr quint64 max_count = static_cast<quint64>((std::numeric_limits<qint64>::max() - header_size) / record_size);
+
+   // Start of each column in a store of 'count' records
+   struct Columns
+   {
+      qint64 states;
+      qint64 epochs;
+      qint64 periods;
+      qint64 checksums;
+      qint64 algorithms;
+      qint64 digits;
+      qint64 end;
+   };
+
+   Columns columns_for(qint64 count)
+   {
+      Columns columns;
+      columns.states = header_size;
+      columns.epochs = columns.states + count * state_size;
+      columns.periods = columns.epochs + count * 8;
+      columns.checksums = columns.periods + count * 4;
+      columns.algorithms = columns.checksums + count * 4;
+      columns.digits = columns.algorithms + count;
+      columns.end = columns.digits + count;
+      return columns;
+   }
+
+   // CRC-32C of a record as stored, seeded with its index so that swapped records are detected as well
+   quint32 record_checksum(qint64 index, const uchar *state, const uchar *epoch, const uchar *period, uchar algorithm, uchar digits)
+   {
+      uchar indexBytes[8];
+      qToLittleEndian<quint64>(static_cast<quint64>(index), indexBytes);
+
+      quint32 crc = libqotp::detail::crc32c(0, indexBytes, sizeof(indexBytes));
+      crc = libqotp::detail::crc32c(crc, state, state_size);
+      crc = libqotp::detail::crc32c(crc, epoch, 8);
+      crc = libqotp::detail::crc32c(crc, period, 4);
+      crc = libqotp::detail::crc32c(crc, &algorithm, 1);
+      return libqotp::detail::crc32c(crc, &digits, 1);
+   }
+
+   bool valid_algorithm(uchar algorithm)
+   {
+      return algorithm <= static_cast<uchar>(Algorithm::Sha512);
+   }
+
+   QCryptographicHash::Algorithm qt_algorithm(Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case Algorithm::Sha1:
+         return QCryptographicHash::Sha1;
+      case Algorithm::Sha256:
+         return QCryptographicHash::Sha256;
+      case Algorithm::Sha512:
+         return QCryptographicHash::Sha512;
+      }
+      return QCryptographicHash::Sha1;
+   }
+
+   // Midstates are stored as 16 little endian 32-bit words for SHA-1 and SHA-256 and 8 64-bit words
+   // for SHA-512, inner state first. Unused words are zero.
+   void store_state(uchar *data, const void *state, Algorithm algorithm)
+   {
+      if (algorithm == Algorithm::Sha512)
+      {
+         const auto *words = static_cast<const quint64 *>(state);
+         for (int i = 0; i < 8; ++i)
+         {
+            qToLittleEndian<quint64>(words[i], data + 8 * i);
+         }
+      }
+      else
+      {
+         const auto *words = static_cast<const quint32 *>(state);
+         for (int i = 0; i < 16; ++i)
+         {
+            qToLittleEndian<quint32>(words[i], data + 4 * i);
+         }
+      }
+   }
+
+   void load_state(void *state, const uchar *data, Algorithm algorithm)
+   {
+      if (algorithm == Algorithm::Sha512)
+      {
+         auto *words = static_cast<quint64 *>(state);
+         for (int i = 0; i < 8; ++i)
+         {
+            words[i] = qFromLittleEndian<quint64>(data + 8 * i);
+         }
+      }
+      else
+      {
+         auto *words = static_cast<quint32 *>(state);
+         for (int i = 0; i < 16; ++i)
+         {
+            words[i] = qFromLittleEndian<quint32>(data + 4 * i);
+         }
+      }
+   }
+}
+
+libqotp::KeyStore::KeyStore() = default;
+
+libqotp::KeyStore::~KeyStore()
+{
+   close();
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStore::open(const QString &fileName)
+{
+   close();
+
+   m_file.setFileName(fileName);
+   if (!m_file.open(QIODevice::ReadOnly))
+   {
+      m_error = KeyStoreError::OpenFailed;
+      return false;
+   }
+
+   const qint64 fileSize = m_file.size();
+   if (fileSize < header_size)
+   {
+      m_file.close();
+      m_error = KeyStoreError::NotAKeyStore;
+      return false;
+   }
+
+   const uchar *data = m_file.map(0, fileSize);
+   if (data == nullptr)
+   {
+      m_file.close();
+      m_error = KeyStoreError::OpenFailed;
+      return false;
+   }
+
+   // The header is checked once, records are checked when they are used
+   KeyStoreError error = KeyStoreError::None;
+   const quint64 count = qFromLittleEndian<quint64>(data + count_offset);
+   if (std::memcmp(data, magic, sizeof(magic)) != 0 ||
+       qFromLittleEndian<quint32>(data + version_offset) != format_version ||
+       qFromLittleEndian<quint32>(data + flags_offset) != 0)
+   {
+      error = KeyStoreError::NotAKeyStore;
+   }
+   else if (detail::crc32c(0, data, header_checksum_offset) != qFromLittleEndian<quint32>(data + header_checksum_offset) || count > max_count)
+   {
+      error = KeyStoreError::ChecksumMismatch;
+   }
+   else if (qFromLittleEndian<quint64>(data + file_size_offset) != static_cast<quint64>(fileSize) ||
+            columns_for(static_cast<qint64>(count)).end != fileSize)
+   {
+      error = KeyStoreError::Truncated;
+   }
+
+   if (error != KeyStoreError::None)
+   {
+      m_file.close();
+      m_error = error;
+      return false;
+   }
+
+   m_data = data;
+   m_count = static_cast<qsizetype>(count);
+   m_error = KeyStoreError::None;
+   return true;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+void libqotp::KeyStore::close()
+{
+   // Closing the file also unmaps it
+   m_file.close();
+   m_data = nullptr;
+   m_count = 0;
+}
+
+bool libqotp::KeyStore::load(qsizetype index, core::Key *key, KeyStoreRecord *record) const
+{
+   if (index < 0 || index >= m_count)
+   {
+      return false;
+   }
+
+   const Columns columns = columns_for(m_count);
+   const uchar *state = m_data + columns.states + index * state_size;
+   const uchar *epoch = m_data + columns.epochs + index * 8;
+   const uchar *period = m_data + columns.periods + index * 4;
+   const uchar algorithm = m_data[columns.algorithms + index];
+   const uchar digits = m_data[columns.digits + index];
+
+   // Fail closed: a corrupt record neither verifies nor generates codes
+   const quint32 checksum = qFromLittleEndian<quint32>(m_data + columns.checksums + index * 4);
+   if (record_checksum(index, state, epoch, period, algorithm, digits) != checksum ||
+       !valid_algorithm(algorithm) || !detail::valid_digits(digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT))
+   {
+      return false;
+   }
+
+   if (key != nullptr)
+   {
+      *key = core::Key();
+      load_state(detail::KeyAccess::innerState(*key), state, static_cast<Algorithm>(algorithm));
+      load_state(detail::KeyAccess::outerState(*key), state + state_size / 2, static_cast<Algorithm>(algorithm));
+      detail::KeyAccess::setValid(*key, static_cast<Algorithm>(algorithm));
+   }
+
+   if (record != nullptr)
+   {
+      record->algorithm = qt_algorithm(static_cast<Algorithm>(algorithm));
+      record->digits = digits;
+      record->period = qFromLittleEndian<quint32>(period);
+      record->epoch = qFromLittleEndian<quint64>(epoch);
+   }
+
+   return true;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+std::optional<libqotp::KeyStoreRecord> libqotp::KeyStore::record(qsizetype index) const
+{
+   KeyStoreRecord result;
+   if (!load(index, nullptr, &result))
+   {
+      return std::nullopt;
+   }
+
+   return result;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+libqotp::core::Key libqotp::KeyStore::key(qsizetype index) const
+{
+   core::Key result;
+   if (!load(index, &result, nullptr))
+   {
+      return core::Key();
+   }
+
+   return result;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+std::optional<int> libqotp::KeyStore::totp_verify(qsizetype index, quint32 code, quint64 currentUnixTime, unsigned int window) const
+{
+   core::Key key;
+   KeyStoreRecord parameters;
+   if (!load(index, &key, &parameters) || parameters.period == 0 || currentUnixTime < parameters.epoch ||
+       window > static_cast<unsigned int>(std::numeric_limits<int>::max()))
+   {
+      return std::nullopt;
+   }
+
+   return detail::verify_window(key, code, (currentUnixTime - parameters.epoch) / parameters.period, window, parameters.digits);
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStore::totp_verify(
+    std::span<const KeyStoreCheck> checks,
+    std::span<std::optional<int>> results,
+    quint64 currentUnixTime,
+    unsigned int window) const
+{
+   if (results.size() < checks.size())
+   {
+      return false;
+   }
+
+   // Wide windows do not fit the stack buffers below and gain nothing from sharing lanes
+   constexpr std::size_t chunkJobs = 256;
+   const std::size_t candidates = 2 * static_cast<std::size_t>(window) + 1;
+   if (window > static_cast<unsigned int>(std::numeric_limits<int>::max()) || candidates > chunkJobs / 4)
+   {
+      for (std::size_t i = 0; i < checks.size(); ++i)
+      {
+         results[i] = totp_verify(checks[i].index, checks[i].code, currentUnixTime, window);
+      }
+      return true;
+   }
+
+   // The checks are taken in groups whose candidates fill one chunk of jobs. The values are computed with
+   // all ten digits, the truncated hash itself, and reduced to the digits of each record afterwards.
+   constexpr std::size_t maxGroupSize = 64;
+   const std::size_t groupSize = std::min(maxGroupSize, chunkJobs / candidates);
+   core::Key keys[maxGroupSize];
+   KeyStoreRecord parameters[maxGroupSize];
+   quint64 counters[maxGroupSize];
+   bool usable[maxGroupSize];
+   detail::HotpJob jobs[chunkJobs];
+   std::uint32_t values[chunkJobs];
+
+   for (std::size_t begin = 0; begin < checks.size(); begin += groupSize)
+   {
+      const std::size_t count = std::min(groupSize, checks.size() - begin);
+      std::size_t pending = 0;
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         usable[i] = load(checks[begin + i].index, &keys[i], &parameters[i]) && parameters[i].period != 0 && currentUnixTime >= parameters[i].epoch;
+         if (!usable[i])
+         {
+            continue;
+         }
+
+         // Counters below zero do not exist, the window is clamped instead
+         counters[i] = (currentUnixTime - parameters[i].epoch) / parameters[i].period;
+         const quint64 first = counters[i] >= window ? counters[i] - window : 0;
+         const quint64 last = counters[i] <= std::numeric_limits<quint64>::max() - window ? counters[i] + window : std::numeric_limits<quint64>::max();
+         for (quint64 counter = first;; ++counter)
+         {
+            jobs[pending++] = {&keys[i], counter};
+            if (counter == last)
+            {
+               break;
+            }
+         }
+      }
+
+      detail::hotp_values(jobs, pending, detail::max_code_digits, values);
+
+      std::size_t job = 0;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+         if (!usable[i])
+         {
+            results[begin + i] = std::nullopt;
+            continue;
+         }
+
+         detail::WindowMatch match;
+         for (; job < pending && jobs[job].key == &keys[i]; ++job)
+         {
+            const std::uint32_t value = values[job] == detail::invalid_code ? detail::invalid_code : detail::reduce_to_digits(values[job], parameters[i].digits);
+            match.add(static_cast<std::int64_t>(jobs[job].counter - counters[i]), value, checks[begin + i].code);
+         }
+         results[begin + i] = match.result();
+      }
+   }
+
+   // The keys wipe themselves when they go out of scope
+   detail::secure_zero(values, sizeof(values));
+   return true;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+std::optional<quint32> libqotp::KeyStore::totp_value(qsizetype index, quint64 currentUnixTime) const
+{
+   core::Key key;
+   KeyStoreRecord parameters;
+   if (!load(index, &key, &parameters) || parameters.period == 0 || currentUnixTime < parameters.epoch)
+   {
+      return std::nullopt;
+   }
+
+   return core::hotp_value(key, (currentUnixTime - parameters.epoch) / parameters.period, parameters.digits);
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+std::optional<quint32> libqotp::KeyStore::hotp_value(qsizetype index, quint64 counter) const
+{
+   core::Key key;
+   KeyStoreRecord parameters;
+   if (!load(index, &key, &parameters))
+   {
+      return std::nullopt;
+   }
+
+   return core::hotp_value(key, counter, parameters.digits);
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStore::verifyChecksums()
+{
+   for (qsizetype index = 0; index < m_count; ++index)
+   {
+      if (!load(index, nullptr, nullptr))
+      {
+         m_error = KeyStoreError::ChecksumMismatch;
+         return false;
+      }
+   }
+
+   m_error = KeyStoreError::None;
+   return true;
+}
+
+libqotp::KeyStoreWriter::KeyStoreWriter(const QString &fileName)
+   : m_file(std::make_unique<QSaveFile>(fileName))
+{
+   // The header is written on commit(), when the count is known
+   const char placeholder[header_size] = {};
+   if (!m_file->open(QIODevice::WriteOnly) ||
+       !m_file->setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner) ||
+       m_file->write(placeholder, header_size) != header_size)
+   {
+      m_failed = true;
+      m_error = KeyStoreError::OpenFailed;
+   }
+}
+
+// Destroying an uncommitted QSaveFile removes its temporary file and leaves the target untouched
+libqotp::KeyStoreWriter::~KeyStoreWriter() = default;
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStoreWriter::add(const OtpKey &key, unsigned int digits, unsigned int period, quint64 epoch)
+{
+   if (m_failed || !m_file->isOpen())
+   {
+      m_error = KeyStoreError::WriteFailed;
+      return false;
+   }
+
+   if (!key.isValid() || !detail::valid_digits(digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT) ||
+       static_cast<quint64>(count()) >= max_count)
+   {
+      m_error = KeyStoreError::InvalidKey;
+      return false;
+   }
+
+   const core::Key &coreKey = key.coreKey();
+   const auto algorithm = static_cast<uchar>(coreKey.algorithm());
+
+   uchar state[state_size];
+   store_state(state, detail::KeyAccess::innerState(coreKey), coreKey.algorithm());
+   store_state(state + state_size / 2, detail::KeyAccess::outerState(coreKey), coreKey.algorithm());
+
+   uchar epochBytes[8];
+   uchar periodBytes[4];
+   qToLittleEndian<quint64>(epoch, epochBytes);
+   qToLittleEndian<quint32>(period, periodBytes);
+   const quint32 checksum = record_checksum(count(), state, epochBytes, periodBytes, algorithm, static_cast<uchar>(digits));
+
+   const bool written = m_file->write(reinterpret_cast<const char *>(state), state_size) == state_size;
+   detail::secure_zero(state, sizeof(state));
+
+   if (!written)
+   {
+      // The midstate column is now out of step with the others, the file cannot be completed
+      m_failed = true;
+      m_error = KeyStoreError::WriteFailed;
+      return false;
+   }
+
+   m_epochs.push_back(epoch);
+   m_periods.push_back(period);
+   m_checksums.push_back(checksum);
+   m_algorithms.push_back(algorithm);
+   m_digits.push_back(static_cast<quint8>(digits));
+
+   m_error = KeyStoreError::None;
+   return true;
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStoreWriter::add(const OtpAuthUri &uri)
+{
+   return add(OtpKey(uri.secret, uri.algorithm), uri.digits, uri.type == OtpType::Totp ? uri.period : 0);
+}
+
+// Refer to the detailed documentation in keystore.h for complete information about this function.
+bool libqotp::KeyStoreWriter::commit()
+{
+   if (m_failed || !m_file->isOpen())
+   {
+      m_error = KeyStoreError::WriteFailed;
+      return false;
+   }
+
+   // Converted in place, the columns are not used afterwards
+   const qint64 count = static_cast<qint64>(m_checksums.size());
+   qToLittleEndian<quint64>(m_epochs.data(), count, m_epochs.data());
+   qToLittleEndian<quint32>(m_periods.data(), count, m_periods.data());
+   qToLittleEndian<quint32>(m_checksums.data(), count, m_checksums.data());
+
+   uchar header[header_size] = {};
+   std::memcpy(header, magic, sizeof(magic));
+   qToLittleEndian<quint32>(format_version, header + version_offset);
+   qToLittleEndian<quint64>(static_cast<quint64>(count), header + count_offset);
+   qToLittleEndian<quint64>(static_cast<quint64>(columns_for(count).end), header + file_size_offset);
+   qToLittleEndian<quint32>(detail::crc32c(0, header, header_checksum_offset), header + header_checksum_offset);
+
+   const bool written = m_file->write(reinterpret_cast<const char *>(m_epochs.data()), count * 8) == count * 8 &&
+                        m_file->write(reinterpret_cast<const char *>(m_periods.data()), count * 4) == count * 4 &&
+                        m_file->write(reinterpret_cast<const char *>(m_checksums.data()), count * 4) == count * 4 &&
+                        m_file->write(reinterpret_cast<const char *>(m_algorithms.data()), count) == count &&
+                        m_file->write(reinterpret_cast<const char *>(m_digits.data()), count) == count &&
+                        m_file->seek(0) &&
+                        m_file->write(reinterpret_cast<const char *>(header), header_size) == header_size;
+
+   m_failed = true;
+   if (!written)
+   {
+      m_file->cancelWriting();
+      m_error = KeyStoreError::WriteFailed;
+      return false;
+   }
+
+   if (!m_file->commit())
+   {
+      m_error = KeyStoreError::WriteFailed;
+      return false;
+   }
+
+   m_error = KeyStoreError::None;
+   return true;
+}
@@ -0,0 +1,220 @@
+#include <libqotp/metrics.h>
+
+#include "metrics_record.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef QOTP_WITH_METRICS
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+// The counters of one thread. Only the owning thread writes them, metrics() reads them from any thread.
+struct libqotp::detail::ThreadMetrics
+{
+   std::atomic<quint64> calls[3];
+   std::atomic<quint64> failures[otp_error_count];
+   std::atomic<quint64> latency[Metrics::latency_buckets];
+
+   // Operations until the next sample. Only used by the owning thread.
+   unsigned int countdown = 0;
+};
+
+namespace
+{
+   using libqotp::Metrics;
+   using libqotp::detail::ThreadMetrics;
+
+   // With a single writer a plain load and store is enough, which is much cheaper than a locked add
+   void increment(std::atomic<quint64> &counter)
+   {
+      counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+   }
+
+   struct Registry
+   {
+      std::mutex mutex;
+      std::vector<const ThreadMetrics *> threads;
+
+      // The counts of threads that exited
+      Metrics exited;
+
+      // The counts at the last reset_metrics()
+      Metrics baseline;
+   };
+
+   // Never destroyed, threads may still exit during static destruction
+   Registry &registry()
+   {
+      static Registry *instance = new Registry();
+      return *instance;
+   }
+
+   void add(Metrics &total, const ThreadMetrics &metrics)
+   {
+      for (std::size_t i = 0; i < total.calls.size(); ++i)
+      {
+         total.calls[i] += metrics.calls[i].load(std::memory_order_relaxed);
+      }
+      for (std::size_t i = 0; i < total.failures.size(); ++i)
+      {
+         total.failures[i] += metrics.failures[i].load(std::memory_order_relaxed);
+      }
+      for (std::size_t i = 0; i < total.latency.size(); ++i)
+      {
+         total.latency[i] += metrics.latency[i].load(std::memory_order_relaxed);
+      }
+   }
+
+   // Sums all blocks. Called with the registry locked.
+   Metrics total(const Registry &registry)
+   {
+      Metrics result = registry.exited;
+      for (const ThreadMetrics *metrics : registry.threads)
+      {
+         add(result, *metrics);
+      }
+      return result;
+   }
+
+   // Registers the block of a thread on first use and folds it into 'exited' when the thread ends
+   struct ThreadSlot
+   {
+      ThreadMetrics metrics;
+
+      ThreadSlot()
+      {
+         Registry &instance = registry();
+         std::lock_guard lock(instance.mutex);
+         instance.threads.push_back(&metrics);
+      }
+
+      ~ThreadSlot()
+      {
+         Registry &instance = registry();
+         std::lock_guard lock(instance.mutex);
+         add(instance.exited, metrics);
+         std::erase(instance.threads, &metrics);
+      }
+   };
+
+   ThreadMetrics &local_metrics()
+   {
+      thread_local ThreadSlot slot;
+      return slot.metrics;
+   }
+}
+
+void libqotp::detail::record_failure(OtpError error)
+{
+   increment(local_metrics().failures[static_cast<int>(error)]);
+}
+
+libqotp::detail::MetricsScope::MetricsScope(const OtpKey &key)
+   : m_metrics(&local_metrics())
+{
+   if (const auto algorithm = core_algorithm(key.algorithm()))
+   {
+      increment(m_metrics->calls[static_cast<int>(*algorithm)]);
+   }
+
+   // Reading the clock costs about as much as a short HMAC, so only some operations are timed
+   if (m_metrics->countdown-- == 0)
+   {
+      m_metrics->countdown = metrics_sample_interval - 1;
+      m_sampled = true;
+      m_start = std::chrono::steady_clock::now();
+   }
+}
+
+libqotp::detail::MetricsScope::~MetricsScope()
+{
+   if (m_sampled)
+   {
+      const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+      const int bucket = std::min(static_cast<int>(std::bit_width(static_cast<quint64>(std::max<qint64>(elapsed, 0)))), Metrics::latency_buckets - 1);
+      increment(m_metrics->latency[bucket]);
+   }
+
+   if (m_error != OtpError::None)
+   {
+      increment(m_metrics->failures[static_cast<int>(m_error)]);
+   }
+}
+#endif
+
+// Refer to the detailed documentation in metrics.h for complete information about this function.
+quint64 libqotp::Metrics::samples() const
+{
+   quint64 result = 0;
+   for (quint64 count : latency)
+   {
+      result += count;
+   }
+   return result;
+}
+
+// Refer to the detailed documentation in metrics.h for complete information about this function.
+std::chrono::nanoseconds libqotp::Metrics::latencyPercentile(double fraction) const
+{
+   const quint64 count = samples();
+   if (count == 0)
+   {
+      return std::chrono::nanoseconds(0);
+   }
+
+   // The smallest bucket that contains the requested share of the samples, reported by its upper end
+   const quint64 wanted = std::max<quint64>(static_cast<quint64>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count))), 1);
+   quint64 seen = 0;
+   int bucket = 0;
+   for (; bucket < latency_buckets - 1; ++bucket)
+   {
+      seen += latency[bucket];
+      if (seen >= wanted)
+      {
+         break;
+      }
+   }
+
+   return std::chrono::nanoseconds(qint64(1) << bucket);
+}
+
+// Refer to the detailed documentation in metrics.h for complete information about this function.
+libqotp::Metrics libqotp::metrics()
+{
+#ifdef QOTP_WITH_METRICS
+   Registry &instance = registry();
+   std::lock_guard lock(instance.mutex);
+
+   // Every counter only grows, so the difference to the baseline is never negative
+   Metrics result = total(instance);
+   for (std::size_t i = 0; i < result.calls.size(); ++i)
+   {
+      result.calls[i] -= instance.baseline.calls[i];
+   }
+   for (std::size_t i = 0; i < result.failures.size(); ++i)
+   {
+      result.failures[i] -= instance.baseline.failures[i];
+   }
+   for (std::size_t i = 0; i < result.latency.size(); ++i)
+   {
+      result.latency[i] -= instance.baseline.latency[i];
+   }
+   return result;
+#else
+   return Metrics();
+#endif
+}
+
+// Refer to the detailed documentation in metrics.h for complete information about this function.
+void libqotp::reset_metrics()
+{
+#ifdef QOTP_WITH_METRICS
+   // The blocks belong to their threads and are not written here, the baseline is subtracted instead
+   Registry &instance = registry();
+   std::lock_guard lock(instance.mutex);
+   instance.baseline = total(instance);
+#endif
+}
@@ -0,0 +1,61 @@
+#ifndef LIBQOTP_METRICS_RECORD_H_20261018
+#define LIBQOTP_METRICS_RECORD_H_20261018
+
+#include <libqotp/metrics.h>
+#include <libqotp/otpkey.h>
+
+#ifdef QOTP_WITH_METRICS
+#include <chrono>
+#endif
+
+namespace libqotp::detail
+{
+#ifdef QOTP_WITH_METRICS
+   struct ThreadMetrics;
+
+   // Adds one failure for 'error' to the block of the calling thread
+   void record_failure(OtpError error);
+
+   /**
+    * Records one OTP operation of the calling thread: counts it for the algorithm of the key, measures
+    * its duration if it is sampled and counts the failure set with fail() when it goes out of scope.
+    */
+   class MetricsScope
+   {
+   public:
+      explicit MetricsScope(const OtpKey &key);
+      ~MetricsScope();
+
+      MetricsScope(const MetricsScope &) = delete;
+      MetricsScope &operator=(const MetricsScope &) = delete;
+
+      void fail(OtpError error) { m_error = error; }
+
+   private:
+      ThreadMetrics *m_metrics = nullptr;
+      OtpError m_error = OtpError::None;
+      bool m_sampled = false;
+      std::chrono::steady_clock::time_point m_start;
+   };
+#else
+   // Without QOTP_WITH_METRICS recording is empty and inlined away
+
+   inline void record_failure(OtpError)
+   {
+   }
+
+   class MetricsScope
+   {
+   public:
+      explicit MetricsScope(const OtpKey &)
+      {
+      }
+
+      void fail(OtpError)
+      {
+      }
+   };
+#endif
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include "multibuffer.h"
+#include "cpu.h"
+#include "sha.h"
+
+#include <libqotp/core/hmacbackend.h>
+
+#include <cstring>
+
+namespace
+{
+   using libqotp::detail::HashKind;
+   using libqotp::detail::HmacCounterJob;
+
+   using Kernel = void (*)(const HmacCounterJob *jobs);
+
+   // The kernel for the widest instruction set available, together with its lane count.
+   struct KernelChoice
+   {
+      Kernel kernel = nullptr;
+      std::size_t lanes = 0;
+   };
+
+   KernelChoice select_kernel(HashKind kind)
+   {
+#if defined(QOTP_ARCH_X86)
+      // Kernels per hash function, widest first
+      struct Kernels
+      {
+         Kernel avx512;
+         Kernel avx2;
+         Kernel sse2;
+      };
+
+      static constexpr Kernels kernels[] = {
+         {libqotp::detail::hmac_sha1_counters_avx512, libqotp::detail::hmac_sha1_counters_avx2, libqotp::detail::hmac_sha1_counters_sse2},
+         {libqotp::detail::hmac_sha256_counters_avx512, libqotp::detail::hmac_sha256_counters_avx2, libqotp::detail::hmac_sha256_counters_sse2},
+         {libqotp::detail::hmac_sha512_counters_avx512, libqotp::detail::hmac_sha512_counters_avx2, libqotp::detail::hmac_sha512_counters_sse2},
+      };
+
+      const Kernels &candidates = kernels[static_cast<int>(kind)];
+
+      // A 128-bit register holds four 32-bit or two 64-bit lanes
+      const std::size_t lanes128 = kind == HashKind::Sha512 ? 2 : 4;
+
+      switch (libqotp::core::hmac_batch_level())
+      {
+      case libqotp::core::HmacBatchLevel::None:
+         return {};
+      case libqotp::core::HmacBatchLevel::Sse2:
+         return {candidates.sse2, lanes128};
+      case libqotp::core::HmacBatchLevel::Avx2:
+         return {candidates.avx2, lanes128 * 2};
+      case libqotp::core::HmacBatchLevel::Avx512:
+         return {candidates.avx512, lanes128 * 4};
+      }
+#else
+      (void)kind;
+#endif
+      return {};
+   }
+
+   // Scalar HMAC over one counter, starting from the cached midstates.
+   void hmac_counter_scalar(HashKind kind, const HmacCounterJob &job)
+   {
+      std::uint8_t message[8];
+      for (int i = 7; i >= 0; --i)
+      {
+         message[i] = static_cast<std::uint8_t>(job.counter >> ((7 - i) * 8));
+      }
+
+      switch (kind)
+      {
+      case HashKind::Sha1:
+      {
+         std::uint32_t state[5];
+         std::uint8_t inner[20];
+         std::memcpy(state, job.innerState, sizeof(state));
+         libqotp::detail::sha1_finish(state, message, sizeof(message), 64, inner);
+         std::memcpy(state, job.outerState, sizeof(state));
+         libqotp::detail::sha1_finish(state, inner, sizeof(inner), 64, job.digest);
+         libqotp::detail::secure_zero(inner, sizeof(inner));
+         break;
+      }
+      case HashKind::Sha256:
+      {
+         std::uint32_t state[8];
+         std::uint8_t inner[32];
+         std::memcpy(state, job.innerState, sizeof(state));
+         libqotp::detail::sha256_finish(state, message, sizeof(message), 64, inner);
+         std::memcpy(state, job.outerState, sizeof(state));
+         libqotp::detail::sha256_finish(state, inner, sizeof(inner), 64, job.digest);
+         libqotp::detail::secure_zero(inner, sizeof(inner));
+         break;
+      }
+      case HashKind::Sha512:
+      {
+         std::uint64_t state[8];
+         std::uint8_t inner[64];
+         std::memcpy(state, job.innerState, sizeof(state));
+         libqotp::detail::sha512_finish(state, message, sizeof(message), 128, inner);
+         std::memcpy(state, job.outerState, sizeof(state));
+         libqotp::detail::sha512_finish(state, inner, sizeof(inner), 128, job.digest);
+         libqotp::detail::secure_zero(inner, sizeof(inner));
+         break;
+      }
+      }
+   }
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+libqotp::core::HmacBatchLevel libqotp::core::hmac_batch_level()
+{
+#if defined(QOTP_ARCH_X86)
+   const libqotp::detail::CpuFeatures &features = libqotp::detail::cpu_features();
+   if (features.avx512f)
+   {
+      return HmacBatchLevel::Avx512;
+   }
+   if (features.avx2)
+   {
+      return HmacBatchLevel::Avx2;
+   }
+   if (features.sse2)
+   {
+      return HmacBatchLevel::Sse2;
+   }
+#endif
+   return HmacBatchLevel::None;
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+std::string_view libqotp::core::hmac_batch_level_name(HmacBatchLevel level)
+{
+   switch (level)
+   {
+   case HmacBatchLevel::None:
+      return "none";
+   case HmacBatchLevel::Sse2:
+      return "sse2";
+   case HmacBatchLevel::Avx2:
+      return "avx2";
+   case HmacBatchLevel::Avx512:
+      return "avx512";
+   }
+   return std::string_view();
+}
+
+// Refer to the detailed documentation in multibuffer.h for complete information about this function.
+void libqotp::detail::hmac_counters(HashKind kind, const HmacCounterJob *jobs, std::size_t count)
+{
+   const KernelChoice choice = select_kernel(kind);
+
+   std::size_t index = 0;
+   if (choice.kernel)
+   {
+      // Full vectors
+      for (; index + choice.lanes <= count; index += choice.lanes)
+      {
+         choice.kernel(jobs + index);
+      }
+
+      // A tail that fills more than half a vector is cheaper as one padded vector than one by one.
+      // The padding lanes repeat the last job and write into a scratch digest.
+      const std::size_t remaining = count - index;
+      if (remaining * 2 > choice.lanes)
+      {
+         HmacCounterJob padded[16];
+         std::uint8_t scratch[64];
+         for (std::size_t lane = 0; lane < choice.lanes; ++lane)
+         {
+            if (lane < remaining)
+            {
+               padded[lane] = jobs[index + lane];
+            }
+            else
+            {
+               padded[lane] = jobs[count - 1];
+               padded[lane].digest = scratch;
+            }
+         }
+
+         choice.kernel(padded);
+         secure_zero(scratch, sizeof(scratch));
+         index = count;
+      }
+   }
+
+   // Whatever is left, or everything if no vector kernel is available
+   for (; index < count; ++index)
+   {
+      hmac_counter_scalar(kind, jobs[index]);
+   }
+}
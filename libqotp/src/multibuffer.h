@@ -0,0 +1,60 @@
+#ifndef LIBQOTP_MULTIBUFFER_H_20261018
+#define LIBQOTP_MULTIBUFFER_H_20261018
+
+#include <cstddef>
+#include <cstdint>
+
+// Multi-buffer HMAC engine for HOTP counters.
+//
+// HMAC over an 8 byte counter is two dependent compressions, which keeps a single hash pipeline
+// latency bound. The engine computes several independent HMACs at once, one per vector lane, using
+// the midstates cached by OtpKey. The lane count depends on the instruction set selected at runtime,
+// which core::hmac_batch_level() reports:
+//
+//   SHA-1/SHA-256: SSE2 4 lanes, AVX2 8 lanes, AVX-512 16 lanes
+//   SHA-512:       SSE2 2 lanes, AVX2 4 lanes, AVX-512 8 lanes
+//
+// Jobs that do not fill a vector are computed with the scalar implementation from sha.cpp on the block
+// functions of the active HMAC backend, which produces the same bytes as QMessageAuthenticationCode.
+namespace libqotp::detail
+{
+   enum class HashKind
+   {
+      Sha1,
+      Sha256,
+      Sha512
+   };
+
+   struct HmacCounterJob
+   {
+      // Midstates as stored in OtpKey: five/eight 32-bit words for SHA-1/SHA-256, eight 64-bit words for SHA-512
+      const void *innerState;
+      const void *outerState;
+
+      // The HOTP moving factor, hashed as 8 byte big-endian message
+      std::uint64_t counter;
+
+      // Receives the 20, 32 or 64 byte HMAC
+      std::uint8_t *digest;
+   };
+
+   /**
+    * Computes HMAC(key, counter) for 'count' jobs that all use the hash function 'kind'.
+    */
+   void hmac_counters(HashKind kind, const HmacCounterJob *jobs, std::size_t count);
+
+   // Instruction set specific kernels. Each call processes exactly one vector of jobs.
+   void hmac_sha1_counters_sse2(const HmacCounterJob *jobs);
+   void hmac_sha256_counters_sse2(const HmacCounterJob *jobs);
+   void hmac_sha512_counters_sse2(const HmacCounterJob *jobs);
+
+   void hmac_sha1_counters_avx2(const HmacCounterJob *jobs);
+   void hmac_sha256_counters_avx2(const HmacCounterJob *jobs);
+   void hmac_sha512_counters_avx2(const HmacCounterJob *jobs);
+
+   void hmac_sha1_counters_avx512(const HmacCounterJob *jobs);
+   void hmac_sha256_counters_avx512(const HmacCounterJob *jobs);
+   void hmac_sha512_counters_avx512(const HmacCounterJob *jobs);
+}
+
+#endif
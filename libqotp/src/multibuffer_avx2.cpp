@@ -0,0 +1,64 @@
+#include "multibuffer.h"
+#include "cpu.h"
+
+#if defined(QOTP_ARCH_X86)
+
+#include <immintrin.h>
+
+namespace
+{
+   // AVX2: eight 32-bit lanes or four 64-bit lanes.
+   struct Vec32
+   {
+      __m256i v;
+   };
+
+   struct Vec64
+   {
+      __m256i v;
+   };
+
+   constexpr int lanes32 = 8;
+   constexpr int lanes64 = 4;
+
+   inline Vec32 add(Vec32 a, Vec32 b) { return {_mm256_add_epi32(a.v, b.v)}; }
+   inline Vec32 bit_xor(Vec32 a, Vec32 b) { return {_mm256_xor_si256(a.v, b.v)}; }
+   inline Vec32 xor3(Vec32 a, Vec32 b, Vec32 c) { return {_mm256_xor_si256(_mm256_xor_si256(a.v, b.v), c.v)}; }
+   inline Vec32 ch(Vec32 x, Vec32 y, Vec32 z) { return {_mm256_xor_si256(z.v, _mm256_and_si256(x.v, _mm256_xor_si256(y.v, z.v)))}; }
+   inline Vec32 maj(Vec32 x, Vec32 y, Vec32 z) { return {_mm256_or_si256(_mm256_and_si256(x.v, y.v), _mm256_and_si256(z.v, _mm256_or_si256(x.v, y.v)))}; }
+   template <int N> inline Vec32 rotl(Vec32 a) { return {_mm256_or_si256(_mm256_slli_epi32(a.v, N), _mm256_srli_epi32(a.v, 32 - N))}; }
+   template <int N> inline Vec32 rotr(Vec32 a) { return {_mm256_or_si256(_mm256_srli_epi32(a.v, N), _mm256_slli_epi32(a.v, 32 - N))}; }
+   template <int N> inline Vec32 shr(Vec32 a) { return {_mm256_srli_epi32(a.v, N)}; }
+   inline Vec32 broadcast32(std::uint32_t value) { return {_mm256_set1_epi32(static_cast<int>(value))}; }
+   inline Vec32 load(const std::uint32_t *data) { return {_mm256_load_si256(reinterpret_cast<const __m256i *>(data))}; }
+   inline void store(std::uint32_t *data, Vec32 a) { _mm256_store_si256(reinterpret_cast<__m256i *>(data), a.v); }
+
+   inline Vec64 add(Vec64 a, Vec64 b) { return {_mm256_add_epi64(a.v, b.v)}; }
+   inline Vec64 xor3(Vec64 a, Vec64 b, Vec64 c) { return {_mm256_xor_si256(_mm256_xor_si256(a.v, b.v), c.v)}; }
+   inline Vec64 ch(Vec64 x, Vec64 y, Vec64 z) { return {_mm256_xor_si256(z.v, _mm256_and_si256(x.v, _mm256_xor_si256(y.v, z.v)))}; }
+   inline Vec64 maj(Vec64 x, Vec64 y, Vec64 z) { return {_mm256_or_si256(_mm256_and_si256(x.v, y.v), _mm256_and_si256(z.v, _mm256_or_si256(x.v, y.v)))}; }
+   template <int N> inline Vec64 rotr(Vec64 a) { return {_mm256_or_si256(_mm256_srli_epi64(a.v, N), _mm256_slli_epi64(a.v, 64 - N))}; }
+   template <int N> inline Vec64 shr(Vec64 a) { return {_mm256_srli_epi64(a.v, N)}; }
+   inline Vec64 broadcast64(std::uint64_t value) { return {_mm256_set1_epi64x(static_cast<long long>(value))}; }
+   inline Vec64 load(const std::uint64_t *data) { return {_mm256_load_si256(reinterpret_cast<const __m256i *>(data))}; }
+   inline void store(std::uint64_t *data, Vec64 a) { _mm256_store_si256(reinterpret_cast<__m256i *>(data), a.v); }
+}
+
+#include "multibuffer_kernels.h"
+
+void libqotp::detail::hmac_sha1_counters_avx2(const HmacCounterJob *jobs)
+{
+   hmac_sha1_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha256_counters_avx2(const HmacCounterJob *jobs)
+{
+   hmac_sha256_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha512_counters_avx2(const HmacCounterJob *jobs)
+{
+   hmac_sha512_lanes(jobs);
+}
+
+#endif
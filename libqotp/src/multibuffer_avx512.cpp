@@ -0,0 +1,65 @@
+#include "multibuffer.h"
+#include "cpu.h"
+
+#if defined(QOTP_ARCH_X86)
+
+#include <immintrin.h>
+
+namespace
+{
+   // AVX-512F: sixteen 32-bit lanes or eight 64-bit lanes. Native rotates and the ternary logic
+   // instruction replace the shift/or sequences and the two-instruction choose/majority functions.
+   struct Vec32
+   {
+      __m512i v;
+   };
+
+   struct Vec64
+   {
+      __m512i v;
+   };
+
+   constexpr int lanes32 = 16;
+   constexpr int lanes64 = 8;
+
+   inline Vec32 add(Vec32 a, Vec32 b) { return {_mm512_add_epi32(a.v, b.v)}; }
+   inline Vec32 bit_xor(Vec32 a, Vec32 b) { return {_mm512_xor_si512(a.v, b.v)}; }
+   inline Vec32 xor3(Vec32 a, Vec32 b, Vec32 c) { return {_mm512_ternarylogic_epi32(a.v, b.v, c.v, 0x96)}; }
+   inline Vec32 ch(Vec32 x, Vec32 y, Vec32 z) { return {_mm512_ternarylogic_epi32(x.v, y.v, z.v, 0xca)}; }
+   inline Vec32 maj(Vec32 x, Vec32 y, Vec32 z) { return {_mm512_ternarylogic_epi32(x.v, y.v, z.v, 0xe8)}; }
+   template <int N> inline Vec32 rotl(Vec32 a) { return {_mm512_rol_epi32(a.v, N)}; }
+   template <int N> inline Vec32 rotr(Vec32 a) { return {_mm512_ror_epi32(a.v, N)}; }
+   template <int N> inline Vec32 shr(Vec32 a) { return {_mm512_srli_epi32(a.v, N)}; }
+   inline Vec32 broadcast32(std::uint32_t value) { return {_mm512_set1_epi32(static_cast<int>(value))}; }
+   inline Vec32 load(const std::uint32_t *data) { return {_mm512_load_si512(data)}; }
+   inline void store(std::uint32_t *data, Vec32 a) { _mm512_store_si512(data, a.v); }
+
+   inline Vec64 add(Vec64 a, Vec64 b) { return {_mm512_add_epi64(a.v, b.v)}; }
+   inline Vec64 xor3(Vec64 a, Vec64 b, Vec64 c) { return {_mm512_ternarylogic_epi64(a.v, b.v, c.v, 0x96)}; }
+   inline Vec64 ch(Vec64 x, Vec64 y, Vec64 z) { return {_mm512_ternarylogic_epi64(x.v, y.v, z.v, 0xca)}; }
+   inline Vec64 maj(Vec64 x, Vec64 y, Vec64 z) { return {_mm512_ternarylogic_epi64(x.v, y.v, z.v, 0xe8)}; }
+   template <int N> inline Vec64 rotr(Vec64 a) { return {_mm512_ror_epi64(a.v, N)}; }
+   template <int N> inline Vec64 shr(Vec64 a) { return {_mm512_srli_epi64(a.v, N)}; }
+   inline Vec64 broadcast64(std::uint64_t value) { return {_mm512_set1_epi64(static_cast<long long>(value))}; }
+   inline Vec64 load(const std::uint64_t *data) { return {_mm512_load_si512(data)}; }
+   inline void store(std::uint64_t *data, Vec64 a) { _mm512_store_si512(data, a.v); }
+}
+
+#include "multibuffer_kernels.h"
+
+void libqotp::detail::hmac_sha1_counters_avx512(const HmacCounterJob *jobs)
+{
+   hmac_sha1_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha256_counters_avx512(const HmacCounterJob *jobs)
+{
+   hmac_sha256_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha512_counters_avx512(const HmacCounterJob *jobs)
+{
+   hmac_sha512_lanes(jobs);
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef LIBQOTP_MULTIBUFFER_KERNELS_H_20261018
+#define LIBQOTP_MULTIBUFFER_KERNELS_H_20261018
+
+// Lane-parallel SHA-1/SHA-256/SHA-512 HMAC kernels, written once against a small vector interface.
+//
+// This header is included by the instruction set specific translation units only (multibuffer_sse2.cpp,
+// multibuffer_avx2.cpp, multibuffer_avx512.cpp), which are compiled with different target flags. Before
+// including it, a unit defines in an anonymous namespace:
+//
+//   Vec32, Vec64           wrappers around a vector register holding 32-bit and 64-bit lanes
+//   lanes32, lanes64       the number of lanes of each type
+//   add, bit_xor, xor3     lane-wise arithmetic for both types
+//   ch, maj                the SHA choose and majority functions
+//   rotl<N>, rotr<N>, shr<N>
+//   broadcast32, broadcast64, load, store
+//
+// Everything here has internal linkage on purpose: code compiled with AVX2 or AVX-512 enabled must never
+// be merged by the linker into code paths that run on CPUs without those extensions.
+
+#include "multibuffer.h"
+#include "sha.h"
+
+#include <cstdint>
+
+namespace
+{
+   using libqotp::detail::HmacCounterJob;
+
+   inline void store_be32(std::uint8_t *data, std::uint32_t value)
+   {
+      data[0] = static_cast<std::uint8_t>(value >> 24);
+      data[1] = static_cast<std::uint8_t>(value >> 16);
+      data[2] = static_cast<std::uint8_t>(value >> 8);
+      data[3] = static_cast<std::uint8_t>(value);
+   }
+
+   inline void store_be64(std::uint8_t *data, std::uint64_t value)
+   {
+      store_be32(data, static_cast<std::uint32_t>(value >> 32));
+      store_be32(data + 4, static_cast<std::uint32_t>(value));
+   }
+
+   // Transposes word 'index' of every job's midstate into one vector.
+   inline Vec32 gather32(const HmacCounterJob *jobs, bool outer, int index)
+   {
+      alignas(64) std::uint32_t words[lanes32];
+      for (int lane = 0; lane < lanes32; ++lane)
+      {
+         const void *state = outer ? jobs[lane].outerState : jobs[lane].innerState;
+         words[lane] = static_cast<const std::uint32_t *>(state)[index];
+      }
+      return load(words);
+   }
+
+   inline Vec64 gather64(const HmacCounterJob *jobs, bool outer, int index)
+   {
+      alignas(64) std::uint64_t words[lanes64];
+      for (int lane = 0; lane < lanes64; ++lane)
+      {
+         const void *state = outer ? jobs[lane].outerState : jobs[lane].innerState;
+         words[lane] = static_cast<const std::uint64_t *>(state)[index];
+      }
+      return load(words);
+   }
+
+   // Writes word 'index' of every lane as big-endian bytes into the job's digest.
+   inline void scatter32(const HmacCounterJob *jobs, Vec32 value, int index)
+   {
+      alignas(64) std::uint32_t words[lanes32];
+      store(words, value);
+      for (int lane = 0; lane < lanes32; ++lane)
+      {
+         store_be32(jobs[lane].digest + index * 4, words[lane]);
+      }
+   }
+
+   inline void scatter64(const HmacCounterJob *jobs, Vec64 value, int index)
+   {
+      alignas(64) std::uint64_t words[lanes64];
+      store(words, value);
+      for (int lane = 0; lane < lanes64; ++lane)
+      {
+         store_be64(jobs[lane].digest + index * 8, words[lane]);
+      }
+   }
+
+   // Loads the 8 byte big-endian counter as the first two message words of a SHA-1/SHA-256 block.
+   inline void counter_words32(const HmacCounterJob *jobs, Vec32 &high, Vec32 &low)
+   {
+      alignas(64) std::uint32_t highWords[lanes32];
+      alignas(64) std::uint32_t lowWords[lanes32];
+      for (int lane = 0; lane < lanes32; ++lane)
+      {
+         highWords[lane] = static_cast<std::uint32_t>(jobs[lane].counter >> 32);
+         lowWords[lane] = static_cast<std::uint32_t>(jobs[lane].counter);
+      }
+      high = load(highWords);
+      low = load(lowWords);
+   }
+
+   inline Vec64 counter_words64(const HmacCounterJob *jobs)
+   {
+      alignas(64) std::uint64_t words[lanes64];
+      for (int lane = 0; lane < lanes64; ++lane)
+      {
+         words[lane] = jobs[lane].counter;
+      }
+      return load(words);
+   }
+
+   // One SHA-1 compression of the block in 'w' into 'state'. The schedule in 'w' is overwritten.
+   inline void sha1_rounds(Vec32 state[5], Vec32 w[16])
+   {
+      Vec32 a = state[0];
+      Vec32 b = state[1];
+      Vec32 c = state[2];
+      Vec32 d = state[3];
+      Vec32 e = state[4];
+
+      auto schedule = [w](int i)
+      {
+         if (i >= 16)
+         {
+            w[i & 15] = rotl<1>(xor3(w[(i + 13) & 15], w[(i + 8) & 15], bit_xor(w[(i + 2) & 15], w[i & 15])));
+         }
+         return w[i & 15];
+      };
+
+      auto round = [&](int i, Vec32 f, std::uint32_t k)
+      {
+         const Vec32 temp = add(add(rotl<5>(a), f), add(add(e, broadcast32(k)), schedule(i)));
+         e = d;
+         d = c;
+         c = rotl<30>(b);
+         b = a;
+         a = temp;
+      };
+
+      for (int i = 0; i < 20; ++i)
+      {
+         round(i, ch(b, c, d), 0x5a827999);
+      }
+      for (int i = 20; i < 40; ++i)
+      {
+         round(i, xor3(b, c, d), 0x6ed9eba1);
+      }
+      for (int i = 40; i < 60; ++i)
+      {
+         round(i, maj(b, c, d), 0x8f1bbcdc);
+      }
+      for (int i = 60; i < 80; ++i)
+      {
+         round(i, xor3(b, c, d), 0xca62c1d6);
+      }
+
+      state[0] = add(state[0], a);
+      state[1] = add(state[1], b);
+      state[2] = add(state[2], c);
+      state[3] = add(state[3], d);
+      state[4] = add(state[4], e);
+   }
+
+   // One SHA-256 compression of the block in 'w' into 'state'. The schedule in 'w' is overwritten.
+   inline void sha256_rounds(Vec32 state[8], Vec32 w[16])
+   {
+      Vec32 v[8];
+      for (int i = 0; i < 8; ++i)
+      {
+         v[i] = state[i];
+      }
+
+      for (int i = 0; i < 64; ++i)
+      {
+         if (i >= 16)
+         {
+            const Vec32 w15 = w[(i + 1) & 15];
+            const Vec32 w2 = w[(i + 14) & 15];
+            const Vec32 s0 = xor3(rotr<7>(w15), rotr<18>(w15), shr<3>(w15));
+            const Vec32 s1 = xor3(rotr<17>(w2), rotr<19>(w2), shr<10>(w2));
+            w[i & 15] = add(add(w[i & 15], s0), add(w[(i + 9) & 15], s1));
+         }
+
+         const Vec32 s1 = xor3(rotr<6>(v[4]), rotr<11>(v[4]), rotr<25>(v[4]));
+         const Vec32 temp1 = add(add(v[7], s1), add(ch(v[4], v[5], v[6]), add(broadcast32(libqotp::detail::sha256_round_constants[i]), w[i & 15])));
+         const Vec32 s0 = xor3(rotr<2>(v[0]), rotr<13>(v[0]), rotr<22>(v[0]));
+         const Vec32 temp2 = add(s0, maj(v[0], v[1], v[2]));
+
+         v[7] = v[6];
+         v[6] = v[5];
+         v[5] = v[4];
+         v[4] = add(v[3], temp1);
+         v[3] = v[2];
+         v[2] = v[1];
+         v[1] = v[0];
+         v[0] = add(temp1, temp2);
+      }
+
+      for (int i = 0; i < 8; ++i)
+      {
+         state[i] = add(state[i], v[i]);
+      }
+   }
+
+   // One SHA-512 compression of the block in 'w' into 'state'. The schedule in 'w' is overwritten.
+   inline void sha512_rounds(Vec64 state[8], Vec64 w[16])
+   {
+      Vec64 v[8];
+      for (int i = 0; i < 8; ++i)
+      {
+         v[i] = state[i];
+      }
+
+      for (int i = 0; i < 80; ++i)
+      {
+         if (i >= 16)
+         {
+            const Vec64 w15 = w[(i + 1) & 15];
+            const Vec64 w2 = w[(i + 14) & 15];
+            const Vec64 s0 = xor3(rotr<1>(w15), rotr<8>(w15), shr<7>(w15));
+            const Vec64 s1 = xor3(rotr<19>(w2), rotr<61>(w2), shr<6>(w2));
+            w[i & 15] = add(add(w[i & 15], s0), add(w[(i + 9) & 15], s1));
+         }
+
+         const Vec64 s1 = xor3(rotr<14>(v[4]), rotr<18>(v[4]), rotr<41>(v[4]));
+         const Vec64 temp1 = add(add(v[7], s1), add(ch(v[4], v[5], v[6]), add(broadcast64(libqotp::detail::sha512_round_constants[i]), w[i & 15])));
+         const Vec64 s0 = xor3(rotr<28>(v[0]), rotr<34>(v[0]), rotr<39>(v[0]));
+         const Vec64 temp2 = add(s0, maj(v[0], v[1], v[2]));
+
+         v[7] = v[6];
+         v[6] = v[5];
+         v[5] = v[4];
+         v[4] = add(v[3], temp1);
+         v[3] = v[2];
+         v[2] = v[1];
+         v[1] = v[0];
+         v[0] = add(temp1, temp2);
+      }
+
+      for (int i = 0; i < 8; ++i)
+      {
+         state[i] = add(state[i], v[i]);
+      }
+   }
+
+   // HMAC-SHA1 over the counters of 'lanes32' jobs.
+   //
+   // Both message blocks are built directly as words: the inner block is the counter followed by the
+   // padding for a 64 + 8 byte message, the outer block is the inner digest followed by the padding
+   // for a 64 + 20 byte message.
+   inline void hmac_sha1_lanes(const HmacCounterJob *jobs)
+   {
+      Vec32 inner[5];
+      Vec32 outer[5];
+      for (int i = 0; i < 5; ++i)
+      {
+         inner[i] = gather32(jobs, false, i);
+         outer[i] = gather32(jobs, true, i);
+      }
+
+      const Vec32 zero = broadcast32(0);
+      Vec32 w[16];
+
+      counter_words32(jobs, w[0], w[1]);
+      w[2] = broadcast32(0x80000000);
+      for (int i = 3; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast32((64 + 8) * 8);
+      sha1_rounds(inner, w);
+
+      for (int i = 0; i < 5; ++i)
+      {
+         w[i] = inner[i];
+      }
+      w[5] = broadcast32(0x80000000);
+      for (int i = 6; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast32((64 + 20) * 8);
+      sha1_rounds(outer, w);
+
+      for (int i = 0; i < 5; ++i)
+      {
+         scatter32(jobs, outer[i], i);
+      }
+   }
+
+   // HMAC-SHA256 over the counters of 'lanes32' jobs.
+   inline void hmac_sha256_lanes(const HmacCounterJob *jobs)
+   {
+      Vec32 inner[8];
+      Vec32 outer[8];
+      for (int i = 0; i < 8; ++i)
+      {
+         inner[i] = gather32(jobs, false, i);
+         outer[i] = gather32(jobs, true, i);
+      }
+
+      const Vec32 zero = broadcast32(0);
+      Vec32 w[16];
+
+      counter_words32(jobs, w[0], w[1]);
+      w[2] = broadcast32(0x80000000);
+      for (int i = 3; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast32((64 + 8) * 8);
+      sha256_rounds(inner, w);
+
+      for (int i = 0; i < 8; ++i)
+      {
+         w[i] = inner[i];
+      }
+      w[8] = broadcast32(0x80000000);
+      for (int i = 9; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast32((64 + 32) * 8);
+      sha256_rounds(outer, w);
+
+      for (int i = 0; i < 8; ++i)
+      {
+         scatter32(jobs, outer[i], i);
+      }
+   }
+
+   // HMAC-SHA512 over the counters of 'lanes64' jobs. SHA-512 blocks are 128 bytes with a 128-bit length field.
+   inline void hmac_sha512_lanes(const HmacCounterJob *jobs)
+   {
+      Vec64 inner[8];
+      Vec64 outer[8];
+      for (int i = 0; i < 8; ++i)
+      {
+         inner[i] = gather64(jobs, false, i);
+         outer[i] = gather64(jobs, true, i);
+      }
+
+      const Vec64 zero = broadcast64(0);
+      Vec64 w[16];
+
+      w[0] = counter_words64(jobs);
+      w[1] = broadcast64(0x8000000000000000);
+      for (int i = 2; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast64((128 + 8) * 8);
+      sha512_rounds(inner, w);
+
+      for (int i = 0; i < 8; ++i)
+      {
+         w[i] = inner[i];
+      }
+      w[8] = broadcast64(0x8000000000000000);
+      for (int i = 9; i < 15; ++i)
+      {
+         w[i] = zero;
+      }
+      w[15] = broadcast64((128 + 64) * 8);
+      sha512_rounds(outer, w);
+
+      for (int i = 0; i < 8; ++i)
+      {
+         scatter64(jobs, outer[i], i);
+      }
+   }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "multibuffer.h"
+#include "cpu.h"
+
+#if defined(QOTP_ARCH_X86)
+
+#include <emmintrin.h>
+
+namespace
+{
+   // SSE2: four 32-bit lanes or two 64-bit lanes. SSE2 is part of every x86-64 CPU.
+   struct Vec32
+   {
+      __m128i v;
+   };
+
+   struct Vec64
+   {
+      __m128i v;
+   };
+
+   constexpr int lanes32 = 4;
+   constexpr int lanes64 = 2;
+
+   inline Vec32 add(Vec32 a, Vec32 b) { return {_mm_add_epi32(a.v, b.v)}; }
+   inline Vec32 bit_xor(Vec32 a, Vec32 b) { return {_mm_xor_si128(a.v, b.v)}; }
+   inline Vec32 xor3(Vec32 a, Vec32 b, Vec32 c) { return {_mm_xor_si128(_mm_xor_si128(a.v, b.v), c.v)}; }
+   inline Vec32 ch(Vec32 x, Vec32 y, Vec32 z) { return {_mm_xor_si128(z.v, _mm_and_si128(x.v, _mm_xor_si128(y.v, z.v)))}; }
+   inline Vec32 maj(Vec32 x, Vec32 y, Vec32 z) { return {_mm_or_si128(_mm_and_si128(x.v, y.v), _mm_and_si128(z.v, _mm_or_si128(x.v, y.v)))}; }
+   template <int N> inline Vec32 rotl(Vec32 a) { return {_mm_or_si128(_mm_slli_epi32(a.v, N), _mm_srli_epi32(a.v, 32 - N))}; }
+   template <int N> inline Vec32 rotr(Vec32 a) { return {_mm_or_si128(_mm_srli_epi32(a.v, N), _mm_slli_epi32(a.v, 32 - N))}; }
+   template <int N> inline Vec32 shr(Vec32 a) { return {_mm_srli_epi32(a.v, N)}; }
+   inline Vec32 broadcast32(std::uint32_t value) { return {_mm_set1_epi32(static_cast<int>(value))}; }
+   inline Vec32 load(const std::uint32_t *data) { return {_mm_load_si128(reinterpret_cast<const __m128i *>(data))}; }
+   inline void store(std::uint32_t *data, Vec32 a) { _mm_store_si128(reinterpret_cast<__m128i *>(data), a.v); }
+
+   inline Vec64 add(Vec64 a, Vec64 b) { return {_mm_add_epi64(a.v, b.v)}; }
+   inline Vec64 xor3(Vec64 a, Vec64 b, Vec64 c) { return {_mm_xor_si128(_mm_xor_si128(a.v, b.v), c.v)}; }
+   inline Vec64 ch(Vec64 x, Vec64 y, Vec64 z) { return {_mm_xor_si128(z.v, _mm_and_si128(x.v, _mm_xor_si128(y.v, z.v)))}; }
+   inline Vec64 maj(Vec64 x, Vec64 y, Vec64 z) { return {_mm_or_si128(_mm_and_si128(x.v, y.v), _mm_and_si128(z.v, _mm_or_si128(x.v, y.v)))}; }
+   template <int N> inline Vec64 rotr(Vec64 a) { return {_mm_or_si128(_mm_srli_epi64(a.v, N), _mm_slli_epi64(a.v, 64 - N))}; }
+   template <int N> inline Vec64 shr(Vec64 a) { return {_mm_srli_epi64(a.v, N)}; }
+   inline Vec64 broadcast64(std::uint64_t value) { return {_mm_set1_epi64x(static_cast<long long>(value))}; }
+   inline Vec64 load(const std::uint64_t *data) { return {_mm_load_si128(reinterpret_cast<const __m128i *>(data))}; }
+   inline void store(std::uint64_t *data, Vec64 a) { _mm_store_si128(reinterpret_cast<__m128i *>(data), a.v); }
+}
+
+#include "multibuffer_kernels.h"
+
+void libqotp::detail::hmac_sha1_counters_sse2(const HmacCounterJob *jobs)
+{
+   hmac_sha1_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha256_counters_sse2(const HmacCounterJob *jobs)
+{
+   hmac_sha256_lanes(jobs);
+}
+
+void libqotp::detail::hmac_sha512_counters_sse2(const HmacCounterJob *jobs)
+{
+   hmac_sha512_lanes(jobs);
+}
+
+#endif
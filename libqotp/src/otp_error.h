@@ -0,0 +1,32 @@
+#ifndef LIBQOTP_OTP_ERROR_H_20261018
+#define LIBQOTP_OTP_ERROR_H_20261018
+
+#include <libqotp/otpkey.h>
+#include <libqotp/result.h>
+
+#include "truncate.h"
+
+namespace libqotp::detail
+{
+   /**
+    * Returns why an operation with 'key' and 'digits' fails, or OtpError::None if both are valid.
+    *
+    * Only called to name the reason once an operation failed or before it starts, never per candidate.
+    */
+   inline OtpError check_otp(const OtpKey &key, unsigned int digits, unsigned int digitMinimum, unsigned int digitMaximum)
+   {
+      if (!key.isValid())
+      {
+         return core_algorithm(key.algorithm()) ? OtpError::InvalidKey : OtpError::UnsupportedAlgorithm;
+      }
+
+      if (!valid_digits(digits, digitMinimum, digitMaximum))
+      {
+         return OtpError::InvalidDigits;
+      }
+
+      return OtpError::None;
+   }
+}
+
+#endif
@@ -0,0 +1,587 @@
+#include <libqotp/otpauth.h>
+
+#include "sha.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+   constexpr char scheme[] = "otpauth://";
+   constexpr qsizetype scheme_length = sizeof(scheme) - 1;
+
+   char to_lower(char c)
+   {
+      return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+   }
+
+   // Compares ASCII text case-insensitively with a lower case literal
+   bool equals(QByteArrayView text, QByteArrayView lowercase)
+   {
+      if (text.size() != lowercase.size())
+      {
+         return false;
+      }
+
+      for (qsizetype i = 0; i < text.size(); ++i)
+      {
+         if (to_lower(text[i]) != lowercase[i])
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   int hex_value(char c)
+   {
+      if (c >= '0' && c <= '9')
+      {
+         return c - '0';
+      }
+      if (c >= 'a' && c <= 'f')
+      {
+         return c - 'a' + 10;
+      }
+      if (c >= 'A' && c <= 'F')
+      {
+         return c - 'A' + 10;
+      }
+      return -1;
+   }
+
+   // Decodes %XX escapes in place. Returns the decoded length, or -1 for a malformed escape.
+   qsizetype percent_decode(char *data, qsizetype length)
+   {
+      qsizetype written = 0;
+      for (qsizetype position = 0; position < length; ++position)
+      {
+         if (data[position] != '%')
+         {
+            data[written++] = data[position];
+            continue;
+         }
+
+         if (length - position < 3)
+         {
+            return -1;
+         }
+
+         const int high = hex_value(data[position + 1]);
+         const int low = hex_value(data[position + 2]);
+         if (high < 0 || low < 0)
+         {
+            return -1;
+         }
+
+         data[written++] = static_cast<char>(high * 16 + low);
+         position += 2;
+      }
+      return written;
+   }
+
+   // Parses a decimal number without sign or whitespace that does not exceed 'maximum'
+   bool parse_number(QByteArrayView text, quint64 maximum, quint64 &value)
+   {
+      if (text.isEmpty())
+      {
+         return false;
+      }
+
+      value = 0;
+      for (const char c : text)
+      {
+         if (c < '0' || c > '9')
+         {
+            return false;
+         }
+
+         const unsigned int digit = static_cast<unsigned int>(c - '0');
+         if (digit > maximum || value > (maximum - digit) / 10)
+         {
+            return false;
+         }
+         value = value * 10 + digit;
+      }
+      return true;
+   }
+
+   bool parse_algorithm(QByteArrayView text, QCryptographicHash::Algorithm &algorithm)
+   {
+      if (equals(text, "sha1"))
+      {
+         algorithm = QCryptographicHash::Sha1;
+      }
+      else if (equals(text, "sha256"))
+      {
+         algorithm = QCryptographicHash::Sha256;
+      }
+      else if (equals(text, "sha512"))
+      {
+         algorithm = QCryptographicHash::Sha512;
+      }
+      else
+      {
+         return false;
+      }
+      return true;
+   }
+
+   const char *algorithm_name(QCryptographicHash::Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case QCryptographicHash::Sha1:
+         return "SHA1";
+      case QCryptographicHash::Sha256:
+         return "SHA256";
+      case QCryptographicHash::Sha512:
+         return "SHA512";
+      default:
+         return nullptr;
+      }
+   }
+
+   char *write_text(QByteArrayView text, char *output)
+   {
+      std::memcpy(output, text.data(), static_cast<std::size_t>(text.size()));
+      return output + text.size();
+   }
+
+   char *write_number(quint64 value, char *output)
+   {
+      char digits[20];
+      int count = 0;
+      do
+      {
+         digits[count++] = static_cast<char>('0' + value % 10);
+         value /= 10;
+      } while (value != 0);
+
+      while (count > 0)
+      {
+         *output++ = digits[--count];
+      }
+      return output;
+   }
+
+   // Percent-encodes everything but unreserved characters (RFC 3986) and '@', which is common in account names
+   char *write_encoded(QByteArrayView text, char *output)
+   {
+      constexpr char hex[] = "0123456789ABCDEF";
+
+      for (const char c : text)
+      {
+         const bool plain = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                            || c == '-' || c == '.' || c == '_' || c == '~' || c == '@';
+         if (plain)
+         {
+            *output++ = c;
+            continue;
+         }
+
+         const quint8 byte = static_cast<quint8>(c);
+         *output++ = '%';
+         *output++ = hex[byte >> 4];
+         *output++ = hex[byte & 0xf];
+      }
+      return output;
+   }
+
+   bool is_space(char c)
+   {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+   }
+}
+
+// Refer to the detailed documentation in otpauth.h for complete information about this function.
+libqotp::OtpAuthError libqotp::parse_otpauth_uri(
+    std::span<char> uri,
+    OtpAuthUri &result,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   result = OtpAuthUri();
+
+   char *data = uri.data();
+   const qsizetype length = static_cast<qsizetype>(uri.size());
+
+   if (length < scheme_length || !equals(QByteArrayView(data, scheme_length), scheme))
+   {
+      return OtpAuthError::InvalidScheme;
+   }
+
+   // The type runs up to the label or the parameters
+   qsizetype position = scheme_length;
+   qsizetype typeEnd = position;
+   while (typeEnd < length && data[typeEnd] != '/' && data[typeEnd] != '?')
+   {
+      ++typeEnd;
+   }
+
+   const QByteArrayView type(data + position, typeEnd - position);
+   if (equals(type, "totp"))
+   {
+      result.type = OtpType::Totp;
+   }
+   else if (equals(type, "hotp"))
+   {
+      result.type = OtpType::Hotp;
+   }
+   else
+   {
+      return OtpAuthError::InvalidType;
+   }
+   position = typeEnd;
+
+   QByteArrayView label;
+   if (position < length && data[position] == '/')
+   {
+      ++position;
+      qsizetype labelEnd = position;
+      while (labelEnd < length && data[labelEnd] != '?')
+      {
+         ++labelEnd;
+      }
+
+      const qsizetype labelLength = percent_decode(data + position, labelEnd - position);
+      if (labelLength < 0)
+      {
+         return OtpAuthError::InvalidEncoding;
+      }
+
+      label = QByteArrayView(data + position, labelLength);
+      position = labelEnd;
+   }
+
+   // Parameters are split on the raw text, so escaped '&' and '=' in values are kept. Every value is
+   // decoded in place and validated once all parameters are known.
+   QByteArrayView issuer;
+   QByteArrayView secret;
+   QByteArrayView algorithm;
+   QByteArrayView digits;
+   QByteArrayView period;
+   QByteArrayView counter;
+   bool hasCounter = false;
+
+   while (position < length)
+   {
+      ++position;
+      qsizetype parameterEnd = position;
+      while (parameterEnd < length && data[parameterEnd] != '&')
+      {
+         ++parameterEnd;
+      }
+
+      qsizetype nameEnd = position;
+      while (nameEnd < parameterEnd && data[nameEnd] != '=')
+      {
+         ++nameEnd;
+      }
+
+      const QByteArrayView name(data + position, nameEnd - position);
+      char *value = data + std::min(nameEnd + 1, parameterEnd);
+      const qsizetype valueLength = percent_decode(value, data + parameterEnd - value);
+      if (valueLength < 0)
+      {
+         return OtpAuthError::InvalidEncoding;
+      }
+
+      const QByteArrayView text(value, valueLength);
+      if (equals(name, "secret"))
+      {
+         secret = text;
+      }
+      else if (equals(name, "issuer"))
+      {
+         issuer = text;
+      }
+      else if (equals(name, "algorithm"))
+      {
+         algorithm = text;
+      }
+      else if (equals(name, "digits"))
+      {
+         digits = text;
+      }
+      else if (equals(name, "period"))
+      {
+         period = text;
+      }
+      else if (equals(name, "counter"))
+      {
+         counter = text;
+         hasCounter = true;
+      }
+
+      position = parameterEnd;
+   }
+
+   // The label is "account" or "issuer:account", where the separator may be percent-encoded and
+   // the account may be preceded by spaces. An issuer parameter that prefixes the label wins over the
+   // first ':', so issuers containing a ':' survive.
+   qsizetype separator = -1;
+   if (!issuer.isEmpty() && label.size() > issuer.size() && label.startsWith(issuer) && label[issuer.size()] == ':')
+   {
+      separator = issuer.size();
+   }
+   else
+   {
+      separator = label.indexOf(':');
+   }
+
+   if (separator >= 0)
+   {
+      result.issuer = label.first(separator);
+      label = label.sliced(separator + 1);
+   }
+
+   while (!label.isEmpty() && label.front() == ' ')
+   {
+      label = label.sliced(1);
+   }
+   result.account = label;
+
+   if (!issuer.isEmpty())
+   {
+      result.issuer = issuer;
+   }
+
+   if (secret.isEmpty())
+   {
+      return OtpAuthError::MissingSecret;
+   }
+
+   // The decoded secret is shorter than its encoding and overwrites it
+   char *secretData = const_cast<char *>(secret.data());
+   const Base32DecodeResult decoded = base32_decode(secret, std::span<char>(secretData, static_cast<std::size_t>(secret.size())));
+   if (!decoded.isValid() || decoded.size == 0)
+   {
+      return OtpAuthError::InvalidSecret;
+   }
+   result.secret = QByteArrayView(secretData, decoded.size);
+
+   if (!algorithm.isEmpty() && !parse_algorithm(algorithm, result.algorithm))
+   {
+      return OtpAuthError::InvalidAlgorithm;
+   }
+
+   if (!digits.isEmpty())
+   {
+      quint64 value = 0;
+      if (!parse_number(digits, digitMaximum, value) || value < digitMinimum)
+      {
+         return OtpAuthError::InvalidDigits;
+      }
+      result.digits = static_cast<unsigned int>(value);
+   }
+   else if (result.digits < digitMinimum || result.digits > digitMaximum)
+   {
+      return OtpAuthError::InvalidDigits;
+   }
+
+   if (!period.isEmpty())
+   {
+      quint64 value = 0;
+      if (!parse_number(period, 0xffffffffu, value) || value == 0)
+      {
+         return OtpAuthError::InvalidPeriod;
+      }
+      result.period = static_cast<unsigned int>(value);
+   }
+
+   if (result.type == OtpType::Hotp || hasCounter)
+   {
+      if (!parse_number(counter, ~quint64(0), result.counter))
+      {
+         return OtpAuthError::InvalidCounter;
+      }
+   }
+
+   return OtpAuthError::None;
+}
+
+// Refer to the detailed documentation in otpauth.h for complete information about this function.
+qsizetype libqotp::write_otpauth_uri(const OtpAuthUri &uri, QByteArray &buffer)
+{
+   const char *algorithm = algorithm_name(uri.algorithm);
+   if (uri.secret.isEmpty() || !algorithm)
+   {
+      return -1;
+   }
+
+   // Grow once for the longest possible URI, then cut back to what was written
+   const qsizetype maximum = scheme_length + 5 + 6 * uri.issuer.size() + 1 + 3 * uri.account.size()
+                             + 8 + base32_encoded_size(uri.secret.size(), Base32Option::OmitPadding)
+                             + 8 + 17 + 8 + 20 + 8 + 20 + 9 + 20;
+
+   const qsizetype start = buffer.size();
+   buffer.resize(start + maximum);
+
+   char *begin = buffer.data() + start;
+   char *output = write_text(scheme, begin);
+   output = write_text(uri.type == OtpType::Hotp ? "hotp/" : "totp/", output);
+
+   if (!uri.issuer.isEmpty())
+   {
+      output = write_encoded(uri.issuer, output);
+      *output++ = ':';
+   }
+   output = write_encoded(uri.account, output);
+
+   output = write_text("?secret=", output);
+   output += base32_encode(uri.secret, std::span<char>(output, buffer.data() + buffer.size()), Base32Option::OmitPadding);
+
+   if (!uri.issuer.isEmpty())
+   {
+      output = write_text("&issuer=", output);
+      output = write_encoded(uri.issuer, output);
+   }
+
+   if (uri.algorithm != QCryptographicHash::Sha1)
+   {
+      output = write_text("&algorithm=", output);
+      output = write_text(algorithm, output);
+   }
+
+   if (uri.digits != 6)
+   {
+      output = write_text("&digits=", output);
+      output = write_number(uri.digits, output);
+   }
+
+   if (uri.type == OtpType::Hotp)
+   {
+      output = write_text("&counter=", output);
+      output = write_number(uri.counter, output);
+   }
+   else if (uri.period != 30)
+   {
+      output = write_text("&period=", output);
+      output = write_number(uri.period, output);
+   }
+
+   const qsizetype written = output - begin;
+   buffer.resize(start + written);
+   return written;
+}
+
+libqotp::OtpAuthReader::OtpAuthReader(
+    QIODevice *device,
+    qsizetype bufferSize,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+   : m_device(device)
+   , m_buffer(std::max<qsizetype>(bufferSize, 1), Qt::Uninitialized)
+   , m_digitMinimum(digitMinimum)
+   , m_digitMaximum(digitMaximum)
+{
+}
+
+libqotp::OtpAuthReader::~OtpAuthReader()
+{
+   // The buffer holds secrets, encoded and decoded
+   detail::secure_zero(m_buffer.data(), static_cast<std::size_t>(m_buffer.size()));
+}
+
+bool libqotp::OtpAuthReader::readNext()
+{
+   m_error = OtpAuthError::None;
+   m_uri = OtpAuthUri();
+
+   if (!m_device)
+   {
+      return false;
+   }
+
+   for (;;)
+   {
+      char *data = m_buffer.data();
+      const char *newline = static_cast<const char *>(std::memchr(data + m_begin, '\n', static_cast<std::size_t>(m_end - m_begin)));
+
+      if (!newline && !m_eof)
+      {
+         // Move the incomplete line to the front and read more
+         if (m_begin > 0)
+         {
+            std::memmove(data, data + m_begin, static_cast<std::size_t>(m_end - m_begin));
+            m_end -= m_begin;
+            m_begin = 0;
+         }
+
+         if (m_end == m_buffer.size())
+         {
+            // A full buffer without a line break: the line is reported once and dropped up to its end
+            m_end = 0;
+            if (!m_skipping)
+            {
+               m_skipping = true;
+               ++m_lineNumber;
+               m_error = OtpAuthError::LineTooLong;
+               return true;
+            }
+         }
+
+         const qint64 read = m_device->read(data + m_end, m_buffer.size() - m_end);
+         if (read < 0)
+         {
+            return false;
+         }
+
+         if (read == 0 && (!m_device->isSequential() || !m_device->waitForReadyRead(-1)))
+         {
+            m_eof = true;
+         }
+
+         m_end += read;
+         continue;
+      }
+
+      if (!newline && m_begin == m_end)
+      {
+         m_atEnd = true;
+         return false;
+      }
+
+      // A line up to the line break, or the last line of the input without one
+      qsizetype lineBegin = m_begin;
+      qsizetype lineEnd = newline ? newline - data : m_end;
+      m_begin = newline ? lineEnd + 1 : lineEnd;
+
+      if (m_skipping)
+      {
+         // The remainder of an overlong line
+         m_skipping = false;
+         continue;
+      }
+      ++m_lineNumber;
+
+      while (lineBegin < lineEnd && is_space(data[lineBegin]))
+      {
+         ++lineBegin;
+      }
+      while (lineEnd > lineBegin && is_space(data[lineEnd - 1]))
+      {
+         --lineEnd;
+      }
+
+      if (lineBegin == lineEnd || data[lineBegin] == '#')
+      {
+         continue;
+      }
+
+      m_error = parse_otpauth_uri(std::span<char>(data + lineBegin, static_cast<std::size_t>(lineEnd - lineBegin)), m_uri, m_digitMinimum, m_digitMaximum);
+      return true;
+   }
+}
+
+libqotp::OtpKey libqotp::OtpAuthReader::key() const
+{
+   if (m_error != OtpAuthError::None)
+   {
+      return OtpKey();
+   }
+   return OtpKey(m_uri.secret, m_uri.algorithm);
+}
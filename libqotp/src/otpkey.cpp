@@ -0,0 +1,31 @@
+#include <libqotp/otpkey.h>
+
+// Refer to the detailed documentation in otpkey.h for complete information about this function.
+libqotp::OtpKey::OtpKey(QByteArrayView secret, QCryptographicHash::Algorithm algorithm)
+    : m_algorithm(algorithm)
+{
+   // Unsupported algorithms leave the key invalid
+   if (const auto coreAlgorithm = detail::core_algorithm(algorithm))
+   {
+      m_key = core::Key(std::as_bytes(std::span(secret.data(), static_cast<std::size_t>(secret.size()))), *coreAlgorithm);
+   }
+}
+
+// Refer to the detailed documentation in otpkey.h for complete information about this function.
+int libqotp::OtpKey::hashLength() const
+{
+   return static_cast<int>(m_key.hashLength());
+}
+
+// Refer to the detailed documentation in otpkey.h for complete information about this function.
+int libqotp::OtpKey::hmac(QByteArrayView message, char *digest) const
+{
+   const std::span<const std::byte> messageBytes = std::as_bytes(std::span(message.data(), static_cast<std::size_t>(message.size())));
+   return static_cast<int>(m_key.hmac(messageBytes, std::as_writable_bytes(std::span(digest, m_key.hashLength()))));
+}
+
+// Refer to the detailed documentation in otpkey.h for complete information about this function.
+void libqotp::OtpKey::clear()
+{
+   m_key.clear();
+}
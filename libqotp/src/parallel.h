@@ -0,0 +1,71 @@
+#ifndef LIBQOTP_PARALLEL_H_20261018
+#define LIBQOTP_PARALLEL_H_20261018
+
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstddef>
+
+// Splits an index range across a thread pool.
+//
+// The range is cut into one contiguous part per thread, so every index is handled by exactly one call and
+// results written by index do not depend on scheduling. The calling thread computes the first part and any
+// part the pool does not accept right away, then waits for the rest. Nothing is queued behind a busy pool,
+// which also makes it safe to call from a pool thread.
+namespace libqotp::detail
+{
+   /**
+    * Calls 'function(begin, end)' for consecutive parts of [0, count).
+    *
+    * @param maxThreads Upper bound on the number of threads including the caller, 0 for the pool size.
+    * @param minimumPerThread Parts are never smaller than this, except for the last one.
+    */
+   template <typename Function>
+   void parallel_for(std::size_t count, QThreadPool *pool, int maxThreads, std::size_t minimumPerThread, Function function)
+   {
+      if (count == 0)
+      {
+         return;
+      }
+
+      if (!pool)
+      {
+         pool = QThreadPool::globalInstance();
+      }
+
+      std::size_t threads = static_cast<std::size_t>(maxThreads > 0 ? maxThreads : std::max(pool->maxThreadCount(), 1));
+      minimumPerThread = std::max<std::size_t>(minimumPerThread, 1);
+      threads = std::min(threads, (count + minimumPerThread - 1) / minimumPerThread);
+      threads = std::max<std::size_t>(threads, 1);
+
+      const std::size_t part = (count + threads - 1) / threads;
+
+      QSemaphore finished;
+      int started = 0;
+
+      for (std::size_t begin = part; begin < count; begin += part)
+      {
+         const std::size_t end = std::min(count, begin + part);
+         const bool accepted = pool->tryStart([&function, &finished, begin, end]()
+         {
+            function(begin, end);
+            finished.release();
+         });
+
+         if (accepted)
+         {
+            ++started;
+         }
+         else
+         {
+            function(begin, end);
+         }
+      }
+
+      function(std::size_t(0), std::min(count, part));
+      finished.acquire(started);
+   }
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include <libqotp/replaystore.h>
+
+#include <QHashFunctions>
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+namespace
+{
+   constexpr quint64 counter_mask = 0xffffffffu;
+
+   // The number of buckets searched for a user before the store gives up
+   constexpr qsizetype probe_buckets = 4;
+
+   // 64 bits of seeded hash. On platforms with a 32-bit size_t two differently seeded hashes are combined.
+   quint64 hash_of(QByteArrayView userId, size_t seed)
+   {
+      if constexpr (sizeof(size_t) >= sizeof(quint64))
+      {
+         return qHash(userId, seed);
+      }
+      else
+      {
+         return (quint64(qHash(userId, seed)) << 32) | qHash(userId, ~seed);
+      }
+   }
+}
+
+libqotp::ReplayStore::ReplayStore(qsizetype capacity, unsigned int timeStep, quint64 epoch, unsigned int window)
+   : m_seed(static_cast<size_t>(QRandomGenerator::system()->generate64()))
+   , m_timeStep(timeStep)
+   , m_epoch(epoch)
+   , m_window(window)
+{
+   const qsizetype buckets = std::max<qsizetype>((capacity + bucket_size - 1) / bucket_size, 1);
+
+   m_bucketCount = 1;
+   while (m_bucketCount < buckets)
+   {
+      m_bucketCount *= 2;
+   }
+
+   m_buckets.reset(new Bucket[static_cast<std::size_t>(m_bucketCount)]);
+}
+
+libqotp::ReplayStore::~ReplayStore() = default;
+
+libqotp::ReplayResult libqotp::ReplayStore::accept(QByteArrayView userId, quint64 counter, quint64 currentUnixTime)
+{
+   return record(hash_of(userId, m_seed), counter, currentUnixTime);
+}
+
+libqotp::ReplayResult libqotp::ReplayStore::accept(quint64 userId, quint64 counter, quint64 currentUnixTime)
+{
+   return record(hash_of(QByteArrayView(reinterpret_cast<const char *>(&userId), sizeof(userId)), m_seed), counter, currentUnixTime);
+}
+
+libqotp::ReplayResult libqotp::ReplayStore::record(quint64 hash, quint64 counter, quint64 currentUnixTime)
+{
+   if (counter > counter_mask)
+   {
+      return ReplayResult::Unavailable;
+   }
+
+   // Time steps that left the window can no longer be verified, so recording one of them is refused.
+   // Their entries are reused one time step later, so a caller whose clock is slightly behind still
+   // finds the entry of a step it would accept.
+   const bool expires = m_timeStep != 0;
+   quint64 expired = 0;
+   if (expires)
+   {
+      const quint64 current = (currentUnixTime - m_epoch) / m_timeStep;
+      const quint64 oldest = current > m_window ? current - m_window : 0;
+      if (counter < oldest)
+      {
+         return ReplayResult::Replayed;
+      }
+      expired = oldest > 0 ? oldest - 1 : 0;
+   }
+
+   // The high half of the hash tags the entry, the low half selects the first bucket. A tag is never
+   // zero, so an entry of zero is empty.
+   const quint64 tag = std::max<quint64>(hash >> 32, 1);
+   const quint64 wanted = (tag << 32) | counter;
+   const qsizetype first = static_cast<qsizetype>(hash & static_cast<quint64>(m_bucketCount - 1));
+   const qsizetype probes = std::min(probe_buckets, m_bucketCount);
+
+   // Entries are visited in the same order by every thread. Entries are never emptied again, so an empty
+   // entry ends the search: the user cannot have an entry behind it.
+   const auto visit = [&](auto function) {
+      for (qsizetype i = 0; i < probes; ++i)
+      {
+         Bucket &bucket = m_buckets[(first + i) & (m_bucketCount - 1)];
+         for (std::atomic<quint64> &entry : bucket.entries)
+         {
+            if (!function(entry))
+            {
+               return;
+            }
+         }
+      }
+   };
+
+   for (;;)
+   {
+      // The user's entry, or else the first entry that is empty or expired
+      std::atomic<quint64> *own = nullptr;
+      std::atomic<quint64> *reusable = nullptr;
+      quint64 expected = 0;
+
+      visit([&](std::atomic<quint64> &entry) {
+         const quint64 value = entry.load();
+         if ((value >> 32) == tag)
+         {
+            own = &entry;
+            expected = value;
+            return false;
+         }
+
+         if (!reusable && (value == 0 || (expires && (value & counter_mask) < expired)))
+         {
+            reusable = &entry;
+            expected = value;
+         }
+         return value != 0;
+      });
+
+      std::atomic<quint64> *target = own ? own : reusable;
+      if (!target)
+      {
+         // Fail closed
+         return ReplayResult::Unavailable;
+      }
+
+      if (own && (expected & counter_mask) >= counter)
+      {
+         return ReplayResult::Replayed;
+      }
+
+      if (!target->compare_exchange_strong(expected, wanted))
+      {
+         // Another thread changed the entry first
+         continue;
+      }
+
+      // Two threads that did not see each other's entry may have written the same user to different
+      // entries. Both writes precede both of these sequentially consistent searches, so at least one of
+      // the threads sees the other entry and backs off.
+      bool replayed = false;
+      visit([&](std::atomic<quint64> &entry) {
+         const quint64 value = entry.load();
+         if (&entry != target && (value >> 32) == tag && (value & counter_mask) >= counter)
+         {
+            replayed = true;
+            return false;
+         }
+         return value != 0;
+      });
+
+      return replayed ? ReplayResult::Replayed : ReplayResult::Accepted;
+   }
+}
+
+// Refer to the detailed documentation in replaystore.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    ReplayStore &store,
+    QByteArrayView userId,
+    const OtpKey &key,
+    quint32 code,
+    quint64 currentUnixTime,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   if (store.timeStep() == 0)
+   {
+      return std::nullopt;
+   }
+
+   const std::optional<int> offset = libqotp::totp_verify(key, code, currentUnixTime, store.window(), store.timeStep(), store.epoch(), digits, digitMinimum, digitMaximum);
+   if (!offset)
+   {
+      return std::nullopt;
+   }
+
+   const quint64 counter = (currentUnixTime - store.epoch()) / store.timeStep() + static_cast<quint64>(static_cast<qint64>(*offset));
+   if (store.accept(userId, counter, currentUnixTime) != ReplayResult::Accepted)
+   {
+      return std::nullopt;
+   }
+
+   return offset;
+}
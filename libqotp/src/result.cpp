@@ -0,0 +1,33 @@
+#include <libqotp/result.h>
+
+// Refer to the detailed documentation in result.h for complete information about this function.
+const char *libqotp::otp_error_name(OtpError error)
+{
+   switch (error)
+   {
+   case OtpError::None:
+      return "None";
+   case OtpError::EmptySecret:
+      return "EmptySecret";
+   case OtpError::UnsupportedAlgorithm:
+      return "UnsupportedAlgorithm";
+   case OtpError::InvalidKey:
+      return "InvalidKey";
+   case OtpError::InvalidDigits:
+      return "InvalidDigits";
+   case OtpError::InvalidTimeStep:
+      return "InvalidTimeStep";
+   case OtpError::InvalidWindow:
+      return "InvalidWindow";
+   case OtpError::MalformedCode:
+      return "MalformedCode";
+   case OtpError::InvalidBase32Character:
+      return "InvalidBase32Character";
+   case OtpError::Base32CharacterAfterPadding:
+      return "Base32CharacterAfterPadding";
+   case OtpError::OutputTooSmall:
+      return "OutputTooSmall";
+   }
+
+   return "Unknown";
+}
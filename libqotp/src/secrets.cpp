@@ -0,0 +1,131 @@
+#include <libqotp/secrets.h>
+
+#include "sha.h"
+
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace
+{
+   // Fills 'data' with random bytes from the system generator. QRandomGenerator produces 32-bit words,
+   // which are staged in a small stack buffer so the arena itself needs no particular alignment.
+   void fill_random(char *data, qsizetype length)
+   {
+      quint32 words[256];
+
+      while (length > 0)
+      {
+         const qsizetype bytes = std::min<qsizetype>(length, sizeof(words));
+         const qsizetype count = (bytes + 3) / 4;
+         QRandomGenerator::system()->fillRange(words, count);
+         std::memcpy(data, words, static_cast<std::size_t>(bytes));
+
+         data += bytes;
+         length -= bytes;
+      }
+
+      libqotp::detail::secure_zero(words, sizeof(words));
+   }
+
+   void wipe(QByteArray &data)
+   {
+      if (!data.isEmpty())
+      {
+         libqotp::detail::secure_zero(data.data(), static_cast<std::size_t>(data.size()));
+      }
+      data.clear();
+   }
+}
+
+libqotp::SecretBatch::SecretBatch(SecretBatch &&other) noexcept
+   : m_secrets(std::move(other.m_secrets))
+   , m_encoded(std::move(other.m_encoded))
+   , m_count(std::exchange(other.m_count, 0))
+   , m_secretLength(std::exchange(other.m_secretLength, 0))
+   , m_encodedLength(std::exchange(other.m_encodedLength, 0))
+{
+}
+
+libqotp::SecretBatch &libqotp::SecretBatch::operator=(SecretBatch &&other) noexcept
+{
+   if (this != &other)
+   {
+      clear();
+      m_secrets = std::move(other.m_secrets);
+      m_encoded = std::move(other.m_encoded);
+      m_count = std::exchange(other.m_count, 0);
+      m_secretLength = std::exchange(other.m_secretLength, 0);
+      m_encodedLength = std::exchange(other.m_encodedLength, 0);
+   }
+   return *this;
+}
+
+libqotp::SecretBatch::~SecretBatch()
+{
+   clear();
+}
+
+QByteArrayView libqotp::SecretBatch::secret(qsizetype index) const
+{
+   return QByteArrayView(m_secrets.constData() + index * m_secretLength, m_secretLength);
+}
+
+QLatin1StringView libqotp::SecretBatch::encodedSecret(qsizetype index) const
+{
+   return QLatin1StringView(m_encoded.constData() + index * m_encodedLength, m_encodedLength);
+}
+
+void libqotp::SecretBatch::clear()
+{
+   wipe(m_secrets);
+   wipe(m_encoded);
+   m_count = 0;
+   m_secretLength = 0;
+   m_encodedLength = 0;
+}
+
+// Refer to the detailed documentation in secrets.h for complete information about this function.
+libqotp::SecretBatch libqotp::generate_secrets(
+    qsizetype count,
+    qsizetype secretLength,
+    Base32Options options)
+{
+   SecretBatch batch;
+
+   // Input validation
+   if (count <= 0 || secretLength <= 0)
+   {
+      return batch;
+   }
+
+   const qsizetype encodedLength = base32_encoded_size(secretLength, options);
+   if (count > std::numeric_limits<qsizetype>::max() / encodedLength)
+   {
+      // The arenas would not be addressable
+      return batch;
+   }
+
+   batch.m_secrets = QByteArray(count * secretLength, Qt::Uninitialized);
+   batch.m_encoded = QByteArray(count * encodedLength, Qt::Uninitialized);
+   batch.m_count = count;
+   batch.m_secretLength = secretLength;
+   batch.m_encodedLength = encodedLength;
+
+   fill_random(batch.m_secrets.data(), batch.m_secrets.size());
+
+   // One pass over the arena, every secret is encoded into its fixed slot
+   const char *secret = batch.m_secrets.constData();
+   char *encoded = batch.m_encoded.data();
+   for (qsizetype i = 0; i < count; ++i)
+   {
+      base32_encode(QByteArrayView(secret, secretLength), std::span<char>(encoded, encodedLength), options);
+      secret += secretLength;
+      encoded += encodedLength;
+   }
+
+   return batch;
+}
@@ -0,0 +1,362 @@
+#include "sha.h"
+#include "sha_backend.h"
+
+#include <cstring>
+
+namespace
+{
+   inline std::uint32_t rotl32(std::uint32_t value, int bits)
+   {
+      return (value << bits) | (value >> (32 - bits));
+   }
+
+   inline std::uint32_t rotr32(std::uint32_t value, int bits)
+   {
+      return (value >> bits) | (value << (32 - bits));
+   }
+
+   inline std::uint64_t rotr64(std::uint64_t value, int bits)
+   {
+      return (value >> bits) | (value << (64 - bits));
+   }
+
+   inline std::uint32_t load_be32(const std::uint8_t *data)
+   {
+      return (static_cast<std::uint32_t>(data[0]) << 24) |
+             (static_cast<std::uint32_t>(data[1]) << 16) |
+             (static_cast<std::uint32_t>(data[2]) << 8) |
+             (static_cast<std::uint32_t>(data[3]));
+   }
+
+   inline std::uint64_t load_be64(const std::uint8_t *data)
+   {
+      return (static_cast<std::uint64_t>(load_be32(data)) << 32) | load_be32(data + 4);
+   }
+
+   inline void store_be32(std::uint8_t *data, std::uint32_t value)
+   {
+      data[0] = static_cast<std::uint8_t>(value >> 24);
+      data[1] = static_cast<std::uint8_t>(value >> 16);
+      data[2] = static_cast<std::uint8_t>(value >> 8);
+      data[3] = static_cast<std::uint8_t>(value);
+   }
+
+   inline void store_be64(std::uint8_t *data, std::uint64_t value)
+   {
+      store_be32(data, static_cast<std::uint32_t>(value >> 32));
+      store_be32(data + 4, static_cast<std::uint32_t>(value));
+   }
+
+   // Shared Merkle-Damgard tail: absorbs full blocks, then pads with 0x80, zeros and the big-endian bit length.
+   template <typename Word, std::size_t BlockSize, std::size_t LengthSize, typename Compress>
+   void finish_blocks(Word *state, const std::uint8_t *data, std::size_t length, std::uint64_t processed, Compress compress)
+   {
+      const std::uint64_t totalBits = (processed + length) * 8;
+
+      const std::size_t fullBlocks = length / BlockSize;
+      if (fullBlocks > 0)
+      {
+         compress(state, data, fullBlocks);
+         data += fullBlocks * BlockSize;
+         length -= fullBlocks * BlockSize;
+      }
+
+      std::uint8_t tail[BlockSize * 2] = {};
+      if (length > 0)
+      {
+         std::memcpy(tail, data, length);
+      }
+      tail[length] = 0x80;
+
+      const std::size_t tailBlocks = (length + 1 + LengthSize > BlockSize) ? 2 : 1;
+      store_be64(tail + tailBlocks * BlockSize - 8, totalBits);
+      compress(state, tail, tailBlocks);
+
+      libqotp::detail::secure_zero(tail, sizeof(tail));
+   }
+}
+
+const std::uint32_t libqotp::detail::sha1_initial[5] = {
+   0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+const std::uint32_t libqotp::detail::sha256_initial[8] = {
+   0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const std::uint64_t libqotp::detail::sha512_initial[8] = {
+   0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+   0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+};
+
+const std::uint32_t libqotp::detail::sha256_round_constants[64] = {
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const std::uint64_t libqotp::detail::sha512_round_constants[80] = {
+   0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+   0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+   0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+   0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+   0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+   0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+   0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+   0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+   0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+   0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+   0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+   0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+   0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+   0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+   0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+   0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+};
+
+void libqotp::detail::sha1_compress_generic(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks)
+{
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      std::uint32_t w[80];
+      for (int i = 0; i < 16; ++i)
+      {
+         w[i] = load_be32(data + i * 4);
+      }
+      for (int i = 16; i < 80; ++i)
+      {
+         w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+      }
+
+      std::uint32_t a = state[0];
+      std::uint32_t b = state[1];
+      std::uint32_t c = state[2];
+      std::uint32_t d = state[3];
+      std::uint32_t e = state[4];
+
+      for (int i = 0; i < 80; ++i)
+      {
+         std::uint32_t f;
+         std::uint32_t k;
+         if (i < 20)
+         {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+         }
+         else if (i < 40)
+         {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+         }
+         else if (i < 60)
+         {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+         }
+         else
+         {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+         }
+
+         const std::uint32_t temp = rotl32(a, 5) + f + e + k + w[i];
+         e = d;
+         d = c;
+         c = rotl32(b, 30);
+         b = a;
+         a = temp;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+   }
+}
+
+void libqotp::detail::sha256_compress_generic(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      std::uint32_t w[64];
+      for (int i = 0; i < 16; ++i)
+      {
+         w[i] = load_be32(data + i * 4);
+      }
+      for (int i = 16; i < 64; ++i)
+      {
+         const std::uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+         const std::uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+         w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      std::uint32_t a = state[0];
+      std::uint32_t b = state[1];
+      std::uint32_t c = state[2];
+      std::uint32_t d = state[3];
+      std::uint32_t e = state[4];
+      std::uint32_t f = state[5];
+      std::uint32_t g = state[6];
+      std::uint32_t h = state[7];
+
+      for (int i = 0; i < 64; ++i)
+      {
+         const std::uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+         const std::uint32_t ch = (e & f) ^ (~e & g);
+         const std::uint32_t temp1 = h + s1 + ch + libqotp::detail::sha256_round_constants[i] + w[i];
+         const std::uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+         const std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+         const std::uint32_t temp2 = s0 + maj;
+
+         h = g;
+         g = f;
+         f = e;
+         e = d + temp1;
+         d = c;
+         c = b;
+         b = a;
+         a = temp1 + temp2;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+      state[5] += f;
+      state[6] += g;
+      state[7] += h;
+   }
+}
+
+void libqotp::detail::sha512_compress_generic(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   for (; blocks > 0; --blocks, data += 128)
+   {
+      std::uint64_t w[80];
+      for (int i = 0; i < 16; ++i)
+      {
+         w[i] = load_be64(data + i * 8);
+      }
+      for (int i = 16; i < 80; ++i)
+      {
+         const std::uint64_t s0 = rotr64(w[i - 15], 1) ^ rotr64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+         const std::uint64_t s1 = rotr64(w[i - 2], 19) ^ rotr64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+         w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      std::uint64_t a = state[0];
+      std::uint64_t b = state[1];
+      std::uint64_t c = state[2];
+      std::uint64_t d = state[3];
+      std::uint64_t e = state[4];
+      std::uint64_t f = state[5];
+      std::uint64_t g = state[6];
+      std::uint64_t h = state[7];
+
+      for (int i = 0; i < 80; ++i)
+      {
+         const std::uint64_t s1 = rotr64(e, 14) ^ rotr64(e, 18) ^ rotr64(e, 41);
+         const std::uint64_t ch = (e & f) ^ (~e & g);
+         const std::uint64_t temp1 = h + s1 + ch + libqotp::detail::sha512_round_constants[i] + w[i];
+         const std::uint64_t s0 = rotr64(a, 28) ^ rotr64(a, 34) ^ rotr64(a, 39);
+         const std::uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+         const std::uint64_t temp2 = s0 + maj;
+
+         h = g;
+         g = f;
+         f = e;
+         e = d + temp1;
+         d = c;
+         c = b;
+         b = a;
+         a = temp1 + temp2;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+      state[5] += f;
+      state[6] += g;
+      state[7] += h;
+   }
+}
+
+void libqotp::detail::sha1_finish(std::uint32_t state[5], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[20])
+{
+   sha1_finish(active_sha_functions(), state, data, length, processed, digest);
+}
+
+void libqotp::detail::sha256_finish(std::uint32_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[32])
+{
+   sha256_finish(active_sha_functions(), state, data, length, processed, digest);
+}
+
+void libqotp::detail::sha512_finish(std::uint64_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[64])
+{
+   sha512_finish(active_sha_functions(), state, data, length, processed, digest);
+}
+
+void libqotp::detail::sha1_finish(const ShaFunctions &functions, std::uint32_t state[5], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[20])
+{
+   finish_blocks<std::uint32_t, 64, 8>(state, data, length, processed, functions.sha1);
+
+   for (int i = 0; i < 5; ++i)
+   {
+      store_be32(digest + i * 4, state[i]);
+   }
+}
+
+void libqotp::detail::sha256_finish(const ShaFunctions &functions, std::uint32_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[32])
+{
+   finish_blocks<std::uint32_t, 64, 8>(state, data, length, processed, functions.sha256);
+
+   for (int i = 0; i < 8; ++i)
+   {
+      store_be32(digest + i * 4, state[i]);
+   }
+}
+
+void libqotp::detail::sha512_finish(const ShaFunctions &functions, std::uint64_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[64])
+{
+   // SHA-512 uses a 128-bit length field. Messages handled here never exceed 2^64 bits,
+   // so the upper half of the field stays zero.
+   finish_blocks<std::uint64_t, 128, 16>(state, data, length, processed, functions.sha512);
+
+   for (int i = 0; i < 8; ++i)
+   {
+      store_be64(digest + i * 8, state[i]);
+   }
+}
+
+void libqotp::detail::sha1_compress(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks)
+{
+   active_sha_functions().sha1(state, data, blocks);
+}
+
+void libqotp::detail::sha256_compress(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   active_sha_functions().sha256(state, data, blocks);
+}
+
+void libqotp::detail::sha512_compress(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   active_sha_functions().sha512(state, data, blocks);
+}
+
+void libqotp::detail::secure_zero(void *data, std::size_t length)
+{
+   volatile std::uint8_t *bytes = static_cast<volatile std::uint8_t *>(data);
+   while (length--)
+   {
+      *bytes++ = 0;
+   }
+}
@@ -0,0 +1,70 @@
+#ifndef LIBQOTP_SHA_H_20261018
+#define LIBQOTP_SHA_H_20261018
+
+#include <cstddef>
+#include <cstdint>
+
+// Internal SHA-1/SHA-256/SHA-512 primitives (FIPS 180-4).
+//
+// QCryptographicHash does not expose the chaining state of a hash, which is exactly what is needed to cache
+// the HMAC inner and outer pad computation of a key. These functions operate on the raw chaining state so
+// that a key can be absorbed once and every following HMAC only pays for the message blocks.
+namespace libqotp::detail
+{
+   // Initial hash values as defined by FIPS 180-4.
+   extern const std::uint32_t sha1_initial[5];
+   extern const std::uint32_t sha256_initial[8];
+   extern const std::uint64_t sha512_initial[8];
+
+   // Round constants, shared with the multi-buffer kernels.
+   extern const std::uint32_t sha256_round_constants[64];
+   extern const std::uint64_t sha512_round_constants[80];
+
+   // The block functions of one SHA implementation (see sha_backend.h).
+   struct ShaFunctions
+   {
+      void (*sha1)(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks);
+      void (*sha256)(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks);
+      void (*sha512)(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks);
+   };
+
+   /**
+    * Processes 'blocks' consecutive message blocks (64 bytes for SHA-1/SHA-256, 128 bytes for SHA-512)
+    * and updates the chaining state in place, using the active HMAC backend.
+    */
+   void sha1_compress(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks);
+   void sha256_compress(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks);
+   void sha512_compress(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks);
+
+   /**
+    * The portable implementation of the block functions, which every other backend is checked against.
+    */
+   void sha1_compress_generic(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks);
+   void sha256_compress_generic(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks);
+   void sha512_compress_generic(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks);
+
+   /**
+    * Absorbs the remaining 'length' bytes of a message, applies the final padding and writes the digest.
+    *
+    * 'processed' is the number of bytes that were already compressed into 'state' and must be a multiple
+    * of the block size. The state is consumed by this call.
+    */
+   void sha1_finish(std::uint32_t state[5], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[20]);
+   void sha256_finish(std::uint32_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[32]);
+   void sha512_finish(std::uint64_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[64]);
+
+   /**
+    * Same as above, but with the block functions of a given backend instead of the active one.
+    */
+   void sha1_finish(const ShaFunctions &functions, std::uint32_t state[5], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[20]);
+   void sha256_finish(const ShaFunctions &functions, std::uint32_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[32]);
+   void sha512_finish(const ShaFunctions &functions, std::uint64_t state[8], const std::uint8_t *data, std::size_t length, std::uint64_t processed, std::uint8_t digest[64]);
+
+   /**
+    * Overwrites memory in a way the compiler is not allowed to optimize away.
+    * Used to wipe key material from temporary buffers.
+    */
+   void secure_zero(void *data, std::size_t length);
+}
+
+#endif
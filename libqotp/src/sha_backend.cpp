@@ -0,0 +1,318 @@
+#include <libqotp/core/hmacbackend.h>
+
+#include "cpu.h"
+#include "multibuffer.h"
+#include "sha_backend.h"
+#include "truncate.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+   using libqotp::core::HmacBackend;
+   using libqotp::detail::HashKind;
+   using libqotp::detail::ShaFunctions;
+
+   constexpr ShaFunctions generic_functions = {
+      libqotp::detail::sha1_compress_generic,
+      libqotp::detail::sha256_compress_generic,
+      libqotp::detail::sha512_compress_generic,
+   };
+
+#if defined(QOTP_ARCH_X86)
+   constexpr ShaFunctions shani_functions = {
+      libqotp::detail::sha1_compress_shani,
+      libqotp::detail::sha256_compress_shani,
+      libqotp::detail::sha512_compress_generic,
+   };
+#endif
+
+#if defined(QOTP_WITH_OPENSSL)
+   constexpr ShaFunctions openssl_functions = {
+      libqotp::detail::sha1_compress_openssl,
+      libqotp::detail::sha256_compress_openssl,
+      libqotp::detail::sha512_compress_openssl,
+   };
+#endif
+
+   // The block functions of a backend, or nullptr if it was not compiled in or the CPU does not support it.
+   const ShaFunctions *supported_functions(HmacBackend backend)
+   {
+      switch (backend)
+      {
+      case HmacBackend::Generic:
+         return &generic_functions;
+      case HmacBackend::ShaNi:
+#if defined(QOTP_ARCH_X86)
+      {
+         const libqotp::detail::CpuFeatures &features = libqotp::detail::cpu_features();
+         if (features.sha && features.sse41)
+         {
+            return &shani_functions;
+         }
+      }
+#endif
+         return nullptr;
+      case HmacBackend::OpenSsl:
+#if defined(QOTP_WITH_OPENSSL)
+         return &openssl_functions;
+#else
+         return nullptr;
+#endif
+      }
+      return nullptr;
+   }
+
+   struct TestVector
+   {
+      HashKind kind;
+      const char *secret;
+      std::uint64_t counter;
+      unsigned int digits;
+      std::uint32_t code;
+   };
+
+   constexpr const char *sha1_secret = "12345678901234567890";
+   constexpr const char *sha256_secret = "12345678901234567890123456789012";
+   constexpr const char *sha512_secret = "1234567890123456789012345678901234567890123456789012345678901234";
+
+   constexpr TestVector test_vectors[] = {
+      // RFC 4226 appendix D
+      {HashKind::Sha1, sha1_secret, 0, 6, 755224},
+      {HashKind::Sha1, sha1_secret, 1, 6, 287082},
+      {HashKind::Sha1, sha1_secret, 2, 6, 359152},
+      {HashKind::Sha1, sha1_secret, 3, 6, 969429},
+      {HashKind::Sha1, sha1_secret, 4, 6, 338314},
+      {HashKind::Sha1, sha1_secret, 5, 6, 254676},
+      {HashKind::Sha1, sha1_secret, 6, 6, 287922},
+      {HashKind::Sha1, sha1_secret, 7, 6, 162583},
+      {HashKind::Sha1, sha1_secret, 8, 6, 399871},
+      {HashKind::Sha1, sha1_secret, 9, 6, 520489},
+
+      // RFC 6238 appendix B at T = 59 and T = 1111111109, with a time step of 30 seconds
+      {HashKind::Sha1, sha1_secret, 1, 8, 94287082},
+      {HashKind::Sha256, sha256_secret, 1, 8, 46119246},
+      {HashKind::Sha512, sha512_secret, 1, 8, 90693936},
+      {HashKind::Sha1, sha1_secret, 37037036, 8, 7081804},
+      {HashKind::Sha256, sha256_secret, 37037036, 8, 68084774},
+      {HashKind::Sha512, sha512_secret, 37037036, 8, 25091201},
+   };
+
+   // HOTP computed with the given block functions. The secrets of the test vectors fit into one block.
+   std::uint32_t hotp_with(const ShaFunctions &functions, const TestVector &vector)
+   {
+      const std::size_t blockSize = vector.kind == HashKind::Sha512 ? 128 : 64;
+      const std::size_t secretLength = std::strlen(vector.secret);
+
+      std::uint8_t innerPad[128] = {};
+      std::uint8_t outerPad[128] = {};
+      for (std::size_t i = 0; i < blockSize; ++i)
+      {
+         const std::uint8_t key = i < secretLength ? static_cast<std::uint8_t>(vector.secret[i]) : 0;
+         innerPad[i] = key ^ 0x36;
+         outerPad[i] = key ^ 0x5c;
+      }
+
+      std::uint8_t message[8];
+      libqotp::detail::write_counter(vector.counter, message);
+
+      std::uint8_t digest[64] = {};
+      const int hashLength = vector.kind == HashKind::Sha1 ? 20 : (vector.kind == HashKind::Sha256 ? 32 : 64);
+      switch (vector.kind)
+      {
+      case HashKind::Sha1:
+      {
+         std::uint32_t inner[5];
+         std::uint32_t outer[5];
+         std::uint8_t innerHash[20];
+         std::memcpy(inner, libqotp::detail::sha1_initial, sizeof(inner));
+         std::memcpy(outer, libqotp::detail::sha1_initial, sizeof(outer));
+         functions.sha1(inner, innerPad, 1);
+         functions.sha1(outer, outerPad, 1);
+         libqotp::detail::sha1_finish(functions, inner, message, sizeof(message), 64, innerHash);
+         libqotp::detail::sha1_finish(functions, outer, innerHash, sizeof(innerHash), 64, digest);
+         break;
+      }
+      case HashKind::Sha256:
+      {
+         std::uint32_t inner[8];
+         std::uint32_t outer[8];
+         std::uint8_t innerHash[32];
+         std::memcpy(inner, libqotp::detail::sha256_initial, sizeof(inner));
+         std::memcpy(outer, libqotp::detail::sha256_initial, sizeof(outer));
+         functions.sha256(inner, innerPad, 1);
+         functions.sha256(outer, outerPad, 1);
+         libqotp::detail::sha256_finish(functions, inner, message, sizeof(message), 64, innerHash);
+         libqotp::detail::sha256_finish(functions, outer, innerHash, sizeof(innerHash), 64, digest);
+         break;
+      }
+      case HashKind::Sha512:
+      {
+         std::uint64_t inner[8];
+         std::uint64_t outer[8];
+         std::uint8_t innerHash[64];
+         std::memcpy(inner, libqotp::detail::sha512_initial, sizeof(inner));
+         std::memcpy(outer, libqotp::detail::sha512_initial, sizeof(outer));
+         functions.sha512(inner, innerPad, 1);
+         functions.sha512(outer, outerPad, 1);
+         libqotp::detail::sha512_finish(functions, inner, message, sizeof(message), 128, innerHash);
+         libqotp::detail::sha512_finish(functions, outer, innerHash, sizeof(innerHash), 128, digest);
+         break;
+      }
+      }
+
+      std::uint32_t truncatedHash = 0;
+      if (!libqotp::detail::dynamic_truncate(digest, hashLength, truncatedHash))
+      {
+         return libqotp::detail::invalid_code;
+      }
+      return libqotp::detail::reduce_to_digits(truncatedHash, vector.digits);
+   }
+
+   // Checks a backend against the RFC test vectors. The vectors only compress single blocks, so the
+   // block functions are also compared with the portable implementation over several blocks at once.
+   bool self_test(const ShaFunctions &functions)
+   {
+      for (const TestVector &vector : test_vectors)
+      {
+         if (hotp_with(functions, vector) != vector.code)
+         {
+            return false;
+         }
+      }
+
+      std::uint8_t blocks[3 * 128];
+      for (std::size_t i = 0; i < sizeof(blocks); ++i)
+      {
+         blocks[i] = static_cast<std::uint8_t>(i * 167 + 13);
+      }
+
+      std::uint32_t sha1[2][5];
+      std::uint32_t sha256[2][8];
+      std::uint64_t sha512[2][8];
+      for (int i = 0; i < 2; ++i)
+      {
+         std::memcpy(sha1[i], libqotp::detail::sha1_initial, sizeof(sha1[i]));
+         std::memcpy(sha256[i], libqotp::detail::sha256_initial, sizeof(sha256[i]));
+         std::memcpy(sha512[i], libqotp::detail::sha512_initial, sizeof(sha512[i]));
+      }
+
+      functions.sha1(sha1[0], blocks, 6);
+      functions.sha256(sha256[0], blocks, 6);
+      functions.sha512(sha512[0], blocks, 3);
+      generic_functions.sha1(sha1[1], blocks, 6);
+      generic_functions.sha256(sha256[1], blocks, 6);
+      generic_functions.sha512(sha512[1], blocks, 3);
+
+      return std::memcmp(sha1[0], sha1[1], sizeof(sha1[0])) == 0 &&
+             std::memcmp(sha256[0], sha256[1], sizeof(sha256[0])) == 0 &&
+             std::memcmp(sha512[0], sha512[1], sizeof(sha512[0])) == 0;
+   }
+
+   struct Backend
+   {
+      HmacBackend backend;
+      const ShaFunctions *functions;
+      bool available;
+   };
+
+   constexpr HmacBackend all_backends[] = {HmacBackend::Generic, HmacBackend::ShaNi, HmacBackend::OpenSsl};
+
+   // Every backend with the result of its self-test, indexed by HmacBackend. Runs once.
+   const std::array<Backend, std::size(all_backends)> &backends()
+   {
+      static const auto result = []() {
+         std::array<Backend, std::size(all_backends)> backends = {};
+         for (const HmacBackend backend : all_backends)
+         {
+            const ShaFunctions *functions = supported_functions(backend);
+            backends[static_cast<std::size_t>(backend)] = {backend, functions, functions && self_test(*functions)};
+         }
+         return backends;
+      }();
+      return result;
+   }
+
+   const Backend *default_backend()
+   {
+      const auto &candidates = backends();
+
+      // Optional override for testing and benchmarking
+      if (const char *name = std::getenv("QOTP_HMAC"))
+      {
+         for (const Backend &candidate : candidates)
+         {
+            if (candidate.available && libqotp::core::hmac_backend_name(candidate.backend) == name)
+            {
+               return &candidate;
+            }
+         }
+      }
+
+      // Fastest first. The portable implementation is the last resort even if its self-test failed.
+      for (const HmacBackend backend : {HmacBackend::ShaNi, HmacBackend::OpenSsl})
+      {
+         const Backend &candidate = candidates[static_cast<std::size_t>(backend)];
+         if (candidate.available)
+         {
+            return &candidate;
+         }
+      }
+      return &candidates[static_cast<std::size_t>(HmacBackend::Generic)];
+   }
+
+   std::atomic<const Backend *> &active_backend()
+   {
+      static std::atomic<const Backend *> active(default_backend());
+      return active;
+   }
+}
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+const libqotp::detail::ShaFunctions &libqotp::detail::active_sha_functions()
+{
+   return *active_backend().load(std::memory_order_acquire)->functions;
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+libqotp::core::HmacBackend libqotp::core::hmac_backend()
+{
+   return active_backend().load(std::memory_order_acquire)->backend;
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+std::string_view libqotp::core::hmac_backend_name(HmacBackend backend)
+{
+   switch (backend)
+   {
+   case HmacBackend::Generic:
+      return "generic";
+   case HmacBackend::ShaNi:
+      return "sha-ni";
+   case HmacBackend::OpenSsl:
+      return "openssl";
+   }
+   return std::string_view();
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+bool libqotp::core::hmac_backend_available(HmacBackend backend)
+{
+   const auto index = static_cast<std::size_t>(backend);
+   return index < backends().size() && backends()[index].available;
+}
+
+// Refer to the detailed documentation in core/hmacbackend.h for complete information about this function.
+bool libqotp::core::set_hmac_backend(HmacBackend backend)
+{
+   if (!hmac_backend_available(backend))
+   {
+      return false;
+   }
+
+   active_backend().store(&backends()[static_cast<std::size_t>(backend)], std::memory_order_release);
+   return true;
+}
@@ -0,0 +1,31 @@
+#ifndef LIBQOTP_SHA_BACKEND_H_20261018
+#define LIBQOTP_SHA_BACKEND_H_20261018
+
+#include "sha.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Backends for the SHA block functions behind every single HMAC (see libqotp/core/hmacbackend.h). Full
+// vectors of the multi-buffer engine run on its own kernels, see multibuffer.h.
+//
+// A backend only replaces the block function. Padding, the HMAC construction and the midstates cached
+// by OtpKey are shared, so all backends produce the same bytes and keys never depend on the backend.
+namespace libqotp::detail
+{
+   /**
+    * Returns the block functions of the active backend. The backend is selected and self-tested on first use.
+    */
+   const ShaFunctions &active_sha_functions();
+
+   // x86 SHA extensions, compiled with SHA and SSE4.1 enabled. Only called if the CPU supports both.
+   void sha1_compress_shani(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks);
+   void sha256_compress_shani(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks);
+
+   // OpenSSL's libcrypto, only compiled if QOTP_WITH_OPENSSL is defined.
+   void sha1_compress_openssl(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks);
+   void sha256_compress_openssl(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks);
+   void sha512_compress_openssl(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks);
+}
+
+#endif
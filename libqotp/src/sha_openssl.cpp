@@ -0,0 +1,62 @@
+// The block functions are deprecated in OpenSSL 3, but remain the only way to continue a hash from a
+// cached chaining state. The EVP interface does not expose it.
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "sha_backend.h"
+
+#include <openssl/sha.h>
+
+#include <cstring>
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+void libqotp::detail::sha1_compress_openssl(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks)
+{
+   SHA_CTX context = {};
+   context.h0 = state[0];
+   context.h1 = state[1];
+   context.h2 = state[2];
+   context.h3 = state[3];
+   context.h4 = state[4];
+
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      SHA1_Transform(&context, data);
+   }
+
+   state[0] = context.h0;
+   state[1] = context.h1;
+   state[2] = context.h2;
+   state[3] = context.h3;
+   state[4] = context.h4;
+   secure_zero(&context, sizeof(context));
+}
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+void libqotp::detail::sha256_compress_openssl(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   SHA256_CTX context = {};
+   std::memcpy(context.h, state, sizeof(context.h));
+
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      SHA256_Transform(&context, data);
+   }
+
+   std::memcpy(state, context.h, sizeof(context.h));
+   secure_zero(&context, sizeof(context));
+}
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+void libqotp::detail::sha512_compress_openssl(std::uint64_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   SHA512_CTX context = {};
+   std::memcpy(context.h, state, sizeof(context.h));
+
+   for (; blocks > 0; --blocks, data += 128)
+   {
+      SHA512_Transform(&context, data);
+   }
+
+   std::memcpy(state, context.h, sizeof(context.h));
+   secure_zero(&context, sizeof(context));
+}
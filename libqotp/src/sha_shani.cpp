@@ -0,0 +1,156 @@
+#include "sha_backend.h"
+
+#include <immintrin.h>
+
+#include <utility>
+
+// SHA-1 and SHA-256 block functions using the x86 SHA extensions.
+//
+// The instructions work on four words at a time: sha1rnds4 and sha256rnds2 perform four and two rounds,
+// sha1msg1/sha1msg2 and sha256msg1/sha256msg2 extend the message schedule by four words. The round
+// function of sha1rnds4 is an immediate, so the rounds are unrolled at compile time.
+namespace
+{
+   // SHA-1 rounds 4 * Group to 4 * Group + 3. 'message' holds the last four schedule vectors, the vector
+   // for this group at index Group % 4.
+   template <int Group>
+   inline void sha1_rounds(__m128i &abcd, __m128i &e0, __m128i &e1, __m128i message[4])
+   {
+      __m128i &current = message[Group % 4];
+
+      if constexpr (Group == 0)
+      {
+         e0 = _mm_add_epi32(e0, current);
+         e1 = abcd;
+         abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      }
+      else
+      {
+         // Groups alternate between the two E registers
+         __m128i &e = Group % 2 ? e1 : e0;
+         __m128i &next = Group % 2 ? e0 : e1;
+
+         e = _mm_sha1nexte_epu32(e, current);
+         next = abcd;
+         if constexpr (Group >= 3 && Group <= 18)
+         {
+            message[(Group + 1) % 4] = _mm_sha1msg2_epu32(message[(Group + 1) % 4], current);
+         }
+         abcd = _mm_sha1rnds4_epu32(abcd, e, Group / 5);
+      }
+
+      if constexpr (Group >= 1 && Group <= 16)
+      {
+         message[(Group + 3) % 4] = _mm_sha1msg1_epu32(message[(Group + 3) % 4], current);
+      }
+      if constexpr (Group >= 2 && Group <= 17)
+      {
+         message[(Group + 2) % 4] = _mm_xor_si128(message[(Group + 2) % 4], current);
+      }
+   }
+
+   template <int... Group>
+   inline void sha1_all_rounds(__m128i &abcd, __m128i &e0, __m128i &e1, __m128i message[4], std::integer_sequence<int, Group...>)
+   {
+      (sha1_rounds<Group>(abcd, e0, e1, message), ...);
+   }
+
+   // SHA-256 rounds 4 * Group to 4 * Group + 3, with the schedule vector for this group at index Group % 4.
+   template <int Group>
+   inline void sha256_rounds(__m128i &abef, __m128i &cdgh, __m128i message[4])
+   {
+      __m128i &current = message[Group % 4];
+
+      const __m128i constants = _mm_loadu_si128(reinterpret_cast<const __m128i *>(libqotp::detail::sha256_round_constants + Group * 4));
+      __m128i words = _mm_add_epi32(current, constants);
+      cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+
+      if constexpr (Group >= 3 && Group <= 14)
+      {
+         __m128i &next = message[(Group + 1) % 4];
+         next = _mm_add_epi32(next, _mm_alignr_epi8(current, message[(Group + 3) % 4], 4));
+         next = _mm_sha256msg2_epu32(next, current);
+      }
+
+      words = _mm_shuffle_epi32(words, 0x0e);
+      abef = _mm_sha256rnds2_epu32(abef, cdgh, words);
+
+      if constexpr (Group >= 1 && Group <= 12)
+      {
+         message[(Group + 3) % 4] = _mm_sha256msg1_epu32(message[(Group + 3) % 4], current);
+      }
+   }
+
+   template <int... Group>
+   inline void sha256_all_rounds(__m128i &abef, __m128i &cdgh, __m128i message[4], std::integer_sequence<int, Group...>)
+   {
+      (sha256_rounds<Group>(abef, cdgh, message), ...);
+   }
+}
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+void libqotp::detail::sha1_compress_shani(std::uint32_t state[5], const std::uint8_t *data, std::size_t blocks)
+{
+   // Words are big-endian and ABCD is kept in reversed lane order
+   const __m128i byteOrder = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+   __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1b);
+   __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+   __m128i e1 = _mm_setzero_si128();
+
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      const __m128i abcdSaved = abcd;
+      const __m128i eSaved = e0;
+
+      __m128i message[4];
+      for (int i = 0; i < 4; ++i)
+      {
+         message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteOrder);
+      }
+
+      sha1_all_rounds(abcd, e0, e1, message, std::make_integer_sequence<int, 20>());
+
+      e0 = _mm_sha1nexte_epu32(e0, eSaved);
+      abcd = _mm_add_epi32(abcd, abcdSaved);
+   }
+
+   _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1b));
+   state[4] = static_cast<std::uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+// Refer to the detailed documentation in sha_backend.h for complete information about this function.
+void libqotp::detail::sha256_compress_shani(std::uint32_t state[8], const std::uint8_t *data, std::size_t blocks)
+{
+   const __m128i byteOrder = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+   // The instructions expect the state as ABEF and CDGH
+   const __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+   const __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4));
+   const __m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+   const __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+   __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+   __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+   for (; blocks > 0; --blocks, data += 64)
+   {
+      const __m128i abefSaved = abef;
+      const __m128i cdghSaved = cdgh;
+
+      __m128i message[4];
+      for (int i = 0; i < 4; ++i)
+      {
+         message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteOrder);
+      }
+
+      sha256_all_rounds(abef, cdgh, message, std::make_integer_sequence<int, 16>());
+
+      abef = _mm_add_epi32(abef, abefSaved);
+      cdgh = _mm_add_epi32(cdgh, cdghSaved);
+   }
+
+   const __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+   const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+   _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+   _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
@@ -0,0 +1,369 @@
+#include <libqotp/throttle.h>
+
+#include <QHashFunctions>
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+namespace
+{
+   // An entry holds the tag in its high 20 bits, then the number of reserved attempts in 4 bits, the
+   // failure count in 8 bits and the deadline in Unix seconds in the low 32 bits.
+   constexpr int tag_shift = 44;
+   constexpr int reserved_shift = 40;
+   constexpr quint64 reserved_mask = 0xf;
+   constexpr int failures_shift = 32;
+   constexpr quint64 failures_mask = 0xff;
+   constexpr quint64 deadline_mask = 0xffffffffu;
+
+   // The reservations, failure count and deadline, which order entries for eviction
+   constexpr quint64 state_mask = (reserved_mask << reserved_shift) | (failures_mask << failures_shift) | deadline_mask;
+
+   // The number of buckets searched for a user
+   constexpr qsizetype probe_buckets = 4;
+
+   // 64 bits of seeded hash. On platforms with a 32-bit size_t two differently seeded hashes are combined.
+   quint64 hash_of(QByteArrayView userId, size_t seed)
+   {
+      if constexpr (sizeof(size_t) >= sizeof(quint64))
+      {
+         return qHash(userId, seed);
+      }
+      else
+      {
+         return (quint64(qHash(userId, seed)) << 32) | qHash(userId, ~seed);
+      }
+   }
+
+   QByteArrayView view_of(const quint64 &userId)
+   {
+      return QByteArrayView(reinterpret_cast<const char *>(&userId), sizeof(userId));
+   }
+
+   // The high 20 bits of the hash, never zero, so an entry of zero is empty
+   quint64 tag_of(quint64 hash)
+   {
+      return std::max<quint64>(hash >> tag_shift, 1);
+   }
+
+   unsigned int reserved_of(quint64 value)
+   {
+      return static_cast<unsigned int>((value >> reserved_shift) & reserved_mask);
+   }
+
+   unsigned int failures_of(quint64 value)
+   {
+      return static_cast<unsigned int>((value >> failures_shift) & failures_mask);
+   }
+
+   quint64 entry_of(quint64 tag, unsigned int reserved, unsigned int failures, quint64 deadline)
+   {
+      return (tag << tag_shift) | (quint64(reserved) << reserved_shift) | (quint64(failures) << failures_shift) | deadline;
+   }
+}
+
+libqotp::Throttle::Throttle(const ThrottleOptions &options)
+   : m_options(options)
+   , m_seed(static_cast<size_t>(QRandomGenerator::system()->generate64()))
+{
+   m_options.timeStep = std::max(m_options.timeStep, 1u);
+
+   const qsizetype buckets = std::max<qsizetype>((m_options.capacity + bucket_size - 1) / bucket_size, 1);
+
+   m_bucketCount = 1;
+   while (m_bucketCount < buckets)
+   {
+      m_bucketCount *= 2;
+   }
+
+   m_buckets.reset(new Bucket[static_cast<std::size_t>(m_bucketCount)]);
+}
+
+libqotp::Throttle::~Throttle() = default;
+
+quint64 libqotp::Throttle::check(QByteArrayView userId, quint64 currentUnixTime) const
+{
+   const quint64 deadline = find(hash_of(userId, m_seed), currentUnixTime).deadline;
+   return deadline > currentUnixTime ? deadline : 0;
+}
+
+quint64 libqotp::Throttle::check(quint64 userId, quint64 currentUnixTime) const
+{
+   return check(view_of(userId), currentUnixTime);
+}
+
+quint64 libqotp::Throttle::reserve(QByteArrayView userId, quint64 currentUnixTime)
+{
+   return acquire(hash_of(userId, m_seed), currentUnixTime);
+}
+
+quint64 libqotp::Throttle::reserve(quint64 userId, quint64 currentUnixTime)
+{
+   return reserve(view_of(userId), currentUnixTime);
+}
+
+quint64 libqotp::Throttle::recordFailure(QByteArrayView userId, quint64 currentUnixTime)
+{
+   return fail(hash_of(userId, m_seed), currentUnixTime);
+}
+
+quint64 libqotp::Throttle::recordFailure(quint64 userId, quint64 currentUnixTime)
+{
+   return recordFailure(view_of(userId), currentUnixTime);
+}
+
+void libqotp::Throttle::recordSuccess(QByteArrayView userId)
+{
+   reset(hash_of(userId, m_seed));
+}
+
+void libqotp::Throttle::recordSuccess(quint64 userId)
+{
+   recordSuccess(view_of(userId));
+}
+
+unsigned int libqotp::Throttle::failures(QByteArrayView userId, quint64 currentUnixTime) const
+{
+   return find(hash_of(userId, m_seed), currentUnixTime).failures;
+}
+
+unsigned int libqotp::Throttle::failures(quint64 userId, quint64 currentUnixTime) const
+{
+   return failures(view_of(userId), currentUnixTime);
+}
+
+// Entries are visited in the same order by every thread. Entries are never emptied again, so an empty
+// entry ends the search: the user cannot have an entry behind it.
+template <typename Function>
+void libqotp::Throttle::visit(quint64 hash, Function function) const
+{
+   const qsizetype first = static_cast<qsizetype>(hash & static_cast<quint64>(m_bucketCount - 1));
+   const qsizetype probes = std::min(probe_buckets, m_bucketCount);
+
+   for (qsizetype i = 0; i < probes; ++i)
+   {
+      Bucket &bucket = m_buckets[(first + i) & (m_bucketCount - 1)];
+      for (std::atomic<quint64> &entry : bucket.entries)
+      {
+         if (!function(entry))
+         {
+            return;
+         }
+      }
+   }
+}
+
+bool libqotp::Throttle::expired(quint64 value, quint64 currentUnixTime) const
+{
+   if (failures_of(value) == 0 && reserved_of(value) == 0)
+   {
+      return true;
+   }
+
+   const quint64 deadline = std::max(value & deadline_mask, m_options.epoch);
+   const quint64 expiry = totp_expire_time(deadline, m_options.epoch, m_options.timeStep) + quint64(m_options.retention) * m_options.timeStep;
+   return currentUnixTime >= expiry;
+}
+
+quint64 libqotp::Throttle::delay(unsigned int failures) const
+{
+   // The failure that uses up the free attempts starts the delay
+   const unsigned int freeAttempts = std::max(m_options.freeAttempts, 1u);
+   if (failures < freeAttempts)
+   {
+      return 0;
+   }
+
+   const unsigned int doublings = failures - freeAttempts;
+   if (doublings >= 32)
+   {
+      return m_options.maxDelay;
+   }
+   return std::min<quint64>(quint64(m_options.baseDelay) << doublings, m_options.maxDelay);
+}
+
+libqotp::Throttle::Found libqotp::Throttle::find(quint64 hash, quint64 currentUnixTime) const
+{
+   const quint64 tag = tag_of(hash);
+
+   // Two threads inserting the same user at once can leave it two entries, so all of them are merged
+   Found found;
+   visit(hash, [&](std::atomic<quint64> &entry) {
+      const quint64 value = entry.load();
+      if ((value >> tag_shift) == tag && !expired(value, currentUnixTime))
+      {
+         found.failures = std::max(found.failures, failures_of(value));
+         found.deadline = std::max(found.deadline, value & deadline_mask);
+      }
+      return value != 0;
+   });
+   return found;
+}
+
+libqotp::Throttle::Slot libqotp::Throttle::locate(quint64 hash, quint64 currentUnixTime) const
+{
+   const quint64 tag = tag_of(hash);
+
+   // The user's entry, preferably one that has not expired, or else the first entry that is empty or
+   // expired, or else the entry with the fewest reservations and failures and the earliest deadline
+   std::atomic<quint64> *own = nullptr;
+   std::atomic<quint64> *reusable = nullptr;
+   std::atomic<quint64> *victim = nullptr;
+   quint64 ownValue = 0;
+   quint64 reusableValue = 0;
+   quint64 victimValue = 0;
+   bool ownExpired = true;
+
+   visit(hash, [&](std::atomic<quint64> &entry) {
+      const quint64 value = entry.load();
+      const bool stale = value == 0 || expired(value, currentUnixTime);
+      if (value != 0 && (value >> tag_shift) == tag)
+      {
+         if (!own || (ownExpired && !stale))
+         {
+            own = &entry;
+            ownValue = value;
+            ownExpired = stale;
+         }
+         return ownExpired;
+      }
+
+      if (stale)
+      {
+         if (!reusable)
+         {
+            reusable = &entry;
+            reusableValue = value;
+         }
+      }
+      else if (!victim || (value & state_mask) < (victimValue & state_mask))
+      {
+         victim = &entry;
+         victimValue = value;
+      }
+      return value != 0;
+   });
+
+   if (own)
+   {
+      return {own, ownValue, !ownExpired};
+   }
+   return reusable ? Slot{reusable, reusableValue, false} : Slot{victim, victimValue, false};
+}
+
+quint64 libqotp::Throttle::acquire(quint64 hash, quint64 currentUnixTime)
+{
+   const quint64 tag = tag_of(hash);
+
+   for (;;)
+   {
+      Slot slot = locate(hash, currentUnixTime);
+
+      unsigned int reserved = 0;
+      unsigned int failures = 0;
+      if (slot.live)
+      {
+         const quint64 deadline = slot.value & deadline_mask;
+         if (deadline > currentUnixTime)
+         {
+            return deadline;
+         }
+
+         // Attempts in flight count as failures until they are recorded. Once the free attempts are
+         // used up, a user gets one attempt at a time.
+         reserved = reserved_of(slot.value);
+         failures = failures_of(slot.value);
+         if (reserved == reserved_mask || (reserved != 0 && failures + reserved >= m_options.freeAttempts))
+         {
+            return currentUnixTime + 1;
+         }
+      }
+
+      // The deadline is moved to now, which keeps the entry from expiring while the attempt is in flight
+      const quint64 wanted = entry_of(tag, reserved + 1, failures, std::min(currentUnixTime, deadline_mask));
+      if (slot.entry->compare_exchange_strong(slot.value, wanted))
+      {
+         return 0;
+      }
+   }
+}
+
+quint64 libqotp::Throttle::fail(quint64 hash, quint64 currentUnixTime)
+{
+   const quint64 tag = tag_of(hash);
+
+   for (;;)
+   {
+      Slot slot = locate(hash, currentUnixTime);
+
+      // A failure completes one reserved attempt, if there is one
+      unsigned int reserved = 0;
+      unsigned int failures = 1;
+      quint64 deadline = currentUnixTime;
+      if (slot.live)
+      {
+         reserved = reserved_of(slot.value) - (reserved_of(slot.value) != 0);
+         failures = std::min<unsigned int>(failures_of(slot.value) + 1, failures_mask);
+         deadline = std::max(deadline, slot.value & deadline_mask);
+      }
+      deadline = std::min(std::max(deadline, currentUnixTime + delay(failures)), deadline_mask);
+
+      if (!slot.entry->compare_exchange_strong(slot.value, entry_of(tag, reserved, failures, deadline)))
+      {
+         // Another thread changed the entry first
+         continue;
+      }
+
+      return deadline > currentUnixTime ? deadline : 0;
+   }
+}
+
+void libqotp::Throttle::reset(quint64 hash)
+{
+   const quint64 tag = tag_of(hash);
+
+   // Entries keep their tag with no failures and no reservations, which makes them expired and free for
+   // reuse. Attempts still in flight are forgotten as well; a failure recorded for one of them later
+   // counts as the first one.
+   visit(hash, [&](std::atomic<quint64> &entry) {
+      quint64 value = entry.load();
+      while ((value >> tag_shift) == tag && (value & ((reserved_mask << reserved_shift) | (failures_mask << failures_shift))) != 0)
+      {
+         if (entry.compare_exchange_weak(value, tag << tag_shift))
+         {
+            break;
+         }
+      }
+      return value != 0;
+   });
+}
+
+// Refer to the detailed documentation in throttle.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    Throttle &throttle,
+    QByteArrayView userId,
+    const OtpKey &key,
+    quint32 code,
+    quint64 currentUnixTime,
+    unsigned int window,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // The attempt is counted before the HMAC, so concurrent guesses cannot all pass a check first
+   if (throttle.reserve(userId, currentUnixTime) != 0)
+   {
+      return std::nullopt;
+   }
+
+   const ThrottleOptions &options = throttle.options();
+   const std::optional<int> offset = libqotp::totp_verify(key, code, currentUnixTime, window, options.timeStep, options.epoch, digits, digitMinimum, digitMaximum);
+   if (!offset)
+   {
+      throttle.recordFailure(userId, currentUnixTime);
+      return std::nullopt;
+   }
+
+   throttle.recordSuccess(userId);
+   return offset;
+}
@@ -1,7 +1,141 @@
 #include <libqotp/qotp.h>
 
+#include "base32_secret.h"
+#include "hotp_batch.h"
+#include "metrics_record.h"
+#include "otp_error.h"
+#include "truncate.h"
+
+#include <limits>
+
+namespace
+{
+   // Parses a code that consists of exactly 'digits' decimal digits. The length of a code is not secret,
+   // so malformed input is rejected early.
+   std::optional<quint32> parse_code(QStringView code, unsigned int digits)
+   {
+      if (code.size() != static_cast<qsizetype>(digits) || digits > libqotp::detail::max_code_digits)
+      {
+         return std::nullopt;
+      }
+
+      quint64 value = 0;
+      for (QChar character : code)
+      {
+         const char16_t unicode = character.unicode();
+         if (unicode < u'0' || unicode > u'9')
+         {
+            return std::nullopt;
+         }
+         value = value * 10 + (unicode - u'0');
+      }
+
+      if (value > std::numeric_limits<quint32>::max())
+      {
+         return std::nullopt;
+      }
+
+      return static_cast<quint32>(value);
+   }
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QString libqotp::totp(
+    QByteArrayView secret,
+    quint64 currentUnixTime,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   return libqotp::try_totp(secret, currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum, algorithm).value();
+}
+
 // Refer to the detailed documentation in qotp.h for complete information about this function.
 QString libqotp::totp(
+    const OtpKey &key,
+    quint64 currentUnixTime,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::try_totp(key, currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum).value();
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QString> libqotp::try_totp(
+    QByteArrayView secret,
+    quint64 currentUnixTime,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   if (secret.isEmpty())
+   {
+      detail::record_failure(OtpError::EmptySecret);
+      return OtpError::EmptySecret;
+   }
+
+   return libqotp::try_totp(OtpKey(secret, algorithm), currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QString> libqotp::try_totp(
+    const OtpKey &key,
+    quint64 currentUnixTime,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Ensure timeStep is not zero to avoid division by zero
+   if (timeStep == 0)
+   {
+      detail::record_failure(OtpError::InvalidTimeStep);
+      return OtpError::InvalidTimeStep;
+   }
+
+   // Calculate the counter value based on the current time
+   quint64 counter = (currentUnixTime - epoch) / timeStep;
+
+   // Call the HOTP function using the calculated counter
+   return libqotp::try_hotp(key, counter, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint32> libqotp::totp_value(
+    const OtpKey &key,
+    quint64 currentUnixTime,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Ensure timeStep is not zero to avoid division by zero
+   if (timeStep == 0)
+   {
+      detail::record_failure(OtpError::InvalidTimeStep);
+      return std::nullopt;
+   }
+
+   // Calculate the counter value based on the current time
+   quint64 counter = (currentUnixTime - epoch) / timeStep;
+
+   // Call the HOTP function using the calculated counter
+   return libqotp::hotp_value(key, counter, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint32> libqotp::totp_value(
     QByteArrayView secret,
     quint64 currentUnixTime,
     unsigned int timeStep,
@@ -11,16 +145,151 @@ QString libqotp::totp(
     unsigned int digitMaximum,
     QCryptographicHash::Algorithm algorithm)
 {
-    // Ensure timeStep is not zero to avoid division by zero
-    if (timeStep == 0) {
-        return QString();
-    }
+   return libqotp::totp_value(OtpKey(secret, algorithm), currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
 
-    // Calculate the counter value based on the current time
-    quint64 counter = (currentUnixTime - epoch) / timeStep;
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+qsizetype libqotp::totp(
+    const OtpKey &key,
+    quint64 currentUnixTime,
+    std::span<char> output,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   // Ensure timeStep is not zero to avoid division by zero
+   if (timeStep == 0)
+   {
+      detail::record_failure(OtpError::InvalidTimeStep);
+      return 0;
+   }
 
-    // Call the HOTP function using the calculated counter
-    return libqotp::hotp(secret, counter, digits, digitMinimum, digitMaximum, algorithm);
+   // Calculate the counter value based on the current time
+   quint64 counter = (currentUnixTime - epoch) / timeStep;
+
+   // Call the HOTP function using the calculated counter
+   return libqotp::hotp(key, counter, output, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+qsizetype libqotp::totp(
+    QByteArrayView secret,
+    quint64 currentUnixTime,
+    std::span<char> output,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   return libqotp::totp(OtpKey(secret, algorithm), currentUnixTime, output, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    const OtpKey &key,
+    quint32 code,
+    quint64 currentUnixTime,
+    unsigned int window,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   detail::MetricsScope metrics(key);
+
+   // Input validation
+   const OtpError error = detail::check_otp(key, digits, digitMinimum, digitMaximum);
+   if (error != OtpError::None)
+   {
+      metrics.fail(error);
+      return std::nullopt;
+   }
+
+   if (timeStep == 0)
+   {
+      metrics.fail(OtpError::InvalidTimeStep);
+      return std::nullopt;
+   }
+
+   if (window > static_cast<unsigned int>(std::numeric_limits<int>::max()))
+   {
+      // The matched offset must be representable
+      metrics.fail(OtpError::InvalidWindow);
+      return std::nullopt;
+   }
+
+   // Calculate the counter value based on the current time
+   const quint64 counter = (currentUnixTime - epoch) / timeStep;
+
+   // Compare with the codes of the window around it
+   return detail::verify_window(key.coreKey(), code, counter, window, digits);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    const OtpKey &key,
+    QStringView code,
+    quint64 currentUnixTime,
+    unsigned int window,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   const auto value = parse_code(code, digits);
+   if (!value)
+   {
+      detail::record_failure(OtpError::MalformedCode);
+      return std::nullopt;
+   }
+
+   return libqotp::totp_verify(key, *value, currentUnixTime, window, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    QByteArrayView secret,
+    quint32 code,
+    quint64 currentUnixTime,
+    unsigned int window,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   // One key schedule is shared by all candidates of the window
+   return libqotp::totp_verify(OtpKey(secret, algorithm), code, currentUnixTime, window, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    QByteArrayView secret,
+    QStringView code,
+    quint64 currentUnixTime,
+    unsigned int window,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum,
+    QCryptographicHash::Algorithm algorithm)
+{
+   const auto value = parse_code(code, digits);
+   if (!value)
+   {
+      detail::record_failure(OtpError::MalformedCode);
+      return std::nullopt;
+   }
+
+   return libqotp::totp_verify(OtpKey(secret, algorithm), *value, currentUnixTime, window, timeStep, epoch, digits, digitMinimum, digitMaximum);
 }
 
 // Refer to the detailed documentation in qotp.h for complete information about this function.
@@ -39,6 +308,69 @@ quint64 libqotp::totp_expire_time(
    return epoch + windowStart + timeStep;
 }
 
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+QString libqotp::totp(
+    const OtpKey &key,
+    const Clock &clock,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::totp(key, clock.now(), timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+libqotp::Result<QString> libqotp::try_totp(
+    const OtpKey &key,
+    const Clock &clock,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::try_totp(key, clock.now(), timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<quint32> libqotp::totp_value(
+    const OtpKey &key,
+    const Clock &clock,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::totp_value(key, clock.now(), timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+std::optional<int> libqotp::totp_verify(
+    const OtpKey &key,
+    quint32 code,
+    const Clock &clock,
+    unsigned int window,
+    unsigned int timeStep,
+    quint64 epoch,
+    unsigned int digits,
+    unsigned int digitMinimum,
+    unsigned int digitMaximum)
+{
+   return libqotp::totp_verify(key, code, clock.now(), window, timeStep, epoch, digits, digitMinimum, digitMaximum);
+}
+
+// Refer to the detailed documentation in qotp.h for complete information about this function.
+quint64 libqotp::totp_expire_time(
+   const Clock &clock,
+   quint64 epoch,
+   unsigned int timeStep)
+{
+   return libqotp::totp_expire_time(clock.now(), epoch, timeStep);
+}
+
 // Convenience
 QString libqotp::totp_sha256(
     QByteArrayView secret,
@@ -76,11 +408,11 @@ QString libqotp::totp_base32(
    unsigned int digitMaximum,
    QCryptographicHash::Algorithm algorithm)
 {
-   // Decode the Base32 secret
-   QByteArray secret = libqotp::base32_decode(base32);
-
-   // Call the original hotp function with the decoded secret
-   return libqotp::totp(QByteArrayView(secret), currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum, algorithm);
+   // Decode the Base32 secret and call the original totp function with it
+   return libqotp::detail::with_base32_secret(base32, [&](QByteArrayView secret)
+   {
+      return libqotp::totp(secret, currentUnixTime, timeStep, epoch, digits, digitMinimum, digitMaximum, algorithm);
+   });
 }
 
 // Convenience
@@ -0,0 +1,227 @@
+#include <libqotp/totpcache.h>
+
+#include "hotp_batch.h"
+#include "parallel.h"
+#include "sha.h"
+#include "truncate.h"
+
+#include <algorithm>
+#include <limits>
+
+struct libqotp::TotpCache::Table
+{
+   // The keys the codes belong to. Shared with later tables until the keys are replaced.
+   std::shared_ptr<const std::vector<OtpKey>> keys;
+
+   // The time step the table was computed for
+   quint64 counter = 0;
+
+   // codes[key * span + column] is the code of counter base + column
+   quint64 base = 0;
+   std::size_t span = 0;
+   std::vector<quint32> codes;
+
+   // When the table was replaced by a newer one
+   std::chrono::steady_clock::time_point retired;
+
+   ~Table()
+   {
+      detail::secure_zero(codes.data(), codes.size() * sizeof(quint32));
+   }
+};
+
+libqotp::TotpCache::TotpCache(std::span<const OtpKey> keys, const TotpCacheOptions &options)
+   : m_options(options)
+   , m_keys(std::make_shared<const std::vector<OtpKey>>(keys.begin(), keys.end()))
+{
+   // A lead of a whole step or more would publish the table of a later step than the current one
+   const std::chrono::seconds longestLead(std::max(m_options.timeStep, 1u) - 1);
+   m_options.lead = std::clamp(m_options.lead, std::chrono::seconds(0), longestLead);
+
+   {
+      std::lock_guard lock(m_mutex);
+      publish(counterAt(current_unix_time()));
+   }
+
+   if (m_options.background)
+   {
+      m_thread = std::thread([this]() { run(); });
+   }
+}
+
+libqotp::TotpCache::~TotpCache()
+{
+   {
+      std::lock_guard lock(m_mutex);
+      m_stopping = true;
+   }
+   m_wake.notify_all();
+   if (m_thread.joinable())
+   {
+      m_thread.join();
+   }
+}
+
+// Refer to the detailed documentation in totpcache.h for complete information about this function.
+void libqotp::TotpCache::setKeys(std::span<const OtpKey> keys)
+{
+   std::lock_guard lock(m_mutex);
+   m_keys = std::make_shared<const std::vector<OtpKey>>(keys.begin(), keys.end());
+   publish(m_current->counter);
+}
+
+// Refer to the detailed documentation in totpcache.h for complete information about this function.
+qsizetype libqotp::TotpCache::size() const
+{
+   return static_cast<qsizetype>(m_table.load(std::memory_order_acquire)->keys->size());
+}
+
+// Refer to the detailed documentation in totpcache.h for complete information about this function.
+void libqotp::TotpCache::refresh(quint64 currentUnixTime)
+{
+   std::lock_guard lock(m_mutex);
+   publish(counterAt(currentUnixTime));
+}
+
+quint64 libqotp::TotpCache::counterAt(quint64 currentUnixTime) const
+{
+   // Times before the epoch have no time step, the first one is used instead
+   if (m_options.timeStep == 0 || currentUnixTime < m_options.epoch)
+   {
+      return 0;
+   }
+
+   return (currentUnixTime - m_options.epoch) / m_options.timeStep;
+}
+
+void libqotp::TotpCache::publish(quint64 counter)
+{
+   const auto started = std::chrono::steady_clock::now();
+   const quint64 window = m_options.window;
+
+   // The window around 'counter' and the one around the step before, clamped to the range of counters
+   auto table = std::make_unique<Table>();
+   table->keys = m_keys;
+   table->counter = counter;
+   table->base = counter > window ? counter - window - 1 : 0;
+   const quint64 last = counter <= std::numeric_limits<quint64>::max() - window ? counter + window : std::numeric_limits<quint64>::max();
+   table->span = static_cast<std::size_t>(last - table->base + 1);
+
+   const std::vector<OtpKey> &keys = *table->keys;
+   const std::size_t span = table->span;
+   const quint64 base = table->base;
+
+   // Invalid parameters leave every entry invalid, which no code matches
+   table->codes.assign(keys.size() * span, detail::invalid_code);
+   if (m_options.timeStep > 0 && detail::valid_digits(m_options.digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT))
+   {
+      quint32 *codes = table->codes.data();
+      const std::size_t minimumKeys = static_cast<std::size_t>(std::max<qsizetype>(m_options.batch.minimumPerThread, 1)) / span;
+
+      detail::parallel_for(keys.size(), m_options.batch.pool, m_options.batch.maxThreads, std::max<std::size_t>(minimumKeys, 1), [&](std::size_t begin, std::size_t end)
+      {
+         // Consecutive entries are consecutive counters of one key, then the next key
+         constexpr std::size_t chunkSize = 64;
+         detail::HotpJob jobs[chunkSize];
+
+         const std::size_t stop = end * span;
+         for (std::size_t first = begin * span; first < stop; first += chunkSize)
+         {
+            const std::size_t count = std::min(chunkSize, stop - first);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               jobs[i] = {&keys[(first + i) / span].coreKey(), base + (first + i) % span};
+            }
+
+            detail::hotp_values(jobs, count, m_options.digits, codes + first);
+         }
+      });
+   }
+
+   // Publication is a single pointer store. The replaced table stays alive for lookups that already
+   // loaded it, and is freed by a later refresh once it is a time step old.
+   const auto now = std::chrono::steady_clock::now();
+   if (m_current)
+   {
+      m_current->retired = now;
+      m_retired.push_back(std::move(m_current));
+   }
+   m_current = std::move(table);
+   m_table.store(m_current.get(), std::memory_order_release);
+
+   const auto grace = std::chrono::seconds(std::max(m_options.timeStep, 1u));
+   std::erase_if(m_retired, [&](const std::unique_ptr<Table> &retired) { return now - retired->retired >= grace; });
+
+   ++m_refreshes;
+   m_lastRefresh = std::chrono::duration_cast<std::chrono::microseconds>(now - started).count();
+}
+
+void libqotp::TotpCache::run()
+{
+   std::unique_lock lock(m_mutex);
+   while (!m_stopping)
+   {
+      // The step that starts within 'lead' seconds is the one the table must cover
+      const quint64 now = current_unix_time();
+      const quint64 upcoming = counterAt(now + static_cast<quint64>(m_options.lead.count()));
+      if (upcoming != m_current->counter)
+      {
+         publish(upcoming);
+         continue;
+      }
+
+      // Sleep until 'lead' seconds before the step after it starts
+      const quint64 refreshAt = totp_expire_time(m_options.epoch + upcoming * m_options.timeStep, m_options.epoch, std::max(m_options.timeStep, 1u)) -
+                                static_cast<quint64>(m_options.lead.count());
+      m_wake.wait_for(lock, std::chrono::seconds(refreshAt > now ? refreshAt - now : 1));
+   }
+}
+
+// Refer to the detailed documentation in totpcache.h for complete information about this function.
+std::optional<int> libqotp::TotpCache::verify(qsizetype index, quint32 code, quint64 currentUnixTime) const
+{
+   const Table *table = m_table.load(std::memory_order_acquire);
+   if (index < 0 || static_cast<std::size_t>(index) >= table->keys->size() || m_options.timeStep == 0 ||
+       currentUnixTime < m_options.epoch || m_options.window > static_cast<unsigned int>(std::numeric_limits<int>::max()))
+   {
+      return std::nullopt;
+   }
+
+   const quint64 counter = counterAt(currentUnixTime);
+   const quint64 window = m_options.window;
+   const quint64 first = counter >= window ? counter - window : 0;
+   const quint64 last = counter <= std::numeric_limits<quint64>::max() - window ? counter + window : std::numeric_limits<quint64>::max();
+
+   if (first < table->base || last - table->base >= table->span)
+   {
+      // Not in the table, for example because the refresh for this step is late
+      ++m_misses;
+      return libqotp::totp_verify((*table->keys)[static_cast<std::size_t>(index)], code, currentUnixTime, m_options.window,
+                                  m_options.timeStep, m_options.epoch, m_options.digits);
+   }
+
+   const quint32 *codes = table->codes.data() + static_cast<std::size_t>(index) * table->span + (first - table->base);
+
+   // Same constant time selection as totp_verify(): every code of the window is compared, and among
+   // several matches the one closest to the current step wins
+   detail::WindowMatch match;
+   for (quint64 candidate = first;; ++candidate)
+   {
+      match.add(static_cast<qint64>(candidate - counter), codes[candidate - first], code);
+      if (candidate == last)
+      {
+         break;
+      }
+   }
+   return match.result();
+}
+
+// Refer to the detailed documentation in totpcache.h for complete information about this function.
+libqotp::TotpCacheStats libqotp::TotpCache::stats() const
+{
+   TotpCacheStats result;
+   result.refreshes = m_refreshes.load(std::memory_order_relaxed);
+   result.misses = m_misses.load(std::memory_order_relaxed);
+   result.lastRefresh = std::chrono::microseconds(m_lastRefresh.load(std::memory_order_relaxed));
+   return result;
+}
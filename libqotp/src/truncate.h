@@ -0,0 +1,128 @@
+#ifndef LIBQOTP_TRUNCATE_H_20261018
+#define LIBQOTP_TRUNCATE_H_20261018
+
+#include <cstdint>
+
+// Internal helpers for the final HOTP stage: dynamic truncation and decimal formatting.
+//
+// Both work on plain integers and caller-provided buffers, so the generation path does not
+// allocate and does not go through floating point.
+namespace libqotp::detail
+{
+   // The longest code a 31-bit truncated value can produce.
+   inline constexpr unsigned int max_code_digits = 10;
+
+   // Marks a value that could not be computed. Real values are below 2^31, so this never collides.
+   inline constexpr std::uint32_t invalid_code = 0xffffffffu;
+
+   // 10^n for every digit count that needs a reduction. Ten digits never need one,
+   // because the truncated value is below 2^31 < 10^10.
+   inline constexpr std::uint32_t powers_of_ten[max_code_digits] = {
+      1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u
+   };
+
+   /**
+    * The digit rules shared by every HOTP entry point.
+    *
+    * The RFC 4226 recommends the output OTP to be at least 6 digits long. Digits more than 8 are often not
+    * supported by OTP systems and may be harder for users. Independent of the configured range, a 31-bit
+    * truncated hash cannot produce more than 10 digits.
+    */
+   inline bool valid_digits(unsigned int digits, unsigned int digitMinimum, unsigned int digitMaximum)
+   {
+      return digits >= digitMinimum && digits <= digitMaximum && digits > 0 && digits <= max_code_digits;
+   }
+
+   /**
+    * Dynamic truncation as described in RFC 4226 section 5.3.
+    *
+    * Returns false if the offset taken from the last byte does not leave four bytes in the hash.
+    */
+   inline bool dynamic_truncate(const std::uint8_t *hash, int hashLength, std::uint32_t &truncatedHash)
+   {
+      const int offset = hash[hashLength - 1] & 0xf;
+      if (offset > hashLength - 4)
+      {
+         // Ensuring offset is within the bounds of the hash array to prevent out-of-bounds access.
+         return false;
+      }
+
+      truncatedHash = (static_cast<std::uint32_t>(hash[offset] & 0x7f) << 24) |
+                      (static_cast<std::uint32_t>(hash[offset + 1]) << 16) |
+                      (static_cast<std::uint32_t>(hash[offset + 2]) << 8) |
+                      (static_cast<std::uint32_t>(hash[offset + 3]));
+      return true;
+   }
+
+   /**
+    * Dynamic truncation for a hash length known at compile time. The offset taken from the last byte is
+    * at most 15, so for every supported hash the four bytes after it are in bounds and no check is needed.
+    */
+   template <int HashLength>
+   inline std::uint32_t dynamic_truncate(const std::uint8_t *hash)
+   {
+      static_assert(HashLength >= 19, "The offset must leave four bytes in the hash");
+
+      const int offset = hash[HashLength - 1] & 0xf;
+      return (static_cast<std::uint32_t>(hash[offset] & 0x7f) << 24) |
+             (static_cast<std::uint32_t>(hash[offset + 1]) << 16) |
+             (static_cast<std::uint32_t>(hash[offset + 2]) << 8) |
+             (static_cast<std::uint32_t>(hash[offset + 3]));
+   }
+
+   /**
+    * Reduces a truncated hash to 'digits' decimal digits. 'digits' must be in [1, max_code_digits].
+    */
+   inline std::uint32_t reduce_to_digits(std::uint32_t truncatedHash, unsigned int digits)
+   {
+      return digits < max_code_digits ? truncatedHash % powers_of_ten[digits] : truncatedHash;
+   }
+
+   /**
+    * Writes 'counter' as the 8 byte big-endian HOTP message.
+    */
+   inline void write_counter(std::uint64_t counter, std::uint8_t *bytes)
+   {
+      for (int i = 7; i >= 0; --i)
+      {
+         bytes[i] = static_cast<std::uint8_t>(counter);
+         counter >>= 8;
+      }
+   }
+
+   /**
+    * Returns 1 if 'a' equals 'b' and 0 otherwise, without a data-dependent branch.
+    */
+   inline std::uint32_t equal_mask(std::uint32_t a, std::uint32_t b)
+   {
+      const std::uint32_t difference = a ^ b;
+      return ((difference | (0u - difference)) >> 31) ^ 1u;
+   }
+
+   /**
+    * Writes 'value' as exactly 'digits' zero-padded ASCII digits. No terminator is written.
+    */
+   inline void write_digits(std::uint32_t value, unsigned int digits, char *output)
+   {
+      for (unsigned int i = digits; i > 0; --i)
+      {
+         output[i - 1] = static_cast<char>('0' + value % 10);
+         value /= 10;
+      }
+   }
+
+   /**
+    * Writes 'value' as exactly 'Digits' zero-padded ASCII digits. The loop has a constant trip count and is unrolled.
+    */
+   template <unsigned int Digits>
+   inline void write_digits(std::uint32_t value, char *output)
+   {
+      for (unsigned int i = Digits; i > 0; --i)
+      {
+         output[i - 1] = static_cast<char>('0' + value % 10);
+         value /= 10;
+      }
+   }
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include <QtTest>
+
+#include <libqotp/asyncverifier.h>
+
+#include <atomic>
+#include <limits>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+class test_asyncverifier : public QObject
+{
+   Q_OBJECT
+
+   // 94287082 is the code of time step 1 of the RFC 6238 SHA-1 secret
+   const libqotp::OtpKey sha1Key{"12345678901234567890"};
+
+private slots:
+   void test_verify()
+   {
+      libqotp::AsyncVerifier verifier;
+
+      QFuture<bool> valid = verifier.verify(sha1Key, 94287082u, 59);
+      QFuture<bool> previous = verifier.verify(sha1Key, 94287082u, 89);
+      QFuture<bool> outside = verifier.verify(sha1Key, 94287082u, 119);
+      QFuture<bool> wrong = verifier.verify(sha1Key, 12345678u, 59);
+
+      QVERIFY(valid.result());
+      QVERIFY(previous.result());
+      QVERIFY(!outside.result());
+      QVERIFY(!wrong.result());
+
+      // RFC 6238 appendix B, other algorithms go to their own batches
+      const libqotp::OtpKey sha256("12345678901234567890123456789012", QCryptographicHash::Sha256);
+      const libqotp::OtpKey sha512("1234567890123456789012345678901234567890123456789012345678901234", QCryptographicHash::Sha512);
+      QFuture<bool> valid256 = verifier.verify(sha256, 68084774u, 1111111109);
+      QFuture<bool> valid512 = verifier.verify(sha512, 25091201u, 1111111109);
+      QVERIFY(valid256.result());
+      QVERIFY(valid512.result());
+
+      // Invalid input is answered without being queued
+      const quint64 queued = verifier.stats().requests;
+      QFuture<bool> invalid = verifier.verify(libqotp::OtpKey(), 94287082u, 59);
+      QVERIFY(invalid.isFinished());
+      QVERIFY(!invalid.result());
+      QCOMPARE(verifier.stats().requests, queued);
+   }
+
+   void test_callback()
+   {
+      libqotp::AsyncVerifier verifier;
+
+      std::atomic<int> accepted = 0;
+      std::atomic<int> rejected = 0;
+      for (int i = 0; i < 10; ++i)
+      {
+         verifier.verify(sha1Key, i % 2 ? 94287082u : 1u, [&](bool valid) { ++(valid ? accepted : rejected); }, 59);
+      }
+      verifier.waitForDone();
+
+      QCOMPARE(accepted.load(), 5);
+      QCOMPARE(rejected.load(), 5);
+      QCOMPARE(verifier.stats().completed, quint64(10));
+   }
+
+   void test_generate()
+   {
+      libqotp::AsyncVerifierOptions options;
+      options.maxDelay = std::chrono::hours(1);
+      libqotp::AsyncVerifier verifier(options);
+
+      // Generations share the batch of verifications
+      std::atomic<quint32> generated = 0;
+      std::atomic<bool> valid = false;
+      verifier.generate(sha1Key, [&](std::optional<quint32> code) { generated = code.value_or(0); }, 59);
+      verifier.verify(sha1Key, 94287082u, [&](bool result) { valid = result; }, 59);
+
+      // A request stopped before its batch runs is answered without a result
+      std::stop_source stop;
+      std::atomic<int> cancelled = 0;
+      verifier.generate(sha1Key, [&](std::optional<quint32> code) { cancelled += !code; }, 59, stop.get_token());
+      verifier.verify(sha1Key, 94287082u, [&](bool result) { cancelled += !result; }, 59, stop.get_token());
+      stop.request_stop();
+
+      verifier.waitForDone();
+      QCOMPARE(generated.load(), 94287082u);
+      QVERIFY(valid);
+      QCOMPARE(cancelled.load(), 2);
+      QCOMPARE(verifier.stats().batches, quint64(1));
+
+      // Invalid input is answered on the pool as well, not on the calling thread
+      std::optional<quint32> invalid = 1;
+      std::atomic<bool> invalidValid = true;
+      std::atomic<bool> callerThread = false;
+      const std::thread::id caller = std::this_thread::get_id();
+      verifier.generate(libqotp::OtpKey(), [&](std::optional<quint32> code)
+      {
+         invalid = code;
+         callerThread = callerThread || std::this_thread::get_id() == caller;
+      }, 59);
+      verifier.verify(libqotp::OtpKey(), 94287082u, [&](bool result)
+      {
+         invalidValid = result;
+         callerThread = callerThread || std::this_thread::get_id() == caller;
+      }, 59);
+      verifier.waitForDone();
+      QCOMPARE(invalid, std::optional<quint32>());
+      QVERIFY(!invalidValid);
+      QVERIFY(!callerThread);
+   }
+
+   void test_window()
+   {
+      // The window is clamped to the range totp_verify() accepts
+      libqotp::AsyncVerifierOptions options;
+      options.window = std::numeric_limits<unsigned int>::max();
+      libqotp::AsyncVerifier clamped(options);
+      QCOMPARE(clamped.options().window, static_cast<unsigned int>(std::numeric_limits<int>::max()));
+
+      options.window = 2;
+      libqotp::AsyncVerifier verifier(options);
+      QCOMPARE(verifier.options().window, 2u);
+      QVERIFY(verifier.verify(sha1Key, 94287082u, 59 + 60).result());
+      QVERIFY(!verifier.verify(sha1Key, 94287082u, 59 + 90).result());
+   }
+
+   void test_batch_size()
+   {
+      // Without the delay only full batches are started
+      libqotp::AsyncVerifierOptions options;
+      options.maxBatchSize = 4;
+      options.maxDelay = std::chrono::hours(1);
+      libqotp::AsyncVerifier verifier(options);
+
+      std::vector<QFuture<bool>> results;
+      for (int i = 0; i < 10; ++i)
+      {
+         results.push_back(verifier.verify(sha1Key, 94287082u, 59));
+      }
+      results[7].waitForFinished();
+
+      libqotp::AsyncVerifierStats stats = verifier.stats();
+      QCOMPARE(stats.requests, quint64(10));
+      QCOMPARE(stats.batches, quint64(2));
+      QCOMPARE(stats.fullBatches, quint64(2));
+      QCOMPARE(stats.queueDepth, qsizetype(2));
+      QCOMPARE(stats.largestBatch, qsizetype(4));
+      QVERIFY(!results[9].isFinished());
+
+      // The rest is started by flush()
+      verifier.flush();
+      QVERIFY(results[9].result());
+
+      stats = verifier.stats();
+      QCOMPARE(stats.batches, quint64(3));
+      QCOMPARE(stats.fullBatches, quint64(2));
+      QCOMPARE(stats.queueDepth, qsizetype(0));
+      QCOMPARE(stats.peakQueueDepth, qsizetype(4));
+      QCOMPARE(stats.averageBatchSize(), 10.0 / 3.0);
+   }
+
+   void test_delay()
+   {
+      // Batches that never fill up are started by the timer
+      libqotp::AsyncVerifierOptions options;
+      options.maxBatchSize = 1000;
+      options.maxDelay = std::chrono::microseconds(100);
+      libqotp::AsyncVerifier verifier(options);
+
+      QFuture<bool> first = verifier.verify(sha1Key, 94287082u, 59);
+      QFuture<bool> second = verifier.verify(sha1Key, 94287082u, 59);
+      QVERIFY(first.result());
+      QVERIFY(second.result());
+      QCOMPARE(verifier.stats().fullBatches, quint64(0));
+
+      // No delay at all starts every request on its own
+      options.maxDelay = std::chrono::microseconds(0);
+      libqotp::AsyncVerifier immediate(options);
+      QVERIFY(immediate.verify(sha1Key, 94287082u, 59).result());
+      QVERIFY(immediate.verify(sha1Key, 94287082u, 59).result());
+      QCOMPARE(immediate.stats().batches, quint64(2));
+   }
+
+   void test_threads()
+   {
+      libqotp::AsyncVerifierOptions options;
+      options.maxBatchSize = 32;
+      libqotp::AsyncVerifier verifier(options);
+
+      // Every thread submits valid and invalid codes and checks each result
+      constexpr int threadCount = 8;
+      constexpr int perThread = 500;
+      std::atomic<int> mismatches = 0;
+      std::vector<std::thread> threads;
+      for (int t = 0; t < threadCount; ++t)
+      {
+         threads.emplace_back([&, t]()
+         {
+            std::vector<QFuture<bool>> results;
+            for (int i = 0; i < perThread; ++i)
+            {
+               results.push_back(verifier.verify(sha1Key, (i + t) % 3 ? 94287082u : 94287083u, 59));
+            }
+            for (int i = 0; i < perThread; ++i)
+            {
+               mismatches += results[i].result() != ((i + t) % 3 != 0);
+            }
+         });
+      }
+      for (std::thread &thread : threads)
+      {
+         thread.join();
+      }
+
+      QCOMPARE(mismatches.load(), 0);
+      verifier.waitForDone();
+      const libqotp::AsyncVerifierStats stats = verifier.stats();
+      QCOMPARE(stats.completed, quint64(threadCount * perThread));
+      QCOMPARE(stats.batched, quint64(threadCount * perThread));
+      QVERIFY(stats.largestBatch <= 32);
+   }
+
+   void test_destructor()
+   {
+      // Waiting requests are completed before the verifier goes away
+      std::atomic<int> accepted = 0;
+      {
+         libqotp::AsyncVerifierOptions options;
+         options.maxDelay = std::chrono::hours(1);
+         libqotp::AsyncVerifier verifier(options);
+         for (int i = 0; i < 3; ++i)
+         {
+            verifier.verify(sha1Key, 94287082u, [&](bool valid) { accepted += valid; }, 59);
+         }
+      }
+      QCOMPARE(accepted.load(), 3);
+   }
+};
+
+QTEST_MAIN(test_asyncverifier)
+
+#include "test_asyncverifier.moc"
@@ -0,0 +1,204 @@
+#include <QtTest>
+
+#include <libqotp/awaitable.h>
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <stop_token>
+#include <thread>
+
+// A coroutine that starts when called and frees itself when it returns
+struct Task
+{
+   struct promise_type
+   {
+      Task get_return_object() { return {}; }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+   };
+};
+
+// What a coroutine saw after its await
+struct Outcome
+{
+   std::atomic<bool> done = false;
+   bool valid = false;
+   std::optional<quint32> code;
+   QThread *thread = nullptr;
+};
+
+class test_awaitable : public QObject
+{
+   Q_OBJECT
+
+   // 94287082 is the code of time step 1 of the RFC 6238 SHA-1 secret
+   const libqotp::OtpKey sha1Key{"12345678901234567890"};
+
+   static Task verify(libqotp::AsyncVerifier &verifier, const libqotp::OtpKey &key, quint32 code, std::stop_token stopToken, Outcome &outcome)
+   {
+      outcome.valid = co_await libqotp::totp_verify_async(verifier, key, code, stopToken, 59);
+      outcome.thread = QThread::currentThread();
+      outcome.done = true;
+   }
+
+   static Task generate(libqotp::AsyncVerifier &verifier, const libqotp::OtpKey &key, std::stop_token stopToken, Outcome &outcome)
+   {
+      outcome.code = co_await libqotp::totp_async(verifier, key, stopToken, 59);
+      outcome.thread = QThread::currentThread();
+      outcome.done = true;
+   }
+
+   // Issues both requests before awaiting the first, so they can share a batch
+   static Task generateAndVerify(libqotp::AsyncVerifier &verifier, const libqotp::OtpKey &key, Outcome &outcome)
+   {
+      libqotp::GenerateAwaitable generated = libqotp::totp_async(verifier, key, {}, 59);
+      libqotp::VerifyAwaitable verified = libqotp::totp_verify_async(verifier, key, 94287082u, {}, 59);
+      outcome.code = co_await generated;
+      outcome.valid = co_await verified;
+      outcome.thread = QThread::currentThread();
+      outcome.done = true;
+   }
+
+private slots:
+   void test_verify()
+   {
+      libqotp::AsyncVerifier verifier;
+
+      Outcome valid;
+      Outcome wrong;
+      verify(verifier, sha1Key, 94287082u, {}, valid);
+      verify(verifier, sha1Key, 12345678u, {}, wrong);
+
+      QTRY_VERIFY(valid.done && wrong.done);
+      QVERIFY(valid.valid);
+      QVERIFY(!wrong.valid);
+
+      // The coroutines continue on this thread, not on the pool
+      QCOMPARE(valid.thread, QThread::currentThread());
+      QCOMPARE(wrong.thread, QThread::currentThread());
+
+      // Invalid input is answered on the pool and resumes like any other result
+      Outcome invalid;
+      verify(verifier, libqotp::OtpKey(), 94287082u, {}, invalid);
+      QTRY_VERIFY(invalid.done);
+      QVERIFY(!invalid.valid);
+      QCOMPARE(invalid.thread, QThread::currentThread());
+   }
+
+   void test_generate()
+   {
+      libqotp::AsyncVerifier verifier;
+
+      Outcome generated;
+      generate(verifier, sha1Key, {}, generated);
+      QTRY_VERIFY(generated.done);
+      QCOMPARE(generated.code, std::optional<quint32>(94287082u));
+      QCOMPARE(generated.thread, QThread::currentThread());
+
+      Outcome invalid;
+      generate(verifier, libqotp::OtpKey(), {}, invalid);
+      QTRY_VERIFY(invalid.done);
+      QCOMPARE(invalid.code, std::optional<quint32>());
+   }
+
+   void test_batch()
+   {
+      // Awaits issued together are verified and generated in one batch
+      libqotp::AsyncVerifierOptions options;
+      options.maxBatchSize = 16;
+      options.maxDelay = std::chrono::hours(1);
+      libqotp::AsyncVerifier verifier(options);
+
+      Outcome outcomes[15];
+      for (int i = 0; i < 7; ++i)
+      {
+         verify(verifier, sha1Key, i % 2 ? 94287082u : 1u, {}, outcomes[i]);
+         generate(verifier, sha1Key, {}, outcomes[7 + i]);
+      }
+      QCOMPARE(verifier.stats().batches, quint64(0));
+      generateAndVerify(verifier, sha1Key, outcomes[14]);
+
+      QTRY_VERIFY(std::all_of(std::begin(outcomes), std::end(outcomes), [](const Outcome &outcome) { return outcome.done.load(); }));
+      for (int i = 0; i < 7; ++i)
+      {
+         QCOMPARE(outcomes[i].valid, i % 2 != 0);
+         QCOMPARE(outcomes[7 + i].code, std::optional<quint32>(94287082u));
+      }
+      QVERIFY(outcomes[14].valid);
+      QCOMPARE(outcomes[14].code, std::optional<quint32>(94287082u));
+
+      const libqotp::AsyncVerifierStats stats = verifier.stats();
+      QCOMPARE(stats.batches, quint64(1));
+      QCOMPARE(stats.largestBatch, qsizetype(16));
+   }
+
+   void test_cancel()
+   {
+      libqotp::AsyncVerifierOptions options;
+      options.maxDelay = std::chrono::hours(1);
+      libqotp::AsyncVerifier verifier(options);
+
+      // Stopping resumes the coroutines without waiting for the batch
+      std::stop_source stop;
+      Outcome verified;
+      Outcome generated;
+      verify(verifier, sha1Key, 94287082u, stop.get_token(), verified);
+      generate(verifier, sha1Key, stop.get_token(), generated);
+      QVERIFY(!verified.done && !generated.done);
+
+      stop.request_stop();
+      QTRY_VERIFY(verified.done && generated.done);
+      QVERIFY(!verified.valid);
+      QCOMPARE(generated.code, std::optional<quint32>());
+      QCOMPARE(verified.thread, QThread::currentThread());
+      QCOMPARE(generated.thread, QThread::currentThread());
+
+      // The batch skips the cancelled requests and the late results are dropped
+      verifier.waitForDone();
+      QCOMPARE(verifier.stats().completed, quint64(2));
+      QVERIFY(!verified.valid);
+
+      // A token stopped before the await does not suspend
+      Outcome early;
+      verify(verifier, sha1Key, 94287082u, stop.get_token(), early);
+      QVERIFY(early.done);
+      QVERIFY(!early.valid);
+      verifier.waitForDone();
+   }
+
+   void test_threads()
+   {
+      libqotp::AsyncVerifier verifier;
+
+      // A coroutine started on a thread with an event loop continues there
+      QThread thread;
+      thread.start();
+      QObject context;
+      context.moveToThread(&thread);
+
+      Outcome outcome;
+      QMetaObject::invokeMethod(&context, [&]() { verify(verifier, sha1Key, 94287082u, {}, outcome); }, Qt::QueuedConnection);
+      QTRY_VERIFY(outcome.done);
+      QVERIFY(outcome.valid);
+      QCOMPARE(outcome.thread, &thread);
+
+      thread.quit();
+      QVERIFY(thread.wait());
+
+      // Without an event loop it continues on the thread that delivered the result
+      Outcome unlooped;
+      std::thread([&]() { generate(verifier, sha1Key, {}, unlooped); }).join();
+      QTRY_VERIFY(unlooped.done);
+      QCOMPARE(unlooped.code, std::optional<quint32>(94287082u));
+   }
+};
+
+QTEST_MAIN(test_awaitable)
+
+#include "test_awaitable.moc"
@@ -0,0 +1,191 @@
+#include <QtTest>
+
+#include <libqotp/qotp.h>
+
+class test_base32 : public QObject
+{
+   Q_OBJECT
+
+private:
+   // Straightforward RFC 4648 encoder used to produce inputs of any length
+   static QString encode(const QByteArray &data)
+   {
+      static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+      QString encoded;
+      quint32 bitBuffer = 0;
+      int currentBits = 0;
+      for (char byte : data)
+      {
+         bitBuffer = (bitBuffer << 8) | static_cast<quint8>(byte);
+         currentBits += 8;
+         while (currentBits >= 5)
+         {
+            currentBits -= 5;
+            encoded.append(QLatin1Char(alphabet[(bitBuffer >> currentBits) & 0x1f]));
+         }
+      }
+
+      if (currentBits > 0)
+      {
+         encoded.append(QLatin1Char(alphabet[(bitBuffer << (5 - currentBits)) & 0x1f]));
+      }
+      return encoded;
+   }
+
+private slots:
+   void test_rfc4648()
+   {
+      // RFC 4648 section 10
+      QCOMPARE(libqotp::base32_decode(QString()), QByteArray());
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MY======")), QByteArray("f"));
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZXQ====")), QByteArray("fo"));
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZXW6===")), QByteArray("foo"));
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZXW6YQ=")), QByteArray("foob"));
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZXW6YTB")), QByteArray("fooba"));
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZXW6YTBOI======")), QByteArray("foobar"));
+
+      // Case-insensitive, padding optional
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("mzxw6ytboi")), QByteArray("foobar"));
+   }
+
+   void test_long_input()
+   {
+      // Lengths around the 16 and 32 character blocks of the vectorized decoders
+      for (int length : {9, 10, 11, 19, 20, 21, 39, 40, 41, 100, 1000})
+      {
+         QByteArray data(length, Qt::Uninitialized);
+         for (int i = 0; i < length; ++i)
+         {
+            data[i] = static_cast<char>(i * 37 + 11);
+         }
+
+         const QString encoded = encode(data);
+         QCOMPARE(libqotp::base32_decode(encoded), data);
+         QCOMPARE(libqotp::base32_decode(encoded.toLower()), data);
+      }
+   }
+
+   void test_buffer()
+   {
+      const QString encoded = QStringLiteral("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ");
+      QCOMPARE(libqotp::base32_decoded_size(encoded.size()), 20);
+
+      char buffer[20];
+      const libqotp::Base32DecodeResult result = libqotp::base32_decode(encoded, std::span<char>(buffer));
+      QVERIFY(result.isValid());
+      QCOMPARE(result.size, 20);
+      QCOMPARE(QByteArray(buffer, result.size), QByteArray("12345678901234567890"));
+
+      // One byte short
+      const libqotp::Base32DecodeResult tooSmall = libqotp::base32_decode(encoded, std::span<char>(buffer, 19));
+      QVERIFY(tooSmall.error == libqotp::Base32Error::OutputTooSmall);
+   }
+
+   void test_in_place()
+   {
+      // Latin-1 input decoded over itself, across the vector block sizes
+      for (int length : {5, 10, 20, 40, 41, 200})
+      {
+         QByteArray data(length, Qt::Uninitialized);
+         for (int i = 0; i < length; ++i)
+         {
+            data[i] = static_cast<char>(i * 53 + 7);
+         }
+
+         QByteArray buffer = encode(data).toLatin1();
+         const libqotp::Base32DecodeResult result = libqotp::base32_decode(QByteArrayView(buffer), std::span<char>(buffer.data(), buffer.size()));
+         QVERIFY(result.isValid());
+         QCOMPARE(QByteArray(buffer.constData(), result.size), data);
+      }
+
+      QByteArray invalid("MZXW6YTB1");
+      const libqotp::Base32DecodeResult result = libqotp::base32_decode(QByteArrayView(invalid), std::span<char>(invalid.data(), invalid.size()));
+      QVERIFY(result.error == libqotp::Base32Error::InvalidCharacter);
+      QCOMPARE(result.position, 8);
+   }
+
+   void test_errors()
+   {
+      char buffer[64];
+
+      // The position points at the offending character, also behind a vectorized block
+      libqotp::Base32DecodeResult result = libqotp::base32_decode(QStringLiteral("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ1ABC"), std::span<char>(buffer));
+      QVERIFY(result.error == libqotp::Base32Error::InvalidCharacter);
+      QCOMPARE(result.position, 32);
+
+      result = libqotp::base32_decode(QStringLiteral("MZXW6==A"), std::span<char>(buffer));
+      QVERIFY(result.error == libqotp::Base32Error::CharacterAfterPadding);
+      QCOMPARE(result.position, 7);
+
+      // Whitespace and characters outside Latin-1 are not part of the alphabet
+      result = libqotp::base32_decode(QStringLiteral("MZXW 6YTB"), std::span<char>(buffer));
+      QVERIFY(result.error == libqotp::Base32Error::InvalidCharacter);
+      QCOMPARE(result.position, 4);
+
+      result = libqotp::base32_decode(QStringView(u"MZXW6YTB\u0141"), std::span<char>(buffer));
+      QVERIFY(result.error == libqotp::Base32Error::InvalidCharacter);
+      QCOMPARE(result.position, 8);
+
+      // The QByteArray overloads return an empty array
+      libqotp::Base32Error error = libqotp::Base32Error::None;
+      QCOMPARE(libqotp::base32_decode(QStringView(u"MZ1W"), error), QByteArray());
+      QVERIFY(error == libqotp::Base32Error::InvalidCharacter);
+      QCOMPARE(libqotp::base32_decode(QStringLiteral("MZ1W")), QByteArray());
+   }
+
+   void test_encode_rfc4648()
+   {
+      // RFC 4648 section 10
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("")), QString());
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("f")), QStringLiteral("MY======"));
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("fo")), QStringLiteral("MZXQ===="));
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("foo")), QStringLiteral("MZXW6==="));
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("foob")), QStringLiteral("MZXW6YQ="));
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("fooba")), QStringLiteral("MZXW6YTB"));
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("foobar")), QStringLiteral("MZXW6YTBOI======"));
+   }
+
+   void test_encode_options()
+   {
+      const auto data = QByteArrayView("foobar");
+      QCOMPARE(libqotp::base32_encode(data, libqotp::Base32Option::OmitPadding), QStringLiteral("MZXW6YTBOI"));
+      QCOMPARE(libqotp::base32_encode(data, libqotp::Base32Option::Lowercase), QStringLiteral("mzxw6ytboi======"));
+      QCOMPARE(libqotp::base32_encode(data, libqotp::Base32Option::OmitPadding | libqotp::Base32Option::Lowercase), QStringLiteral("mzxw6ytboi"));
+
+      QCOMPARE(libqotp::base32_encoded_size(6), 16);
+      QCOMPARE(libqotp::base32_encoded_size(6, libqotp::Base32Option::OmitPadding), 10);
+   }
+
+   void test_encode_long_input()
+   {
+      // Lengths around the 10 and 20 byte blocks of the vectorized encoders
+      for (int length : {9, 10, 11, 19, 20, 21, 39, 40, 41, 100, 1000})
+      {
+         QByteArray data(length, Qt::Uninitialized);
+         for (int i = 0; i < length; ++i)
+         {
+            data[i] = static_cast<char>(i * 37 + 11);
+         }
+
+         const QString encoded = libqotp::base32_encode(data, libqotp::Base32Option::OmitPadding);
+         QCOMPARE(encoded, encode(data));
+         QCOMPARE(libqotp::base32_encode(data, libqotp::Base32Option::OmitPadding | libqotp::Base32Option::Lowercase), encoded.toLower());
+         QCOMPARE(libqotp::base32_decode(libqotp::base32_encode(data)), data);
+      }
+   }
+
+   void test_encode_buffer()
+   {
+      char buffer[32];
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("12345678901234567890"), std::span<char>(buffer)), 32);
+      QCOMPARE(QByteArray(buffer, 32), QByteArray("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ"));
+
+      // Too small
+      QCOMPARE(libqotp::base32_encode(QByteArrayView("12345678901234567890"), std::span<char>(buffer, 31)), -1);
+   }
+};
+
+QTEST_MAIN(test_base32)
+
+#include "test_base32.moc"
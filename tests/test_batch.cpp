@@ -0,0 +1,134 @@
+#include <QtTest>
+#include <QThreadPool>
+
+#include <libqotp/batch.h>
+
+#include <vector>
+
+class test_batch : public QObject
+{
+   Q_OBJECT
+
+private:
+   // Distinct secrets, every 50th one empty and therefore invalid
+   static std::vector<QByteArray> make_secrets(int count)
+   {
+      std::vector<QByteArray> secrets;
+      secrets.reserve(count);
+      for (int i = 0; i < count; ++i)
+      {
+         secrets.push_back(i % 50 == 0 ? QByteArray() : QByteArray("secret-") + QByteArray::number(i));
+      }
+      return secrets;
+   }
+
+private slots:
+   void test_totp_keys_data()
+   {
+      QTest::addColumn<int>("maxThreads");
+
+      QTest::addRow("pool") << 0;
+      QTest::addRow("caller only") << 1;
+      QTest::addRow("three threads") << 3;
+   }
+
+   void test_totp_keys()
+   {
+      QFETCH(int, maxThreads);
+
+      const auto secrets = make_secrets(5000);
+      std::vector<libqotp::OtpKey> keys;
+      for (std::size_t i = 0; i < secrets.size(); ++i)
+      {
+         keys.emplace_back(secrets[i], i % 3 == 0 ? QCryptographicHash::Sha256 : QCryptographicHash::Sha1);
+      }
+
+      libqotp::BatchOptions options;
+      options.maxThreads = maxThreads;
+      options.minimumPerThread = 500;
+
+      std::vector<quint32> values(keys.size());
+      QVERIFY(libqotp::totp_batch(keys, 1700000000, values, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, options));
+
+      // Every entry matches the single-key result at its own index
+      for (std::size_t i = 0; i < keys.size(); ++i)
+      {
+         const auto expected = libqotp::totp_value(keys[i], 1700000000);
+         QCOMPARE(values[i], expected.value_or(libqotp::invalid_batch_value));
+      }
+   }
+
+   void test_totp_secrets()
+   {
+      const auto secrets = make_secrets(1000);
+      const std::vector<QByteArrayView> views(secrets.begin(), secrets.end());
+
+      std::vector<quint32> values(views.size());
+      QVERIFY(libqotp::totp_batch(views, 1700000000, values, 30, 0, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha512));
+
+      for (std::size_t i = 0; i < views.size(); ++i)
+      {
+         const auto expected = libqotp::totp_value(views[i], 1700000000, 30, 0, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha512);
+         QCOMPARE(values[i], expected.value_or(libqotp::invalid_batch_value));
+      }
+   }
+
+   void test_hotp()
+   {
+      const auto secrets = make_secrets(1000);
+      const std::vector<QByteArrayView> views(secrets.begin(), secrets.end());
+      std::vector<libqotp::OtpKey> keys(secrets.begin(), secrets.end());
+
+      std::vector<quint64> counters;
+      for (std::size_t i = 0; i < secrets.size(); ++i)
+      {
+         counters.push_back(i * 31);
+      }
+
+      std::vector<quint32> fromKeys(keys.size());
+      std::vector<quint32> fromSecrets(views.size());
+      QVERIFY(libqotp::hotp_batch(keys, counters, fromKeys));
+      QVERIFY(libqotp::hotp_batch(views, counters, fromSecrets));
+
+      for (std::size_t i = 0; i < keys.size(); ++i)
+      {
+         const auto expected = libqotp::hotp_value(keys[i], counters[i]);
+         QCOMPARE(fromKeys[i], expected.value_or(libqotp::invalid_batch_value));
+         QCOMPARE(fromSecrets[i], fromKeys[i]);
+      }
+   }
+
+   void test_rfc()
+   {
+      // RFC 6238 appendix B, SHA-1
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      const std::vector<libqotp::OtpKey> keys(3, key);
+
+      std::vector<quint32> values(keys.size());
+      QVERIFY(libqotp::totp_batch(keys, 1111111109, values));
+      QCOMPARE(values, std::vector<quint32>({7081804, 7081804, 7081804}));
+   }
+
+   void test_invalid_inputs()
+   {
+      const std::vector<libqotp::OtpKey> keys(4, libqotp::OtpKey(QByteArrayView("secret")));
+      const std::vector<quint64> counters(3, 0);
+      std::vector<quint32> values(3, 42);
+
+      // Output too small, zero time step, bad digits, mismatched counters
+      QVERIFY(!libqotp::totp_batch(keys, 0, values));
+      QVERIFY(!libqotp::totp_batch(std::span(keys).first(3), 0, values, 0));
+      QVERIFY(!libqotp::totp_batch(std::span(keys).first(3), 0, values, 30, 0, 4));
+      QVERIFY(!libqotp::hotp_batch(keys, counters, values));
+
+      // Nothing was written
+      QCOMPARE(values, std::vector<quint32>(3, 42));
+
+      // An empty batch is valid
+      QVERIFY(libqotp::totp_batch(std::span<const libqotp::OtpKey>(), 0, std::span<quint32>()));
+   }
+};
+
+QTEST_MAIN(test_batch)
+
+#include "test_batch.moc"
@@ -0,0 +1,91 @@
+#include <QtTest>
+
+#include <libqotp/clock.h>
+#include <libqotp/qotp.h>
+
+#include <limits>
+
+class test_clock : public QObject
+{
+   Q_OBJECT
+
+   // 94287082 is the code of time step 1 of the RFC 6238 SHA-1 secret
+   const libqotp::OtpKey key{"12345678901234567890"};
+
+private slots:
+   void test_system()
+   {
+      const qint64 reference = QDateTime::currentDateTimeUtc().toSecsSinceEpoch();
+      const libqotp::SystemClock system;
+      const libqotp::CoarseClock coarse;
+
+      // The coarse clock may lag by a tick, which can cross a second boundary
+      QVERIFY(qAbs(static_cast<qint64>(system.now()) - reference) <= 1);
+      QVERIFY(qAbs(static_cast<qint64>(coarse.now()) - reference) <= 1);
+      QVERIFY(qAbs(static_cast<qint64>(libqotp::current_unix_time()) - reference) <= 1);
+   }
+
+   void test_fake()
+   {
+      libqotp::FakeClock clock(59);
+      QCOMPARE(clock.now(), quint64(59));
+
+      clock.advance(30);
+      QCOMPARE(clock.now(), quint64(89));
+      clock.advance(-100);
+      QCOMPARE(clock.now(), quint64(0));
+      clock.set(1111111109);
+      QCOMPARE(clock.now(), quint64(1111111109));
+   }
+
+   void test_skewed()
+   {
+      libqotp::FakeClock base(100);
+      libqotp::SkewedClock clock(base, 3);
+      QCOMPARE(clock.now(), quint64(103));
+
+      clock.setOffset(-40);
+      QCOMPARE(clock.offset(), qint64(-40));
+      QCOMPARE(clock.now(), quint64(60));
+
+      // Clamped at both ends
+      clock.setOffset(std::numeric_limits<qint64>::min());
+      QCOMPARE(clock.now(), quint64(0));
+      base.set(std::numeric_limits<quint64>::max() - 1);
+      clock.setOffset(5);
+      QCOMPARE(clock.now(), std::numeric_limits<quint64>::max());
+   }
+
+   void test_overloads()
+   {
+      const libqotp::FakeClock clock(59);
+      QCOMPARE(libqotp::totp(key, clock), QString("94287082"));
+      QCOMPARE(libqotp::try_totp(key, clock).value(), QString("94287082"));
+      QCOMPARE(libqotp::totp_value(key, clock), std::optional<quint32>(94287082u));
+      QCOMPARE(libqotp::totp_verify(key, 94287082u, clock), std::optional<int>(0));
+      QCOMPARE(libqotp::totp_expire_time(clock), quint64(60));
+
+      // Twenty seconds of skew move the time into the next window
+      const libqotp::SkewedClock skewed(clock, 20);
+      QCOMPARE(libqotp::totp_verify(key, 94287082u, skewed), std::optional<int>(-1));
+   }
+
+   void test_default_clock()
+   {
+      const libqotp::FakeClock clock(59);
+      libqotp::set_default_clock(&clock);
+      QCOMPARE(&libqotp::default_clock(), static_cast<const libqotp::Clock *>(&clock));
+      QCOMPARE(libqotp::current_unix_time(), quint64(59));
+
+      // Every defaulted time argument follows
+      QCOMPARE(libqotp::totp(key), QString("94287082"));
+      QCOMPARE(libqotp::totp_verify(key, 94287082u), std::optional<int>(0));
+
+      libqotp::set_default_clock(nullptr);
+      QVERIFY(libqotp::current_unix_time() > 1111111109);
+   }
+};
+
+QTEST_MAIN(test_clock)
+
+#include "test_clock.moc"
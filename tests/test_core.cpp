@@ -0,0 +1,226 @@
+#include <QtTest>
+
+#include <libqotp/core/hmacbackend.h>
+#include <libqotp/core/hotprange.h>
+#include <libqotp/core/otp.h>
+#include <libqotp/qotp.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <ranges>
+#include <string_view>
+
+using namespace std::chrono_literals;
+
+class test_core : public QObject
+{
+   Q_OBJECT
+
+   static std::span<const std::byte> bytes(std::string_view text)
+   {
+      return std::as_bytes(std::span(text));
+   }
+
+   static std::chrono::sys_seconds at(std::int64_t unixTime)
+   {
+      return std::chrono::sys_seconds(std::chrono::seconds(unixTime));
+   }
+
+   static constexpr std::string_view sha1Secret = "12345678901234567890";
+   static constexpr std::string_view sha256Secret = "12345678901234567890123456789012";
+   static constexpr std::string_view sha512Secret = "1234567890123456789012345678901234567890123456789012345678901234";
+
+private slots:
+   void test_hotp_rfc()
+   {
+      // RFC 4226 appendix D
+      const libqotp::core::Key key(bytes(sha1Secret));
+      QVERIFY(key.isValid());
+      QCOMPARE(key.hashLength(), std::size_t(20));
+
+      const std::array<std::uint32_t, 10> expected = {755224, 287082, 359152, 969429, 338314, 254676, 287922, 162583, 399871, 520489};
+      for (std::uint64_t counter = 0; counter < expected.size(); ++counter)
+      {
+         QCOMPARE(libqotp::core::hotp_value(key, counter), std::optional<std::uint32_t>(expected[counter]));
+         QCOMPARE(libqotp::core::hotp_value(bytes(sha1Secret), counter), std::optional<std::uint32_t>(expected[counter]));
+      }
+
+      char buffer[10];
+      QCOMPARE(libqotp::core::hotp(key, 7, buffer), std::size_t(6));
+      QCOMPARE(std::string_view(buffer, 6), std::string_view("162583"));
+
+      // Too small buffers, invalid keys and digit counts out of range
+      QCOMPARE(libqotp::core::hotp(key, 7, std::span<char>(buffer, 5)), std::size_t(0));
+      QCOMPARE(libqotp::core::hotp(libqotp::core::Key(), 7, buffer), std::size_t(0));
+      QCOMPARE(libqotp::core::hotp_value(bytes(""), 0), std::nullopt);
+      QCOMPARE(libqotp::core::hotp_value(key, 0, 5), std::nullopt);
+   }
+
+   void test_totp_rfc()
+   {
+      // RFC 6238 appendix B
+      const libqotp::core::Key sha1(bytes(sha1Secret), libqotp::core::Algorithm::Sha1);
+      const libqotp::core::Key sha256(bytes(sha256Secret), libqotp::core::Algorithm::Sha256);
+      const libqotp::core::Key sha512(bytes(sha512Secret), libqotp::core::Algorithm::Sha512);
+
+      QCOMPARE(libqotp::core::totp_value(sha1, at(59)), std::optional<std::uint32_t>(94287082));
+      QCOMPARE(libqotp::core::totp_value(sha256, at(59)), std::optional<std::uint32_t>(46119246));
+      QCOMPARE(libqotp::core::totp_value(sha512, at(59)), std::optional<std::uint32_t>(90693936));
+      QCOMPARE(libqotp::core::totp_value(bytes(sha512Secret), at(20000000000), 30s, at(0), 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, libqotp::core::Algorithm::Sha512),
+               std::optional<std::uint32_t>(47863826));
+
+      char buffer[8];
+      QCOMPARE(libqotp::core::totp(sha1, at(1111111109), buffer), std::size_t(8));
+      QCOMPARE(std::string_view(buffer, 8), std::string_view("07081804"));
+
+      // Counters of other time steps and epochs, and times that do not have one
+      QCOMPARE(libqotp::core::totp_counter(at(1111111109), 60s, at(1000)), std::optional<std::uint64_t>(18518501));
+      QCOMPARE(libqotp::core::totp_counter(at(59), 0s), std::nullopt);
+      QCOMPARE(libqotp::core::totp_counter(at(59), 30s, at(60)), std::nullopt);
+      QCOMPARE(libqotp::core::totp_value(sha1, at(59), 30s, at(60)), std::nullopt);
+   }
+
+   void test_totp_verify()
+   {
+      const libqotp::core::Key key(bytes(sha1Secret));
+
+      // 94287082 is the code of time step 1
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(59)), std::optional<int>(0));
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(89)), std::optional<int>(-1));
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(29)), std::optional<int>(1));
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(119)), std::nullopt);
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(119), 2), std::optional<int>(-2));
+
+      QCOMPARE(libqotp::core::totp_verify(key, std::string_view("94287082"), at(59)), std::optional<int>(0));
+      QCOMPARE(libqotp::core::totp_verify(key, std::string_view("9428708"), at(59)), std::nullopt);
+      QCOMPARE(libqotp::core::totp_verify(key, std::string_view("9428708x"), at(59)), std::nullopt);
+      QCOMPARE(libqotp::core::totp_verify(bytes(sha1Secret), 94287082u, at(59)), std::optional<int>(0));
+
+      // Invalid input
+      QCOMPARE(libqotp::core::totp_verify(libqotp::core::Key(), 94287082u, at(59)), std::nullopt);
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(59), 1, 0s), std::nullopt);
+      QCOMPARE(libqotp::core::totp_verify(key, 94287082u, at(59), 1, 30s, at(60)), std::nullopt);
+   }
+
+   void test_hotp_resync()
+   {
+      const libqotp::core::Key key(bytes(sha1Secret));
+
+      // 162583 and 399871 are the codes of counters 7 and 8
+      QCOMPARE(libqotp::core::hotp_resync(key, 0, 162583u), std::optional<std::uint64_t>(8));
+      QCOMPARE(libqotp::core::hotp_resync(key, 0, 162583u, 6), std::nullopt);
+
+      const std::array<std::uint32_t, 2> codes = {162583, 399871};
+      QCOMPARE(libqotp::core::hotp_resync(key, 0, codes), std::optional<std::uint64_t>(9));
+   }
+
+   void test_hotp_range()
+   {
+      static_assert(std::ranges::forward_range<libqotp::core::HotpRange>);
+      static_assert(std::ranges::view<libqotp::core::HotpRange>);
+      static_assert(std::ranges::borrowed_range<libqotp::core::HotpRange>);
+      static_assert(!std::is_constructible_v<libqotp::core::HotpRange, libqotp::core::Key, std::uint64_t, std::uint64_t>);
+      static_assert(std::is_constructible_v<libqotp::core::HotpRange, const libqotp::core::Key &, std::uint64_t, std::uint64_t>);
+
+      // RFC 4226 appendix D
+      const libqotp::core::Key key(bytes(sha1Secret));
+      const std::array<std::uint32_t, 10> expected = {755224, 287082, 359152, 969429, 338314, 254676, 287922, 162583, 399871, 520489};
+
+      const libqotp::core::HotpRange codes(key, 0, expected.size());
+      QCOMPARE(codes.size(), std::uint64_t(10));
+      QVERIFY(std::ranges::equal(codes, expected));
+
+      // Adaptors, and a start in the middle of a block
+      auto view = libqotp::core::HotpRange(key, 2, 100) | std::views::drop(5) | std::views::take(3);
+      QVERIFY(std::ranges::equal(view, std::array<std::uint32_t, 3>{162583, 399871, 520489}));
+
+      // Runs longer than a block match single computations, also for copies taken midway
+      const libqotp::core::HotpRange run(key, 1000, 3 * libqotp::core::HotpRange::block_size + 5, 8);
+      std::uint64_t counter = 1000;
+      for (auto it = run.begin(); it != run.end(); ++it, ++counter)
+      {
+         QCOMPARE(it.counter(), counter);
+         QCOMPARE(std::optional<std::uint32_t>(*it), libqotp::core::hotp_value(key, counter, 8));
+         if (counter % 7 == 0)
+         {
+            const auto copy = std::next(it, 2);
+            QCOMPARE(std::optional<std::uint32_t>(*copy), libqotp::core::hotp_value(key, counter + 2, 8));
+         }
+      }
+      QCOMPARE(counter, std::uint64_t(1000 + run.size()));
+
+      // Codes written into one reusable buffer
+      char buffer[8];
+      auto it = codes.begin();
+      QCOMPARE(it.write(buffer), std::size_t(6));
+      QCOMPARE(std::string_view(buffer, 6), std::string_view("755224"));
+      std::advance(it, 9);
+      QCOMPARE(it.write(buffer), std::size_t(6));
+      QCOMPARE(std::string_view(buffer, 6), std::string_view("520489"));
+      QCOMPARE(it.write(std::span<char>(buffer, 5)), std::size_t(0));
+
+      // Invalid input gives an empty range, the counters never wrap around
+      const libqotp::core::Key invalid;
+      QVERIFY(libqotp::core::HotpRange(invalid, 0, 10).empty());
+      QVERIFY(libqotp::core::HotpRange(key, 0, 10, 9).empty());
+      QVERIFY(libqotp::core::HotpRange().empty());
+      constexpr std::uint64_t maximum = std::numeric_limits<std::uint64_t>::max();
+      const libqotp::core::HotpRange last(key, maximum - 1, 10);
+      QCOMPARE(last.size(), std::uint64_t(2));
+      QCOMPARE(std::optional<std::uint32_t>(*std::next(last.begin())), libqotp::core::hotp_value(key, maximum));
+   }
+
+   void test_templates()
+   {
+      using Code = libqotp::core::Hotp<libqotp::core::Algorithm::Sha1, 6>;
+      const libqotp::core::Key key(bytes(sha1Secret));
+
+      QCOMPARE(Code::value(key, 3), std::optional<std::uint32_t>(969429));
+
+      char buffer[6];
+      QVERIFY(Code::write(key, 9, buffer));
+      QCOMPARE(std::string_view(buffer, sizeof(buffer)), std::string_view("520489"));
+
+      // A key prepared for another algorithm
+      QCOMPARE((libqotp::core::Hotp<libqotp::core::Algorithm::Sha256, 6>::value(key, 3)), std::nullopt);
+
+      using Time = libqotp::core::Totp<libqotp::core::Algorithm::Sha1, 8>;
+      QCOMPARE(Time::value(key, at(59)), std::optional<std::uint32_t>(94287082));
+      QCOMPARE(Time::counter(at(59), at(60)), std::nullopt);
+   }
+
+   void test_hmac()
+   {
+      const libqotp::core::Key key(bytes(sha256Secret), libqotp::core::Algorithm::Sha256);
+
+      std::array<std::byte, 64> digest;
+      QCOMPARE(key.hmac(bytes("message"), digest), std::size_t(32));
+      QCOMPARE(key.hmac(bytes("message"), std::span(digest).first(31)), std::size_t(0));
+
+      libqotp::core::Key copy = key;
+      copy.clear();
+      QVERIFY(!copy.isValid());
+      QCOMPARE(copy.hmac(bytes("message"), digest), std::size_t(0));
+   }
+
+   void test_matches_qt()
+   {
+      // The Qt API is a wrapper around the core, both must agree
+      const libqotp::OtpKey key(QByteArrayView(sha256Secret.data(), sha256Secret.size()), QCryptographicHash::Sha256);
+      QCOMPARE(key.coreKey().algorithm(), libqotp::core::Algorithm::Sha256);
+
+      for (quint64 counter = 0; counter < 16; ++counter)
+      {
+         QCOMPARE(libqotp::hotp_value(key, counter, 8), libqotp::core::hotp_value(key.coreKey(), counter, 8));
+      }
+      QCOMPARE(libqotp::totp_verify(key, 46119246u, 59), libqotp::core::totp_verify(key.coreKey(), 46119246u, at(59)));
+
+      QCOMPARE(libqotp::core::hmac_backend_name(libqotp::core::HmacBackend::Generic), std::string_view("generic"));
+      QVERIFY(libqotp::core::hmac_backend_available(libqotp::core::hmac_backend()));
+   }
+};
+
+QTEST_MAIN(test_core)
+
+#include "test_core.moc"
@@ -0,0 +1,369 @@
+#include <QtTest>
+
+#include <libqotp/counterlog.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+class test_counterlog : public QObject
+{
+   Q_OBJECT
+
+   static QByteArray read_file(const QString &fileName)
+   {
+      QFile file(fileName);
+      return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+   }
+
+   static void write_file(const QString &fileName, const QByteArray &data)
+   {
+      QFile file(fileName);
+      QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+      QCOMPARE(file.write(data), qint64(data.size()));
+   }
+
+private slots:
+   void test_advance()
+   {
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      libqotp::CounterLog log;
+      QVERIFY(!log.isOpen());
+      QVERIFY(log.error() == libqotp::CounterLogError::NotOpen);
+      QVERIFY(log.advance(1, 1) == libqotp::CounterLogResult::Failed);
+
+      QVERIFY(log.open(fileName));
+      QVERIFY(log.error() == libqotp::CounterLogError::None);
+      QCOMPARE(log.value(1), std::optional<quint64>());
+
+      QVERIFY(log.advance(1, 5) == libqotp::CounterLogResult::Advanced);
+      QVERIFY(log.advance(1, 5) == libqotp::CounterLogResult::Stale);
+      QVERIFY(log.advance(1, 4) == libqotp::CounterLogResult::Stale);
+      QVERIFY(log.advance(1, 6) == libqotp::CounterLogResult::Advanced);
+      QVERIFY(log.advance(2, 0) == libqotp::CounterLogResult::Advanced);
+      QCOMPARE(log.value(1), std::optional<quint64>(6));
+      QCOMPARE(log.value(2), std::optional<quint64>(0));
+      QCOMPARE(log.size(), 2);
+      QCOMPARE(log.stats().records, quint64(3));
+
+      // Updates of one batch are applied in order and share a sync
+      const libqotp::CounterUpdate updates[] = {{3, 10}, {3, 9}, {3, 11}, {1, 6}, {4, 1}};
+      libqotp::CounterLogResult results[5];
+      QVERIFY(!log.advance(updates, std::span<libqotp::CounterLogResult>(results, 4)));
+      const quint64 syncs = log.stats().syncs;
+      QVERIFY(log.advance(updates, results));
+      QVERIFY(results[0] == libqotp::CounterLogResult::Advanced);
+      QVERIFY(results[1] == libqotp::CounterLogResult::Stale);
+      QVERIFY(results[2] == libqotp::CounterLogResult::Advanced);
+      QVERIFY(results[3] == libqotp::CounterLogResult::Stale);
+      QVERIFY(results[4] == libqotp::CounterLogResult::Advanced);
+      QCOMPARE(log.stats().syncs, syncs + 1);
+
+      // Everything is recovered from the log
+      log.close();
+      QVERIFY(log.advance(1, 7) == libqotp::CounterLogResult::Failed);
+
+      libqotp::CounterLog reopened;
+      QVERIFY(reopened.open(fileName));
+      QCOMPARE(reopened.stats().recovered, quint64(6));
+      QCOMPARE(reopened.stats().discarded, quint64(0));
+      QCOMPARE(reopened.value(1), std::optional<quint64>(6));
+      QCOMPARE(reopened.value(2), std::optional<quint64>(0));
+      QCOMPARE(reopened.value(3), std::optional<quint64>(11));
+      QCOMPARE(reopened.value(4), std::optional<quint64>(1));
+      QVERIFY(reopened.advance(3, 11) == libqotp::CounterLogResult::Stale);
+   }
+
+   void test_torn_log()
+   {
+      // A crash can stop the log at any byte. Every prefix recovers the records it holds completely.
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      {
+         libqotp::CounterLog log;
+         QVERIFY(log.open(fileName));
+         for (quint64 value = 1; value <= 8; ++value)
+         {
+            QVERIFY(log.advance(value % 3, value) == libqotp::CounterLogResult::Advanced);
+         }
+      }
+
+      // Each update is a group of one entry
+      const QByteArray complete = read_file(fileName + ".log");
+      const qsizetype header = 16;
+      const qsizetype group = 16 + 16;
+      QCOMPARE(complete.size(), header + 8 * group);
+
+      const QString copy = dir.filePath("copy");
+      for (qsizetype size = 0; size <= complete.size(); ++size)
+      {
+         write_file(copy + ".log", complete.left(size));
+
+         libqotp::CounterLog log;
+         QVERIFY(log.open(copy));
+
+         const qsizetype records = size < header ? 0 : (size - header) / group;
+         QCOMPARE(log.stats().recovered, quint64(records));
+         QCOMPARE(log.stats().discarded, quint64(size < header ? 0 : (size - header) % group));
+         for (quint64 user = 0; user < 3; ++user)
+         {
+            // The last value written for each user within the prefix
+            std::optional<quint64> expected;
+            for (quint64 value = 1; value <= quint64(records); ++value)
+            {
+               expected = value % 3 == user ? std::optional<quint64>(value) : expected;
+            }
+            QCOMPARE(log.value(user), expected);
+         }
+
+         // The log is usable and the tail is gone
+         QVERIFY(log.advance(7, 1) == libqotp::CounterLogResult::Advanced);
+         log.close();
+         QCOMPARE(read_file(copy + ".log").size(), header + (records + 1) * group);
+      }
+   }
+
+   void test_corruption()
+   {
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      // Four groups of one entry, then a group of four entries
+      {
+         libqotp::CounterLog log;
+         QVERIFY(log.open(fileName));
+         for (quint64 user = 0; user < 4; ++user)
+         {
+            QVERIFY(log.advance(user, 100 + user) == libqotp::CounterLogResult::Advanced);
+         }
+
+         const libqotp::CounterUpdate updates[] = {{10, 110}, {11, 111}, {12, 112}, {13, 113}};
+         libqotp::CounterLogResult results[4];
+         QVERIFY(log.advance(updates, results));
+      }
+
+      const qsizetype lastGroup = 16 + 4 * 32;
+      const QByteArray intact = read_file(fileName + ".log");
+      QCOMPARE(intact.size(), lastGroup + 16 + 4 * 16);
+
+      // A damaged group followed by intact ones is not a torn write, the log fails closed and is kept
+      QByteArray data = intact;
+      data[16 + 2 * 32 + 16 + 9] = char(data[16 + 2 * 32 + 16 + 9] ^ 0x01);
+      write_file(fileName + ".log", data);
+
+      {
+         libqotp::CounterLog log;
+         QVERIFY(!log.open(fileName));
+         QVERIFY(log.error() == libqotp::CounterLogError::ChecksumMismatch);
+         QVERIFY(!log.isOpen());
+         QCOMPARE(read_file(fileName + ".log"), data);
+      }
+
+      // The last group may reach the disk with a hole anywhere, even with intact entries behind it; it
+      // was never reported durable and is cut off as a whole
+      data = intact;
+      std::memset(data.data() + lastGroup, 0, 16);
+      write_file(fileName + ".log", data);
+
+      {
+         libqotp::CounterLog log;
+         QVERIFY(log.open(fileName));
+         QCOMPARE(log.stats().recovered, quint64(4));
+         QCOMPARE(log.stats().discarded, quint64(16 + 4 * 16));
+      }
+
+      data = intact;
+      data[lastGroup + 16 + 16 + 9] = char(data[lastGroup + 16 + 16 + 9] ^ 0x01);
+      write_file(fileName + ".log", data);
+
+      {
+         libqotp::CounterLog log;
+         QVERIFY(log.open(fileName));
+         QCOMPARE(log.stats().recovered, quint64(4));
+         QCOMPARE(log.stats().discarded, quint64(16 + 4 * 16));
+         QCOMPARE(log.value(3), std::optional<quint64>(103));
+         QCOMPARE(log.value(10), std::optional<quint64>());
+         QCOMPARE(log.value(13), std::optional<quint64>());
+         QCOMPARE(read_file(fileName + ".log").size(), lastGroup);
+         QVERIFY(log.compact());
+      }
+
+      // A damaged snapshot fails closed
+      data = read_file(fileName);
+      QCOMPARE(data.size(), 32 + 4 * 16);
+      data[40] = char(data[40] ^ 0x01);
+      write_file(fileName, data);
+
+      libqotp::CounterLog log;
+      QVERIFY(!log.open(fileName));
+      QVERIFY(log.error() == libqotp::CounterLogError::ChecksumMismatch);
+      QVERIFY(!log.isOpen());
+
+      write_file(fileName, data.left(40));
+      QVERIFY(!log.open(fileName));
+      QVERIFY(log.error() == libqotp::CounterLogError::ChecksumMismatch);
+
+      write_file(fileName, QByteArray("not a snapshot of counters, not at all"));
+      QVERIFY(!log.open(fileName));
+      QVERIFY(log.error() == libqotp::CounterLogError::NotACounterLog);
+
+      QFile::remove(fileName);
+      write_file(fileName + ".log", QByteArray("not a log of counters"));
+      QVERIFY(!log.open(fileName));
+      QVERIFY(log.error() == libqotp::CounterLogError::NotACounterLog);
+   }
+
+   void test_compaction()
+   {
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      libqotp::CounterLogOptions options;
+      options.compactBytes = 1000;
+      libqotp::CounterLog log(options);
+      QVERIFY(log.open(fileName));
+      for (quint64 value = 1; value <= 200; ++value)
+      {
+         QVERIFY(log.advance(value % 10, value) == libqotp::CounterLogResult::Advanced);
+      }
+      QVERIFY(log.stats().compactions >= 3);
+      QVERIFY(read_file(fileName + ".log").size() < 1000);
+      QCOMPARE(read_file(fileName).size(), 32 + 10 * 16);
+
+      // A crash after the snapshot was replaced but before the log was emptied replays the old log
+      QVERIFY(log.compact());
+      QVERIFY(log.advance(0, 1000) == libqotp::CounterLogResult::Advanced);
+      const QByteArray oldLog = read_file(fileName + ".log");
+      QCOMPARE(oldLog.size(), 16 + 32);
+      QVERIFY(log.compact());
+      QCOMPARE(read_file(fileName + ".log").size(), 16);
+      log.close();
+      write_file(fileName + ".log", oldLog);
+
+      QVERIFY(log.open(fileName));
+      QCOMPARE(log.size(), 10);
+      QCOMPARE(log.value(0), std::optional<quint64>(1000));
+      for (quint64 user = 1; user < 10; ++user)
+      {
+         QCOMPARE(log.value(user), std::optional<quint64>(190 + user));
+      }
+   }
+
+   void test_write_failure()
+   {
+#if defined(__linux__)
+      // The file size limit makes the next write of the log fall short, as a full disk would
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      libqotp::CounterLog log;
+      QVERIFY(log.open(fileName));
+      QVERIFY(log.advance(1, 1) == libqotp::CounterLogResult::Advanced);
+
+      rlimit previous = {};
+      QCOMPARE(getrlimit(RLIMIT_FSIZE, &previous), 0);
+      const auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+      rlimit limited = previous;
+      limited.rlim_cur = 16 + 32 + 10;
+      QCOMPARE(setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+      const libqotp::CounterLogResult failed = log.advance(1, 2);
+      const libqotp::CounterLogResult refused = log.advance(2, 1);
+
+      QCOMPARE(setrlimit(RLIMIT_FSIZE, &previous), 0);
+      std::signal(SIGXFSZ, previousHandler);
+
+      QVERIFY(failed == libqotp::CounterLogResult::Failed);
+      QVERIFY(refused == libqotp::CounterLogResult::Failed);
+      QVERIFY(log.error() == libqotp::CounterLogError::WriteFailed);
+
+      // The value that did not become durable is not reported
+      QCOMPARE(log.value(1), std::optional<quint64>(1));
+      QCOMPARE(log.value(2), std::optional<quint64>());
+
+      // Reopening cuts off the partial group
+      QVERIFY(log.open(fileName));
+      QCOMPARE(log.stats().discarded, quint64(10));
+      QCOMPARE(log.value(1), std::optional<quint64>(1));
+      QVERIFY(log.advance(1, 2) == libqotp::CounterLogResult::Advanced);
+#else
+      QSKIP("needs RLIMIT_FSIZE");
+#endif
+   }
+
+   void test_concurrent()
+   {
+      // Threads advance their own users and race for a shared one; syncs are shared between threads
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("counters");
+
+      libqotp::CounterLog log;
+      QVERIFY(log.open(fileName));
+
+      constexpr int threads = 8;
+      constexpr quint64 updates = 200;
+      constexpr quint64 shared = 1000;
+      std::vector<std::atomic<int>> advanced(updates + 1);
+      std::atomic<int> failed = 0;
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t)
+      {
+         workers.emplace_back([&, t]() {
+            for (quint64 value = 1; value <= updates; ++value)
+            {
+               if (log.advance(quint64(t), value) != libqotp::CounterLogResult::Advanced)
+               {
+                  ++failed;
+               }
+               if (log.advance(shared, value) == libqotp::CounterLogResult::Advanced)
+               {
+                  ++advanced[value];
+               }
+            }
+         });
+      }
+
+      for (std::thread &worker : workers)
+      {
+         worker.join();
+      }
+
+      QCOMPARE(failed.load(), 0);
+      for (quint64 value = 1; value <= updates; ++value)
+      {
+         QVERIFY(advanced[value] <= 1);
+      }
+      QVERIFY(log.stats().syncs <= log.stats().records);
+
+      log.close();
+      QVERIFY(log.open(fileName));
+      QCOMPARE(log.size(), threads + 1);
+      for (int t = 0; t < threads; ++t)
+      {
+         QCOMPARE(log.value(quint64(t)), std::optional<quint64>(updates));
+      }
+      QCOMPARE(log.value(shared), std::optional<quint64>(updates));
+   }
+};
+
+QTEST_MAIN(test_counterlog)
+
+#include "test_counterlog.moc"
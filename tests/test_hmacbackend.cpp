@@ -0,0 +1,149 @@
+#include <QtTest>
+#include <QMessageAuthenticationCode>
+
+#include <libqotp/batch.h>
+#include <libqotp/hmacbackend.h>
+#include <libqotp/qotp.h>
+
+class test_hmacbackend : public QObject
+{
+   Q_OBJECT
+
+   libqotp::HmacBackend m_default = libqotp::HmacBackend::Generic;
+
+private slots:
+   void initTestCase()
+   {
+      m_default = libqotp::hmac_backend();
+      QVERIFY(libqotp::hmac_backend_available(m_default));
+      QVERIFY(libqotp::hmac_backend_available(libqotp::HmacBackend::Generic));
+   }
+
+   void cleanupTestCase()
+   {
+      QVERIFY(libqotp::set_hmac_backend(m_default));
+   }
+
+   void test_select()
+   {
+      for (const auto backend : {libqotp::HmacBackend::Generic, libqotp::HmacBackend::ShaNi, libqotp::HmacBackend::OpenSsl})
+      {
+         QVERIFY(!libqotp::hmac_backend_name(backend).isEmpty());
+
+         const bool available = libqotp::hmac_backend_available(backend);
+         QCOMPARE(libqotp::set_hmac_backend(backend), available);
+         if (available)
+         {
+            QVERIFY(libqotp::hmac_backend() == backend);
+         }
+      }
+   }
+
+   void test_batch_level()
+   {
+      const libqotp::HmacBatchLevel level = libqotp::hmac_batch_level();
+      QCOMPARE(libqotp::hmac_batch_level(), level);
+      for (const auto other : {libqotp::HmacBatchLevel::None, libqotp::HmacBatchLevel::Sse2, libqotp::HmacBatchLevel::Avx2, libqotp::HmacBatchLevel::Avx512})
+      {
+         QVERIFY(!libqotp::hmac_batch_level_name(other).isEmpty());
+      }
+
+      // The level is independent of the backend
+      QVERIFY(libqotp::set_hmac_backend(libqotp::HmacBackend::Generic));
+      QCOMPARE(libqotp::hmac_batch_level(), level);
+
+      // QOTP_SIMD caps the level
+      const QByteArray cap = qgetenv("QOTP_SIMD");
+      if (cap == "none")
+      {
+         QCOMPARE(libqotp::hmac_batch_level(), libqotp::HmacBatchLevel::None);
+      }
+      else if (cap == "sse2" || cap == "ssse3")
+      {
+         QVERIFY(level <= libqotp::HmacBatchLevel::Sse2);
+      }
+      else if (cap == "avx2")
+      {
+         QVERIFY(level <= libqotp::HmacBatchLevel::Avx2);
+      }
+   }
+
+   void test_rfc_vectors_data()
+   {
+      QTest::addColumn<int>("backendValue");
+
+      for (const auto backend : {libqotp::HmacBackend::Generic, libqotp::HmacBackend::ShaNi, libqotp::HmacBackend::OpenSsl})
+      {
+         if (libqotp::hmac_backend_available(backend))
+         {
+            QTest::addRow("%s", qPrintable(libqotp::hmac_backend_name(backend))) << int(backend);
+         }
+      }
+   }
+
+   void test_rfc_vectors()
+   {
+      QFETCH(int, backendValue);
+      QVERIFY(libqotp::set_hmac_backend(static_cast<libqotp::HmacBackend>(backendValue)));
+
+      // RFC 4226 appendix D, one by one and through the batch engine
+      const QByteArray sha1Secret("12345678901234567890");
+      const QStringList expected = {"755224", "287082", "359152", "969429", "338314", "254676", "287922", "162583", "399871", "520489"};
+      for (int counter = 0; counter < expected.size(); ++counter)
+      {
+         QCOMPARE(libqotp::hotp(sha1Secret, counter), expected[counter]);
+      }
+
+      // The batch engine only falls back to the block functions for jobs that do not fill a vector
+      const std::vector<libqotp::OtpKey> keys(3, libqotp::OtpKey(sha1Secret));
+      const std::vector<quint64> counters = {0, 1, 9};
+      std::vector<quint32> values(keys.size());
+      QVERIFY(libqotp::hotp_batch(keys, counters, values));
+      QCOMPARE(values, (std::vector<quint32>{755224, 287082, 520489}));
+
+      // RFC 6238 appendix B
+      const QByteArray sha256Secret("12345678901234567890123456789012");
+      const QByteArray sha512Secret("1234567890123456789012345678901234567890123456789012345678901234");
+      QCOMPARE(libqotp::totp(sha1Secret, 59, 30, 0, 8), QLatin1String("94287082"));
+      QCOMPARE(libqotp::totp(sha256Secret, 59, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha256), QLatin1String("46119246"));
+      QCOMPARE(libqotp::totp(sha512Secret, 59, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha512), QLatin1String("90693936"));
+      QCOMPARE(libqotp::totp(sha1Secret, 20000000000, 30, 0, 8), QLatin1String("65353130"));
+      QCOMPARE(libqotp::totp(sha256Secret, 20000000000, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha256), QLatin1String("77737706"));
+      QCOMPARE(libqotp::totp(sha512Secret, 20000000000, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha512), QLatin1String("47863826"));
+   }
+
+   void test_hmac_matches_qt_data()
+   {
+      test_rfc_vectors_data();
+   }
+
+   void test_hmac_matches_qt()
+   {
+      QFETCH(int, backendValue);
+      QVERIFY(libqotp::set_hmac_backend(static_cast<libqotp::HmacBackend>(backendValue)));
+
+      // Keys and messages longer than a block exercise block functions called for several blocks at once
+      for (const auto algorithm : {QCryptographicHash::Sha1, QCryptographicHash::Sha256, QCryptographicHash::Sha512})
+      {
+         for (int keyLength : {20, 129, 300})
+         {
+            QByteArray secret(keyLength, Qt::Uninitialized);
+            for (int i = 0; i < keyLength; ++i)
+            {
+               secret[i] = static_cast<char>(i * 7 + 3);
+            }
+
+            const libqotp::OtpKey key(secret, algorithm);
+            const QByteArray message(500, 'm');
+            char digest[64];
+            const int length = key.hmac(message, digest);
+
+            QCOMPARE(QByteArray(digest, length), QMessageAuthenticationCode::hash(message, secret, algorithm));
+         }
+      }
+   }
+};
+
+QTEST_MAIN(test_hmacbackend)
+
+#include "test_hmacbackend.moc"
@@ -2,6 +2,13 @@
 
 #include <libqotp/qotp.h>
 
+#include <limits>
+#include <utility>
+
+// True if hotp_range() accepts a key of type K
+template <typename K>
+concept has_hotp_range = requires(K &&key) { libqotp::hotp_range(std::forward<K>(key), 0, 10); };
+
 class test_hotp : public QObject
 {
    Q_OBJECT
@@ -22,6 +29,78 @@ private slots:
       QCOMPARE(libqotp::hotp(key, 9), QLatin1String("520489"));
    }
 
+   void test_match_rfc_otpkey()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      QCOMPARE(libqotp::hotp(key, 0), QLatin1String("755224"));
+      QCOMPARE(libqotp::hotp(key, 1), QLatin1String("287082"));
+      QCOMPARE(libqotp::hotp(key, 2), QLatin1String("359152"));
+      QCOMPARE(libqotp::hotp(key, 3), QLatin1String("969429"));
+      QCOMPARE(libqotp::hotp(key, 4), QLatin1String("338314"));
+      QCOMPARE(libqotp::hotp(key, 5), QLatin1String("254676"));
+      QCOMPARE(libqotp::hotp(key, 6), QLatin1String("287922"));
+      QCOMPARE(libqotp::hotp(key, 7), QLatin1String("162583"));
+      QCOMPARE(libqotp::hotp(key, 8), QLatin1String("399871"));
+      QCOMPARE(libqotp::hotp(key, 9), QLatin1String("520489"));
+   }
+
+   void test_match_rfc_value()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      const quint32 expected[] = {755224, 287082, 359152, 969429, 338314, 254676, 287922, 162583, 399871, 520489};
+
+      for (quint64 counter = 0; counter < 10; ++counter)
+      {
+         QCOMPARE(libqotp::hotp_value(key, counter), std::optional<quint32>(expected[counter]));
+         QCOMPARE(libqotp::hotp_value(QByteArrayView("12345678901234567890"), counter), std::optional<quint32>(expected[counter]));
+      }
+   }
+
+   void test_match_rfc_buffer()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      char buffer[10];
+
+      QCOMPARE(libqotp::hotp(key, 0, buffer), 6);
+      QCOMPARE(QByteArray(buffer, 6), QByteArray("755224"));
+
+      QCOMPARE(libqotp::hotp(QByteArrayView("12345678901234567890"), 9, buffer), 6);
+      QCOMPARE(QByteArray(buffer, 6), QByteArray("520489"));
+
+      // Buffer too small for the requested digits
+      QCOMPARE(libqotp::hotp(key, 0, std::span<char>(buffer, 5)), 0);
+   }
+
+   void test_match_rfc_range()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      const quint32 expected[] = {755224, 287082, 359152, 969429, 338314, 254676, 287922, 162583, 399871, 520489};
+
+      quint64 counter = 0;
+      for (const quint32 value : libqotp::hotp_range(key, 0, 10))
+      {
+         QCOMPARE(value, expected[counter++]);
+      }
+      QCOMPARE(counter, quint64(10));
+
+      QVERIFY(libqotp::hotp_range(key, 0, 10, 5).empty());
+      const libqotp::OtpKey invalid;
+      QVERIFY(libqotp::hotp_range(invalid, 0, 10).empty());
+
+      // The range refers to the key, a temporary one does not compile
+      static_assert(has_hotp_range<const libqotp::OtpKey &>);
+      static_assert(!has_hotp_range<libqotp::OtpKey>);
+   }
+
+   void test_ten_digits()
+   {
+      // A 31-bit truncated value has at most 10 digits, so no reduction takes place
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      QCOMPARE(libqotp::hotp_value(key, 0, 10, 6, 10), std::optional<quint32>(1284755224));
+      QCOMPARE(libqotp::hotp(key, 0, 10, 6, 10), QLatin1String("1284755224"));
+      QCOMPARE(libqotp::hotp(key, 0, 11, 6, 11), QString());
+   }
+
    void test_match_rfc_base32()
    {
       const auto key = QLatin1String("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ");
@@ -83,6 +162,67 @@ private slots:
 
       // Test with requested digits outside the range of digitMinimum and digitMaximum
       QCOMPARE(libqotp::hotp(key, 0, 9, 7, 8), QString());
+
+      // The numeric overloads follow the same rules
+      QCOMPARE(libqotp::hotp_value(QByteArrayView(""), 0), std::nullopt);
+      QCOMPARE(libqotp::hotp_value(key, 0, 4), std::nullopt);
+      QCOMPARE(libqotp::hotp_value(key, 0, 10), std::nullopt);
+   }
+
+   void test_resync()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+
+      // The token is ahead of the server, the counter following the matched one is returned
+      QCOMPARE(libqotp::hotp_resync(key, 0, 755224), std::optional<quint64>(1));
+      QCOMPARE(libqotp::hotp_resync(key, 0, 520489), std::optional<quint64>(10));
+      QCOMPARE(libqotp::hotp_resync(key, 2, 520489, 7), std::optional<quint64>(10));
+
+      // Counters outside of the look-ahead window, and counters behind the server, do not match
+      QCOMPARE(libqotp::hotp_resync(key, 2, 520489, 6), std::nullopt);
+      QCOMPARE(libqotp::hotp_resync(key, 3, 755224), std::nullopt);
+
+      // The raw secret overload
+      QCOMPARE(libqotp::hotp_resync(QByteArrayView("12345678901234567890"), 0, 399871), std::optional<quint64>(9));
+
+      // A window larger than one batch
+      const quint32 far = *libqotp::hotp_value(key, 1000);
+      QCOMPARE(libqotp::hotp_resync(key, 10, far, 1000), std::optional<quint64>(1001));
+   }
+
+   void test_resync_two_codes()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+
+      const quint32 consecutive[] = {162583, 399871};
+      QCOMPARE(libqotp::hotp_resync(key, 0, consecutive), std::optional<quint64>(9));
+
+      // The first code at the end of the window, the second one just behind it
+      QCOMPARE(libqotp::hotp_resync(key, 0, consecutive, 7), std::optional<quint64>(9));
+      QCOMPARE(libqotp::hotp_resync(key, 0, consecutive, 6), std::nullopt);
+
+      // Codes that are not consecutive do not match
+      const quint32 gap[] = {162583, 520489};
+      QCOMPARE(libqotp::hotp_resync(key, 0, gap), std::nullopt);
+
+      const quint32 reversed[] = {399871, 162583};
+      QCOMPARE(libqotp::hotp_resync(key, 0, reversed), std::nullopt);
+   }
+
+   void test_resync_invalid_inputs()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      const quint32 three[] = {755224, 287082, 359152};
+
+      QCOMPARE(libqotp::hotp_resync(libqotp::OtpKey(), 0, 755224), std::nullopt);
+      QCOMPARE(libqotp::hotp_resync(key, 0, 755224, 100, 4), std::nullopt);
+      QCOMPARE(libqotp::hotp_resync(key, 0, std::span<const quint32>()), std::nullopt);
+      QCOMPARE(libqotp::hotp_resync(key, 0, three), std::nullopt);
+
+      // The window is clamped at the end of the counter range
+      QCOMPARE(libqotp::hotp_resync(key, std::numeric_limits<quint64>::max(), 755224), std::nullopt);
+      const quint64 end = std::numeric_limits<quint64>::max() - 1;
+      QCOMPARE(libqotp::hotp_resync(key, end, *libqotp::hotp_value(key, end)), std::optional<quint64>(end + 1));
    }
 };
 
@@ -0,0 +1,264 @@
+#include <QtTest>
+
+#include <libqotp/keystore.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+class test_keystore : public QObject
+{
+   Q_OBJECT
+
+   // Inverts the byte at 'offset' of a file
+   static void corrupt(const QString &fileName, qint64 offset)
+   {
+      QFile file(fileName);
+      QVERIFY(file.open(QIODevice::ReadWrite));
+
+      char byte = 0;
+      QVERIFY(file.seek(offset));
+      QCOMPARE(file.read(&byte, 1), qint64(1));
+      byte = static_cast<char>(~byte);
+      QVERIFY(file.seek(offset));
+      QCOMPARE(file.write(&byte, 1), qint64(1));
+   }
+
+   // Writes the RFC 6238 keys as records 0 to 2, an HOTP key as record 3 and a key with an epoch as record 4
+   static void write_store(const QString &fileName)
+   {
+      libqotp::KeyStoreWriter writer(fileName);
+      QCOMPARE(writer.error(), libqotp::KeyStoreError::None);
+
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890"), 8));
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890123456789012", QCryptographicHash::Sha256), 8));
+      QVERIFY(writer.add(libqotp::OtpKey("1234567890123456789012345678901234567890123456789012345678901234", QCryptographicHash::Sha512), 8));
+
+      libqotp::OtpAuthUri uri;
+      uri.type = libqotp::OtpType::Hotp;
+      uri.secret = "12345678901234567890";
+      QVERIFY(writer.add(uri));
+
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890"), 6, 60, 1000));
+      QCOMPARE(writer.count(), 5);
+      QVERIFY(writer.commit());
+   }
+
+private slots:
+   void test_roundtrip()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+      write_store(fileName);
+
+      libqotp::KeyStore store;
+      QVERIFY(store.open(fileName));
+      QCOMPARE(store.size(), 5);
+      QVERIFY(store.verifyChecksums());
+
+      const auto sha256 = store.record(1);
+      QVERIFY(sha256.has_value());
+      QCOMPARE(sha256->algorithm, QCryptographicHash::Sha256);
+      QCOMPARE(sha256->digits, 8u);
+      QCOMPARE(sha256->period, 30u);
+      QCOMPARE(sha256->epoch, quint64(0));
+      QCOMPARE(store.record(3)->period, 0u);
+      QCOMPARE(store.record(4)->epoch, quint64(1000));
+
+      // RFC 6238 appendix B
+      QCOMPARE(store.totp_value(0, 59), std::optional<quint32>(94287082));
+      QCOMPARE(store.totp_value(1, 59), std::optional<quint32>(46119246));
+      QCOMPARE(store.totp_value(2, 59), std::optional<quint32>(90693936));
+      QCOMPARE(store.totp_verify(0, 7081804, 1111111109), std::optional<int>(0));
+      QCOMPARE(store.totp_verify(1, 68084774, 1111111109 + 30), std::optional<int>(-1));
+      QCOMPARE(store.totp_verify(2, 25091201, 1111111109), std::optional<int>(0));
+      QCOMPARE(store.totp_verify(2, 25091201, 1111111109 + 90), std::nullopt);
+      QCOMPARE(store.totp_verify(2, 25091201, 1111111109 + 90, 3), std::optional<int>(-3));
+
+      // RFC 4226 appendix D, and the HOTP key has no TOTP
+      QCOMPARE(store.hotp_value(3, 0), std::optional<quint32>(755224));
+      QCOMPARE(store.hotp_value(3, 9), std::optional<quint32>(520489));
+      QCOMPARE(store.totp_value(3, 59), std::nullopt);
+      QCOMPARE(store.totp_verify(3, 755224, 59), std::nullopt);
+
+      // Period and epoch of the record are used
+      const libqotp::OtpKey key("12345678901234567890");
+      QCOMPARE(store.totp_value(4, 1000 + 60 * 5), libqotp::hotp_value(key, 5));
+      QCOMPARE(store.totp_value(4, 999), std::nullopt);
+
+      // Keys loaded from the store compute the same HMAC as freshly derived ones
+      const libqotp::core::Key loaded = store.key(2);
+      QVERIFY(loaded.isValid());
+      QCOMPARE(loaded.algorithm(), libqotp::core::Algorithm::Sha512);
+      for (quint64 counter = 0; counter < 8; ++counter)
+      {
+         QCOMPARE(libqotp::core::hotp_value(loaded, counter), libqotp::hotp_value(libqotp::OtpKey("1234567890123456789012345678901234567890123456789012345678901234", QCryptographicHash::Sha512), counter));
+      }
+
+      // Indexes out of range
+      QCOMPARE(store.record(5), std::nullopt);
+      QCOMPARE(store.record(-1), std::nullopt);
+      QVERIFY(!store.key(5).isValid());
+
+      store.close();
+      QVERIFY(!store.isOpen());
+      QCOMPARE(store.size(), 0);
+      QVERIFY(loaded.isValid());
+   }
+
+   void test_verify_batch()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+      write_store(fileName);
+
+      libqotp::KeyStore store;
+      QVERIFY(store.open(fileName));
+
+      // Mixed algorithms, offsets, misses, an HOTP record, an epoch and indexes out of range, repeated so
+      // that the checks span several groups
+      const libqotp::KeyStoreCheck pattern[] = {
+         {0, 7081804}, {1, 68084774}, {2, 25091201}, {0, 1}, {3, 755224}, {4, 0}, {5, 7081804}, {-1, 0}};
+      std::vector<libqotp::KeyStoreCheck> checks;
+      for (int i = 0; i < 40; ++i)
+      {
+         checks.insert(checks.end(), std::begin(pattern), std::end(pattern));
+      }
+      checks.push_back({4, *store.totp_value(4, 1111111109 - 60)});
+
+      for (const unsigned int window : {0u, 1u, 3u, 100u})
+      {
+         for (const quint64 time : {quint64(59), quint64(1111111109), quint64(1111111109 + 30)})
+         {
+            std::vector<std::optional<int>> results(checks.size(), std::optional<int>(42));
+            QVERIFY(store.totp_verify(checks, results, time, window));
+            for (std::size_t i = 0; i < checks.size(); ++i)
+            {
+               QCOMPARE(results[i], store.totp_verify(checks[i].index, checks[i].code, time, window));
+            }
+         }
+      }
+
+      std::vector<std::optional<int>> results(checks.size());
+      QVERIFY(store.totp_verify(checks, results, 1111111109));
+      QCOMPARE(results[0], std::optional<int>(0));
+      QCOMPARE(results[3], std::nullopt);
+      QCOMPARE(results.back(), std::optional<int>(-1));
+
+      // Too small for the results
+      results.resize(checks.size() - 1);
+      QVERIFY(!store.totp_verify(checks, results, 1111111109));
+   }
+
+   void test_corrupt_record()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+      write_store(fileName);
+
+      // A midstate byte of record 1, and the digits of record 4, which are the last byte of the file
+      // (a 64-byte header and five 146-byte records)
+      corrupt(fileName, 64 + 128 + 5);
+      corrupt(fileName, 64 + 5 * 146 - 1);
+
+      libqotp::KeyStore store;
+      QVERIFY(store.open(fileName));
+
+      // Corrupt records fail closed, the others still work
+      QCOMPARE(store.record(1), std::nullopt);
+      QVERIFY(!store.key(1).isValid());
+      QCOMPARE(store.totp_verify(1, 46119246, 59), std::nullopt);
+      QCOMPARE(store.totp_value(4, 1300), std::nullopt);
+      QCOMPARE(store.totp_value(0, 59), std::optional<quint32>(94287082));
+
+      QVERIFY(!store.verifyChecksums());
+      QCOMPARE(store.error(), libqotp::KeyStoreError::ChecksumMismatch);
+   }
+
+   void test_corrupt_header()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+      write_store(fileName);
+
+      // The record count
+      corrupt(fileName, 16);
+      libqotp::KeyStore store;
+      QVERIFY(!store.open(fileName));
+      QCOMPARE(store.error(), libqotp::KeyStoreError::ChecksumMismatch);
+      QVERIFY(!store.isOpen());
+
+      // The magic
+      write_store(fileName);
+      corrupt(fileName, 0);
+      QVERIFY(!store.open(fileName));
+      QCOMPARE(store.error(), libqotp::KeyStoreError::NotAKeyStore);
+
+      // Missing and short files
+      QVERIFY(!store.open(dir.filePath("missing")));
+      QCOMPARE(store.error(), libqotp::KeyStoreError::OpenFailed);
+
+      QFile file(dir.filePath("short"));
+      QVERIFY(file.open(QIODevice::WriteOnly));
+      QCOMPARE(file.write("QOTPKEYS", 8), qint64(8));
+      file.close();
+      QVERIFY(!store.open(dir.filePath("short")));
+      QCOMPARE(store.error(), libqotp::KeyStoreError::NotAKeyStore);
+   }
+
+   void test_truncated()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+      write_store(fileName);
+
+      {
+         QFile file(fileName);
+         QVERIFY(file.open(QIODevice::ReadWrite));
+         QVERIFY(file.resize(file.size() - 1));
+      }
+
+      libqotp::KeyStore store;
+      QVERIFY(!store.open(fileName));
+      QCOMPARE(store.error(), libqotp::KeyStoreError::Truncated);
+   }
+
+   void test_writer()
+   {
+      QTemporaryDir dir;
+      const QString fileName = dir.filePath("users.qotpkeys");
+
+      // Nothing is written until commit()
+      {
+         libqotp::KeyStoreWriter writer(fileName);
+         QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890")));
+      }
+      QVERIFY(!QFile::exists(fileName));
+
+      libqotp::KeyStoreWriter writer(fileName);
+      QVERIFY(!writer.add(libqotp::OtpKey()));
+      QCOMPARE(writer.error(), libqotp::KeyStoreError::InvalidKey);
+      QVERIFY(!writer.add(libqotp::OtpKey("12345678901234567890", QCryptographicHash::Md5)));
+      QVERIFY(!writer.add(libqotp::OtpKey("12345678901234567890"), 11));
+      QCOMPARE(writer.count(), 0);
+
+      // An empty store is valid
+      QVERIFY(writer.commit());
+      QVERIFY(!writer.add(libqotp::OtpKey("12345678901234567890")));
+      QVERIFY(!writer.commit());
+
+      libqotp::KeyStore store;
+      QVERIFY(store.open(fileName));
+      QCOMPARE(store.size(), 0);
+      QVERIFY(store.verifyChecksums());
+      QCOMPARE(store.record(0), std::nullopt);
+
+      // The midstates are as sensitive as the secrets
+      QFile file(fileName);
+      QVERIFY(file.open(QIODevice::ReadOnly));
+      QVERIFY(!(file.permissions() & QFileDevice::ReadOther));
+   }
+};
+
+QTEST_MAIN(test_keystore)
+
+#include "test_keystore.moc"
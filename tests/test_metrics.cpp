@@ -0,0 +1,107 @@
+#include <QtTest>
+
+#include <libqotp/metrics.h>
+#include <libqotp/qotp.h>
+
+#include <thread>
+#include <vector>
+
+class test_metrics : public QObject
+{
+   Q_OBJECT
+
+   const QByteArray secret = "12345678901234567890";
+
+private slots:
+   void test_counts()
+   {
+      if (!libqotp::metrics_enabled)
+      {
+         QSKIP("Built without WITH_METRICS");
+      }
+
+      libqotp::reset_metrics();
+      const libqotp::OtpKey key(secret);
+      for (int i = 0; i < 3; ++i)
+      {
+         QVERIFY(!libqotp::hotp(key, static_cast<quint64>(i)).isEmpty());
+      }
+      QVERIFY(libqotp::totp_value(libqotp::OtpKey(secret, QCryptographicHash::Sha256), 59));
+      QVERIFY(libqotp::totp_verify(key, 94287082u, 59));
+
+      // Failures by reason, an unsupported algorithm is not counted as call
+      QVERIFY(libqotp::hotp(QByteArray(), 0).isEmpty());
+      QVERIFY(libqotp::hotp(key, 0, 9).isEmpty());
+      QVERIFY(libqotp::totp(key, 59, 0).isEmpty());
+      QVERIFY(libqotp::hotp(secret, 0, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Md5).isEmpty());
+      QVERIFY(!libqotp::totp_verify(key, u"1234", 59));
+      QVERIFY(libqotp::base32_decode(QString("GE!")).isEmpty());
+
+      const libqotp::Metrics metrics = libqotp::metrics();
+      QCOMPARE(metrics.callCount(libqotp::core::Algorithm::Sha1), quint64(5));
+      QCOMPARE(metrics.callCount(libqotp::core::Algorithm::Sha256), quint64(1));
+      QCOMPARE(metrics.callCount(libqotp::core::Algorithm::Sha512), quint64(0));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::EmptySecret), quint64(1));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::InvalidDigits), quint64(1));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::InvalidTimeStep), quint64(1));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::UnsupportedAlgorithm), quint64(1));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::MalformedCode), quint64(1));
+      QCOMPARE(metrics.failureCount(libqotp::OtpError::InvalidBase32Character), quint64(1));
+
+      // Counting starts over
+      libqotp::reset_metrics();
+      QCOMPARE(libqotp::metrics().callCount(libqotp::core::Algorithm::Sha1), quint64(0));
+   }
+
+   void test_threads()
+   {
+      if (!libqotp::metrics_enabled)
+      {
+         QSKIP("Built without WITH_METRICS");
+      }
+
+      // The blocks of exited threads are kept
+      libqotp::reset_metrics();
+      const libqotp::OtpKey key(secret);
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; ++t)
+      {
+         threads.emplace_back([&]()
+         {
+            for (quint64 i = 0; i < 1000; ++i)
+            {
+               libqotp::hotp_value(key, i);
+            }
+         });
+      }
+      for (std::thread &thread : threads)
+      {
+         thread.join();
+      }
+
+      const libqotp::Metrics metrics = libqotp::metrics();
+      QCOMPARE(metrics.callCount(libqotp::core::Algorithm::Sha1), quint64(4000));
+      QVERIFY(metrics.samples() >= 4000 / libqotp::metrics_sample_interval);
+      QVERIFY(metrics.samples() <= 4000 / libqotp::metrics_sample_interval + 4);
+      QVERIFY(metrics.latencyPercentile(0.5).count() > 0);
+   }
+
+   void test_percentile()
+   {
+      libqotp::Metrics metrics;
+      QCOMPARE(metrics.latencyPercentile(0.5).count(), qint64(0));
+
+      // 90 samples of [512, 1024) ns, 10 of [4096, 8192) ns
+      metrics.latency[10] = 90;
+      metrics.latency[13] = 10;
+      QCOMPARE(metrics.samples(), quint64(100));
+      QCOMPARE(metrics.latencyPercentile(0.5).count(), qint64(1024));
+      QCOMPARE(metrics.latencyPercentile(0.9).count(), qint64(1024));
+      QCOMPARE(metrics.latencyPercentile(0.99).count(), qint64(8192));
+      QCOMPARE(metrics.latencyPercentile(1.0).count(), qint64(8192));
+   }
+};
+
+QTEST_MAIN(test_metrics)
+
+#include "test_metrics.moc"
@@ -0,0 +1,92 @@
+#include <QtTest>
+
+#include <libqotp/otp.h>
+
+class test_otp : public QObject
+{
+   Q_OBJECT
+
+   template <QCryptographicHash::Algorithm Algorithm, unsigned int Digits>
+   static void compare_instance(const libqotp::OtpKey &key)
+   {
+      // The instance must produce the same codes as the runtime functions
+      for (quint64 counter = 0; counter < 32; ++counter)
+      {
+         QCOMPARE((libqotp::Hotp<Algorithm, Digits>::value(key, counter)), libqotp::hotp_value(key, counter, Digits, 1, 10));
+         QCOMPARE((libqotp::Hotp<Algorithm, Digits>::generate(key, counter)), libqotp::hotp(key, counter, Digits, 1, 10));
+      }
+   }
+
+   template <QCryptographicHash::Algorithm Algorithm, unsigned int... Digits>
+   static void compare_with_runtime(const libqotp::OtpKey &key, std::integer_sequence<unsigned int, Digits...>)
+   {
+      (compare_instance<Algorithm, Digits + 1>(key), ...);
+   }
+
+private slots:
+   void test_hotp_rfc()
+   {
+      // RFC 4226 appendix D
+      using Code = libqotp::Hotp<QCryptographicHash::Sha1, 6>;
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+
+      QCOMPARE(Code::hashLength, 20);
+      QCOMPARE(Code::modulus, quint64(1000000));
+
+      QCOMPARE(Code::generate(key, 0), QLatin1String("755224"));
+      QCOMPARE(Code::generate(key, 1), QLatin1String("287082"));
+      QCOMPARE(Code::generate(key, 9), QLatin1String("520489"));
+      QCOMPARE(Code::value(key, 3), std::optional<quint32>(969429));
+
+      char buffer[6];
+      QVERIFY(Code::write(key, 7, buffer));
+      QCOMPARE(QByteArrayView(buffer, sizeof(buffer)), QByteArrayView("162583"));
+   }
+
+   void test_totp_rfc()
+   {
+      // RFC 6238 appendix B
+      const libqotp::OtpKey sha1(QByteArrayView("12345678901234567890"), QCryptographicHash::Sha1);
+      const libqotp::OtpKey sha256(QByteArrayView("12345678901234567890123456789012"), QCryptographicHash::Sha256);
+      const libqotp::OtpKey sha512(QByteArrayView("1234567890123456789012345678901234567890123456789012345678901234"), QCryptographicHash::Sha512);
+
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha1, 8>::generate(sha1, 59)), QLatin1String("94287082"));
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha256, 8>::generate(sha256, 59)), QLatin1String("46119246"));
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha512, 8>::generate(sha512, 59)), QLatin1String("90693936"));
+
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha1, 8>::generate(sha1, 1111111109)), QLatin1String("07081804"));
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha256, 8>::generate(sha256, 1111111109)), QLatin1String("68084774"));
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha512, 8>::generate(sha512, 1111111109)), QLatin1String("25091201"));
+
+      // A different time step and epoch
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha1, 8, 60>::counter(1111111109, 1000)), quint64(18518501));
+      QCOMPARE((libqotp::Totp<QCryptographicHash::Sha1, 8, 60>::value(sha1, 118)), (libqotp::Hotp<QCryptographicHash::Sha1, 8>::value(sha1, 1)));
+   }
+
+   void test_matches_runtime()
+   {
+      compare_with_runtime<QCryptographicHash::Sha1>(libqotp::OtpKey(QByteArrayView("12345678901234567890"), QCryptographicHash::Sha1),
+                                                     std::make_integer_sequence<unsigned int, 10>());
+      compare_with_runtime<QCryptographicHash::Sha256>(libqotp::OtpKey(QByteArrayView("12345678901234567890"), QCryptographicHash::Sha256),
+                                                       std::make_integer_sequence<unsigned int, 10>());
+      compare_with_runtime<QCryptographicHash::Sha512>(libqotp::OtpKey(QByteArrayView("12345678901234567890"), QCryptographicHash::Sha512),
+                                                       std::make_integer_sequence<unsigned int, 10>());
+   }
+
+   void test_invalid_keys()
+   {
+      using Code = libqotp::Hotp<QCryptographicHash::Sha256, 6>;
+
+      // An invalid key, and a key prepared for another algorithm
+      QCOMPARE(Code::value(libqotp::OtpKey(), 0), std::nullopt);
+      QCOMPARE(Code::value(libqotp::OtpKey(QByteArrayView("12345678901234567890")), 0), std::nullopt);
+      QCOMPARE(Code::generate(libqotp::OtpKey(QByteArrayView("12345678901234567890")), 0), QString());
+
+      char buffer[6];
+      QVERIFY(!Code::write(libqotp::OtpKey(), 0, buffer));
+   }
+};
+
+QTEST_MAIN(test_otp)
+
+#include "test_otp.moc"
@@ -0,0 +1,184 @@
+#include <QtTest>
+#include <QBuffer>
+
+#include <libqotp/otpauth.h>
+
+class test_otpauth : public QObject
+{
+   Q_OBJECT
+
+private:
+   static libqotp::OtpAuthError parse(QByteArray &uri, libqotp::OtpAuthUri &result)
+   {
+      return libqotp::parse_otpauth_uri(std::span<char>(uri.data(), uri.size()), result);
+   }
+
+private slots:
+   void test_parse()
+   {
+      QByteArray uri("otpauth://totp/ACME%20Co:john.doe@email.com?secret=HXDMVJECJJWSRB3HWIZR4IFUGFTMXBOZ&issuer=ACME%20Co&algorithm=SHA256&digits=8&period=60");
+      const char *begin = uri.constData();
+
+      libqotp::OtpAuthUri result;
+      QVERIFY(parse(uri, result) == libqotp::OtpAuthError::None);
+      QVERIFY(result.type == libqotp::OtpType::Totp);
+      QCOMPARE(result.issuer.toByteArray(), QByteArray("ACME Co"));
+      QCOMPARE(result.account.toByteArray(), QByteArray("john.doe@email.com"));
+      QCOMPARE(result.secret.toByteArray(), libqotp::base32_decode(QStringLiteral("HXDMVJECJJWSRB3HWIZR4IFUGFTMXBOZ")));
+      QCOMPARE(result.algorithm, QCryptographicHash::Sha256);
+      QCOMPARE(result.digits, 8u);
+      QCOMPARE(result.period, 60u);
+
+      // All views point into the parsed buffer
+      QVERIFY(result.secret.data() >= begin && result.secret.data() + result.secret.size() <= begin + uri.size());
+      QVERIFY(result.account.data() >= begin && result.account.data() < begin + uri.size());
+   }
+
+   void test_parse_defaults()
+   {
+      // Lower case secret with padding, no label prefix, spaces before the account, unknown parameters
+      QByteArray uri("OTPAUTH://TOTP/%20%20alice?SECRET=mzxw6ytboi%3D%3D%3D%3D%3D%3D&image=https%3A%2F%2Fexample.com");
+
+      libqotp::OtpAuthUri result;
+      QVERIFY(parse(uri, result) == libqotp::OtpAuthError::None);
+      QVERIFY(result.issuer.isEmpty());
+      QCOMPARE(result.account.toByteArray(), QByteArray("alice"));
+      QCOMPARE(result.secret.toByteArray(), QByteArray("foobar"));
+      QCOMPARE(result.algorithm, QCryptographicHash::Sha1);
+      QCOMPARE(result.digits, 6u);
+      QCOMPARE(result.period, 30u);
+
+      QByteArray hotp("otpauth://hotp/Example%3Abob?secret=GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ&counter=18446744073709551615");
+      QVERIFY(parse(hotp, result) == libqotp::OtpAuthError::None);
+      QVERIFY(result.type == libqotp::OtpType::Hotp);
+      QCOMPARE(result.issuer.toByteArray(), QByteArray("Example"));
+      QCOMPARE(result.account.toByteArray(), QByteArray("bob"));
+      QCOMPARE(result.secret.toByteArray(), QByteArray("12345678901234567890"));
+      QCOMPARE(result.counter, Q_UINT64_C(18446744073709551615));
+   }
+
+   void test_parse_errors()
+   {
+      const std::pair<const char *, libqotp::OtpAuthError> cases[] = {
+         {"", libqotp::OtpAuthError::InvalidScheme},
+         {"https://totp/a?secret=MZXW6", libqotp::OtpAuthError::InvalidScheme},
+         {"otpauth://motp/a?secret=MZXW6", libqotp::OtpAuthError::InvalidType},
+         {"otpauth://totp/a%2?secret=MZXW6", libqotp::OtpAuthError::InvalidEncoding},
+         {"otpauth://totp/a?secret=MZXW6&issuer=%zz", libqotp::OtpAuthError::InvalidEncoding},
+         {"otpauth://totp/a", libqotp::OtpAuthError::MissingSecret},
+         {"otpauth://totp/a?secret=", libqotp::OtpAuthError::MissingSecret},
+         {"otpauth://totp/a?secret=MZXW1", libqotp::OtpAuthError::InvalidSecret},
+         {"otpauth://totp/a?secret=MZXW6&algorithm=MD5", libqotp::OtpAuthError::InvalidAlgorithm},
+         {"otpauth://totp/a?secret=MZXW6&digits=5", libqotp::OtpAuthError::InvalidDigits},
+         {"otpauth://totp/a?secret=MZXW6&digits=9", libqotp::OtpAuthError::InvalidDigits},
+         {"otpauth://totp/a?secret=MZXW6&digits=-6", libqotp::OtpAuthError::InvalidDigits},
+         {"otpauth://totp/a?secret=MZXW6&period=0", libqotp::OtpAuthError::InvalidPeriod},
+         {"otpauth://totp/a?secret=MZXW6&period=4294967296", libqotp::OtpAuthError::InvalidPeriod},
+         {"otpauth://hotp/a?secret=MZXW6", libqotp::OtpAuthError::InvalidCounter},
+         {"otpauth://hotp/a?secret=MZXW6&counter=18446744073709551616", libqotp::OtpAuthError::InvalidCounter},
+      };
+
+      for (const auto &[text, expected] : cases)
+      {
+         QByteArray uri(text);
+         libqotp::OtpAuthUri result;
+         QVERIFY2(parse(uri, result) == expected, text);
+      }
+   }
+
+   void test_write()
+   {
+      libqotp::OtpAuthUri uri;
+      uri.issuer = "ACME Co";
+      uri.account = "john.doe@email.com";
+      uri.secret = "12345678901234567890";
+
+      QByteArray buffer;
+      qsizetype written = libqotp::write_otpauth_uri(uri, buffer);
+      QCOMPARE(buffer, QByteArray("otpauth://totp/ACME%20Co:john.doe@email.com?secret=GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ&issuer=ACME%20Co"));
+      QCOMPARE(written, buffer.size());
+
+      // Appends, and writes parameters that differ from the defaults
+      uri.type = libqotp::OtpType::Hotp;
+      uri.issuer = QByteArrayView();
+      uri.account = "a:b";
+      uri.algorithm = QCryptographicHash::Sha512;
+      uri.digits = 8;
+      uri.counter = 42;
+      buffer.append('\n');
+      written = libqotp::write_otpauth_uri(uri, buffer);
+      const QByteArray second("otpauth://hotp/a%3Ab?secret=GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ&algorithm=SHA512&digits=8&counter=42");
+      QCOMPARE(written, second.size());
+      QVERIFY(buffer.endsWith(second));
+
+      uri.secret = QByteArrayView();
+      QCOMPARE(libqotp::write_otpauth_uri(uri, buffer), -1);
+   }
+
+   void test_round_trip()
+   {
+      libqotp::OtpAuthUri uri;
+      uri.issuer = "Issuer & Sons: 100%";
+      uri.account = "user name";
+      uri.secret = QByteArrayView("\x00\x01\xfe\xff\x7f", 5);
+      uri.algorithm = QCryptographicHash::Sha256;
+      uri.period = 45;
+
+      QByteArray buffer;
+      QVERIFY(libqotp::write_otpauth_uri(uri, buffer) > 0);
+
+      libqotp::OtpAuthUri parsed;
+      QVERIFY(parse(buffer, parsed) == libqotp::OtpAuthError::None);
+      QCOMPARE(parsed.issuer.toByteArray(), uri.issuer.toByteArray());
+      QCOMPARE(parsed.account.toByteArray(), uri.account.toByteArray());
+      QCOMPARE(parsed.secret.toByteArray(), uri.secret.toByteArray());
+      QCOMPARE(parsed.algorithm, uri.algorithm);
+      QCOMPARE(parsed.period, uri.period);
+   }
+
+   void test_reader()
+   {
+      QByteArray data;
+      data.append("# exported accounts\r\n");
+      data.append("otpauth://totp/A:one?secret=GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ&issuer=A\r\n");
+      data.append("\n");
+      data.append("otpauth://totp/A:two?secret=MZXW6&digits=12\n");
+      data.append("otpauth://totp/A:" + QByteArray(100, 'x') + "?secret=MZXW6\n");
+      data.append("  otpauth://hotp/B:three?secret=MZXW6YTB&counter=7  ");
+
+      QBuffer device(&data);
+      QVERIFY(device.open(QIODevice::ReadOnly));
+
+      // A buffer smaller than the input, so lines straddle reads
+      libqotp::OtpAuthReader reader(&device, 96);
+
+      QVERIFY(reader.readNext());
+      QVERIFY(reader.error() == libqotp::OtpAuthError::None);
+      QCOMPARE(reader.lineNumber(), 2);
+      QCOMPARE(reader.uri().account.toByteArray(), QByteArray("one"));
+      QCOMPARE(libqotp::totp(reader.key(), 59), QStringLiteral("94287082"));
+
+      QVERIFY(reader.readNext());
+      QVERIFY(reader.error() == libqotp::OtpAuthError::InvalidDigits);
+      QCOMPARE(reader.lineNumber(), 4);
+      QVERIFY(!reader.key().isValid());
+
+      QVERIFY(reader.readNext());
+      QVERIFY(reader.error() == libqotp::OtpAuthError::LineTooLong);
+      QCOMPARE(reader.lineNumber(), 5);
+
+      QVERIFY(reader.readNext());
+      QVERIFY(reader.error() == libqotp::OtpAuthError::None);
+      QCOMPARE(reader.lineNumber(), 6);
+      QVERIFY(reader.uri().type == libqotp::OtpType::Hotp);
+      QCOMPARE(reader.uri().secret.toByteArray(), QByteArray("fooba"));
+      QCOMPARE(reader.uri().counter, 7u);
+
+      QVERIFY(!reader.readNext());
+      QVERIFY(reader.atEnd());
+   }
+};
+
+QTEST_MAIN(test_otpauth)
+
+#include "test_otpauth.moc"
@@ -0,0 +1,77 @@
+#include <QtTest>
+#include <QMessageAuthenticationCode>
+
+#include <libqotp/qotp.h>
+
+class test_otpkey : public QObject
+{
+   Q_OBJECT
+
+private slots:
+   void test_hmac_matches_qt_data()
+   {
+      QTest::addColumn<int>("algorithmValue");
+      QTest::addColumn<int>("keyLength");
+
+      // Key lengths around the 64 and 128 byte block sizes exercise the padding and the hashed-key path.
+      for (int keyLength : {1, 20, 32, 63, 64, 65, 127, 128, 129, 300})
+      {
+         QTest::addRow("sha1-%d", keyLength) << int(QCryptographicHash::Sha1) << keyLength;
+         QTest::addRow("sha256-%d", keyLength) << int(QCryptographicHash::Sha256) << keyLength;
+         QTest::addRow("sha512-%d", keyLength) << int(QCryptographicHash::Sha512) << keyLength;
+      }
+   }
+
+   void test_hmac_matches_qt()
+   {
+      QFETCH(int, algorithmValue);
+      QFETCH(int, keyLength);
+
+      const auto algorithm = static_cast<QCryptographicHash::Algorithm>(algorithmValue);
+
+      QByteArray secret(keyLength, Qt::Uninitialized);
+      for (int i = 0; i < keyLength; ++i)
+      {
+         secret[i] = static_cast<char>(i * 7 + 3);
+      }
+
+      const libqotp::OtpKey key(secret, algorithm);
+      QVERIFY(key.isValid());
+      QCOMPARE(key.hashLength(), QCryptographicHash::hashLength(algorithm));
+
+      // Message lengths around the padding boundaries
+      for (int messageLength : {0, 8, 55, 56, 63, 64, 111, 112, 200})
+      {
+         const QByteArray message(messageLength, 'm');
+         char digest[64];
+         const int length = key.hmac(message, digest);
+
+         QCOMPARE(QByteArray(digest, length), QMessageAuthenticationCode::hash(message, secret, algorithm));
+      }
+   }
+
+   void test_invalid_keys()
+   {
+      QVERIFY(!libqotp::OtpKey().isValid());
+      QVERIFY(!libqotp::OtpKey(QByteArrayView("")).isValid());
+      QVERIFY(!libqotp::OtpKey(QByteArrayView("12345678901234567890"), QCryptographicHash::Md5).isValid());
+
+      char digest[64];
+      QCOMPARE(libqotp::OtpKey().hmac(QByteArrayView("message"), digest), 0);
+      QCOMPARE(libqotp::hotp(libqotp::OtpKey(), 0), QString());
+   }
+
+   void test_clear()
+   {
+      libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      QVERIFY(key.isValid());
+
+      key.clear();
+      QVERIFY(!key.isValid());
+      QCOMPARE(libqotp::hotp(key, 0), QString());
+   }
+};
+
+QTEST_MAIN(test_otpkey)
+
+#include "test_otpkey.moc"
@@ -0,0 +1,152 @@
+#include <QtTest>
+
+#include "qotpd_protocol.h"
+#include "qotpd_replay.h"
+
+#include <QProcess>
+#include <QSet>
+#include <QTemporaryDir>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+class test_qotpd : public QObject
+{
+   Q_OBJECT
+
+   // Connects to the daemon listening on 'path'. Returns -1 if it does not listen (yet).
+   static int connect_to(const QByteArray &path)
+   {
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, path.constData(), std::size_t(path.size()));
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+      {
+         ::close(fd);
+         return -1;
+      }
+      return fd;
+   }
+
+private slots:
+   void test_replay()
+   {
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString fileName = dir.filePath("keys.qks");
+
+      // Records of a 30 second period, a 60 second period and an epoch
+      libqotp::KeyStoreWriter writer(fileName);
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890")));
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890"), 6, 60));
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890"), 6, 30, 1000));
+      QVERIFY(writer.commit());
+
+      libqotp::KeyStore store;
+      QVERIFY(store.open(fileName));
+
+      const quint64 now = 1'700'000'010;
+      qotpd::ReplayGuard guard(store, 64, 1);
+
+      // Each record accepts the steps of its window once and in order
+      for (qsizetype index = 0; index < store.size(); ++index)
+      {
+         QVERIFY(!guard.replayed(index, -1, now));
+         QVERIFY(!guard.replayed(index, 0, now));
+         QVERIFY(guard.replayed(index, 0, now));
+         QVERIFY(guard.replayed(index, -1, now));
+      }
+
+      // The same step seen one step later is still a replay, in either period
+      QVERIFY(guard.replayed(0, -1, now + 30));
+      QVERIFY(guard.replayed(1, -1, now + 60));
+      QVERIFY(!guard.replayed(1, 0, now + 60));
+      QVERIFY(!guard.replayed(2, 1, now));
+
+      // Missing records and times before the epoch cannot be recorded
+      QVERIFY(guard.replayed(store.size(), 0, now));
+      QVERIFY(guard.replayed(2, 0, 999));
+   }
+
+   void test_half_close_data()
+   {
+      QTest::addColumn<QString>("inlineLimit");
+
+      QTest::newRow("inline") << QString("1000");
+      QTest::newRow("pool") << QString("0");
+   }
+
+   void test_half_close()
+   {
+#if !defined(QOTPD_EXECUTABLE)
+      QSKIP("qotpd is not built");
+#else
+      QFETCH(QString, inlineLimit);
+
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      const QString storeName = dir.filePath("keys.qks");
+      const QByteArray socketPath = QFile::encodeName(dir.filePath("qotpd.sock"));
+
+      libqotp::KeyStoreWriter writer(storeName);
+      QVERIFY(writer.add(libqotp::OtpKey("12345678901234567890")));
+      QVERIFY(writer.commit());
+
+      QProcess daemon;
+      daemon.start(QStringLiteral(QOTPD_EXECUTABLE), {"--inline", inlineLimit, "--batch", "16", storeName, QFile::decodeName(socketPath)});
+      QVERIFY(daemon.waitForStarted());
+
+      int fd = -1;
+      QTRY_VERIFY((fd = connect_to(socketPath)) >= 0);
+      const timeval timeout = {10, 0};
+      QCOMPARE(::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+
+      // Wrong codes, and an unknown record answered without verification
+      constexpr int count = 200;
+      QByteArray requests(count * qotpd::request_size, Qt::Uninitialized);
+      for (int i = 0; i < count; ++i)
+      {
+         qotpd::Request request;
+         request.id = quint32(i);
+         request.index = i == count - 1 ? 7 : 0;
+         request.code = 1000000;
+         qotpd::write_request(request, requests.data() + i * qotpd::request_size);
+      }
+      QCOMPARE(::write(fd, requests.constData(), std::size_t(requests.size())), ssize_t(requests.size()));
+
+      // Every request is answered after the client stops writing, then the daemon closes the connection
+      QCOMPARE(::shutdown(fd, SHUT_WR), 0);
+
+      QByteArray received;
+      char buffer[4096];
+      ssize_t size = 0;
+      while ((size = ::read(fd, buffer, sizeof(buffer))) > 0)
+      {
+         received.append(buffer, size);
+      }
+      ::close(fd);
+      QCOMPARE(size, ssize_t(0));
+      QCOMPARE(received.size(), count * qotpd::response_size);
+
+      QSet<quint32> ids;
+      for (int i = 0; i < count; ++i)
+      {
+         const qotpd::Response response = qotpd::read_response(received.constData() + i * qotpd::response_size);
+         QCOMPARE(response.status, response.id == count - 1 ? qotpd::Status::UnknownKey : qotpd::Status::Rejected);
+         ids.insert(response.id);
+      }
+      QCOMPARE(ids.size(), count);
+
+      daemon.terminate();
+      QVERIFY(daemon.waitForFinished());
+#endif
+   }
+};
+
+QTEST_MAIN(test_qotpd)
+
+#include "test_qotpd.moc"
@@ -0,0 +1,137 @@
+#include <QtTest>
+
+#include <libqotp/replaystore.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class test_replaystore : public QObject
+{
+   Q_OBJECT
+
+private slots:
+   void test_accept()
+   {
+      libqotp::ReplayStore store(1024);
+      QCOMPARE(store.capacity(), 1024);
+
+      const quint64 now = 1700000000;
+      const quint64 step = now / 30;
+
+      QVERIFY(store.accept("alice", step, now) == libqotp::ReplayResult::Accepted);
+      QVERIFY(store.accept("alice", step, now) == libqotp::ReplayResult::Replayed);
+      QVERIFY(store.accept("alice", step - 1, now) == libqotp::ReplayResult::Replayed);
+      QVERIFY(store.accept("alice", step + 1, now) == libqotp::ReplayResult::Accepted);
+
+      // Users are independent, numeric IDs as well
+      QVERIFY(store.accept("bob", step, now) == libqotp::ReplayResult::Accepted);
+      QVERIFY(store.accept(quint64(42), step, now) == libqotp::ReplayResult::Accepted);
+      QVERIFY(store.accept(quint64(42), step, now) == libqotp::ReplayResult::Replayed);
+
+      // Steps that left the window are refused without being recorded
+      QVERIFY(store.accept("carol", step - 2, now) == libqotp::ReplayResult::Replayed);
+      QVERIFY(store.accept("carol", step - 1, now) == libqotp::ReplayResult::Accepted);
+   }
+
+   void test_expiry()
+   {
+      // A single bucket, so the ninth user finds no free entry until the others expired
+      libqotp::ReplayStore store(8);
+      QCOMPARE(store.capacity(), 8);
+
+      quint64 now = 1700000000;
+      for (quint64 user = 0; user < 8; ++user)
+      {
+         QVERIFY(store.accept(user, now / 30, now) == libqotp::ReplayResult::Accepted);
+      }
+      QVERIFY(store.accept(quint64(8), now / 30, now) == libqotp::ReplayResult::Unavailable);
+
+      // Still within the window, and one step later
+      now += 2 * 30;
+      QVERIFY(store.accept(quint64(8), now / 30, now) == libqotp::ReplayResult::Unavailable);
+
+      now += 30;
+      QVERIFY(store.accept(quint64(8), now / 30, now) == libqotp::ReplayResult::Accepted);
+      QVERIFY(store.accept(quint64(8), now / 30, now) == libqotp::ReplayResult::Replayed);
+   }
+
+   void test_hotp_mode()
+   {
+      libqotp::ReplayStore store(8, 0);
+
+      for (quint64 user = 0; user < 8; ++user)
+      {
+         QVERIFY(store.accept(user, 1, 0) == libqotp::ReplayResult::Accepted);
+      }
+
+      // Entries never expire, the store fails closed
+      QVERIFY(store.accept(quint64(8), 1, Q_UINT64_C(4000000000)) == libqotp::ReplayResult::Unavailable);
+      QVERIFY(store.accept(quint64(0), 1, Q_UINT64_C(4000000000)) == libqotp::ReplayResult::Replayed);
+      QVERIFY(store.accept(quint64(0), 2, 0) == libqotp::ReplayResult::Accepted);
+      QVERIFY(store.accept(quint64(0), Q_UINT64_C(0x100000000), 0) == libqotp::ReplayResult::Unavailable);
+   }
+
+   void test_totp_verify()
+   {
+      // RFC 6238 appendix B, SHA-1 at 59 seconds
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      libqotp::ReplayStore store(64);
+
+      QCOMPARE(libqotp::totp_verify(store, "alice", key, 94287082, 59), std::optional<int>(0));
+      QCOMPARE(libqotp::totp_verify(store, "alice", key, 94287082, 59), std::optional<int>());
+
+      // The same code in the next step, where it is still inside the window
+      QCOMPARE(libqotp::totp_verify(store, "alice", key, 94287082, 61), std::optional<int>());
+      QCOMPARE(libqotp::totp_verify(store, "bob", key, 94287082, 61), std::optional<int>(-1));
+   }
+
+   void test_concurrent()
+   {
+      // Every thread tries every step of every user; no step may be accepted twice
+      libqotp::ReplayStore store(4096);
+      const quint64 now = 1700000000;
+      const quint64 first = now / 30 - 1;
+      constexpr int users = 256;
+      constexpr int steps = 3;
+      constexpr int threads = 4;
+
+      std::vector<std::atomic<int>> accepted(users * steps);
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t)
+      {
+         workers.emplace_back([&]() {
+            for (int user = 0; user < users; ++user)
+            {
+               for (int step = 0; step < steps; ++step)
+               {
+                  if (store.accept(static_cast<quint64>(user), first + step, now) == libqotp::ReplayResult::Accepted)
+                  {
+                     ++accepted[user * steps + step];
+                  }
+               }
+            }
+         });
+      }
+
+      for (std::thread &worker : workers)
+      {
+         worker.join();
+      }
+
+      for (int user = 0; user < users; ++user)
+      {
+         int total = 0;
+         for (int step = 0; step < steps; ++step)
+         {
+            QVERIFY(accepted[user * steps + step] <= 1);
+            total += accepted[user * steps + step];
+         }
+         QVERIFY(total >= 1);
+      }
+   }
+};
+
+QTEST_MAIN(test_replaystore)
+
+#include "test_replaystore.moc"
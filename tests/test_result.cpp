@@ -0,0 +1,69 @@
+#include <QtTest>
+
+#include <libqotp/qotp.h>
+
+class test_result : public QObject
+{
+   Q_OBJECT
+
+   // RFC 4226 appendix D and RFC 6238 appendix B
+   const QByteArray secret = "12345678901234567890";
+
+private slots:
+   void test_hotp()
+   {
+      const libqotp::Result<QString> code = libqotp::try_hotp(secret, 0);
+      QVERIFY(code.has_value());
+      QCOMPARE(code.error(), libqotp::OtpError::None);
+      QCOMPARE(code.value(), QString("755224"));
+      QCOMPARE(*code, libqotp::hotp(secret, 0));
+
+      const libqotp::OtpKey key(secret);
+      QCOMPARE(libqotp::try_hotp(key, 1).value(), QString("287082"));
+   }
+
+   void test_hotp_errors()
+   {
+      QCOMPARE(libqotp::try_hotp(QByteArray(), 0).error(), libqotp::OtpError::EmptySecret);
+      QCOMPARE(libqotp::try_hotp(secret, 0, 6, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Md5).error(), libqotp::OtpError::UnsupportedAlgorithm);
+      QCOMPARE(libqotp::try_hotp(secret, 0, 9).error(), libqotp::OtpError::InvalidDigits);
+      QCOMPARE(libqotp::try_hotp(secret, 0, 5).error(), libqotp::OtpError::InvalidDigits);
+      QCOMPARE(libqotp::try_hotp(libqotp::OtpKey(), 0).error(), libqotp::OtpError::InvalidKey);
+
+      // On error the value is what the function without try_ returns
+      const libqotp::Result<QString> failed = libqotp::try_hotp(QByteArray(), 0);
+      QVERIFY(!failed);
+      QVERIFY(failed.value().isEmpty());
+      QCOMPARE(failed.value_or(QString("none")), QString("none"));
+      QCOMPARE(libqotp::hotp(QByteArray(), 0), QString());
+   }
+
+   void test_totp()
+   {
+      QCOMPARE(libqotp::try_totp(secret, 59).value(), QString("94287082"));
+      QCOMPARE(libqotp::try_totp(libqotp::OtpKey(secret), 1111111109).value(), QString("07081804"));
+
+      QCOMPARE(libqotp::try_totp(secret, 59, 0).error(), libqotp::OtpError::InvalidTimeStep);
+      QCOMPARE(libqotp::try_totp(QByteArray(), 59).error(), libqotp::OtpError::EmptySecret);
+      QCOMPARE(libqotp::try_totp(secret, 59, 30, 0, 11).error(), libqotp::OtpError::InvalidDigits);
+   }
+
+   void test_base32()
+   {
+      QCOMPARE(libqotp::try_base32_decode(u"GEZDGNBV").value(), QByteArray("12345"));
+      QCOMPARE(libqotp::try_base32_decode(u"GEZ!GNBV").error(), libqotp::OtpError::InvalidBase32Character);
+      QCOMPARE(libqotp::try_base32_decode(u"GE======GE").error(), libqotp::OtpError::Base32CharacterAfterPadding);
+      QVERIFY(libqotp::try_base32_decode(u"").has_value());
+   }
+
+   void test_error_name()
+   {
+      QCOMPARE(QString(libqotp::otp_error_name(libqotp::OtpError::None)), QString("None"));
+      QCOMPARE(QString(libqotp::otp_error_name(libqotp::OtpError::InvalidTimeStep)), QString("InvalidTimeStep"));
+      QCOMPARE(QString(libqotp::otp_error_name(libqotp::OtpError::OutputTooSmall)), QString("OutputTooSmall"));
+   }
+};
+
+QTEST_MAIN(test_result)
+
+#include "test_result.moc"
@@ -0,0 +1,67 @@
+#include <QtTest>
+
+#include <libqotp/secrets.h>
+
+#include <set>
+#include <string>
+
+class test_secrets : public QObject
+{
+   Q_OBJECT
+
+private slots:
+   void test_generate()
+   {
+      const libqotp::SecretBatch batch = libqotp::generate_secrets(1000);
+      QCOMPARE(batch.count(), 1000);
+      QCOMPARE(batch.secretLength(), 20);
+      QCOMPARE(batch.encodedLength(), 32);
+      QCOMPARE(batch.secrets().size(), 1000 * 20);
+      QCOMPARE(batch.encodedSecrets().size(), 1000 * 32);
+
+      // Every encoding decodes to its secret, and no two secrets are equal
+      std::set<std::string> seen;
+      for (qsizetype i = 0; i < batch.count(); ++i)
+      {
+         const QByteArrayView secret = batch.secret(i);
+         QCOMPARE(libqotp::base32_decode(QString(batch.encodedSecret(i))), secret.toByteArray());
+         QVERIFY(seen.insert(std::string(secret.data(), secret.size())).second);
+      }
+   }
+
+   void test_options()
+   {
+      const libqotp::SecretBatch batch = libqotp::generate_secrets(10, 16, libqotp::Base32Option::OmitPadding | libqotp::Base32Option::Lowercase);
+      QCOMPARE(batch.encodedLength(), 26);
+
+      for (qsizetype i = 0; i < batch.count(); ++i)
+      {
+         const QString encoded = QString(batch.encodedSecret(i));
+         QCOMPARE(encoded, encoded.toLower());
+         QVERIFY(!encoded.contains(QLatin1Char('=')));
+      }
+   }
+
+   void test_invalid_inputs()
+   {
+      QCOMPARE(libqotp::generate_secrets(0).count(), 0);
+      QCOMPARE(libqotp::generate_secrets(10, 0).count(), 0);
+      QCOMPARE(libqotp::generate_secrets(-1).count(), 0);
+   }
+
+   void test_move_and_clear()
+   {
+      libqotp::SecretBatch batch = libqotp::generate_secrets(4);
+      libqotp::SecretBatch moved = std::move(batch);
+      QCOMPARE(moved.count(), 4);
+      QCOMPARE(batch.count(), 0);
+
+      moved.clear();
+      QCOMPARE(moved.count(), 0);
+      QVERIFY(moved.secrets().isEmpty());
+   }
+};
+
+QTEST_MAIN(test_secrets)
+
+#include "test_secrets.moc"
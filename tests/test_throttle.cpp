@@ -0,0 +1,260 @@
+#include <QtTest>
+
+#include <libqotp/throttle.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class test_throttle : public QObject
+{
+   Q_OBJECT
+
+private slots:
+   void test_backoff()
+   {
+      libqotp::ThrottleOptions options;
+      options.capacity = 1024;
+      options.freeAttempts = 2;
+      options.baseDelay = 4;
+      options.maxDelay = 20;
+      libqotp::Throttle throttle(options);
+      QCOMPARE(throttle.capacity(), 1024);
+
+      const quint64 now = 1700000000;
+      QCOMPARE(throttle.check("alice", now), quint64(0));
+
+      // The free attempts are counted without delay until the last of them
+      QCOMPARE(throttle.recordFailure("alice", now), quint64(0));
+      QCOMPARE(throttle.check("alice", now), quint64(0));
+      QCOMPARE(throttle.failures("alice", now), 1u);
+
+      // Then the delay doubles up to the maximum, counted from the later of now and the last deadline
+      QCOMPARE(throttle.recordFailure("alice", now), now + 4);
+      QCOMPARE(throttle.check("alice", now), now + 4);
+      QCOMPARE(throttle.check("alice", now + 3), now + 4);
+      QCOMPARE(throttle.check("alice", now + 4), quint64(0));
+      QCOMPARE(throttle.recordFailure("alice", now + 4), now + 12);
+      QCOMPARE(throttle.recordFailure("alice", now + 12), now + 28);
+      QCOMPARE(throttle.recordFailure("alice", now + 28), now + 48);
+      QCOMPARE(throttle.failures("alice", now + 28), 5u);
+
+      // Users are independent, numeric IDs as well
+      QCOMPARE(throttle.check("bob", now), quint64(0));
+      QCOMPARE(throttle.check(quint64(42), now), quint64(0));
+      throttle.recordFailure(quint64(42), now);
+      QCOMPARE(throttle.recordFailure(quint64(42), now), now + 4);
+      QCOMPARE(throttle.check(quint64(42), now), now + 4);
+
+      // A success forgets the failures
+      throttle.recordSuccess("alice");
+      QCOMPARE(throttle.check("alice", now + 28), quint64(0));
+      QCOMPARE(throttle.failures("alice", now + 28), 0u);
+      QCOMPARE(throttle.recordFailure("alice", now + 28), quint64(0));
+      QCOMPARE(throttle.failures("alice", now + 28), 1u);
+   }
+
+   void test_reserve()
+   {
+      libqotp::ThrottleOptions options;
+      options.capacity = 1024;
+      options.freeAttempts = 2;
+      options.baseDelay = 4;
+      libqotp::Throttle throttle(options);
+      const quint64 now = 1700000000;
+
+      // Reserved attempts count against the free attempts until they are completed
+      QCOMPARE(throttle.reserve("alice", now), quint64(0));
+      QCOMPARE(throttle.reserve("alice", now), quint64(0));
+      QCOMPARE(throttle.reserve("alice", now), now + 1);
+      QCOMPARE(throttle.failures("alice", now), 0u);
+      QCOMPARE(throttle.recordFailure("alice", now), quint64(0));
+      QCOMPARE(throttle.reserve("alice", now), now + 1);
+      QCOMPARE(throttle.recordFailure("alice", now), now + 4);
+      QCOMPARE(throttle.reserve("alice", now), now + 4);
+
+      // After the deadline one attempt at a time
+      QCOMPARE(throttle.reserve("alice", now + 4), quint64(0));
+      QCOMPARE(throttle.reserve("alice", now + 4), now + 5);
+      QCOMPARE(throttle.recordFailure("alice", now + 4), now + 12);
+
+      // A success forgets the failures and the reservations
+      QCOMPARE(throttle.reserve("alice", now + 12), quint64(0));
+      throttle.recordSuccess("alice");
+      QCOMPARE(throttle.reserve("alice", now + 12), quint64(0));
+      QCOMPARE(throttle.reserve("alice", now + 12), quint64(0));
+      QCOMPARE(throttle.failures("alice", now + 12), 0u);
+   }
+
+   void test_expiry()
+   {
+      libqotp::ThrottleOptions options;
+      options.capacity = 64;
+      options.freeAttempts = 0;
+      options.retention = 2;
+      libqotp::Throttle throttle(options);
+
+      // The deadline falls into the step starting at 1699999980, which ends at 1700000010
+      const quint64 now = 1700000000;
+      QCOMPARE(throttle.recordFailure("alice", now), now + 1);
+      QCOMPARE(throttle.failures("alice", now + 69), 1u);
+      QCOMPARE(throttle.failures("alice", now + 70), 0u);
+
+      // Counting starts over
+      QCOMPARE(throttle.recordFailure("alice", now + 70), now + 71);
+      QCOMPARE(throttle.failures("alice", now + 70), 1u);
+   }
+
+   void test_flood()
+   {
+      // A single bucket. The heavy offender keeps its entry while every other entry is replaced.
+      libqotp::ThrottleOptions options;
+      options.capacity = 8;
+      libqotp::Throttle throttle(options);
+      QCOMPARE(throttle.capacity(), 8);
+
+      const quint64 now = 1700000000;
+      for (int i = 0; i < 10; ++i)
+      {
+         throttle.recordFailure("mallory", now);
+      }
+      const quint64 deadline = throttle.check("mallory", now);
+      QVERIFY(deadline > now);
+
+      // A user sharing the tag of the offender would add to its count, so only a lower bound is checked
+      for (quint64 user = 0; user < 10000; ++user)
+      {
+         throttle.recordFailure(user, now);
+      }
+      QVERIFY(throttle.check("mallory", now) >= deadline);
+      QVERIFY(throttle.failures("mallory", now) >= 10u);
+      QCOMPARE(throttle.failures(quint64(9999), now), 1u);
+   }
+
+   void test_totp_verify()
+   {
+      // RFC 6238 appendix B, SHA-1 at 59 seconds
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      libqotp::ThrottleOptions options;
+      options.capacity = 64;
+      options.freeAttempts = 2;
+      libqotp::Throttle throttle(options);
+
+      QCOMPARE(libqotp::totp_verify(throttle, "alice", key, 94287082, 59), std::optional<int>(0));
+      QCOMPARE(libqotp::totp_verify(throttle, "alice", key, 12345678, 59), std::optional<int>());
+      QCOMPARE(libqotp::totp_verify(throttle, "alice", key, 12345678, 59), std::optional<int>());
+      QCOMPARE(throttle.failures("alice", 59), 2u);
+
+      // Throttled, so even the right code is rejected, and not counted as another failure
+      QCOMPARE(libqotp::totp_verify(throttle, "alice", key, 94287082, 59), std::optional<int>());
+      QCOMPARE(throttle.failures("alice", 59), 2u);
+
+      // Once the deadline passed the right code is accepted and the failures are forgotten
+      QCOMPARE(libqotp::totp_verify(throttle, "alice", key, 94287082, 60), std::optional<int>(-1));
+      QCOMPARE(throttle.failures("alice", 60), 0u);
+   }
+
+   void test_concurrent_guesses()
+   {
+      // Wrong codes for one user from more threads than free attempts. Only reserved attempts reach the
+      // HMAC and every one of them is recorded as a failure.
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      libqotp::ThrottleOptions options;
+      options.capacity = 64;
+      options.freeAttempts = 3;
+      libqotp::Throttle throttle(options);
+      constexpr int threads = 16;
+
+      std::atomic<int> ready = 0;
+      std::atomic<int> accepted = 0;
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t)
+      {
+         workers.emplace_back([&]() {
+            ++ready;
+            while (ready < threads)
+            {
+               std::this_thread::yield();
+            }
+            accepted += libqotp::totp_verify(throttle, "alice", key, 12345678, 59).has_value();
+         });
+      }
+
+      for (std::thread &worker : workers)
+      {
+         worker.join();
+      }
+
+      QCOMPARE(accepted.load(), 0);
+      QCOMPARE(throttle.failures("alice", 59), options.freeAttempts);
+      QVERIFY(throttle.check("alice", 59) > 59);
+
+      // The same holds for reservations that are still in flight
+      std::atomic<int> reserved = 0;
+      workers.clear();
+      ready = 0;
+      for (int t = 0; t < threads; ++t)
+      {
+         workers.emplace_back([&]() {
+            ++ready;
+            while (ready < threads)
+            {
+               std::this_thread::yield();
+            }
+            reserved += throttle.reserve("bob", 59) == 0;
+         });
+      }
+
+      for (std::thread &worker : workers)
+      {
+         worker.join();
+      }
+
+      QCOMPARE(reserved.load(), int(options.freeAttempts));
+   }
+
+   void test_concurrent()
+   {
+      // Every thread fails every user. Each user has an entry beforehand, so every failure is counted.
+      libqotp::ThrottleOptions options;
+      options.capacity = 4096;
+      libqotp::Throttle throttle(options);
+      const quint64 now = 1700000000;
+      constexpr int users = 256;
+      constexpr int failures = 50;
+      constexpr int threads = 4;
+
+      for (int user = 0; user < users; ++user)
+      {
+         throttle.recordFailure(static_cast<quint64>(user), now);
+      }
+
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t)
+      {
+         workers.emplace_back([&]() {
+            for (int i = 0; i < failures; ++i)
+            {
+               for (int user = 0; user < users; ++user)
+               {
+                  throttle.recordFailure(static_cast<quint64>(user), now);
+               }
+            }
+         });
+      }
+
+      for (std::thread &worker : workers)
+      {
+         worker.join();
+      }
+
+      for (int user = 0; user < users; ++user)
+      {
+         QCOMPARE(throttle.failures(static_cast<quint64>(user), now), unsigned(1 + threads * failures));
+      }
+   }
+};
+
+QTEST_MAIN(test_throttle)
+
+#include "test_throttle.moc"
@@ -97,6 +97,98 @@ private slots:
       QCOMPARE(libqotp::totp_base64_sha512(key, 20000000000), QLatin1String("47863826"));
    }
 
+   void test_match_rfc_otpkey()
+   {
+      const libqotp::OtpKey sha1(QByteArrayView("12345678901234567890"));
+      QCOMPARE(libqotp::totp(sha1, 1111111109), QLatin1String("07081804"));
+      QCOMPARE(libqotp::totp(sha1, 20000000000), QLatin1String("65353130"));
+
+      const libqotp::OtpKey sha256(QByteArrayView("12345678901234567890123456789012"), QCryptographicHash::Sha256);
+      QCOMPARE(libqotp::totp(sha256, 1111111109), QLatin1String("68084774"));
+      QCOMPARE(libqotp::totp(sha256, 20000000000), QLatin1String("77737706"));
+
+      const libqotp::OtpKey sha512(QByteArrayView("1234567890123456789012345678901234567890123456789012345678901234"), QCryptographicHash::Sha512);
+      QCOMPARE(libqotp::totp(sha512, 1111111109), QLatin1String("25091201"));
+      QCOMPARE(libqotp::totp(sha512, 20000000000), QLatin1String("47863826"));
+
+      // A zero time step is rejected
+      QCOMPARE(libqotp::totp(sha1, 1111111109, 0), QString());
+   }
+
+   void test_match_rfc_value()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      QCOMPARE(libqotp::totp_value(key, 1111111109), std::optional<quint32>(7081804));
+      QCOMPARE(libqotp::totp_value(key, 1234567890), std::optional<quint32>(89005924));
+      QCOMPARE(libqotp::totp_value(QByteArrayView("12345678901234567890123456789012"), 1111111109, 30, 0, 8, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, QCryptographicHash::Sha256), std::optional<quint32>(68084774));
+      QCOMPARE(libqotp::totp_value(key, 1111111109, 0), std::nullopt);
+
+      char buffer[10];
+      QCOMPARE(libqotp::totp(key, 1111111109, buffer), 8);
+      QCOMPARE(QByteArray(buffer, 8), QByteArray("07081804"));
+      QCOMPARE(libqotp::totp(QByteArrayView("12345678901234567890"), 2000000000, buffer), 8);
+      QCOMPARE(QByteArray(buffer, 8), QByteArray("69279037"));
+   }
+
+   void test_verify_window()
+   {
+      const libqotp::OtpKey key(QByteArrayView("12345678901234567890"));
+      const quint64 now = 1111111109;
+
+      for (int offset = -3; offset <= 3; ++offset)
+      {
+         const quint32 code = *libqotp::totp_value(key, now + offset * 30);
+         const auto matched = libqotp::totp_verify(key, code, now, 2);
+
+         if (offset >= -2 && offset <= 2)
+         {
+            QCOMPARE(matched, std::optional<int>(offset));
+         }
+         else
+         {
+            QCOMPARE(matched, std::nullopt);
+         }
+      }
+
+      // The window is clamped at counter zero
+      const quint32 first = *libqotp::totp_value(key, 0);
+      QCOMPARE(libqotp::totp_verify(key, first, 30, 3), std::optional<int>(-1));
+   }
+
+   void test_verify_wide_window()
+   {
+      // A wide window spans several vectors of the batch engine, including a partial last one
+      const QCryptographicHash::Algorithm algorithms[] = {QCryptographicHash::Sha1, QCryptographicHash::Sha256, QCryptographicHash::Sha512};
+      for (QCryptographicHash::Algorithm algorithm : algorithms)
+      {
+         const libqotp::OtpKey key(QByteArrayView("12345678901234567890"), algorithm);
+         const quint64 now = 1700000000;
+
+         for (int offset = -50; offset <= 50; offset += 7)
+         {
+            const quint32 code = *libqotp::totp_value(key, now + offset * 30);
+            QCOMPARE(libqotp::totp_verify(key, code, now, 50), std::optional<int>(offset));
+         }
+      }
+   }
+
+   void test_verify_string()
+   {
+      const auto secret = QByteArrayView("12345678901234567890");
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("07081804"), 1111111109), std::optional<int>(0));
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("14050471"), 1111111109), std::optional<int>(1));
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("14050471"), 1111111109, 0), std::nullopt);
+
+      // Malformed codes
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("7081804"), 1111111109), std::nullopt);
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("0708180x"), 1111111109), std::nullopt);
+      QCOMPARE(libqotp::totp_verify(secret, QString(), 1111111109), std::nullopt);
+
+      // Invalid parameters
+      QCOMPARE(libqotp::totp_verify(secret, QStringLiteral("07081804"), 1111111109, 1, 0), std::nullopt);
+      QCOMPARE(libqotp::totp_verify(QByteArrayView(""), QStringLiteral("07081804"), 1111111109), std::nullopt);
+   }
+
    void test_totp_expire_time()
    {
       unsigned int timeStep = 30;
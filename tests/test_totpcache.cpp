@@ -0,0 +1,168 @@
+#include <QtTest>
+
+#include <libqotp/totpcache.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class test_totpcache : public QObject
+{
+   Q_OBJECT
+
+   // RFC 6238 appendix B: 07081804 at 1111111109 (step 37037036), 14050471 at 1111111111 (step 37037037)
+   const std::vector<libqotp::OtpKey> keys{
+      libqotp::OtpKey("12345678901234567890"),
+      libqotp::OtpKey("12345678901234567890123456789012", QCryptographicHash::Sha256),
+      libqotp::OtpKey("1234567890123456789012345678901234567890123456789012345678901234", QCryptographicHash::Sha512),
+   };
+
+   static libqotp::TotpCacheOptions manual()
+   {
+      libqotp::TotpCacheOptions options;
+      options.background = false;
+      return options;
+   }
+
+private slots:
+   void test_verify()
+   {
+      libqotp::TotpCache cache(keys, manual());
+      cache.refresh(1111111109);
+      QCOMPARE(cache.size(), qsizetype(3));
+
+      QCOMPARE(cache.verify(0, 7081804u, 1111111109), std::optional<int>(0));
+      QCOMPARE(cache.verify(0, 14050471u, 1111111109), std::optional<int>(1));
+      QCOMPARE(cache.verify(1, 68084774u, 1111111109), std::optional<int>(0));
+      QCOMPARE(cache.verify(2, 25091201u, 1111111109), std::optional<int>(0));
+      QCOMPARE(cache.verify(0, 12345678u, 1111111109), std::nullopt);
+      QCOMPARE(cache.verify(1, 7081804u, 1111111109), std::nullopt);
+
+      // The table also covers the window of the step before
+      QCOMPARE(cache.verify(0, 7081804u, 1111111079), std::optional<int>(1));
+
+      // All answered from the table
+      QCOMPARE(cache.stats().misses, quint64(0));
+      QCOMPARE(cache.stats().refreshes, quint64(2));
+   }
+
+   void test_miss()
+   {
+      libqotp::TotpCache cache(keys, manual());
+      cache.refresh(1111111109);
+
+      // The next step is outside the table, the result is the same as computed directly
+      QCOMPARE(cache.verify(0, 7081804u, 1111111111), std::optional<int>(-1));
+      QCOMPARE(cache.verify(0, 12345678u, 1111111111), std::nullopt);
+      QCOMPARE(cache.stats().misses, quint64(2));
+
+      // Until the table of that step is published
+      cache.refresh(1111111111);
+      QCOMPARE(cache.verify(0, 7081804u, 1111111111), std::optional<int>(-1));
+      QCOMPARE(cache.stats().misses, quint64(2));
+   }
+
+   void test_invalid()
+   {
+      libqotp::TotpCache cache(keys, manual());
+      cache.refresh(1111111109);
+
+      QCOMPARE(cache.verify(-1, 7081804u, 1111111109), std::nullopt);
+      QCOMPARE(cache.verify(3, 7081804u, 1111111109), std::nullopt);
+
+      // Invalid keys have no codes, not even invalid ones
+      const std::vector<libqotp::OtpKey> invalid{libqotp::OtpKey()};
+      libqotp::TotpCache empty(invalid, manual());
+      empty.refresh(1111111109);
+      QCOMPARE(empty.verify(0, 0xffffffffu, 1111111109), std::nullopt);
+      QCOMPARE(empty.verify(0, 0u, 1111111109), std::nullopt);
+
+      // Invalid digits publish tables without any code
+      libqotp::TotpCacheOptions options = manual();
+      options.digits = 11;
+      libqotp::TotpCache tooLong(keys, options);
+      tooLong.refresh(1111111109);
+      QCOMPARE(tooLong.verify(0, 7081804u, 1111111109), std::nullopt);
+
+      // The lead is clamped to less than a time step
+      options = manual();
+      options.lead = std::chrono::seconds(-5);
+      QCOMPARE(libqotp::TotpCache(keys, options).options().lead, std::chrono::seconds(0));
+      options.lead = std::chrono::seconds(45);
+      QCOMPARE(libqotp::TotpCache(keys, options).options().lead, std::chrono::seconds(29));
+   }
+
+   void test_set_keys()
+   {
+      const std::span<const libqotp::OtpKey> all(keys);
+      libqotp::TotpCache cache(all.first(1), manual());
+      cache.refresh(1111111109);
+      QCOMPARE(cache.size(), qsizetype(1));
+      QCOMPARE(cache.verify(1, 68084774u, 1111111109), std::nullopt);
+
+      // The new table keeps the time step of the current one
+      cache.setKeys(all.subspan(1));
+      QCOMPARE(cache.size(), qsizetype(2));
+      QCOMPARE(cache.verify(0, 68084774u, 1111111109), std::optional<int>(0));
+      QCOMPARE(cache.verify(1, 25091201u, 1111111109), std::optional<int>(0));
+      QCOMPARE(cache.stats().misses, quint64(0));
+   }
+
+   void test_background()
+   {
+      // The table of the current step exists as soon as the cache does
+      const quint64 time = libqotp::current_unix_time();
+      libqotp::TotpCache cache(keys);
+      QVERIFY(cache.stats().refreshes >= 1);
+
+      const std::optional<int> expected = libqotp::totp_verify(keys[0], 7081804u, time, 1, 30, 0, 8);
+      QCOMPARE(cache.verify(0, 7081804u, time), expected);
+
+      // A lead beyond the time step still publishes a table that covers the current step
+      libqotp::TotpCacheOptions options;
+      options.lead = std::chrono::hours(1);
+      libqotp::TotpCache early(keys, options);
+      const quint64 now = libqotp::current_unix_time();
+      QCOMPARE(early.verify(0, 7081804u, now), libqotp::totp_verify(keys[0], 7081804u, now, 1, 30, 0, 8));
+      QCOMPARE(early.stats().misses, quint64(0));
+   }
+
+   void test_threads()
+   {
+      libqotp::TotpCache cache(keys, manual());
+      cache.refresh(1111111109);
+
+      // Lookups keep working while tables are replaced underneath them
+      std::atomic<bool> done = false;
+      std::atomic<int> mismatches = 0;
+      std::vector<std::thread> readers;
+      for (int t = 0; t < 4; ++t)
+      {
+         readers.emplace_back([&]()
+         {
+            while (!done)
+            {
+               mismatches += cache.verify(0, 7081804u, 1111111109) != std::optional<int>(0);
+               mismatches += cache.verify(2, 25091201u, 1111111109) != std::optional<int>(0);
+            }
+         });
+      }
+
+      for (int i = 0; i < 200; ++i)
+      {
+         cache.refresh(1111111109);
+      }
+      done = true;
+      for (std::thread &reader : readers)
+      {
+         reader.join();
+      }
+
+      QCOMPARE(mismatches.load(), 0);
+      QCOMPARE(cache.stats().misses, quint64(0));
+   }
+};
+
+QTEST_MAIN(test_totpcache)
+
+#include "test_totpcache.moc"
@@ -0,0 +1,1090 @@
+#include <QFile>
+#include <QHash>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <libqotp/clock.h>
+#include <libqotp/otpauth.h>
+#include <libqotp/qotp.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+// qotp-tool: bulk OTP operations on line-oriented text.
+//
+//   qotp-tool [OPTIONS] gen [FILE...]           one code per "[ID] SECRET" record
+//   qotp-tool [OPTIONS] verify --keys KEYS [FILE...]
+//                                               checks "USER CODE" records against the keys in KEYS
+//   qotp-tool [OPTIONS] audit [FILE...]         flags weak "[ID] SECRET" records
+//   qotp-tool [OPTIONS] uri encode [FILE...]    turns "ACCOUNT SECRET" records into otpauth:// URIs
+//   qotp-tool [OPTIONS] uri decode [FILE...]    splits otpauth:// URIs into their parameters
+//
+// A SECRET is Base32 or an otpauth:// URI, whose parameters then override the command line. Input is
+// read from the FILEs in turn, or from stdin, in chunks of complete lines. Each chunk is cut into slices
+// that run on all cores, each into its own output buffer, while the next chunk is read; the buffers are
+// written in input order, so the output lines match the input lines. Empty lines and lines starting with
+// '#' are skipped. Record counts and throughput go to stderr.
+//
+// Exit status: 0 on success, 1 on usage or I/O errors, 2 if audit flagged a secret.
+
+namespace
+{
+   enum class Command
+   {
+      Gen,
+      Verify,
+      Audit,
+      UriEncode,
+      UriDecode
+   };
+
+   struct Settings
+   {
+      Command command = Command::Gen;
+      QStringList inputs;
+      QString output;
+      QString keys;
+      int threads = 0;
+      qsizetype chunkSize = 4 * 1024 * 1024;
+      bool quiet = false;
+
+      // OTP parameters of plain Base32 secrets
+      quint64 time = 0;
+      unsigned int digits = 6;
+      unsigned int period = 30;
+      QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1;
+      bool hotp = false;
+      quint64 counter = 0;
+      QByteArray issuer;
+
+      // verify
+      unsigned int window = 1;
+      unsigned int lookAhead = 100;
+
+      // audit
+      unsigned int minimumBits = 128;
+      bool flaggedOnly = false;
+   };
+
+   // The counts of one slice, summed over the run
+   struct Counts
+   {
+      quint64 records = 0;
+
+      // Malformed records, unusable secrets and unknown users
+      quint64 errors = 0;
+
+      // Secrets flagged by audit, codes rejected by verify
+      quint64 flagged = 0;
+
+      Counts &operator+=(const Counts &other)
+      {
+         records += other.records;
+         errors += other.errors;
+         flagged += other.flagged;
+         return *this;
+      }
+   };
+
+   // A key of the verify key file
+   struct Entry
+   {
+      libqotp::OtpKey key;
+      libqotp::OtpType type = libqotp::OtpType::Totp;
+      unsigned int digits = 6;
+      unsigned int period = 30;
+      quint64 counter = 0;
+   };
+
+   using KeyTable = QHash<QByteArray, Entry>;
+
+   const char usage[] =
+       "usage: qotp-tool [OPTIONS] COMMAND [FILE...]\n"
+       "\n"
+       "commands:\n"
+       "  gen          print the code of each \"[ID] SECRET\" record\n"
+       "  verify       check \"USER CODE\" records against --keys, print \"USER OK OFFSET|FAIL\"\n"
+       "  audit        print \"ID BITS FLAGS\" for each \"[ID] SECRET\" record\n"
+       "  uri encode   turn \"ACCOUNT SECRET\" records into otpauth:// URIs\n"
+       "  uri decode   print the tab-separated parameters of otpauth:// URIs\n"
+       "\n"
+       "SECRET is Base32 or an otpauth:// URI. Without FILE, stdin is read.\n"
+       "\n"
+       "options:\n"
+       "  -o FILE            write to FILE instead of stdout\n"
+       "  -q                 do not print the summary to stderr\n"
+       "  --threads N        worker threads, default: all cores\n"
+       "  --chunk-size N     bytes read at once, default: 4194304\n"
+       "  --time T           Unix time for TOTP, default: now\n"
+       "  --digits N         code length, default: 6\n"
+       "  --period N         TOTP time step in seconds, default: 30\n"
+       "  --algorithm A      sha1, sha256 or sha512, default: sha1\n"
+       "  --counter N        use HOTP with counter N\n"
+       "  --issuer NAME      issuer for uri encode\n"
+       "  --keys FILE        \"USER SECRET\" records for verify\n"
+       "  --window N         TOTP steps accepted before and after now, default: 1\n"
+       "  --look-ahead N     HOTP counters searched, default: 100\n"
+       "  --min-bits N       audit: flag shorter secrets, default: 128\n"
+       "  --flagged          audit: print only flagged records\n";
+
+   void fail(const char *message, const char *argument = nullptr)
+   {
+      if (argument)
+      {
+         std::fprintf(stderr, "qotp-tool: %s: %s\n", message, argument);
+      }
+      else
+      {
+         std::fprintf(stderr, "qotp-tool: %s\n", message);
+      }
+   }
+
+   template <typename T>
+   bool parse_number(QByteArrayView text, T &value)
+   {
+      const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+      return !text.isEmpty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+   }
+
+   bool parse_algorithm(QByteArrayView text, QCryptographicHash::Algorithm &algorithm)
+   {
+      if (text == "sha1")
+      {
+         algorithm = QCryptographicHash::Sha1;
+      }
+      else if (text == "sha256")
+      {
+         algorithm = QCryptographicHash::Sha256;
+      }
+      else if (text == "sha512")
+      {
+         algorithm = QCryptographicHash::Sha512;
+      }
+      else
+      {
+         return false;
+      }
+      return true;
+   }
+
+   const char *algorithm_name(QCryptographicHash::Algorithm algorithm)
+   {
+      switch (algorithm)
+      {
+      case QCryptographicHash::Sha256:
+         return "sha256";
+      case QCryptographicHash::Sha512:
+         return "sha512";
+      default:
+         return "sha1";
+      }
+   }
+
+   const char *otpauth_error_name(libqotp::OtpAuthError error)
+   {
+      switch (error)
+      {
+      case libqotp::OtpAuthError::None:
+         return "none";
+      case libqotp::OtpAuthError::InvalidScheme:
+         return "invalid-scheme";
+      case libqotp::OtpAuthError::InvalidType:
+         return "invalid-type";
+      case libqotp::OtpAuthError::InvalidEncoding:
+         return "invalid-encoding";
+      case libqotp::OtpAuthError::MissingSecret:
+         return "missing-secret";
+      case libqotp::OtpAuthError::InvalidSecret:
+         return "invalid-secret";
+      case libqotp::OtpAuthError::InvalidAlgorithm:
+         return "invalid-algorithm";
+      case libqotp::OtpAuthError::InvalidDigits:
+         return "invalid-digits";
+      case libqotp::OtpAuthError::InvalidPeriod:
+         return "invalid-period";
+      case libqotp::OtpAuthError::InvalidCounter:
+         return "invalid-counter";
+      case libqotp::OtpAuthError::LineTooLong:
+         return "line-too-long";
+      }
+      return "unknown";
+   }
+
+   // Parses the command line. Returns false after printing the problem.
+   bool parse_arguments(int argc, char **argv, Settings &settings)
+   {
+      bool haveCommand = false;
+      bool haveTime = false;
+
+      for (int i = 1; i < argc; ++i)
+      {
+         const QByteArrayView argument(argv[i]);
+         const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+         // Options taking a value
+         const auto take = [&](auto &target) -> bool
+         {
+            if (!value || !parse_number(QByteArrayView(value), target))
+            {
+               fail("invalid or missing number for", argv[i]);
+               return false;
+            }
+            ++i;
+            return true;
+         };
+
+         if (argument == "-h" || argument == "--help")
+         {
+            std::fputs(usage, stdout);
+            std::exit(0);
+         }
+         else if (argument == "-q")
+         {
+            settings.quiet = true;
+         }
+         else if (argument == "--flagged")
+         {
+            settings.flaggedOnly = true;
+         }
+         else if (argument == "-o" || argument == "--keys" || argument == "--issuer" || argument == "--algorithm")
+         {
+            if (!value)
+            {
+               fail("missing value for", argv[i]);
+               return false;
+            }
+
+            if (argument == "-o")
+            {
+               settings.output = QString::fromLocal8Bit(value);
+            }
+            else if (argument == "--keys")
+            {
+               settings.keys = QString::fromLocal8Bit(value);
+            }
+            else if (argument == "--issuer")
+            {
+               settings.issuer = QByteArray(value);
+            }
+            else if (!parse_algorithm(QByteArrayView(value), settings.algorithm))
+            {
+               fail("unsupported algorithm", value);
+               return false;
+            }
+            ++i;
+         }
+         else if (argument == "--threads")
+         {
+            if (!take(settings.threads))
+            {
+               return false;
+            }
+         }
+         else if (argument == "--chunk-size")
+         {
+            if (!take(settings.chunkSize) || settings.chunkSize < 1)
+            {
+               fail("chunk size out of range");
+               return false;
+            }
+         }
+         else if (argument == "--time")
+         {
+            if (!take(settings.time))
+            {
+               return false;
+            }
+            haveTime = true;
+         }
+         else if (argument == "--digits")
+         {
+            if (!take(settings.digits) || settings.digits < QOTP_MINIMUM_DIGIT || settings.digits > QOTP_MAXIMUM_DIGIT)
+            {
+               fail("digits out of range");
+               return false;
+            }
+         }
+         else if (argument == "--period")
+         {
+            if (!take(settings.period) || settings.period == 0)
+            {
+               fail("period out of range");
+               return false;
+            }
+         }
+         else if (argument == "--counter")
+         {
+            if (!take(settings.counter))
+            {
+               return false;
+            }
+            settings.hotp = true;
+         }
+         else if (argument == "--window")
+         {
+            if (!take(settings.window))
+            {
+               return false;
+            }
+         }
+         else if (argument == "--look-ahead")
+         {
+            if (!take(settings.lookAhead))
+            {
+               return false;
+            }
+         }
+         else if (argument == "--min-bits")
+         {
+            if (!take(settings.minimumBits))
+            {
+               return false;
+            }
+         }
+         else if (argument.size() > 1 && argument.startsWith('-'))
+         {
+            fail("unknown option", argv[i]);
+            return false;
+         }
+         else if (!haveCommand)
+         {
+            haveCommand = true;
+            if (argument == "gen")
+            {
+               settings.command = Command::Gen;
+            }
+            else if (argument == "verify")
+            {
+               settings.command = Command::Verify;
+            }
+            else if (argument == "audit")
+            {
+               settings.command = Command::Audit;
+            }
+            else if (argument == "uri" && value && QByteArrayView(value) == "encode")
+            {
+               settings.command = Command::UriEncode;
+               ++i;
+            }
+            else if (argument == "uri" && value && QByteArrayView(value) == "decode")
+            {
+               settings.command = Command::UriDecode;
+               ++i;
+            }
+            else
+            {
+               fail("unknown command", argv[i]);
+               return false;
+            }
+         }
+         else
+         {
+            settings.inputs.append(QString::fromLocal8Bit(argv[i]));
+         }
+      }
+
+      if (!haveCommand)
+      {
+         std::fputs(usage, stderr);
+         return false;
+      }
+
+      if (settings.command == Command::Verify && settings.keys.isEmpty())
+      {
+         fail("verify needs --keys");
+         return false;
+      }
+
+      if (!haveTime)
+      {
+         settings.time = libqotp::current_unix_time();
+      }
+
+      if (settings.inputs.isEmpty())
+      {
+         settings.inputs.append(QStringLiteral("-"));
+      }
+
+      return true;
+   }
+
+   /**
+    * Reads the inputs in turn as chunks of complete lines.
+    *
+    * A chunk holds at least 'chunkSize' bytes unless the input ends, and always ends with a newline: the
+    * partial line at its end is carried over to the next chunk, and a missing newline at the end of a file
+    * is added. "-" stands for stdin.
+    */
+   class ChunkReader
+   {
+   public:
+      ChunkReader(const QStringList &paths, qsizetype chunkSize)
+         : m_paths(paths)
+         , m_chunkSize(chunkSize)
+      {
+      }
+
+      /**
+       * Replaces 'chunk' with the next chunk. Returns false at the end of the input or after an error.
+       */
+      bool next(QByteArray &chunk)
+      {
+         chunk.resize(0);
+         chunk.append(m_carry);
+         m_carry.resize(0);
+
+         while ((chunk.size() < m_chunkSize || chunk.indexOf('\n') < 0) && fill(chunk))
+         {
+         }
+
+         if (chunk.isEmpty() || m_failed)
+         {
+            return false;
+         }
+
+         const qsizetype end = chunk.lastIndexOf('\n') + 1;
+         m_carry.append(chunk.constData() + end, chunk.size() - end);
+         chunk.resize(end);
+         return true;
+      }
+
+      bool failed() const { return m_failed; }
+
+   private:
+      // Appends up to one chunk of the current input. Returns false once all inputs are consumed.
+      bool fill(QByteArray &chunk)
+      {
+         while (m_current < m_paths.size())
+         {
+            if (!m_file.isOpen())
+            {
+               const QString &path = m_paths[m_current];
+               const bool opened = path == QStringLiteral("-") ? m_file.open(stdin, QIODevice::ReadOnly) : (m_file.setFileName(path), m_file.open(QIODevice::ReadOnly));
+               if (!opened)
+               {
+                  fail("cannot open", qPrintable(path));
+                  m_failed = true;
+                  return false;
+               }
+            }
+
+            const qsizetype size = chunk.size();
+            chunk.resize(size + m_chunkSize);
+            const qint64 count = m_file.read(chunk.data() + size, m_chunkSize);
+            chunk.resize(size + std::max<qint64>(count, 0));
+
+            if (count > 0)
+            {
+               return true;
+            }
+
+            if (count < 0)
+            {
+               fail("cannot read", qPrintable(m_paths[m_current]));
+               m_failed = true;
+               return false;
+            }
+
+            m_file.close();
+            ++m_current;
+
+            if (!chunk.isEmpty() && !chunk.endsWith('\n'))
+            {
+               chunk.append('\n');
+               return true;
+            }
+         }
+         return false;
+      }
+
+      QStringList m_paths;
+      qsizetype m_chunkSize;
+      qsizetype m_current = 0;
+      QFile m_file;
+      QByteArray m_carry;
+      bool m_failed = false;
+   };
+
+   bool is_blank(char c)
+   {
+      return c == ' ' || c == '\t' || c == '\r';
+   }
+
+   // Returns the next whitespace-separated field of [cursor, end) and moves 'cursor' past it
+   std::span<char> next_field(char *&cursor, char *end)
+   {
+      while (cursor < end && is_blank(*cursor))
+      {
+         ++cursor;
+      }
+
+      char *begin = cursor;
+      while (cursor < end && !is_blank(*cursor))
+      {
+         ++cursor;
+      }
+      return std::span<char>(begin, cursor);
+   }
+
+   QByteArrayView view(std::span<const char> field)
+   {
+      return QByteArrayView(field.data(), qsizetype(field.size()));
+   }
+
+   bool is_uri(std::span<const char> field)
+   {
+      static constexpr char scheme[] = "otpauth://";
+      constexpr std::size_t length = sizeof(scheme) - 1;
+      if (field.size() < length)
+      {
+         return false;
+      }
+
+      for (std::size_t i = 0; i < length; ++i)
+      {
+         const char c = field[i];
+         if ((c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c) != scheme[i])
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   /**
+    * Decodes a Base32 secret or an otpauth:// URI in place into 'secret'.
+    *
+    * For Base32 the OTP parameters come from the command line. Returns nullptr on success, otherwise the
+    * reason to report.
+    */
+   const char *decode_secret(std::span<char> field, const Settings &settings, libqotp::OtpAuthUri &secret, unsigned int digitMinimum = QOTP_MINIMUM_DIGIT, unsigned int digitMaximum = QOTP_MAXIMUM_DIGIT)
+   {
+      if (field.empty())
+      {
+         return "missing-secret";
+      }
+
+      if (is_uri(field))
+      {
+         const libqotp::OtpAuthError error = libqotp::parse_otpauth_uri(field, secret, digitMinimum, digitMaximum);
+         return error == libqotp::OtpAuthError::None ? nullptr : otpauth_error_name(error);
+      }
+
+      const libqotp::Base32DecodeResult decoded = libqotp::base32_decode(view(field), field);
+      if (!decoded.isValid() || decoded.size == 0)
+      {
+         return "invalid-base32";
+      }
+
+      secret.type = settings.hotp ? libqotp::OtpType::Hotp : libqotp::OtpType::Totp;
+      secret.secret = QByteArrayView(field.data(), decoded.size);
+      secret.algorithm = settings.algorithm;
+      secret.digits = settings.digits;
+      secret.period = settings.period;
+      secret.counter = settings.counter;
+      return nullptr;
+   }
+
+   void append_number(QByteArray &output, quint64 value)
+   {
+      char text[20];
+      const auto result = std::to_chars(text, text + sizeof(text), value);
+      output.append(text, result.ptr - text);
+   }
+
+   void append_signed(QByteArray &output, qint64 value)
+   {
+      char text[21];
+      const auto result = std::to_chars(text, text + sizeof(text), value);
+      output.append(text, result.ptr - text);
+   }
+
+   void append(QByteArray &output, QByteArrayView text)
+   {
+      output.append(text.data(), text.size());
+   }
+
+   // Writes "ID " for records with an ID, or the account of a URI without one
+   void append_id(QByteArray &output, std::span<const char> id, const libqotp::OtpAuthUri &secret)
+   {
+      if (!id.empty())
+      {
+         append(output, view(id));
+         output.append(' ');
+      }
+      else if (!secret.account.isEmpty())
+      {
+         append(output, secret.account);
+         output.append(' ');
+      }
+   }
+
+   // Splits a record into an optional ID and the last field
+   bool split_record(char *&cursor, char *end, std::span<char> &id, std::span<char> &value)
+   {
+      const std::span<char> first = next_field(cursor, end);
+      const std::span<char> second = next_field(cursor, end);
+      if (!next_field(cursor, end).empty())
+      {
+         return false;
+      }
+
+      id = second.empty() ? std::span<char>() : first;
+      value = second.empty() ? first : second;
+      return true;
+   }
+
+   void gen_record(char *cursor, char *end, const Settings &settings, QByteArray &output, Counts &counts)
+   {
+      std::span<char> id;
+      std::span<char> value;
+      libqotp::OtpAuthUri secret;
+      const char *error = split_record(cursor, end, id, value) ? decode_secret(value, settings, secret) : "malformed";
+
+      char code[16];
+      qsizetype length = 0;
+      if (!error)
+      {
+         const quint64 counter = secret.type == libqotp::OtpType::Hotp ? secret.counter : settings.time / secret.period;
+         length = libqotp::hotp(secret.secret, counter, code, secret.digits, QOTP_MINIMUM_DIGIT, QOTP_MAXIMUM_DIGIT, secret.algorithm);
+         error = length > 0 ? nullptr : "failed";
+      }
+
+      append_id(output, id, secret);
+      if (error)
+      {
+         output.append("error:");
+         output.append(error);
+         ++counts.errors;
+      }
+      else
+      {
+         output.append(code, length);
+      }
+      output.append('\n');
+   }
+
+   void verify_record(char *cursor, char *end, const Settings &settings, const KeyTable &keys, QByteArray &output, Counts &counts)
+   {
+      const std::span<char> user = next_field(cursor, end);
+      const std::span<char> code = next_field(cursor, end);
+      const bool wellFormed = !code.empty() && next_field(cursor, end).empty();
+
+      append(output, view(user));
+      output.append(' ');
+
+      const auto found = keys.constFind(QByteArray::fromRawData(user.data(), view(user).size()));
+      if (found == keys.constEnd())
+      {
+         output.append(wellFormed ? "unknown-user\n" : "malformed\n");
+         ++counts.errors;
+         return;
+      }
+
+      const Entry &entry = found.value();
+      quint32 value = 0;
+      if (!wellFormed || code.size() != entry.digits || !std::all_of(code.begin(), code.end(), [](char c) { return c >= '0' && c <= '9'; }) || !parse_number(view(code), value))
+      {
+         output.append("malformed\n");
+         ++counts.errors;
+         return;
+      }
+
+      if (entry.type == libqotp::OtpType::Hotp)
+      {
+         // The counter the server would store next
+         if (const auto next = libqotp::hotp_resync(entry.key, entry.counter, value, settings.lookAhead, entry.digits))
+         {
+            output.append("OK ");
+            append_number(output, *next);
+            output.append('\n');
+            return;
+         }
+      }
+      else if (const auto offset = libqotp::totp_verify(entry.key, value, settings.time, settings.window, entry.period, 0, entry.digits))
+      {
+         output.append("OK ");
+         append_signed(output, *offset);
+         output.append('\n');
+         return;
+      }
+
+      output.append("FAIL\n");
+      ++counts.flagged;
+   }
+
+   // Returns true if 'data' repeats a pattern of at most half its length
+   bool is_repeated(QByteArrayView data)
+   {
+      for (qsizetype period = 1; period <= data.size() / 2; ++period)
+      {
+         if (std::memcmp(data.data(), data.data() + period, std::size_t(data.size() - period)) == 0)
+         {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   void audit_record(char *cursor, char *end, const Settings &settings, QByteArray &output, Counts &counts)
+   {
+      std::span<char> id;
+      std::span<char> value;
+      libqotp::OtpAuthUri secret;
+
+      // The full digit range is accepted so that short codes are reported instead of rejected
+      const char *error = split_record(cursor, end, id, value) ? decode_secret(value, settings, secret, 1, QOTP_MAXIMUM_DIGIT) : "malformed";
+
+      const qsizetype start = output.size();
+      append_id(output, id, secret);
+
+      if (error)
+      {
+         output.append("error:");
+         output.append(error);
+         output.append('\n');
+         ++counts.errors;
+         return;
+      }
+
+      const QByteArrayView data = secret.secret;
+      const quint64 bits = quint64(data.size()) * 8;
+      append_number(output, bits);
+      output.append(' ');
+
+      // A printable secret was most likely typed in as a password
+      const bool ascii = std::all_of(data.begin(), data.end(), [](char c) { return c >= 0x20 && c <= 0x7e; });
+
+      bool seen[256] = {};
+      int distinct = 0;
+      for (char c : data)
+      {
+         distinct += seen[static_cast<unsigned char>(c)] ? 0 : 1;
+         seen[static_cast<unsigned char>(c)] = true;
+      }
+
+      const qsizetype flagsStart = output.size();
+      const auto flag = [&](const char *name)
+      {
+         if (output.size() != flagsStart)
+         {
+            output.append(',');
+         }
+         output.append(name);
+      };
+
+      if (bits < settings.minimumBits)
+      {
+         flag("short");
+      }
+      if (ascii)
+      {
+         flag("ascii");
+      }
+      if (is_repeated(data))
+      {
+         flag("repeated");
+      }
+      if (distinct * 2 < data.size())
+      {
+         flag("low-entropy");
+      }
+      if (secret.digits < 6)
+      {
+         flag("digits:");
+         append_number(output, secret.digits);
+      }
+
+      if (output.size() == flagsStart)
+      {
+         if (settings.flaggedOnly)
+         {
+            output.resize(start);
+            return;
+         }
+         output.append("ok");
+      }
+      else
+      {
+         ++counts.flagged;
+      }
+      output.append('\n');
+   }
+
+   void uri_encode_record(char *cursor, char *end, const Settings &settings, QByteArray &output, Counts &counts)
+   {
+      std::span<char> account;
+      std::span<char> value;
+      libqotp::OtpAuthUri secret;
+      const char *error = split_record(cursor, end, account, value) && !account.empty() ? decode_secret(value, settings, secret) : "malformed";
+
+      if (!error)
+      {
+         secret.account = view(account);
+         if (!settings.issuer.isEmpty())
+         {
+            secret.issuer = settings.issuer;
+         }
+         error = libqotp::write_otpauth_uri(secret, output) < 0 ? "failed" : nullptr;
+      }
+
+      if (error)
+      {
+         append(output, view(account));
+         output.append(account.empty() ? "error:" : " error:");
+         output.append(error);
+         ++counts.errors;
+      }
+      output.append('\n');
+   }
+
+   void uri_decode_record(char *cursor, char *end, const Settings &settings, QByteArray &output, Counts &counts)
+   {
+      std::span<char> id;
+      std::span<char> value;
+      libqotp::OtpAuthUri secret;
+      const char *error = split_record(cursor, end, id, value) && is_uri(value) ? decode_secret(value, settings, secret) : "malformed";
+
+      if (error)
+      {
+         append_id(output, id, secret);
+         output.append("error:");
+         output.append(error);
+         output.append('\n');
+         ++counts.errors;
+         return;
+      }
+
+      // account, issuer, Base32 secret, type, algorithm, digits, period or counter
+      append(output, secret.account);
+      output.append('\t');
+      append(output, secret.issuer.isEmpty() ? QByteArrayView("-") : secret.issuer);
+      output.append('\t');
+
+      const qsizetype size = output.size();
+      output.resize(size + libqotp::base32_encoded_size(secret.secret.size(), libqotp::Base32Option::OmitPadding));
+      libqotp::base32_encode(secret.secret, std::span<char>(output.data() + size, output.size() - size), libqotp::Base32Option::OmitPadding);
+
+      output.append(secret.type == libqotp::OtpType::Hotp ? "\thotp\t" : "\ttotp\t");
+      output.append(algorithm_name(secret.algorithm));
+      output.append('\t');
+      append_number(output, secret.digits);
+      output.append('\t');
+      append_number(output, secret.type == libqotp::OtpType::Hotp ? secret.counter : secret.period);
+      output.append('\n');
+   }
+
+   // Processes the lines of [begin, end), which ends with a newline
+   void process(char *begin, char *end, const Settings &settings, const KeyTable &keys, QByteArray &output, Counts &counts)
+   {
+      while (begin < end)
+      {
+         char *newline = static_cast<char *>(std::memchr(begin, '\n', std::size_t(end - begin)));
+         char *lineEnd = newline ? newline : end;
+         char *cursor = begin;
+         begin = lineEnd + 1;
+
+         while (cursor < lineEnd && is_blank(*cursor))
+         {
+            ++cursor;
+         }
+         if (cursor == lineEnd || *cursor == '#')
+         {
+            continue;
+         }
+
+         ++counts.records;
+         switch (settings.command)
+         {
+         case Command::Gen:
+            gen_record(cursor, lineEnd, settings, output, counts);
+            break;
+         case Command::Verify:
+            verify_record(cursor, lineEnd, settings, keys, output, counts);
+            break;
+         case Command::Audit:
+            audit_record(cursor, lineEnd, settings, output, counts);
+            break;
+         case Command::UriEncode:
+            uri_encode_record(cursor, lineEnd, settings, output, counts);
+            break;
+         case Command::UriDecode:
+            uri_decode_record(cursor, lineEnd, settings, output, counts);
+            break;
+         }
+      }
+   }
+
+   // Loads the "USER SECRET" records of the verify key file
+   bool load_keys(const Settings &settings, KeyTable &keys)
+   {
+      ChunkReader reader(QStringList{settings.keys}, settings.chunkSize);
+      QByteArray chunk;
+      quint64 line = 0;
+
+      while (reader.next(chunk))
+      {
+         char *end = chunk.data() + chunk.size();
+         for (char *begin = chunk.data(); begin < end;)
+         {
+            char *lineEnd = static_cast<char *>(std::memchr(begin, '\n', std::size_t(end - begin)));
+            char *cursor = begin;
+            begin = lineEnd + 1;
+            ++line;
+
+            while (cursor < lineEnd && is_blank(*cursor))
+            {
+               ++cursor;
+            }
+            if (cursor == lineEnd || *cursor == '#')
+            {
+               continue;
+            }
+
+            std::span<char> user;
+            std::span<char> value;
+            libqotp::OtpAuthUri secret;
+            const char *error = !split_record(cursor, lineEnd, user, value) || user.empty() ? "malformed" : decode_secret(value, settings, secret);
+            if (error)
+            {
+               std::fprintf(stderr, "qotp-tool: %s:%llu: %s\n", qPrintable(settings.keys), static_cast<unsigned long long>(line), error);
+               continue;
+            }
+
+            Entry entry;
+            entry.key = libqotp::OtpKey(secret.secret, secret.algorithm);
+            entry.type = secret.type;
+            entry.digits = secret.digits;
+            entry.period = secret.period;
+            entry.counter = secret.counter;
+            keys.insert(QByteArray(user.data(), qsizetype(user.size())), entry);
+         }
+
+         // The decoded secrets are no longer needed
+         std::fill(chunk.begin(), chunk.end(), '\0');
+      }
+
+      return !reader.failed();
+   }
+
+   // Returns the start of the line following the first newline at or after 'position'
+   qsizetype next_line(const QByteArray &chunk, qsizetype position)
+   {
+      const qsizetype newline = chunk.indexOf('\n', std::min(position, chunk.size() - 1));
+      return newline < 0 ? chunk.size() : newline + 1;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   Settings settings;
+   if (!parse_arguments(argc, argv, settings))
+   {
+      return 1;
+   }
+
+   KeyTable keys;
+   if (settings.command == Command::Verify && !load_keys(settings, keys))
+   {
+      return 1;
+   }
+
+   QFile output;
+   const bool opened = settings.output.isEmpty() ? output.open(stdout, QIODevice::WriteOnly) : (output.setFileName(settings.output), output.open(QIODevice::WriteOnly | QIODevice::Truncate));
+   if (!opened)
+   {
+      fail("cannot open output", settings.output.isEmpty() ? "stdout" : qPrintable(settings.output));
+      return 1;
+   }
+
+   QThreadPool pool;
+   if (settings.threads > 0)
+   {
+      pool.setMaxThreadCount(settings.threads);
+   }
+
+   // A few slices per thread even out lines of uneven cost
+   const int sliceCount = std::max(pool.maxThreadCount(), 1) * 4;
+   std::vector<QByteArray> outputs(static_cast<std::size_t>(sliceCount));
+   std::vector<Counts> counts(static_cast<std::size_t>(sliceCount));
+   Counts total;
+
+   const auto start = std::chrono::steady_clock::now();
+   ChunkReader reader(settings.inputs, settings.chunkSize);
+   QByteArray chunk;
+   QByteArray nextChunk;
+   bool more = reader.next(chunk);
+   bool writeFailed = false;
+
+   while (more)
+   {
+      // Cut the chunk at line boundaries into roughly equal slices
+      std::vector<qsizetype> bounds(1, 0);
+      for (int slice = 1; slice < sliceCount; ++slice)
+      {
+         bounds.push_back(std::max(bounds.back(), next_line(chunk, chunk.size() * slice / sliceCount)));
+      }
+      bounds.push_back(chunk.size());
+
+      char *data = chunk.data();
+      QSemaphore finished;
+      for (int slice = 0; slice < sliceCount; ++slice)
+      {
+         outputs[slice].resize(0);
+         counts[slice] = Counts();
+         pool.start([&, slice]()
+         {
+            process(data + bounds[slice], data + bounds[slice + 1], settings, keys, outputs[slice], counts[slice]);
+            finished.release();
+         });
+      }
+
+      // Read ahead while the pool works on this chunk
+      more = reader.next(nextChunk);
+      finished.acquire(sliceCount);
+
+      for (int slice = 0; slice < sliceCount; ++slice)
+      {
+         total += counts[slice];
+         if (!outputs[slice].isEmpty() && output.write(outputs[slice]) != outputs[slice].size())
+         {
+            writeFailed = true;
+         }
+      }
+
+      // Wipe the decoded secrets before the buffer is reused
+      std::fill(chunk.begin(), chunk.end(), '\0');
+      chunk.swap(nextChunk);
+
+      if (writeFailed)
+      {
+         fail("cannot write output");
+         return 1;
+      }
+   }
+
+   output.close();
+
+   if (!settings.quiet)
+   {
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::fprintf(stderr, "qotp-tool: %llu records, %llu errors", static_cast<unsigned long long>(total.records), static_cast<unsigned long long>(total.errors));
+      if (settings.command == Command::Audit || settings.command == Command::Verify)
+      {
+         std::fprintf(stderr, ", %llu %s", static_cast<unsigned long long>(total.flagged), settings.command == Command::Audit ? "flagged" : "failed");
+      }
+      std::fprintf(stderr, ", %.3f s, %.0f records/s\n", seconds, seconds > 0 ? double(total.records) / seconds : 0.0);
+   }
+
+   if (reader.failed())
+   {
+      return 1;
+   }
+   return settings.command == Command::Audit && total.flagged > 0 ? 2 : 0;
+}
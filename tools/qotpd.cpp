@@ -0,0 +1,794 @@
+#include "qotpd_protocol.h"
+#include "qotpd_replay.h"
+
+#include <QThreadPool>
+
+#include <libqotp/clock.h>
+#include <libqotp/keystore.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// qotpd: a local TOTP verification daemon.
+//
+//   qotpd [OPTIONS] KEYSTORE SOCKET
+//
+// The daemon maps a key store written by libqotp::KeyStoreWriter and serves verifications to the processes
+// of the host over a Unix domain socket, so the key material lives in one process instead of every
+// service. The wire format is described in qotpd_protocol.h.
+//
+// One thread runs an epoll loop over the listening socket, the connections, a signalfd and an eventfd.
+// Each round reads every request that has arrived on any connection, so under load the requests of many
+// clients pile up into one round. A round with few requests is verified right on the loop thread, which
+// costs less than waking a worker. Larger rounds are cut into batches for the worker pool; a batch goes
+// through KeyStore::totp_verify() as a whole, so the multi-buffer HMAC engine fills its lanes with the
+// records of each hash algorithm. Workers queue their responses and wake the loop through the eventfd.
+// Accepted time steps are recorded by a ReplayGuard and answered with Status::Replayed when they repeat.
+//
+// A connection whose unsent responses pile up beyond a limit is not read from until they are written.
+// A client that shuts down its writing side still gets the responses to all its requests; the connection
+// is closed once they are written.
+
+namespace
+{
+   struct Settings
+   {
+      QString keyStore;
+      QByteArray socketPath;
+      int threads = 0;
+      unsigned int window = 1;
+      qsizetype maxBatchSize = 256;
+      qsizetype inlineLimit = 8;
+      qsizetype replayCapacity = -1;
+   };
+
+   // Unsent responses above which a connection is not read from
+   constexpr qsizetype output_limit = 1024 * 1024;
+
+   // A request waiting for verification, and the connection to answer
+   struct Pending
+   {
+      int fd;
+      quint64 generation;
+      quint32 id;
+      libqotp::KeyStoreCheck check;
+   };
+
+   // A response made by a worker, to be sent by the loop
+   struct Completion
+   {
+      int fd;
+      quint64 generation;
+      char bytes[qotpd::response_size];
+   };
+
+   struct Connection
+   {
+      int fd = -1;
+
+      // Tells a reused descriptor from the connection a completion belongs to
+      quint64 generation = 0;
+
+      // A partial request read so far
+      char partial[qotpd::request_size];
+      qsizetype partialSize = 0;
+
+      // Responses not yet written, from 'written' on
+      QByteArray output;
+      qsizetype written = 0;
+
+      // Requests being verified, on the loop thread or in the pool
+      qsizetype outstanding = 0;
+
+      // The events epoll currently waits for
+      quint32 events = 0;
+
+      // Set when the client shut down its writing side
+      bool readClosed = false;
+
+      // Set when the response buffer got data this round
+      bool dirty = false;
+   };
+
+   struct Stats
+   {
+      quint64 connections = 0;
+      quint64 requests = 0;
+      quint64 inlineRequests = 0;
+      quint64 batches = 0;
+   };
+
+   const char usage[] =
+       "usage: qotpd [OPTIONS] KEYSTORE SOCKET\n"
+       "\n"
+       "options:\n"
+       "  --threads N          worker threads, default: all cores\n"
+       "  --window N           TOTP steps accepted before and after now, 0 to 127, default: 1\n"
+       "  --batch N            requests per worker batch, default: 256\n"
+       "  --inline N           rounds of up to N requests are verified on the loop thread, default: 8\n"
+       "  --replay-capacity N  time steps remembered against replay, 0 disables, default: 2 per record\n";
+
+   template <typename T>
+   bool parse_number(const char *text, T &value)
+   {
+      const char *end = text + std::strlen(text);
+      const auto result = std::from_chars(text, end, value);
+      return text != end && result.ec == std::errc() && result.ptr == end;
+   }
+
+   bool parse_arguments(int argc, char **argv, Settings &settings)
+   {
+      QStringList positional;
+      for (int i = 1; i < argc; ++i)
+      {
+         const QByteArrayView argument(argv[i]);
+         const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+         bool ok = true;
+         if (argument == "-h" || argument == "--help")
+         {
+            std::fputs(usage, stdout);
+            std::exit(0);
+         }
+         else if (argument == "--threads")
+         {
+            ok = value && parse_number(value, settings.threads);
+         }
+         else if (argument == "--window")
+         {
+            ok = value && parse_number(value, settings.window) && settings.window <= 127;
+         }
+         else if (argument == "--batch")
+         {
+            ok = value && parse_number(value, settings.maxBatchSize) && settings.maxBatchSize > 0;
+         }
+         else if (argument == "--inline")
+         {
+            ok = value && parse_number(value, settings.inlineLimit);
+         }
+         else if (argument == "--replay-capacity")
+         {
+            ok = value && parse_number(value, settings.replayCapacity);
+         }
+         else if (argument.startsWith('-'))
+         {
+            std::fprintf(stderr, "qotpd: unknown option: %s\n", argv[i]);
+            return false;
+         }
+         else
+         {
+            positional.append(QString::fromLocal8Bit(argv[i]));
+            continue;
+         }
+
+         if (!ok)
+         {
+            std::fprintf(stderr, "qotpd: invalid or missing value for %s\n", argv[i]);
+            return false;
+         }
+         ++i;
+      }
+
+      if (positional.size() != 2)
+      {
+         std::fputs(usage, stderr);
+         return false;
+      }
+
+      settings.keyStore = positional[0];
+      settings.socketPath = positional[1].toLocal8Bit();
+      return true;
+   }
+
+   // Binds and listens on 'path'. A socket file left behind by a daemon that is gone is replaced, the
+   // socket of a running daemon is not.
+   int listen_on(const QByteArray &path)
+   {
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      if (path.size() >= qsizetype(sizeof(address.sun_path)))
+      {
+         std::fprintf(stderr, "qotpd: socket path too long\n");
+         return -1;
+      }
+      std::memcpy(address.sun_path, path.constData(), std::size_t(path.size()));
+
+      const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      const bool running = probe >= 0 && (::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0 || errno == EAGAIN);
+      const bool stale = probe >= 0 && !running && errno == ECONNREFUSED;
+      if (probe >= 0)
+      {
+         ::close(probe);
+      }
+
+      if (running)
+      {
+         std::fprintf(stderr, "qotpd: another daemon is listening on %s\n", path.constData());
+         return -1;
+      }
+      if (stale)
+      {
+         ::unlink(path.constData());
+      }
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+      {
+         return -1;
+      }
+
+      // Only the owner and the group may connect
+      const mode_t mask = ::umask(0117);
+      const bool bound = ::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+      ::umask(mask);
+
+      if (!bound || ::listen(fd, SOMAXCONN) != 0)
+      {
+         std::fprintf(stderr, "qotpd: cannot listen on %s: %s\n", path.constData(), std::strerror(errno));
+         ::close(fd);
+         return -1;
+      }
+      return fd;
+   }
+
+   class Daemon
+   {
+   public:
+      Daemon(const Settings &settings, const libqotp::KeyStore &store, qotpd::ReplayGuard *replay)
+         : m_settings(settings)
+         , m_store(store)
+         , m_replay(replay)
+      {
+         if (settings.threads > 0)
+         {
+            m_pool.setMaxThreadCount(settings.threads);
+         }
+      }
+
+      ~Daemon()
+      {
+         m_pool.waitForDone();
+         for (const std::unique_ptr<Connection> &connection : m_connections)
+         {
+            if (connection)
+            {
+               ::close(connection->fd);
+            }
+         }
+         for (const int fd : {m_epoll, m_wakeup, m_signals})
+         {
+            if (fd >= 0)
+            {
+               ::close(fd);
+            }
+         }
+      }
+
+      bool start(int listener)
+      {
+         m_listener = listener;
+
+         // Workers are started later from this thread and inherit the mask
+         sigset_t stopSignals;
+         sigemptyset(&stopSignals);
+         sigaddset(&stopSignals, SIGINT);
+         sigaddset(&stopSignals, SIGTERM);
+         pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+         std::signal(SIGPIPE, SIG_IGN);
+
+         m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+         m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+         m_signals = ::signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+         return m_epoll >= 0 && m_wakeup >= 0 && m_signals >= 0 && watch(m_listener, EPOLLIN) && watch(m_wakeup, EPOLLIN) && watch(m_signals, EPOLLIN);
+      }
+
+      // Serves until SIGINT or SIGTERM
+      void run()
+      {
+         epoll_event events[256];
+         std::vector<Pending> pending;
+
+         while (!m_stopping)
+         {
+            const int count = ::epoll_wait(m_epoll, events, 256, -1);
+            if (count < 0)
+            {
+               if (errno == EINTR)
+               {
+                  continue;
+               }
+               std::fprintf(stderr, "qotpd: epoll_wait: %s\n", std::strerror(errno));
+               return;
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+               const int fd = events[i].data.fd;
+               if (fd == m_listener)
+               {
+                  accept_connections();
+               }
+               else if (fd == m_wakeup)
+               {
+                  take_completions();
+               }
+               else if (fd == m_signals)
+               {
+                  m_stopping = true;
+               }
+               else
+               {
+                  handle(fd, events[i].events, pending);
+               }
+            }
+
+            dispatch(pending);
+            flush_dirty();
+         }
+      }
+
+      const Stats &stats() const { return m_stats; }
+
+   private:
+      bool watch(int fd, quint32 events)
+      {
+         epoll_event event = {};
+         event.events = events;
+         event.data.fd = fd;
+         return ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+      }
+
+      Connection *connection(int fd, quint64 generation) const
+      {
+         if (fd < 0 || std::size_t(fd) >= m_connections.size() || !m_connections[fd] || m_connections[fd]->generation != generation)
+         {
+            return nullptr;
+         }
+         return m_connections[fd].get();
+      }
+
+      void accept_connections()
+      {
+         for (;;)
+         {
+            const int fd = ::accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+               if (errno == EINTR || errno == ECONNABORTED)
+               {
+                  continue;
+               }
+               if (errno == EMFILE || errno == ENFILE)
+               {
+                  // The connection stays queued and the level-triggered listener would wake the loop
+                  // right away forever. Listen again once a connection is closed.
+                  std::fprintf(stderr, "qotpd: out of descriptors, pausing accept: %s\n", std::strerror(errno));
+                  ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_listener, nullptr);
+                  m_acceptPaused = true;
+               }
+               return;
+            }
+
+            if (std::size_t(fd) >= m_connections.size())
+            {
+               m_connections.resize(std::size_t(fd) + 1);
+            }
+
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->generation = ++m_generation;
+            connection->events = EPOLLIN | EPOLLRDHUP;
+            if (!watch(fd, connection->events))
+            {
+               ::close(fd);
+               continue;
+            }
+            m_connections[fd] = std::move(connection);
+            ++m_stats.connections;
+         }
+      }
+
+      void close_connection(Connection &connection)
+      {
+         // Closing removes the descriptor from the epoll set. Completions still on their way find a
+         // different generation, or no connection, and are dropped.
+         ::close(connection.fd);
+         m_connections[connection.fd].reset();
+
+         if (m_acceptPaused && watch(m_listener, EPOLLIN))
+         {
+            m_acceptPaused = false;
+         }
+      }
+
+      void handle(int fd, quint32 events, std::vector<Pending> &pending)
+      {
+         Connection *connection = std::size_t(fd) < m_connections.size() ? m_connections[fd].get() : nullptr;
+         if (!connection)
+         {
+            return;
+         }
+
+         if (events & (EPOLLHUP | EPOLLERR))
+         {
+            // The client is gone in both directions, nobody is left to answer
+            close_connection(*connection);
+            return;
+         }
+
+         if ((events & EPOLLOUT) && !flush(*connection))
+         {
+            return;
+         }
+
+         if ((events & (EPOLLIN | EPOLLRDHUP)) && !connection->readClosed)
+         {
+            read_requests(*connection, pending);
+         }
+      }
+
+      // Reads everything available. Stops reading at the end of the input and closes the connection on an error.
+      void read_requests(Connection &connection, std::vector<Pending> &pending)
+      {
+         char buffer[64 * 1024];
+         for (;;)
+         {
+            std::memcpy(buffer, connection.partial, std::size_t(connection.partialSize));
+            const std::size_t space = sizeof(buffer) - std::size_t(connection.partialSize);
+            const ssize_t count = ::read(connection.fd, buffer + connection.partialSize, space);
+            if (count == 0)
+            {
+               // Half-closed: the flush at the end of the round closes the connection once every
+               // request is answered
+               connection.readClosed = true;
+               mark_dirty(connection);
+               return;
+            }
+            if (count < 0)
+            {
+               if (errno != EAGAIN && errno != EINTR)
+               {
+                  close_connection(connection);
+               }
+               return;
+            }
+
+            const qsizetype size = connection.partialSize + count;
+            qsizetype offset = 0;
+            for (; offset + qotpd::request_size <= size; offset += qotpd::request_size)
+            {
+               accept_request(connection, qotpd::read_request(buffer + offset), pending);
+            }
+
+            connection.partialSize = size - offset;
+            std::memcpy(connection.partial, buffer + offset, std::size_t(connection.partialSize));
+
+            if (std::size_t(count) < space)
+            {
+               // The socket is drained
+               return;
+            }
+         }
+      }
+
+      void accept_request(Connection &connection, const qotpd::Request &request, std::vector<Pending> &pending)
+      {
+         ++m_stats.requests;
+
+         qotpd::Response response;
+         response.id = request.id;
+         if (request.operation != qotpd::Operation::TotpVerify || request.reserved[0] || request.reserved[1] || request.reserved[2])
+         {
+            response.status = qotpd::Status::BadRequest;
+         }
+         else if (qsizetype(request.index) >= m_store.size())
+         {
+            response.status = qotpd::Status::UnknownKey;
+         }
+         else
+         {
+            pending.push_back({connection.fd, connection.generation, request.id, {qsizetype(request.index), request.code}});
+            ++connection.outstanding;
+            return;
+         }
+
+         append_response(connection, response);
+      }
+
+      void append_response(Connection &connection, const qotpd::Response &response)
+      {
+         const qsizetype size = connection.output.size();
+         connection.output.resize(size + qotpd::response_size);
+         qotpd::write_response(response, connection.output.data() + size);
+         mark_dirty(connection);
+      }
+
+      void mark_dirty(Connection &connection)
+      {
+         if (!connection.dirty)
+         {
+            connection.dirty = true;
+            m_dirty.push_back({connection.fd, connection.generation});
+         }
+      }
+
+      // Verifies the requests of this round on the loop thread or hands them to the pool in batches
+      void dispatch(std::vector<Pending> &pending)
+      {
+         if (pending.empty())
+         {
+            return;
+         }
+
+         if (qsizetype(pending.size()) <= m_settings.inlineLimit)
+         {
+            m_stats.inlineRequests += pending.size();
+            verify(pending, [this](const Pending &request, const qotpd::Response &response)
+            {
+               if (Connection *target = connection(request.fd, request.generation))
+               {
+                  --target->outstanding;
+                  append_response(*target, response);
+               }
+            });
+            pending.clear();
+            return;
+         }
+
+         for (std::size_t begin = 0; begin < pending.size(); begin += std::size_t(m_settings.maxBatchSize))
+         {
+            const std::size_t end = std::min(pending.size(), begin + std::size_t(m_settings.maxBatchSize));
+            auto batch = std::make_shared<std::vector<Pending>>(pending.begin() + qsizetype(begin), pending.begin() + qsizetype(end));
+            ++m_stats.batches;
+
+            m_pool.start([this, batch]()
+            {
+               std::vector<Completion> completions;
+               completions.reserve(batch->size());
+               verify(*batch, [&completions](const Pending &request, const qotpd::Response &response)
+               {
+                  Completion completion;
+                  completion.fd = request.fd;
+                  completion.generation = request.generation;
+                  qotpd::write_response(response, completion.bytes);
+                  completions.push_back(completion);
+               });
+
+               bool wake = false;
+               {
+                  std::lock_guard lock(m_completionMutex);
+                  wake = m_completions.empty();
+                  m_completions.insert(m_completions.end(), completions.begin(), completions.end());
+               }
+
+               // The loop takes all completions per wakeup, so only the first one needs to wake it
+               if (wake)
+               {
+                  const quint64 one = 1;
+                  [[maybe_unused]] const ssize_t written = ::write(m_wakeup, &one, sizeof(one));
+               }
+            });
+         }
+         pending.clear();
+      }
+
+      // Verifies 'requests' as one batch and passes each response to 'deliver'
+      template <typename Deliver>
+      void verify(const std::vector<Pending> &requests, Deliver deliver) const
+      {
+         constexpr std::size_t chunkSize = 256;
+         libqotp::KeyStoreCheck checks[chunkSize];
+         std::optional<int> results[chunkSize];
+         const quint64 now = libqotp::current_unix_time();
+
+         for (std::size_t begin = 0; begin < requests.size(); begin += chunkSize)
+         {
+            const std::size_t count = std::min(chunkSize, requests.size() - begin);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               checks[i] = requests[begin + i].check;
+            }
+
+            m_store.totp_verify(std::span<const libqotp::KeyStoreCheck>(checks, count), std::span<std::optional<int>>(results, count), now, m_settings.window);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+               qotpd::Response response;
+               response.id = requests[begin + i].id;
+               if (results[i])
+               {
+                  response.offset = static_cast<qint8>(*results[i]);
+                  response.status = replayed(checks[i].index, *results[i], now) ? qotpd::Status::Replayed : qotpd::Status::Accepted;
+               }
+               deliver(requests[begin + i], response);
+            }
+         }
+      }
+
+      // Records the time step a code matched and returns true if it was accepted before
+      bool replayed(qsizetype index, int offset, quint64 now) const
+      {
+         return m_replay && m_replay->replayed(index, offset, now);
+      }
+
+      void take_completions()
+      {
+         quint64 value = 0;
+         [[maybe_unused]] const ssize_t read = ::read(m_wakeup, &value, sizeof(value));
+
+         {
+            std::lock_guard lock(m_completionMutex);
+            m_completionsTaken.swap(m_completions);
+         }
+
+         for (const Completion &completion : m_completionsTaken)
+         {
+            if (Connection *target = connection(completion.fd, completion.generation))
+            {
+               --target->outstanding;
+               target->output.append(completion.bytes, qotpd::response_size);
+               mark_dirty(*target);
+            }
+         }
+         m_completionsTaken.clear();
+      }
+
+      void flush_dirty()
+      {
+         for (const auto &[fd, generation] : m_dirty)
+         {
+            if (Connection *target = connection(fd, generation))
+            {
+               target->dirty = false;
+               flush(*target);
+            }
+         }
+         m_dirty.clear();
+      }
+
+      // Writes the pending responses and adjusts the events to wait for. Closes a half-closed connection
+      // once all its requests are answered. Returns false if the connection was closed.
+      bool flush(Connection &connection)
+      {
+         while (connection.written < connection.output.size())
+         {
+            const ssize_t count = ::send(connection.fd, connection.output.constData() + connection.written, std::size_t(connection.output.size() - connection.written), MSG_NOSIGNAL);
+            if (count < 0)
+            {
+               if (errno == EINTR)
+               {
+                  continue;
+               }
+               if (errno != EAGAIN)
+               {
+                  close_connection(connection);
+                  return false;
+               }
+               break;
+            }
+            connection.written += count;
+         }
+
+         const qsizetype unsent = connection.output.size() - connection.written;
+         if (unsent == 0)
+         {
+            // resize(0) keeps the capacity for the next round
+            connection.output.resize(0);
+            connection.written = 0;
+         }
+
+         if (connection.readClosed && unsent == 0 && connection.outstanding == 0)
+         {
+            close_connection(connection);
+            return false;
+         }
+
+         // Wait for the socket to take more, and stop reading while too much is unsent or after the end of the input
+         const bool reading = !connection.readClosed && unsent <= output_limit;
+         const quint32 events = (unsent > 0 ? quint32(EPOLLOUT) : 0u) | (reading ? quint32(EPOLLIN | EPOLLRDHUP) : 0u);
+         if (events != connection.events)
+         {
+            epoll_event event = {};
+            event.events = events;
+            event.data.fd = connection.fd;
+            ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.events = events;
+         }
+         return true;
+      }
+
+      const Settings &m_settings;
+      const libqotp::KeyStore &m_store;
+      qotpd::ReplayGuard *m_replay = nullptr;
+      QThreadPool m_pool;
+
+      int m_listener = -1;
+      int m_epoll = -1;
+      int m_wakeup = -1;
+      int m_signals = -1;
+      bool m_stopping = false;
+
+      // Set while the listener is out of the epoll set because the process ran out of descriptors
+      bool m_acceptPaused = false;
+
+      // Indexed by descriptor
+      std::vector<std::unique_ptr<Connection>> m_connections;
+      quint64 m_generation = 0;
+      std::vector<std::pair<int, quint64>> m_dirty;
+
+      std::mutex m_completionMutex;
+      std::vector<Completion> m_completions;
+      std::vector<Completion> m_completionsTaken;
+
+      Stats m_stats;
+   };
+}
+
+int main(int argc, char **argv)
+{
+   Settings settings;
+   if (!parse_arguments(argc, argv, settings))
+   {
+      return 1;
+   }
+
+   libqotp::KeyStore store;
+   if (!store.open(settings.keyStore))
+   {
+      std::fprintf(stderr, "qotpd: cannot open key store %s (error %d)\n", qPrintable(settings.keyStore), int(store.error()));
+      return 1;
+   }
+
+   std::unique_ptr<qotpd::ReplayGuard> replay;
+   const qsizetype replayCapacity = settings.replayCapacity < 0 ? std::max<qsizetype>(2 * store.size(), 1024) : settings.replayCapacity;
+   if (replayCapacity > 0)
+   {
+      replay = std::make_unique<qotpd::ReplayGuard>(store, replayCapacity, settings.window);
+   }
+
+   const int listener = listen_on(settings.socketPath);
+   if (listener < 0)
+   {
+      return 1;
+   }
+
+   int result = 0;
+   {
+      Daemon daemon(settings, store, replay.get());
+      if (daemon.start(listener))
+      {
+         std::fprintf(stderr, "qotpd: serving %lld records on %s\n", static_cast<long long>(store.size()), settings.socketPath.constData());
+         daemon.run();
+
+         const Stats &stats = daemon.stats();
+         std::fprintf(stderr, "qotpd: %llu connections, %llu requests, %llu verified inline, %llu batches\n", static_cast<unsigned long long>(stats.connections), static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.inlineRequests), static_cast<unsigned long long>(stats.batches));
+      }
+      else
+      {
+         std::fprintf(stderr, "qotpd: cannot set up the event loop: %s\n", std::strerror(errno));
+         result = 1;
+      }
+   }
+
+   ::close(listener);
+   ::unlink(settings.socketPath.constData());
+   return result;
+}
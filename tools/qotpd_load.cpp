@@ -0,0 +1,314 @@
+#include "qotpd_protocol.h"
+
+#include <libqotp/clock.h>
+#include <libqotp/keystore.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// qotpd-load: a load generator for qotpd.
+//
+//   qotpd-load [OPTIONS] SOCKET
+//
+// Opens a number of connections, each on its own thread, and keeps a fixed number of requests in flight
+// on each of them: whenever responses arrive, the same number of new requests is written. The time from
+// writing a request to reading its response is recorded for every request, and the percentiles of all
+// connections are reported together with the throughput and the count of each status.
+//
+// Without --keystore the codes are random and nearly all rejected, which costs the daemon the same as a
+// valid code. With --keystore the client computes the current code of each record from the same store, so
+// the first request per record and time step is accepted and the following ones are replays.
+
+namespace
+{
+   struct Settings
+   {
+      QByteArray socketPath;
+      QString keyStore;
+      int connections = 4;
+      int depth = 16;
+      quint32 requests = 100000;
+      quint32 keys = 1;
+   };
+
+   struct Result
+   {
+      std::vector<quint32> latencies;
+      std::array<quint64, 5> statuses = {};
+      bool failed = false;
+   };
+
+   const char usage[] =
+       "usage: qotpd-load [OPTIONS] SOCKET\n"
+       "\n"
+       "options:\n"
+       "  --connections N   parallel connections, default: 4\n"
+       "  --depth N         requests in flight per connection, default: 16\n"
+       "  --requests N      requests per connection, default: 100000\n"
+       "  --keys N          records the requests are spread over, default: 1, or all with --keystore\n"
+       "  --keystore FILE   send the valid codes of the records of FILE\n";
+
+   template <typename T>
+   bool parse_number(const char *text, T &value)
+   {
+      const char *end = text + std::strlen(text);
+      const auto result = std::from_chars(text, end, value);
+      return text != end && result.ec == std::errc() && result.ptr == end;
+   }
+
+   bool parse_arguments(int argc, char **argv, Settings &settings)
+   {
+      bool haveKeys = false;
+      for (int i = 1; i < argc; ++i)
+      {
+         const QByteArrayView argument(argv[i]);
+         const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+         bool ok = true;
+         if (argument == "-h" || argument == "--help")
+         {
+            std::fputs(usage, stdout);
+            std::exit(0);
+         }
+         else if (argument == "--connections")
+         {
+            ok = value && parse_number(value, settings.connections) && settings.connections > 0;
+         }
+         else if (argument == "--depth")
+         {
+            ok = value && parse_number(value, settings.depth) && settings.depth > 0;
+         }
+         else if (argument == "--requests")
+         {
+            ok = value && parse_number(value, settings.requests) && settings.requests > 0;
+         }
+         else if (argument == "--keys")
+         {
+            ok = value && parse_number(value, settings.keys) && settings.keys > 0;
+            haveKeys = true;
+         }
+         else if (argument == "--keystore")
+         {
+            ok = value != nullptr;
+            settings.keyStore = ok ? QString::fromLocal8Bit(value) : QString();
+         }
+         else if (argument.startsWith('-') || !settings.socketPath.isEmpty())
+         {
+            std::fputs(usage, stderr);
+            return false;
+         }
+         else
+         {
+            settings.socketPath = QByteArray(argv[i]);
+            continue;
+         }
+
+         if (!ok)
+         {
+            std::fprintf(stderr, "qotpd-load: invalid or missing value for %s\n", argv[i]);
+            return false;
+         }
+         ++i;
+      }
+
+      if (settings.socketPath.isEmpty())
+      {
+         std::fputs(usage, stderr);
+         return false;
+      }
+
+      // Spread over the whole store unless told otherwise
+      settings.keys = haveKeys || settings.keyStore.isEmpty() ? settings.keys : 0;
+      return true;
+   }
+
+   int connect_to(const QByteArray &path)
+   {
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      if (path.size() >= qsizetype(sizeof(address.sun_path)))
+      {
+         return -1;
+      }
+      std::memcpy(address.sun_path, path.constData(), std::size_t(path.size()));
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+      {
+         ::close(fd);
+         return -1;
+      }
+      return fd;
+   }
+
+   bool write_all(int fd, const char *data, std::size_t size)
+   {
+      while (size > 0)
+      {
+         const ssize_t count = ::send(fd, data, size, MSG_NOSIGNAL);
+         if (count <= 0)
+         {
+            return false;
+         }
+         data += count;
+         size -= std::size_t(count);
+      }
+      return true;
+   }
+
+   // Drives one connection. The request id is the index of the request, which also indexes the send times.
+   void run_connection(const Settings &settings, const libqotp::KeyStore *store, quint32 keys, unsigned int seed, Result &result)
+   {
+      const int fd = connect_to(settings.socketPath);
+      if (fd < 0)
+      {
+         result.failed = true;
+         return;
+      }
+
+      std::mt19937 random(seed);
+      std::vector<std::chrono::steady_clock::time_point> sent(settings.requests);
+      result.latencies.reserve(settings.requests);
+
+      quint32 next = 0;
+      std::vector<char> output;
+      const auto send_requests = [&](quint32 count) -> bool
+      {
+         output.resize(std::size_t(count) * qotpd::request_size);
+         const quint64 now = libqotp::current_unix_time();
+         const auto time = std::chrono::steady_clock::now();
+         for (quint32 i = 0; i < count; ++i, ++next)
+         {
+            qotpd::Request request;
+            request.id = next;
+            request.index = random() % keys;
+            request.code = store ? store->totp_value(request.index, now).value_or(0) : random() % 1000000;
+            qotpd::write_request(request, output.data() + std::size_t(i) * qotpd::request_size);
+            sent[next] = time;
+         }
+         return write_all(fd, output.data(), output.size());
+      };
+
+      quint32 received = 0;
+      char input[64 * 1024];
+      qsizetype buffered = 0;
+      bool ok = send_requests(std::min<quint32>(quint32(settings.depth), settings.requests));
+
+      while (ok && received < settings.requests)
+      {
+         const ssize_t count = ::read(fd, input + buffered, sizeof(input) - std::size_t(buffered));
+         if (count <= 0)
+         {
+            ok = false;
+            break;
+         }
+
+         const auto time = std::chrono::steady_clock::now();
+         buffered += count;
+
+         qsizetype offset = 0;
+         quint32 arrived = 0;
+         for (; offset + qotpd::response_size <= buffered; offset += qotpd::response_size)
+         {
+            const qotpd::Response response = qotpd::read_response(input + offset);
+            if (response.id >= settings.requests || std::size_t(response.status) >= result.statuses.size())
+            {
+               ok = false;
+               break;
+            }
+
+            result.latencies.push_back(quint32(std::chrono::duration_cast<std::chrono::nanoseconds>(time - sent[response.id]).count()));
+            ++result.statuses[std::size_t(response.status)];
+            ++arrived;
+         }
+
+         std::memmove(input, input + offset, std::size_t(buffered - offset));
+         buffered -= offset;
+         received += arrived;
+
+         const quint32 more = std::min(arrived, settings.requests - next);
+         if (ok && more > 0)
+         {
+            ok = send_requests(more);
+         }
+      }
+
+      result.failed = !ok;
+      ::close(fd);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   Settings settings;
+   if (!parse_arguments(argc, argv, settings))
+   {
+      return 1;
+   }
+
+   libqotp::KeyStore store;
+   if (!settings.keyStore.isEmpty() && !store.open(settings.keyStore))
+   {
+      std::fprintf(stderr, "qotpd-load: cannot open key store %s\n", qPrintable(settings.keyStore));
+      return 1;
+   }
+   const quint32 keys = settings.keys > 0 ? settings.keys : quint32(std::max<qsizetype>(store.size(), 1));
+
+   std::vector<Result> results(std::size_t(settings.connections));
+   std::vector<std::thread> threads;
+   const auto start = std::chrono::steady_clock::now();
+   for (int i = 0; i < settings.connections; ++i)
+   {
+      threads.emplace_back(run_connection, std::cref(settings), store.isOpen() ? &store : nullptr, keys, unsigned(i + 1), std::ref(results[std::size_t(i)]));
+   }
+   for (std::thread &thread : threads)
+   {
+      thread.join();
+   }
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   std::vector<quint32> latencies;
+   std::array<quint64, 5> statuses = {};
+   bool failed = false;
+   for (const Result &result : results)
+   {
+      latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+      for (std::size_t i = 0; i < statuses.size(); ++i)
+      {
+         statuses[i] += result.statuses[i];
+      }
+      failed = failed || result.failed;
+   }
+
+   if (failed)
+   {
+      std::fprintf(stderr, "qotpd-load: a connection to %s failed\n", settings.socketPath.constData());
+   }
+   if (latencies.empty())
+   {
+      return 1;
+   }
+
+   std::sort(latencies.begin(), latencies.end());
+   const auto percentile = [&latencies](double fraction)
+   {
+      const std::size_t index = std::min(latencies.size() - 1, std::size_t(fraction * double(latencies.size())));
+      return double(latencies[index]) / 1000.0;
+   };
+
+   std::printf("%zu requests over %d connections, %d in flight each, %.3f s, %.0f requests/s\n", latencies.size(), settings.connections, settings.depth, seconds, double(latencies.size()) / seconds);
+   std::printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), double(latencies.back()) / 1000.0);
+   std::printf("accepted %llu  rejected %llu  replayed %llu  unknown key %llu  bad request %llu\n", static_cast<unsigned long long>(statuses[0]), static_cast<unsigned long long>(statuses[1]), static_cast<unsigned long long>(statuses[2]), static_cast<unsigned long long>(statuses[3]), static_cast<unsigned long long>(statuses[4]));
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+#ifndef QOTPD_PROTOCOL_H_20261018
+#define QOTPD_PROTOCOL_H_20261018
+
+#include <QtEndian>
+#include <QtGlobal>
+
+// The wire format between qotpd and its clients.
+//
+// Clients connect to the Unix domain socket of the daemon and write fixed-size requests back to back,
+// without waiting for the responses of earlier ones. The daemon answers every request with a fixed-size
+// response carrying the same id. Responses of one connection may arrive in a different order than the
+// requests, so clients match them by id. All integers are little endian.
+namespace qotpd
+{
+   enum class Operation : quint8
+   {
+      // Verify a TOTP code against a record of the key store with the window of the daemon.
+      TotpVerify = 1
+   };
+
+   enum class Status : quint8
+   {
+      // The code matched; the response carries the offset of the matching time step.
+      Accepted = 0,
+
+      // No code in the window matched, or the record is an HOTP key or corrupt.
+      Rejected = 1,
+
+      // The code matched, but its time step was accepted before for this record.
+      Replayed = 2,
+
+      // The record index is beyond the end of the key store.
+      UnknownKey = 3,
+
+      // The operation or a reserved byte is not understood.
+      BadRequest = 4
+   };
+
+   // Bytes of a request: id, record index, code, operation and three reserved zero bytes.
+   inline constexpr qsizetype request_size = 16;
+
+   // Bytes of a response: id, status, offset and two reserved zero bytes.
+   inline constexpr qsizetype response_size = 8;
+
+   struct Request
+   {
+      // Chosen by the client and echoed in the response.
+      quint32 id = 0;
+
+      // The record of the key store to verify against.
+      quint32 index = 0;
+
+      // The code entered by the user.
+      quint32 code = 0;
+
+      Operation operation = Operation::TotpVerify;
+
+      // Must be zero.
+      quint8 reserved[3] = {};
+   };
+
+   struct Response
+   {
+      // The id of the request.
+      quint32 id = 0;
+
+      Status status = Status::Rejected;
+
+      // The offset in time steps of the matching code if the status is Accepted or Replayed, otherwise 0.
+      qint8 offset = 0;
+   };
+
+   inline void write_request(const Request &request, char *output)
+   {
+      qToLittleEndian<quint32>(request.id, output);
+      qToLittleEndian<quint32>(request.index, output + 4);
+      qToLittleEndian<quint32>(request.code, output + 8);
+      output[12] = static_cast<char>(request.operation);
+      output[13] = static_cast<char>(request.reserved[0]);
+      output[14] = static_cast<char>(request.reserved[1]);
+      output[15] = static_cast<char>(request.reserved[2]);
+   }
+
+   inline Request read_request(const char *input)
+   {
+      Request request;
+      request.id = qFromLittleEndian<quint32>(input);
+      request.index = qFromLittleEndian<quint32>(input + 4);
+      request.code = qFromLittleEndian<quint32>(input + 8);
+      request.operation = static_cast<Operation>(input[12]);
+      request.reserved[0] = static_cast<quint8>(input[13]);
+      request.reserved[1] = static_cast<quint8>(input[14]);
+      request.reserved[2] = static_cast<quint8>(input[15]);
+      return request;
+   }
+
+   inline void write_response(const Response &response, char *output)
+   {
+      qToLittleEndian<quint32>(response.id, output);
+      output[4] = static_cast<char>(response.status);
+      output[5] = static_cast<char>(response.offset);
+      output[6] = 0;
+      output[7] = 0;
+   }
+
+   inline Response read_response(const char *input)
+   {
+      Response response;
+      response.id = qFromLittleEndian<quint32>(input);
+      response.status = static_cast<Status>(input[4]);
+      response.offset = static_cast<qint8>(input[5]);
+      return response;
+   }
+}
+
+#endif
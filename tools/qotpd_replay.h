@@ -0,0 +1,65 @@
+#ifndef QOTPD_REPLAY_H_20261018
+#define QOTPD_REPLAY_H_20261018
+
+#include <libqotp/keystore.h>
+#include <libqotp/replaystore.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+// Replay protection of qotpd.
+//
+// The records of a key store may each have their own period and epoch, so the time step a code matched is
+// not comparable between records, nor with the time step of a ReplayStore. ReplayGuard identifies the step
+// by the Unix time it starts at, epoch + step * period, and remembers these times in a ReplayStore that
+// counts seconds. Its window covers the window of the daemon in the longest period of the store, so no
+// step expires while a code of it can still be accepted; steps of shorter periods are remembered longer
+// than needed, which only costs capacity.
+namespace qotpd
+{
+   class ReplayGuard
+   {
+   public:
+      // 'window' is the TOTP window of the daemon. Reads every record of 'store' once for its period.
+      ReplayGuard(const libqotp::KeyStore &store, qsizetype capacity, unsigned int window)
+         : m_store(store)
+         , m_replay(capacity, 1, 0, static_cast<unsigned int>(std::min<quint64>(quint64(window + 1) * longest_period(store), std::numeric_limits<unsigned int>::max())))
+      {
+      }
+
+      // Records the time step a code of record 'index' matched, at 'offset' steps from the current one,
+      // and returns true if it was accepted before or cannot be recorded.
+      bool replayed(qsizetype index, int offset, quint64 now)
+      {
+         const std::optional<libqotp::KeyStoreRecord> record = m_store.record(index);
+         if (!record || record->period == 0 || now < record->epoch)
+         {
+            return true;
+         }
+
+         const quint64 step = (now - record->epoch) / record->period + quint64(qint64(offset));
+         const quint64 start = record->epoch + step * record->period;
+         return m_replay.accept(quint64(index), start, now) != libqotp::ReplayResult::Accepted;
+      }
+
+   private:
+      static unsigned int longest_period(const libqotp::KeyStore &store)
+      {
+         unsigned int longest = 1;
+         for (qsizetype index = 0; index < store.size(); ++index)
+         {
+            if (const std::optional<libqotp::KeyStoreRecord> record = store.record(index))
+            {
+               longest = std::max(longest, record->period);
+            }
+         }
+         return longest;
+      }
+
+      const libqotp::KeyStore &m_store;
+      libqotp::ReplayStore m_replay;
+   };
+}
+
+#endif